@@ -0,0 +1,36 @@
+dnl -*- shell-script -*-
+dnl
+dnl Copyright (c) 2020      The University of Tennessee and The University
+dnl                         of Tennessee Research Foundation.  All rights
+dnl                         reserved.
+dnl $COPYRIGHT$
+dnl
+dnl Additional copyrights may follow
+dnl
+dnl $HEADER$
+dnl
+
+# OPAL_CHECK_IO_URING
+# -------------------
+# io_uring is driven through the raw system calls by opal/util/uring.c,
+# so only the kernel headers are needed. Defines OPAL_HAVE_IO_URING to 1
+# if they provide what opal/util/uring.c and the vectored reads and
+# writes need. Users of newer features (e.g. the registered buffers of
+# btl/tcp) check for them in their own configure.m4.
+AC_DEFUN([OPAL_CHECK_IO_URING],[
+    AC_CACHE_CHECK([for io_uring support in the kernel headers],
+                   [opal_cv_have_io_uring],
+                   [AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[#include <sys/syscall.h>
+#include <linux/io_uring.h>]],
+                                                       [[struct io_uring_params params = { .flags = IORING_SETUP_SQPOLL };
+int ops[] = { __NR_io_uring_setup, __NR_io_uring_enter, __NR_io_uring_register,
+              IORING_OP_READV, IORING_OP_WRITEV, IORING_FEAT_SINGLE_MMAP,
+              IORING_SQ_NEED_WAKEUP, IORING_SQ_CQ_OVERFLOW, IORING_ENTER_SQ_WAKEUP };
+(void) params; (void) ops;]])],
+                                      [opal_cv_have_io_uring=yes],
+                                      [opal_cv_have_io_uring=no])])
+    AS_IF([test "$opal_cv_have_io_uring" = "yes"],
+          [opal_have_io_uring=1], [opal_have_io_uring=0])
+    AC_DEFINE_UNQUOTED([OPAL_HAVE_IO_URING], [$opal_have_io_uring],
+                       [Whether io_uring can be used through opal/util/uring.h])
+])dnl
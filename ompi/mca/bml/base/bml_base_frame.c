@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -52,8 +52,44 @@ opal_rng_buff_t mca_bml_base_rand_buff;
 
 opal_mutex_t mca_bml_lock = OPAL_MUTEX_STATIC_INIT;
 
+bool mca_bml_base_adaptive_striping = false;
+unsigned int mca_bml_base_adaptive_window = 1000;
+double mca_bml_base_adaptive_decay = 0.25;
+
 static int mca_bml_base_register(mca_base_register_flag_t flags)
 {
+    mca_bml_base_adaptive_striping = false;
+    (void) mca_base_var_register("ompi", "bml", "base", "adaptive_striping",
+                                 "Schedule the fragments of large messages on the BTL of a peer expected to "
+                                 "complete them first, based on the throughput measured on each BTL and on the "
+                                 "amount of data already queued on it, instead of splitting the message "
+                                 "according to the static BTL bandwidths (default: false)",
+                                 MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                 OPAL_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_READONLY,
+                                 &mca_bml_base_adaptive_striping);
+
+    mca_bml_base_adaptive_window = 1000;
+    (void) mca_base_var_register("ompi", "bml", "base", "adaptive_window",
+                                 "Time (in microseconds) a BTL must have been busy sending before its "
+                                 "throughput estimate is updated (default: 1000)",
+                                 MCA_BASE_VAR_TYPE_UNSIGNED_INT, NULL, 0, 0,
+                                 OPAL_INFO_LVL_6,
+                                 MCA_BASE_VAR_SCOPE_READONLY,
+                                 &mca_bml_base_adaptive_window);
+
+    mca_bml_base_adaptive_decay = 0.25;
+    (void) mca_base_var_register("ompi", "bml", "base", "adaptive_decay",
+                                 "Weight of the last measurement in the throughput estimate of a BTL, "
+                                 "between 0 (never updated) and 1 (last measurement only) (default: 0.25)",
+                                 MCA_BASE_VAR_TYPE_DOUBLE, NULL, 0, 0,
+                                 OPAL_INFO_LVL_6,
+                                 MCA_BASE_VAR_SCOPE_READONLY,
+                                 &mca_bml_base_adaptive_decay);
+    if (mca_bml_base_adaptive_decay < 0.0 || mca_bml_base_adaptive_decay > 1.0) {
+        mca_bml_base_adaptive_decay = 0.25;
+    }
+
 #if OPAL_ENABLE_DEBUG_RELIABILITY
     do {
         int var_id;
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2009 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -35,6 +35,7 @@
 #include "opal/mca/crs/crs.h"
 #include "opal/mca/crs/base/base.h"
 #include "opal/mca/btl/btl.h"
+#include "opal/mca/timer/base/base.h"
 
 #include "ompi/mca/bml/base/bml_base_btl.h"
 #include "ompi/types.h"
@@ -61,9 +62,100 @@ struct mca_bml_base_btl_t {
     float     btl_weight;                            /**< BTL weight for scheduling */
     struct    mca_btl_base_module_t *btl;            /**< BTL module */
     struct    mca_btl_base_endpoint_t* btl_endpoint; /**< BTL addressing info */
+    /* adaptive striping */
+    opal_atomic_int64_t btl_inflight;                /**< bytes handed to the BTL and not completed yet */
+    opal_atomic_int64_t btl_window_bytes;            /**< bytes completed in the current window */
+    opal_timer_t btl_window_busy;                    /**< usecs with bytes in flight in the current window */
+    opal_timer_t btl_last_event;                     /**< time of the last send or completion */
+    double    btl_rate;                              /**< estimated throughput (bytes/usec) */
 };
 typedef struct mca_bml_base_btl_t mca_bml_base_btl_t;
 
+/**
+ * Adaptive striping.
+ *
+ * When enabled, the PML reports the bytes it hands to each BTL of an
+ * endpoint and their completion. The BML derives from them the
+ * throughput each BTL sustains while it has data in flight, and the
+ * PML sends each fragment of a large message on the BTL expected to
+ * complete it first, given the bytes already queued on it. A loaded
+ * or slower rail thus gets less data, instead of the static share
+ * computed from btl_bandwidth.
+ */
+OMPI_DECLSPEC extern bool mca_bml_base_adaptive_striping;
+/** Length (in usecs of activity) of a throughput measurement window */
+OMPI_DECLSPEC extern unsigned int mca_bml_base_adaptive_window;
+/** Weight of the last window in the throughput estimate */
+OMPI_DECLSPEC extern double mca_bml_base_adaptive_decay;
+
+static inline void mca_bml_base_btl_adaptive_init (mca_bml_base_btl_t *bml_btl)
+{
+    bml_btl->btl_inflight = 0;
+    bml_btl->btl_window_bytes = 0;
+    bml_btl->btl_window_busy = 0;
+    bml_btl->btl_last_event = 0;
+    /* start from the advertised bandwidth (Mbps) */
+    bml_btl->btl_rate = bml_btl->btl->btl_bandwidth > 0 ? bml_btl->btl->btl_bandwidth / 8.0 : 1.0;
+}
+
+/* Account the time elapsed since the last event as busy if there were
+ * bytes in flight. Concurrent events may lose some of it, the estimate
+ * is only used as a hint. */
+static inline void mca_bml_base_btl_adaptive_event (mca_bml_base_btl_t *bml_btl)
+{
+    opal_timer_t now = opal_timer_base_get_usec ();
+
+    if (bml_btl->btl_inflight > 0 && bml_btl->btl_last_event) {
+        bml_btl->btl_window_busy += now - bml_btl->btl_last_event;
+    }
+    bml_btl->btl_last_event = now;
+}
+
+/**
+ * Account bytes handed to a BTL. Must be called before the send, as
+ * the completion can be reported before the send returns.
+ */
+static inline void mca_bml_base_btl_sent (mca_bml_base_btl_t *bml_btl, size_t size)
+{
+    if (mca_bml_base_adaptive_striping) {
+        mca_bml_base_btl_adaptive_event (bml_btl);
+        OPAL_THREAD_ADD_FETCH64(&bml_btl->btl_inflight, (int64_t) size);
+    }
+}
+
+/** Account bytes completed by a BTL, or not sent after all (failure) */
+static inline void mca_bml_base_btl_completed (mca_bml_base_btl_t *bml_btl, size_t size, bool failed)
+{
+    if (!mca_bml_base_adaptive_striping) {
+        return;
+    }
+
+    mca_bml_base_btl_adaptive_event (bml_btl);
+    OPAL_THREAD_ADD_FETCH64(&bml_btl->btl_inflight, -(int64_t) size);
+    if (failed) {
+        return;
+    }
+
+    OPAL_THREAD_ADD_FETCH64(&bml_btl->btl_window_bytes, (int64_t) size);
+    if (bml_btl->btl_window_busy >= mca_bml_base_adaptive_window) {
+        double rate = (double) bml_btl->btl_window_bytes / (double) bml_btl->btl_window_busy;
+
+        bml_btl->btl_rate = mca_bml_base_adaptive_decay * rate +
+            (1.0 - mca_bml_base_adaptive_decay) * bml_btl->btl_rate;
+        bml_btl->btl_window_bytes = 0;
+        bml_btl->btl_window_busy = 0;
+    }
+}
+
+/**
+ * Expected time for a BTL to complete size bytes after the ones it
+ * already has in flight.
+ */
+static inline double mca_bml_base_btl_completion_time (const mca_bml_base_btl_t *bml_btl, size_t size)
+{
+    return (double) (bml_btl->btl_inflight + (int64_t) size) / bml_btl->btl_rate;
+}
+
 
 
 /**
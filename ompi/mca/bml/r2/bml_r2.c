@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -332,6 +332,8 @@ static void mca_bml_r2_compute_endpoint_metrics (mca_bml_base_endpoint_t *bml_en
         } else {
             bml_btl->btl_weight = (float)(1.0 / n_send);
         }
+        /* the adaptive striping starts from the same estimate */
+        mca_bml_base_btl_adaptive_init (bml_btl);
 
         /* check to see if this r2 is already in the array of r2s
          * used for first fragments - if not add it.
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2017 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -1243,3 +1243,471 @@ int ompi_coll_base_allreduce_intra_redscat_allgather(
 }
 
 /* copied function (with appropriate renaming) ends here */
+
+/*
+ * ompi_coll_base_allreduce_intra_redscat_allgather_kary
+ *
+ * Function:  Allreduce as a k-ary Bruck reduce-scatter and allgather
+ * Accepts:   Same as MPI_Allreduce(), plus the radix k of the exchanges
+ * Returns:   MPI_SUCCESS or error code
+ *
+ * Description: same reduce-scatter + allgather scheme as
+ *              ompi_coll_base_allreduce_intra_redscat_allgather, but both
+ *              phases use the k-port Bruck (dissemination) pattern instead
+ *              of recursive halving and doubling. The vector is split into
+ *              p blocks and every process works on a copy rotated by its
+ *              rank, so that the block it ends up owning comes first.
+ *
+ *              Reduce-scatter: for d = k^s, s = \ceil{\log_k p} - 1 down
+ *              to 0, a process holds partial results for its first
+ *              min(kd, p) rotated blocks. For i = 1 .. k - 1 it sends the
+ *              blocks [id, id + min(d, p - id)) to rank + id and reduces
+ *              the blocks coming from rank - id into its first blocks.
+ *              After the last step the first block is fully reduced.
+ *
+ *              Allgather: the exact reverse. For d = 1, k, k^2, ... a
+ *              process sends its first min(d, p - id) blocks to rank - id
+ *              and receives those of rank + id right after its first id
+ *              blocks.
+ *
+ *              There is no folding step for non-power-of-two process
+ *              counts: each phase takes \ceil{\log_k p} rounds for any p
+ *              and moves (p - 1) / p of the vector per process, whereas
+ *              Rabenseifner's algorithm exchanges extra halves and the
+ *              whole vector with the r = p - 2^{\floor{\log_2 p}} excluded
+ *              processes. A larger radix shortens the critical path at the
+ *              cost of k - 1 concurrent messages per round; the volume
+ *              does not change.
+ *
+ * Limitations:
+ *   count >= p
+ *   commutative operations only
+ *   intra-communicators only
+ *
+ * Memory requirements (per process):
+ *   2 * count * typesize + (p + 1) * sizeof(int)
+ */
+int ompi_coll_base_allreduce_intra_redscat_allgather_kary(
+    const void *sbuf, void *rbuf, int count, struct ompi_datatype_t *dtype,
+    struct ompi_op_t *op, struct ompi_communicator_t *comm,
+    mca_coll_base_module_t *module, int radix)
+{
+    int *roff = NULL;
+    ompi_request_t **reqs = NULL;
+    int nreqs = 0;
+
+    int comm_size = ompi_comm_size(comm);
+    int rank = ompi_comm_rank(comm);
+    OPAL_OUTPUT((ompi_coll_base_framework.framework_output,
+                 "coll:base:allreduce_intra_redscat_allgather_kary: rank %d/%d radix %d",
+                 rank, comm_size, radix));
+
+    if (1 == comm_size) {
+        if (MPI_IN_PLACE != sbuf) {
+            return ompi_datatype_copy_content_same_ddt(dtype, count, (char *)rbuf,
+                                                       (char *)sbuf);
+        }
+        return MPI_SUCCESS;
+    }
+
+    if (count < comm_size || !ompi_op_is_commute(op)) {
+        OPAL_OUTPUT((ompi_coll_base_framework.framework_output,
+                     "coll:base:allreduce_intra_redscat_allgather_kary: rank %d/%d "
+                     "count %d switching to recursive doubling allreduce",
+                     rank, comm_size, count));
+        return ompi_coll_base_allreduce_intra_recursivedoubling(sbuf, rbuf, count, dtype,
+                                                                op, comm, module);
+    }
+
+    if (radix < 2) radix = 2;
+    if (radix > comm_size) radix = comm_size;
+
+    int err = MPI_SUCCESS;
+    ptrdiff_t lb, extent, dsize, gap = 0;
+    ompi_datatype_get_extent(dtype, &lb, &extent);
+    dsize = opal_datatype_span(&dtype->super, count, &gap);
+
+    /*
+     * roff[j] is the offset of the j-th block of the rotated vector, that is
+     * of block (rank + j) % p of the user vector. Blocks are balanced as in
+     * COLL_BASE_COMPUTE_BLOCKCOUNT.
+     */
+    roff = malloc(sizeof(*roff) * (comm_size + 1));
+    if (NULL == roff)
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    int block_count = count / comm_size, split_rank = count % comm_size;
+    roff[0] = 0;
+    for (int j = 0; j < comm_size; j++) {
+        roff[j + 1] = roff[j] + block_count +
+            (((rank + j) % comm_size < split_rank) ? 1 : 0);
+    }
+    /* Offset of our own block in the user vector */
+    int first = rank * block_count + ((rank < split_rank) ? rank : split_rank);
+
+    /*
+     * Largest distance d = k^s < p, and the most elements received in one
+     * round of the reduce-scatter.
+     */
+    int dmax = 1, rmax = 0;
+    while (dmax * radix < comm_size)
+        dmax *= radix;
+    for (int d = dmax; d > 0; d /= radix) {
+        int n = 0;
+        for (int i = 1; i < radix && i * d < comm_size; i++) {
+            n += roff[(d < comm_size - i * d) ? d : comm_size - i * d];
+        }
+        if (n > rmax) rmax = n;
+    }
+
+    char *tmp_buf = NULL, *recv_buf = NULL;
+    char *tmp_buf_raw = (char *)malloc(dsize);
+    ptrdiff_t rgap = 0, rsize = opal_datatype_span(&dtype->super, rmax, &rgap);
+    char *recv_buf_raw = (char *)malloc(rsize);
+    if (NULL == tmp_buf_raw || NULL == recv_buf_raw) {
+        err = OMPI_ERR_OUT_OF_RESOURCE;
+        goto cleanup_and_return;
+    }
+    tmp_buf = tmp_buf_raw - gap;
+    recv_buf = recv_buf_raw - rgap;
+
+    reqs = ompi_coll_base_comm_get_reqs(module->base_data, 2 * (radix - 1));
+    if (NULL == reqs) {
+        err = OMPI_ERR_OUT_OF_RESOURCE;
+        goto cleanup_and_return;
+    }
+
+    /* Rotate the input so that our own block comes first */
+    const char *src = (MPI_IN_PLACE == sbuf) ? (char *)rbuf : (char *)sbuf;
+    err = ompi_datatype_copy_content_same_ddt(dtype, count - first, tmp_buf,
+                                              (char *)src + (ptrdiff_t)first * extent);
+    if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+    err = ompi_datatype_copy_content_same_ddt(dtype, first,
+                                              tmp_buf + (ptrdiff_t)(count - first) * extent,
+                                              (char *)src);
+    if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+
+    /*
+     * Step 1. Reduce-scatter. The blocks we send to rank + id are those that
+     * rank + id holds first, and the blocks coming from rank - id are our
+     * first ones, so every message is contiguous in the rotated vector.
+     */
+    for (int d = dmax; d > 0; d /= radix) {
+        char *rptr = recv_buf;
+        nreqs = 0;
+        for (int i = 1; i < radix && i * d < comm_size; i++) {
+            int nblocks = (d < comm_size - i * d) ? d : comm_size - i * d;
+            err = MCA_PML_CALL(irecv(rptr, roff[nblocks], dtype,
+                                     (rank - i * d + comm_size) % comm_size,
+                                     MCA_COLL_BASE_TAG_ALLREDUCE, comm,
+                                     &reqs[nreqs++]));
+            if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+            err = MCA_PML_CALL(isend(tmp_buf + (ptrdiff_t)roff[i * d] * extent,
+                                     roff[i * d + nblocks] - roff[i * d], dtype,
+                                     (rank + i * d) % comm_size,
+                                     MCA_COLL_BASE_TAG_ALLREDUCE,
+                                     MCA_PML_BASE_SEND_STANDARD, comm,
+                                     &reqs[nreqs++]));
+            if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+            rptr += (ptrdiff_t)roff[nblocks] * extent;
+        }
+        err = ompi_request_wait_all(nreqs, reqs, MPI_STATUSES_IGNORE);
+        if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+
+        /* Local reduce: tmp_buf[] = recv_buf[] <op> tmp_buf[] */
+        rptr = recv_buf;
+        for (int i = 1; i < radix && i * d < comm_size; i++) {
+            int nblocks = (d < comm_size - i * d) ? d : comm_size - i * d;
+            ompi_op_reduce(op, rptr, tmp_buf, roff[nblocks], dtype);
+            rptr += (ptrdiff_t)roff[nblocks] * extent;
+        }
+    }
+
+    /*
+     * Step 2. Allgather, with the exchanges of step 1 reversed. Received
+     * blocks land directly after the ones we already have.
+     */
+    for (int d = 1; d < comm_size; d *= radix) {
+        nreqs = 0;
+        for (int i = 1; i < radix && i * d < comm_size; i++) {
+            int nblocks = (d < comm_size - i * d) ? d : comm_size - i * d;
+            err = MCA_PML_CALL(irecv(tmp_buf + (ptrdiff_t)roff[i * d] * extent,
+                                     roff[i * d + nblocks] - roff[i * d], dtype,
+                                     (rank + i * d) % comm_size,
+                                     MCA_COLL_BASE_TAG_ALLREDUCE, comm,
+                                     &reqs[nreqs++]));
+            if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+            err = MCA_PML_CALL(isend(tmp_buf, roff[nblocks], dtype,
+                                     (rank - i * d + comm_size) % comm_size,
+                                     MCA_COLL_BASE_TAG_ALLREDUCE,
+                                     MCA_PML_BASE_SEND_STANDARD, comm,
+                                     &reqs[nreqs++]));
+            if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+        }
+        err = ompi_request_wait_all(nreqs, reqs, MPI_STATUSES_IGNORE);
+        if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+    }
+    nreqs = 0;
+
+    /* Rotate the result back into rbuf */
+    err = ompi_datatype_copy_content_same_ddt(dtype, count - first,
+                                              (char *)rbuf + (ptrdiff_t)first * extent,
+                                              tmp_buf);
+    if (MPI_SUCCESS != err) { goto cleanup_and_return; }
+    err = ompi_datatype_copy_content_same_ddt(dtype, first, (char *)rbuf,
+                                              tmp_buf + (ptrdiff_t)(count - first) * extent);
+
+  cleanup_and_return:
+    if (MPI_SUCCESS != err && NULL != reqs)
+        ompi_coll_base_free_reqs(reqs, nreqs);
+    if (NULL != tmp_buf_raw)
+        free(tmp_buf_raw);
+    if (NULL != recv_buf_raw)
+        free(recv_buf_raw);
+    free(roff);
+    return err;
+}
+
+/* Number of elements in segment seg of a vector cut in segcount-sized pieces */
+static inline int
+allreduce_tree_segment_count(int seg, int num_segments, int segcount, int count)
+{
+    return (seg == num_segments - 1) ? count - seg * segcount : segcount;
+}
+
+/* Send a reduced segment to all children, once the previous one is gone */
+static int
+allreduce_tree_forward(char *buf, int scount, struct ompi_datatype_t *dtype,
+                       ompi_coll_tree_t *tree, ompi_request_t **send_reqs,
+                       struct ompi_communicator_t *comm)
+{
+    int err;
+
+    if (0 == tree->tree_nextsize) {
+        return MPI_SUCCESS;
+    }
+    err = ompi_request_wait_all(tree->tree_nextsize, send_reqs, MPI_STATUSES_IGNORE);
+    if (MPI_SUCCESS != err) {
+        return err;
+    }
+    for (int i = 0; i < tree->tree_nextsize; i++) {
+        err = MCA_PML_CALL(isend(buf, scount, dtype, tree->tree_next[i],
+                                 MCA_COLL_BASE_TAG_ALLREDUCE,
+                                 MCA_PML_BASE_SEND_STANDARD, comm, &send_reqs[i]));
+        if (MPI_SUCCESS != err) {
+            return err;
+        }
+    }
+    return MPI_SUCCESS;
+}
+
+/*
+ * ompi_coll_base_allreduce_intra_segmented_tree
+ *
+ * Function:  Pipelined reduce and broadcast over one n-ary tree
+ * Accepts:   Same as MPI_Allreduce(), plus segment size and tree fanout
+ * Returns:   MPI_SUCCESS or error code
+ *
+ * Description: the vector is cut into segments of about segsize bytes that
+ *              travel up a fanout-ary tree rooted at rank 0, reduced at
+ *              every level, and back down the same tree as soon as the root
+ *              holds their total. Unlike the nonoverlapping algorithm, the
+ *              broadcast of the first segments overlaps the reduction of
+ *              the later ones, so the cost is close to nseg + 2 * depth
+ *              segment steps instead of 2 * (nseg + depth). This targets
+ *              medium vectors on large communicators, too long for
+ *              recursive doubling and too short to amortize the 2(p - 1)
+ *              rounds of the ring.
+ *
+ *              Every process keeps two receive segments per child, so the
+ *              children can send segment s + 1 while segment s is reduced.
+ *              Once a segment has been sent to the parent, the reduced
+ *              segment is received in place in rbuf and forwarded to the
+ *              children as soon as it has arrived.
+ *
+ * Limitations:
+ *   commutative operations only
+ *
+ * Memory requirements (per process):
+ *   2 * fanout * segsize + nseg * sizeof(ompi_request_t *)
+ */
+int ompi_coll_base_allreduce_intra_segmented_tree(
+    const void *sbuf, void *rbuf, int count, struct ompi_datatype_t *dtype,
+    struct ompi_op_t *op, struct ompi_communicator_t *comm,
+    mca_coll_base_module_t *module, uint32_t segsize, int fanout)
+{
+    int ret = MPI_SUCCESS, line, rank, size, segcount, num_segments = 0;
+    int nchildren = 0, next_down = 0;
+    size_t typelng;
+    ptrdiff_t lb, extent, gap, real_segsize;
+    char *inbuf_raw = NULL, *inbuf = NULL, *rptr;
+    ompi_request_t **reqs = NULL, **child_reqs = NULL, **send_reqs = NULL;
+    ompi_request_t **down_reqs = NULL;
+    ompi_coll_tree_t *tree;
+
+    size = ompi_comm_size(comm);
+    rank = ompi_comm_rank(comm);
+
+    OPAL_OUTPUT((ompi_coll_base_framework.framework_output,
+                 "coll:base:allreduce_intra_segmented_tree rank %d, count %d, segsize %u, fanout %d",
+                 rank, count, segsize, fanout));
+
+    if (1 == size || 0 == count) {
+        if (MPI_IN_PLACE != sbuf) {
+            return ompi_datatype_copy_content_same_ddt(dtype, count, (char*)rbuf, (char*)sbuf);
+        }
+        return MPI_SUCCESS;
+    }
+
+    if (!ompi_op_is_commute(op)) {
+        OPAL_OUTPUT((ompi_coll_base_framework.framework_output,
+                     "coll:base:allreduce_intra_segmented_tree rank %d/%d, "
+                     "switching to nonoverlapping allreduce", rank, size));
+        return ompi_coll_base_allreduce_intra_nonoverlapping(sbuf, rbuf, count, dtype,
+                                                             op, comm, module);
+    }
+
+    if (fanout < 1) fanout = 2;
+    if (fanout > MAXTREEFANOUT) fanout = MAXTREEFANOUT;
+    COLL_BASE_UPDATE_TREE(comm, module, 0, fanout);
+    tree = module->base_data->cached_ntree;
+    if (NULL == tree) { ret = OMPI_ERR_OUT_OF_RESOURCE; line = __LINE__; goto error_hndl; }
+    nchildren = tree->tree_nextsize;
+
+    /* Determine segment count based on the suggested segment size */
+    ret = ompi_datatype_type_size(dtype, &typelng);
+    if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+    ret = ompi_datatype_get_extent(dtype, &lb, &extent);
+    if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+    segcount = count;
+    COLL_BASE_COMPUTED_SEGCOUNT(segsize, typelng, segcount)
+    num_segments = (count + segcount - 1) / segcount;
+    real_segsize = opal_datatype_span(&dtype->super, segcount, &gap);
+
+    /* Handle MPI_IN_PLACE */
+    if (MPI_IN_PLACE != sbuf) {
+        ret = ompi_datatype_copy_content_same_ddt(dtype, count, (char*)rbuf, (char*)sbuf);
+        if (ret < 0) { line = __LINE__; goto error_hndl; }
+    }
+
+    if (nchildren > 0) {
+        inbuf_raw = (char*)malloc(2 * nchildren * real_segsize);
+        if (NULL == inbuf_raw) { ret = OMPI_ERR_OUT_OF_RESOURCE; line = __LINE__; goto error_hndl; }
+        inbuf = inbuf_raw - gap;
+
+        /* Two receive slots per child, then the sends to the children */
+        reqs = ompi_coll_base_comm_get_reqs(module->base_data, 3 * nchildren);
+        if (NULL == reqs) { ret = OMPI_ERR_OUT_OF_RESOURCE; line = __LINE__; goto error_hndl; }
+        child_reqs = reqs;
+        send_reqs = reqs + 2 * nchildren;
+
+        for (int s = 0; s < 2 && s < num_segments; s++) {
+            for (int c = 0; c < nchildren; c++) {
+                ret = MCA_PML_CALL(irecv(inbuf + (ptrdiff_t)(s * nchildren + c) * real_segsize,
+                                         allreduce_tree_segment_count(s, num_segments, segcount, count),
+                                         dtype, tree->tree_next[c],
+                                         MCA_COLL_BASE_TAG_ALLREDUCE, comm,
+                                         &child_reqs[s * nchildren + c]));
+                if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+            }
+        }
+    }
+
+    if (rank != tree->tree_root) {
+        down_reqs = (ompi_request_t**)malloc(num_segments * sizeof(ompi_request_t*));
+        if (NULL == down_reqs) { ret = OMPI_ERR_OUT_OF_RESOURCE; line = __LINE__; goto error_hndl; }
+        for (int s = 0; s < num_segments; s++) {
+            down_reqs[s] = MPI_REQUEST_NULL;
+        }
+    }
+
+    for (int s = 0; s < num_segments; s++) {
+        int slot = s & 0x1;
+        int scount = allreduce_tree_segment_count(s, num_segments, segcount, count);
+        rptr = (char*)rbuf + (ptrdiff_t)s * segcount * extent;
+
+        /* Reduce the contributions of the children, and refill the slot */
+        if (nchildren > 0) {
+            ret = ompi_request_wait_all(nchildren, child_reqs + slot * nchildren,
+                                        MPI_STATUSES_IGNORE);
+            if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+            for (int c = 0; c < nchildren; c++) {
+                ompi_op_reduce(op, inbuf + (ptrdiff_t)(slot * nchildren + c) * real_segsize,
+                               rptr, scount, dtype);
+            }
+            if (s + 2 < num_segments) {
+                for (int c = 0; c < nchildren; c++) {
+                    ret = MCA_PML_CALL(irecv(inbuf + (ptrdiff_t)(slot * nchildren + c) * real_segsize,
+                                             allreduce_tree_segment_count(s + 2, num_segments, segcount, count),
+                                             dtype, tree->tree_next[c],
+                                             MCA_COLL_BASE_TAG_ALLREDUCE, comm,
+                                             &child_reqs[slot * nchildren + c]));
+                    if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+                }
+            }
+        }
+
+        if (rank == tree->tree_root) {
+            /* The segment is complete, start sending it down */
+            ret = allreduce_tree_forward(rptr, scount, dtype, tree, send_reqs, comm);
+            if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+            continue;
+        }
+
+        /* Send the partial result up and get the total back in its place */
+        ret = MCA_PML_CALL(send(rptr, scount, dtype, tree->tree_prev,
+                                MCA_COLL_BASE_TAG_ALLREDUCE,
+                                MCA_PML_BASE_SEND_STANDARD, comm));
+        if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+        ret = MCA_PML_CALL(irecv(rptr, scount, dtype, tree->tree_prev,
+                                 MCA_COLL_BASE_TAG_ALLREDUCE, comm, &down_reqs[s]));
+        if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+
+        /* Forward the reduced segments that already came back */
+        while (next_down <= s) {
+            int done;
+            ret = ompi_request_test(&down_reqs[next_down], &done, MPI_STATUS_IGNORE);
+            if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+            if (!done) break;
+            ret = allreduce_tree_forward((char*)rbuf + (ptrdiff_t)next_down * segcount * extent,
+                                         allreduce_tree_segment_count(next_down, num_segments,
+                                                                      segcount, count),
+                                         dtype, tree, send_reqs, comm);
+            if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+            next_down++;
+        }
+    }
+
+    /* Drain the segments still on their way down */
+    if (rank != tree->tree_root) {
+        for ( ; next_down < num_segments; next_down++) {
+            ret = ompi_request_wait(&down_reqs[next_down], MPI_STATUS_IGNORE);
+            if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+            ret = allreduce_tree_forward((char*)rbuf + (ptrdiff_t)next_down * segcount * extent,
+                                         allreduce_tree_segment_count(next_down, num_segments,
+                                                                      segcount, count),
+                                         dtype, tree, send_reqs, comm);
+            if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+        }
+    }
+    if (nchildren > 0) {
+        ret = ompi_request_wait_all(nchildren, send_reqs, MPI_STATUSES_IGNORE);
+        if (MPI_SUCCESS != ret) { line = __LINE__; goto error_hndl; }
+    }
+
+    if (NULL != down_reqs) free(down_reqs);
+    if (NULL != inbuf_raw) free(inbuf_raw);
+
+    return MPI_SUCCESS;
+
+ error_hndl:
+    OPAL_OUTPUT((ompi_coll_base_framework.framework_output, "%s:%4d\tRank %d Error occurred %d\n",
+                 __FILE__, line, rank, ret));
+    (void)line;  // silence compiler warning
+    if (NULL != reqs) ompi_coll_base_free_reqs(reqs, 3 * nchildren);
+    if (NULL != down_reqs) {
+        ompi_coll_base_free_reqs(down_reqs, num_segments);
+        free(down_reqs);
+    }
+    if (NULL != inbuf_raw) free(inbuf_raw);
+    return ret;
+}
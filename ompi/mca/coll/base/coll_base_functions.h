@@ -207,6 +207,8 @@ int ompi_coll_base_allreduce_intra_ring(ALLREDUCE_ARGS);
 int ompi_coll_base_allreduce_intra_ring_segmented(ALLREDUCE_ARGS, uint32_t segsize);
 int ompi_coll_base_allreduce_intra_basic_linear(ALLREDUCE_ARGS);
 int ompi_coll_base_allreduce_intra_redscat_allgather(ALLREDUCE_ARGS);
+int ompi_coll_base_allreduce_intra_redscat_allgather_kary(ALLREDUCE_ARGS, int radix);
+int ompi_coll_base_allreduce_intra_segmented_tree(ALLREDUCE_ARGS, uint32_t segsize, int fanout);
 
 /* AlltoAll */
 int ompi_coll_base_alltoall_intra_pairwise(ALLTOALL_ARGS);
@@ -301,6 +303,21 @@ int mca_coll_base_reduce_local(const void *inbuf, void *inoutbuf, int count,
 
 END_C_DECLS
 
+#define COLL_BASE_UPDATE_TREE( OMPI_COMM, BASE_MODULE, ROOT, FANOUT )	\
+do {                                                                                       \
+    mca_coll_base_comm_t* coll_comm = (BASE_MODULE)->base_data;                        \
+    if( !( (coll_comm->cached_ntree)                                                       \
+           && (coll_comm->cached_ntree_root == (ROOT))                                     \
+           && (coll_comm->cached_ntree_fanout == (FANOUT)) ) ) {                           \
+        if( coll_comm->cached_ntree ) { /* destroy previous n-ary tree if defined */       \
+            ompi_coll_base_topo_destroy_tree( &(coll_comm->cached_ntree) );               \
+        }                                                                                  \
+        coll_comm->cached_ntree = ompi_coll_base_topo_build_tree((FANOUT),(OMPI_COMM),(ROOT)); \
+        coll_comm->cached_ntree_root = (ROOT);                                             \
+        coll_comm->cached_ntree_fanout = (FANOUT);                                         \
+    }                                                                                      \
+} while (0)
+
 #define COLL_BASE_UPDATE_BINTREE( OMPI_COMM, BASE_MODULE, ROOT )	\
 do {                                                                                       \
     mca_coll_base_comm_t* coll_comm = (BASE_MODULE)->base_data;                        \
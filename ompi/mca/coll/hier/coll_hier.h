@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file
+ *
+ * Hierarchical (node-aware) collectives.
+ *
+ * The communicator is split into a node-local communicator (all the
+ * processes sharing a node, obtained with MPI_COMM_TYPE_SHARED) and a
+ * leader communicator (the lowest rank of each node).  Each collective
+ * is then composed of intra-node phases, executed on the node-local
+ * communicator, and of an inter-node phase executed among the leaders.
+ * The sub-communicators are regular communicators, so each phase uses
+ * whatever collective module the coll framework selected for them
+ * (typically coll/sm on the node-local communicator when it is enabled,
+ * and coll/tuned on the leader communicator).
+ *
+ * Everything is set up lazily, on the first collective call on the
+ * communicator: the decision to use the hierarchy requires a global
+ * view of the process placement, which requires communication.
+ * Communicators spanning a single node, or with a single process per
+ * node (such as the sub-communicators themselves), permanently fall
+ * back to the previously selected module.
+ */
+
+#ifndef MCA_COLL_HIER_EXPORT_H
+#define MCA_COLL_HIER_EXPORT_H
+
+#include "ompi_config.h"
+
+#include "mpi.h"
+
+#include "opal/class/opal_object.h"
+#include "opal/mca/mca.h"
+#include "opal/util/output.h"
+
+#include "ompi/constants.h"
+#include "ompi/mca/coll/coll.h"
+#include "ompi/mca/coll/base/base.h"
+#include "ompi/communicator/communicator.h"
+
+BEGIN_C_DECLS
+
+/* API functions */
+
+int mca_coll_hier_init_query(bool enable_progress_threads,
+                             bool enable_mpi_threads);
+mca_coll_base_module_t
+*mca_coll_hier_comm_query(struct ompi_communicator_t *comm,
+                          int *priority);
+
+int mca_coll_hier_module_enable(mca_coll_base_module_t *module,
+                                struct ompi_communicator_t *comm);
+
+int mca_coll_hier_allgather(const void *sbuf, int scount,
+                            struct ompi_datatype_t *sdtype,
+                            void *rbuf, int rcount,
+                            struct ompi_datatype_t *rdtype,
+                            struct ompi_communicator_t *comm,
+                            mca_coll_base_module_t *module);
+
+int mca_coll_hier_allreduce(const void *sbuf, void *rbuf, int count,
+                            struct ompi_datatype_t *dtype,
+                            struct ompi_op_t *op,
+                            struct ompi_communicator_t *comm,
+                            mca_coll_base_module_t *module);
+
+int mca_coll_hier_barrier(struct ompi_communicator_t *comm,
+                          mca_coll_base_module_t *module);
+
+int mca_coll_hier_bcast(void *buff, int count,
+                        struct ompi_datatype_t *datatype,
+                        int root,
+                        struct ompi_communicator_t *comm,
+                        mca_coll_base_module_t *module);
+
+int mca_coll_hier_gather(const void *sbuf, int scount,
+                         struct ompi_datatype_t *sdtype,
+                         void *rbuf, int rcount,
+                         struct ompi_datatype_t *rdtype,
+                         int root,
+                         struct ompi_communicator_t *comm,
+                         mca_coll_base_module_t *module);
+
+int mca_coll_hier_reduce(const void *sbuf, void *rbuf, int count,
+                         struct ompi_datatype_t *dtype,
+                         struct ompi_op_t *op,
+                         int root,
+                         struct ompi_communicator_t *comm,
+                         mca_coll_base_module_t *module);
+
+int mca_coll_hier_scatter(const void *sbuf, int scount,
+                          struct ompi_datatype_t *sdtype,
+                          void *rbuf, int rcount,
+                          struct ompi_datatype_t *rdtype,
+                          int root,
+                          struct ompi_communicator_t *comm,
+                          mca_coll_base_module_t *module);
+
+/* Types */
+
+/**
+ * State of the hierarchy on a given communicator
+ */
+typedef enum {
+    /** Not decided yet: the first collective will find out */
+    MCA_COLL_HIER_UNKNOWN = 0,
+    /** The communicator spans several nodes, with at least one node
+        hosting several processes: use the hierarchy */
+    MCA_COLL_HIER_ENABLED,
+    /** No benefit to expect (or setup failure): always use the
+        previously selected module */
+    MCA_COLL_HIER_DISABLED
+} mca_coll_hier_state_t;
+
+/* Module */
+
+typedef struct mca_coll_hier_module_t {
+    mca_coll_base_module_t super;
+
+    /** Pointers to the collective functions we replaced */
+    mca_coll_base_comm_coll_t previous;
+
+    mca_coll_hier_state_t state;
+
+    /** Processes sharing this node */
+    struct ompi_communicator_t *low_comm;
+    /** One process per node (MPI_COMM_NULL on non-leaders) */
+    struct ompi_communicator_t *up_comm;
+
+    /** Number of nodes, i.e. size of up_comm */
+    int num_nodes;
+    /** For each rank in the communicator, its node (rank of its
+        leader in up_comm) */
+    int *node_of;
+    /** For each rank in the communicator, its rank in its low_comm */
+    int *low_rank_of;
+    /** For each node, its number of processes */
+    int *node_size;
+    /** For each node, the position of its first process when the
+        processes are ordered by node */
+    int *node_disp;
+    /** The communicator ranks, ordered by node and then by local
+        rank, i.e. node_order[node_disp[n] + l] is the rank of local
+        rank l on node n */
+    int *node_order;
+    /** True if node_order is the identity, in which case no
+        reordering of the data is ever needed */
+    bool block_ordered;
+} mca_coll_hier_module_t;
+
+OBJ_CLASS_DECLARATION(mca_coll_hier_module_t);
+
+/* Component */
+
+typedef struct mca_coll_hier_component_t {
+    mca_coll_base_component_2_0_0_t super;
+
+    /** Priority of this component */
+    int priority;
+} mca_coll_hier_component_t;
+
+/* Globally exported variables */
+
+OMPI_MODULE_DECLSPEC extern mca_coll_hier_component_t mca_coll_hier_component;
+
+/* Internal functions */
+
+/**
+ * Make sure the decision about the hierarchy has been made on the
+ * communicator (and the sub-communicators created if needed).  This
+ * is a collective operation on comm, and it is invoked by every
+ * collective the first time it is called.
+ */
+int mca_coll_hier_lazy_enable(mca_coll_hier_module_t *hier_module,
+                              struct ompi_communicator_t *comm);
+
+/**
+ * Return true if the hierarchy is usable on the communicator, setting
+ * it up first if needed.
+ */
+static inline bool mca_coll_hier_is_enabled(mca_coll_hier_module_t *hier_module,
+                                            struct ompi_communicator_t *comm)
+{
+    if (OPAL_UNLIKELY(MCA_COLL_HIER_UNKNOWN == hier_module->state)) {
+        (void) mca_coll_hier_lazy_enable(hier_module, comm);
+    }
+    return MCA_COLL_HIER_ENABLED == hier_module->state;
+}
+
+/**
+ * Allocate a buffer able to hold count elements of dtype.  The
+ * returned pointer is the one to use in the communications; the one
+ * to free is stored in *to_free.
+ */
+char *mca_coll_hier_alloc_buffer(struct ompi_datatype_t *dtype, size_t count,
+                                 char **to_free);
+
+END_C_DECLS
+
+#endif /* MCA_COLL_HIER_EXPORT_H */
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include "mpi.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "coll_hier.h"
+
+
+/*
+ *	allgather
+ *
+ *	Function:	- allgather
+ *	Accepts:	- same arguments as MPI_Allgather()
+ *	Returns:	- MPI_SUCCESS or error code
+ *
+ *	Each node gathers its blocks on its leader, the leaders
+ *	exchange the blocks of their nodes, and then broadcast the
+ *	whole result on their node.  The exchanged data is laid out by
+ *	node; unless the ranks are already ordered by node, it goes
+ *	through a temporary buffer and is reordered at the end.
+ */
+int mca_coll_hier_allgather(const void *sbuf, int scount,
+                            struct ompi_datatype_t *sdtype,
+                            void *rbuf, int rcount,
+                            struct ompi_datatype_t *rdtype,
+                            struct ompi_communicator_t *comm,
+                            mca_coll_base_module_t *module)
+{
+    mca_coll_hier_module_t *s = (mca_coll_hier_module_t*) module;
+    ompi_communicator_t *low_comm, *up_comm;
+    int rank, size, my_node, i, err;
+    int *counts = NULL, *displs = NULL;
+    char *gbuf, *node_block, *free_buf = NULL;
+    ptrdiff_t lb, extent, block;
+
+    if (!mca_coll_hier_is_enabled(s, comm)) {
+        return s->previous.coll_allgather(sbuf, scount, sdtype, rbuf, rcount, rdtype,
+                                          comm, s->previous.coll_allgather_module);
+    }
+
+    low_comm = s->low_comm;
+    up_comm = s->up_comm;
+    rank = ompi_comm_rank(comm);
+    size = ompi_comm_size(comm);
+    my_node = s->node_of[rank];
+    ompi_datatype_get_extent(rdtype, &lb, &extent);
+    block = (ptrdiff_t) rcount * extent;
+
+    if (s->block_ordered) {
+        gbuf = (char *) rbuf;
+    } else {
+        gbuf = mca_coll_hier_alloc_buffer(rdtype, (size_t) size * rcount, &free_buf);
+        if (NULL == gbuf) {
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+    }
+    node_block = gbuf + s->node_disp[my_node] * block;
+
+    if (MPI_IN_PLACE == sbuf) {
+        if (s->block_ordered && MPI_COMM_NULL != up_comm) {
+            /* The leader's block is already where it belongs */
+            err = low_comm->c_coll->coll_gather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                                                node_block, rcount, rdtype, 0,
+                                                low_comm, low_comm->c_coll->coll_gather_module);
+        } else {
+            err = low_comm->c_coll->coll_gather((char *) rbuf + rank * block, rcount, rdtype,
+                                                node_block, rcount, rdtype, 0,
+                                                low_comm, low_comm->c_coll->coll_gather_module);
+        }
+    } else {
+        err = low_comm->c_coll->coll_gather(sbuf, scount, sdtype,
+                                            node_block, rcount, rdtype, 0,
+                                            low_comm, low_comm->c_coll->coll_gather_module);
+    }
+    if (OMPI_SUCCESS != err) {
+        goto cleanup;
+    }
+
+    if (MPI_COMM_NULL != up_comm) {
+        counts = (int *) malloc(2 * s->num_nodes * sizeof(int));
+        if (NULL == counts) {
+            err = OMPI_ERR_OUT_OF_RESOURCE;
+            goto cleanup;
+        }
+        displs = counts + s->num_nodes;
+        for (i = 0; i < s->num_nodes; ++i) {
+            counts[i] = s->node_size[i] * rcount;
+            displs[i] = s->node_disp[i] * rcount;
+        }
+        err = up_comm->c_coll->coll_allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                                               gbuf, counts, displs, rdtype,
+                                               up_comm, up_comm->c_coll->coll_allgatherv_module);
+        if (OMPI_SUCCESS != err) {
+            goto cleanup;
+        }
+    }
+
+    err = low_comm->c_coll->coll_bcast(gbuf, size * rcount, rdtype, 0,
+                                       low_comm, low_comm->c_coll->coll_bcast_module);
+    if (OMPI_SUCCESS != err) {
+        goto cleanup;
+    }
+
+    if (!s->block_ordered) {
+        for (i = 0; i < size; ++i) {
+            err = ompi_datatype_copy_content_same_ddt(rdtype, rcount,
+                                                      (char *) rbuf + s->node_order[i] * block,
+                                                      gbuf + i * block);
+            if (OMPI_SUCCESS != err) {
+                goto cleanup;
+            }
+        }
+    }
+
+ cleanup:
+    if (NULL != counts) {
+        free(counts);
+    }
+    if (NULL != free_buf) {
+        free(free_buf);
+    }
+    return err;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include "mpi.h"
+#include "ompi/op/op.h"
+#include "coll_hier.h"
+
+
+/*
+ *	allreduce
+ *
+ *	Function:	- allreduce
+ *	Accepts:	- same arguments as MPI_Allreduce()
+ *	Returns:	- MPI_SUCCESS or error code
+ *
+ *	Each node reduces toward its leader, the leaders allreduce
+ *	among themselves, and each leader broadcasts the result on its
+ *	node.  Only used for commutative operations.
+ */
+int mca_coll_hier_allreduce(const void *sbuf, void *rbuf, int count,
+                            struct ompi_datatype_t *dtype,
+                            struct ompi_op_t *op,
+                            struct ompi_communicator_t *comm,
+                            mca_coll_base_module_t *module)
+{
+    mca_coll_hier_module_t *s = (mca_coll_hier_module_t*) module;
+    ompi_communicator_t *low_comm, *up_comm;
+    bool leader;
+    int err;
+
+    if (!ompi_op_is_commute(op) || !mca_coll_hier_is_enabled(s, comm)) {
+        return s->previous.coll_allreduce(sbuf, rbuf, count, dtype, op, comm,
+                                          s->previous.coll_allreduce_module);
+    }
+
+    low_comm = s->low_comm;
+    up_comm = s->up_comm;
+    leader = (MPI_COMM_NULL != up_comm);
+
+    if (MPI_IN_PLACE == sbuf) {
+        sbuf = leader ? MPI_IN_PLACE : rbuf;
+    }
+    err = low_comm->c_coll->coll_reduce(sbuf, leader ? rbuf : NULL, count, dtype, op, 0,
+                                        low_comm, low_comm->c_coll->coll_reduce_module);
+    if (OMPI_SUCCESS != err) {
+        return err;
+    }
+
+    if (leader) {
+        err = up_comm->c_coll->coll_allreduce(MPI_IN_PLACE, rbuf, count, dtype, op,
+                                              up_comm, up_comm->c_coll->coll_allreduce_module);
+        if (OMPI_SUCCESS != err) {
+            return err;
+        }
+    }
+
+    return low_comm->c_coll->coll_bcast(rbuf, count, dtype, 0,
+                                        low_comm, low_comm->c_coll->coll_bcast_module);
+}
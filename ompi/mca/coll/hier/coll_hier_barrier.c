@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include "mpi.h"
+#include "coll_hier.h"
+
+
+/*
+ *	barrier
+ *
+ *	Function:	- barrier
+ *	Accepts:	- same arguments as MPI_Barrier()
+ *	Returns:	- MPI_SUCCESS or error code
+ *
+ *	Everybody on a node waits for the whole node, then the
+ *	leaders wait for each other, and finally release their node.
+ */
+int mca_coll_hier_barrier(struct ompi_communicator_t *comm,
+                          mca_coll_base_module_t *module)
+{
+    mca_coll_hier_module_t *s = (mca_coll_hier_module_t*) module;
+    ompi_communicator_t *low_comm, *up_comm;
+    int err;
+
+    if (!mca_coll_hier_is_enabled(s, comm)) {
+        return s->previous.coll_barrier(comm, s->previous.coll_barrier_module);
+    }
+
+    low_comm = s->low_comm;
+    up_comm = s->up_comm;
+
+    err = low_comm->c_coll->coll_barrier(low_comm, low_comm->c_coll->coll_barrier_module);
+    if (OMPI_SUCCESS != err) {
+        return err;
+    }
+
+    if (MPI_COMM_NULL != up_comm) {
+        err = up_comm->c_coll->coll_barrier(up_comm, up_comm->c_coll->coll_barrier_module);
+        if (OMPI_SUCCESS != err) {
+            return err;
+        }
+    }
+
+    return low_comm->c_coll->coll_barrier(low_comm, low_comm->c_coll->coll_barrier_module);
+}
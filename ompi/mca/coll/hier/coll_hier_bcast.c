@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include "mpi.h"
+#include "coll_hier.h"
+
+
+/*
+ *	bcast
+ *
+ *	Function:	- broadcast
+ *	Accepts:	- same arguments as MPI_Bcast()
+ *	Returns:	- MPI_SUCCESS or error code
+ *
+ *	The data is first broadcast on the node of the root (which
+ *	brings it to the leader of that node), then among the
+ *	leaders, and finally on every other node.
+ */
+int mca_coll_hier_bcast(void *buff, int count,
+                        struct ompi_datatype_t *datatype, int root,
+                        struct ompi_communicator_t *comm,
+                        mca_coll_base_module_t *module)
+{
+    mca_coll_hier_module_t *s = (mca_coll_hier_module_t*) module;
+    ompi_communicator_t *low_comm, *up_comm;
+    int root_node, my_node, err;
+
+    if (!mca_coll_hier_is_enabled(s, comm)) {
+        return s->previous.coll_bcast(buff, count, datatype, root, comm,
+                                      s->previous.coll_bcast_module);
+    }
+
+    low_comm = s->low_comm;
+    up_comm = s->up_comm;
+    root_node = s->node_of[root];
+    my_node = s->node_of[ompi_comm_rank(comm)];
+
+    if (my_node == root_node) {
+        err = low_comm->c_coll->coll_bcast(buff, count, datatype, s->low_rank_of[root],
+                                           low_comm, low_comm->c_coll->coll_bcast_module);
+        if (OMPI_SUCCESS != err) {
+            return err;
+        }
+    }
+
+    if (MPI_COMM_NULL != up_comm) {
+        err = up_comm->c_coll->coll_bcast(buff, count, datatype, root_node,
+                                          up_comm, up_comm->c_coll->coll_bcast_module);
+        if (OMPI_SUCCESS != err) {
+            return err;
+        }
+    }
+
+    if (my_node != root_node) {
+        err = low_comm->c_coll->coll_bcast(buff, count, datatype, 0,
+                                           low_comm, low_comm->c_coll->coll_bcast_module);
+    }
+    return err;
+}
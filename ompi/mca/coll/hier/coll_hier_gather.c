@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include "mpi.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "ompi/mca/pml/pml.h"
+#include "ompi/mca/coll/base/coll_tags.h"
+#include "coll_hier.h"
+
+
+/*
+ *	gather
+ *
+ *	Function:	- gather
+ *	Accepts:	- same arguments as MPI_Gather()
+ *	Returns:	- MPI_SUCCESS or error code
+ *
+ *	Each node gathers its blocks on its leader, then the leaders
+ *	gather the blocks of their nodes on the leader of the node of
+ *	the root.  The data travels in node order, and is put back in
+ *	rank order by the root.  Only the root knows about the receive
+ *	datatype: the other processes (including the leaders) describe
+ *	the blocks with their send datatype.
+ */
+int mca_coll_hier_gather(const void *sbuf, int scount,
+                         struct ompi_datatype_t *sdtype,
+                         void *rbuf, int rcount,
+                         struct ompi_datatype_t *rdtype,
+                         int root, struct ompi_communicator_t *comm,
+                         mca_coll_base_module_t *module)
+{
+    mca_coll_hier_module_t *s = (mca_coll_hier_module_t*) module;
+    ompi_communicator_t *low_comm, *up_comm;
+    int rank, size, my_node, root_node, root_leader, i, err, ucount;
+    int *counts = NULL, *displs = NULL;
+    struct ompi_datatype_t *udtype;
+    char *gbuf = NULL, *node_block = NULL, *free_buf = NULL;
+    ptrdiff_t lb, extent, ublock, rblock = 0;
+
+    if (!mca_coll_hier_is_enabled(s, comm)) {
+        return s->previous.coll_gather(sbuf, scount, sdtype, rbuf, rcount, rdtype,
+                                       root, comm, s->previous.coll_gather_module);
+    }
+
+    low_comm = s->low_comm;
+    up_comm = s->up_comm;
+    rank = ompi_comm_rank(comm);
+    size = ompi_comm_size(comm);
+    my_node = s->node_of[rank];
+    root_node = s->node_of[root];
+    root_leader = s->node_order[s->node_disp[root_node]];
+
+    if (rank == root) {
+        udtype = rdtype;
+        ucount = rcount;
+        ompi_datatype_get_extent(rdtype, &lb, &extent);
+        rblock = (ptrdiff_t) rcount * extent;
+        if (MPI_IN_PLACE == sbuf) {
+            sbuf = (char *) rbuf + rank * rblock;
+            scount = rcount;
+            sdtype = rdtype;
+        }
+    } else {
+        udtype = sdtype;
+        ucount = scount;
+    }
+    ompi_datatype_get_extent(udtype, &lb, &extent);
+    ublock = (ptrdiff_t) ucount * extent;
+
+    if (MPI_COMM_NULL != up_comm) {
+        if (my_node == root_node) {
+            gbuf = mca_coll_hier_alloc_buffer(udtype, (size_t) size * ucount, &free_buf);
+            node_block = gbuf + s->node_disp[my_node] * ublock;
+        } else {
+            gbuf = mca_coll_hier_alloc_buffer(udtype, (size_t) s->node_size[my_node] * ucount,
+                                              &free_buf);
+            node_block = gbuf;
+        }
+        if (NULL == gbuf) {
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+    }
+
+    err = low_comm->c_coll->coll_gather(sbuf, scount, sdtype,
+                                        node_block, ucount, udtype, 0,
+                                        low_comm, low_comm->c_coll->coll_gather_module);
+    if (OMPI_SUCCESS != err) {
+        goto cleanup;
+    }
+
+    if (MPI_COMM_NULL != up_comm) {
+        if (my_node == root_node) {
+            counts = (int *) malloc(2 * s->num_nodes * sizeof(int));
+            if (NULL == counts) {
+                err = OMPI_ERR_OUT_OF_RESOURCE;
+                goto cleanup;
+            }
+            displs = counts + s->num_nodes;
+            for (i = 0; i < s->num_nodes; ++i) {
+                counts[i] = s->node_size[i] * ucount;
+                displs[i] = s->node_disp[i] * ucount;
+            }
+            err = up_comm->c_coll->coll_gatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                                                gbuf, counts, displs, udtype, root_node,
+                                                up_comm, up_comm->c_coll->coll_gatherv_module);
+        } else {
+            err = up_comm->c_coll->coll_gatherv(gbuf, s->node_size[my_node] * ucount, udtype,
+                                                NULL, NULL, NULL, udtype, root_node,
+                                                up_comm, up_comm->c_coll->coll_gatherv_module);
+        }
+        if (OMPI_SUCCESS != err) {
+            goto cleanup;
+        }
+    }
+
+    /* The leader of the root's node now has everything, in node order */
+    if (root != root_leader) {
+        if (rank == root_leader) {
+            err = MCA_PML_CALL(send(gbuf, size * ucount, udtype, root,
+                                    MCA_COLL_BASE_TAG_GATHER,
+                                    MCA_PML_BASE_SEND_STANDARD, comm));
+        } else if (rank == root) {
+            gbuf = mca_coll_hier_alloc_buffer(rdtype, (size_t) size * rcount, &free_buf);
+            if (NULL == gbuf) {
+                return OMPI_ERR_OUT_OF_RESOURCE;
+            }
+            err = MCA_PML_CALL(recv(gbuf, size * rcount, rdtype, root_leader,
+                                    MCA_COLL_BASE_TAG_GATHER, comm,
+                                    MPI_STATUS_IGNORE));
+        }
+        if (OMPI_SUCCESS != err) {
+            goto cleanup;
+        }
+    }
+
+    if (rank == root) {
+        for (i = 0; i < size; ++i) {
+            err = ompi_datatype_copy_content_same_ddt(rdtype, rcount,
+                                                      (char *) rbuf + s->node_order[i] * rblock,
+                                                      gbuf + i * rblock);
+            if (OMPI_SUCCESS != err) {
+                goto cleanup;
+            }
+        }
+    }
+
+ cleanup:
+    if (NULL != counts) {
+        free(counts);
+    }
+    if (NULL != free_buf) {
+        free(free_buf);
+    }
+    return err;
+}
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#include <stdio.h>
+
+#include "mpi.h"
+
+#include "opal/util/show_help.h"
+#include "opal/datatype/opal_datatype.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "ompi/mca/rte/rte.h"
+
+#include "ompi/constants.h"
+#include "ompi/communicator/communicator.h"
+#include "ompi/group/group.h"
+#include "ompi/proc/proc.h"
+#include "ompi/mca/coll/coll.h"
+#include "ompi/mca/coll/base/base.h"
+#include "coll_hier.h"
+
+
+static void mca_coll_hier_module_construct(mca_coll_hier_module_t *module)
+{
+    memset(&(module->previous), 0, sizeof(module->previous));
+    module->state = MCA_COLL_HIER_UNKNOWN;
+    module->low_comm = NULL;
+    module->up_comm = NULL;
+    module->num_nodes = 0;
+    module->node_of = NULL;
+    module->low_rank_of = NULL;
+    module->node_size = NULL;
+    module->node_disp = NULL;
+    module->node_order = NULL;
+    module->block_ordered = false;
+}
+
+static void mca_coll_hier_module_destruct(mca_coll_hier_module_t *module)
+{
+    if (NULL != module->low_comm && MPI_COMM_NULL != module->low_comm) {
+        ompi_comm_free(&module->low_comm);
+    }
+    if (NULL != module->up_comm && MPI_COMM_NULL != module->up_comm) {
+        ompi_comm_free(&module->up_comm);
+    }
+    free(module->node_of);
+    free(module->low_rank_of);
+    free(module->node_size);
+    free(module->node_disp);
+    free(module->node_order);
+
+#define RELEASE_PREVIOUS(name)                                          \
+    if (NULL != module->previous.coll_ ## name ## _module) {            \
+        OBJ_RELEASE(module->previous.coll_ ## name ## _module);         \
+    }
+
+    RELEASE_PREVIOUS(allgather);
+    RELEASE_PREVIOUS(allreduce);
+    RELEASE_PREVIOUS(barrier);
+    RELEASE_PREVIOUS(bcast);
+    RELEASE_PREVIOUS(gather);
+    RELEASE_PREVIOUS(reduce);
+    RELEASE_PREVIOUS(scatter);
+}
+
+OBJ_CLASS_INSTANCE(mca_coll_hier_module_t, mca_coll_base_module_t,
+                   mca_coll_hier_module_construct,
+                   mca_coll_hier_module_destruct);
+
+
+/*
+ * Initial query function that is invoked during MPI_INIT, allowing
+ * this component to disqualify itself if it doesn't support the
+ * required level of thread support.
+ */
+int mca_coll_hier_init_query(bool enable_progress_threads,
+                             bool enable_mpi_threads)
+{
+    /* Nothing to do */
+    return OMPI_SUCCESS;
+}
+
+
+/*
+ * Invoked when there's a new communicator that has been created.
+ * Look at the communicator and decide which set of functions and
+ * priority we want to return.
+ */
+mca_coll_base_module_t *
+mca_coll_hier_comm_query(struct ompi_communicator_t *comm,
+                         int *priority)
+{
+    mca_coll_hier_module_t *hier_module;
+
+    /* Intercommunicators and single-process communicators have no use
+       for a hierarchy; neither do communicators entirely on this node.
+       The latter test gives the same answer on all the processes: if
+       one of them has a remote peer, all of them do. */
+    if (mca_coll_hier_component.priority <= 0 ||
+        OMPI_COMM_IS_INTER(comm) || ompi_comm_size(comm) < 2 ||
+        !ompi_group_have_remote_peers(comm->c_local_group)) {
+        opal_output_verbose(10, ompi_coll_base_framework.framework_output,
+                            "coll:hier:comm_query (%d/%s): priority too low, intercomm, or single node; disqualifying myself",
+                            comm->c_contextid, comm->c_name);
+        return NULL;
+    }
+
+    hier_module = OBJ_NEW(mca_coll_hier_module_t);
+    if (NULL == hier_module) {
+        return NULL;
+    }
+
+    *priority = mca_coll_hier_component.priority;
+
+    hier_module->super.coll_module_enable = mca_coll_hier_module_enable;
+    hier_module->super.ft_event = NULL;
+
+    hier_module->super.coll_allgather  = mca_coll_hier_allgather;
+    hier_module->super.coll_allgatherv = NULL;
+    hier_module->super.coll_allreduce  = mca_coll_hier_allreduce;
+    hier_module->super.coll_alltoall   = NULL;
+    hier_module->super.coll_alltoallv  = NULL;
+    hier_module->super.coll_alltoallw  = NULL;
+    hier_module->super.coll_barrier    = mca_coll_hier_barrier;
+    hier_module->super.coll_bcast      = mca_coll_hier_bcast;
+    hier_module->super.coll_exscan     = NULL;
+    hier_module->super.coll_gather     = mca_coll_hier_gather;
+    hier_module->super.coll_gatherv    = NULL;
+    hier_module->super.coll_reduce     = mca_coll_hier_reduce;
+    hier_module->super.coll_reduce_scatter = NULL;
+    hier_module->super.coll_scan       = NULL;
+    hier_module->super.coll_scatter    = mca_coll_hier_scatter;
+    hier_module->super.coll_scatterv   = NULL;
+
+    return &(hier_module->super);
+}
+
+
+/*
+ * Init module on the communicator
+ */
+int mca_coll_hier_module_enable(mca_coll_base_module_t *module,
+                                struct ompi_communicator_t *comm)
+{
+    bool good = true;
+    char *msg = NULL;
+    mca_coll_hier_module_t *s = (mca_coll_hier_module_t*) module;
+
+#define CHECK_AND_RETAIN(src, dst, name)                                                   \
+    if (NULL == (src)->c_coll->coll_ ## name ## _module) {                                 \
+        good = false;                                                                      \
+        msg = #name;                                                                       \
+    } else if (good) {                                                                     \
+        (dst)->previous.coll_ ## name ## _module = (src)->c_coll->coll_ ## name ## _module; \
+        (dst)->previous.coll_ ## name = (src)->c_coll->coll_ ## name;                      \
+        OBJ_RETAIN((src)->c_coll->coll_ ## name ## _module);                               \
+    }
+
+    CHECK_AND_RETAIN(comm, s, allgather);
+    CHECK_AND_RETAIN(comm, s, allreduce);
+    CHECK_AND_RETAIN(comm, s, barrier);
+    CHECK_AND_RETAIN(comm, s, bcast);
+    CHECK_AND_RETAIN(comm, s, gather);
+    CHECK_AND_RETAIN(comm, s, reduce);
+    CHECK_AND_RETAIN(comm, s, scatter);
+
+    /* All done */
+    if (good) {
+        return OMPI_SUCCESS;
+    }
+    opal_show_help("help-coll-hier.txt", "missing collective", true,
+                   ompi_process_info.nodename,
+                   mca_coll_hier_component.priority, msg);
+    return OMPI_ERR_NOT_FOUND;
+}
+
+
+/*
+ * Decide whether the hierarchy is worth it and, if so, build the
+ * sub-communicators and the mapping between the ranks in the
+ * communicator and their position in the hierarchy.
+ */
+int mca_coll_hier_lazy_enable(mca_coll_hier_module_t *hier_module,
+                              struct ompi_communicator_t *comm)
+{
+    int rank = ompi_comm_rank(comm), size = ompi_comm_size(comm);
+    int i, ret, local_procs = 0, low_rank = -1, my_node = -1;
+    int procs_per_node[2], my_info[2], *all_info = NULL;
+    mca_coll_base_comm_coll_t current;
+    ompi_proc_t *proc;
+
+    /* Until proven otherwise (this also prevents any recursion) */
+    hier_module->state = MCA_COLL_HIER_DISABLED;
+
+    for (i = 0; i < size; ++i) {
+        if (i == rank) {
+            ++local_procs;
+            continue;
+        }
+        proc = ompi_group_peer_lookup(comm->c_local_group, i);
+        if (OPAL_PROC_ON_LOCAL_NODE(proc->super.proc_flags)) {
+            ++local_procs;
+        }
+    }
+
+    /* Get the largest and smallest numbers of processes per node */
+    procs_per_node[0] = local_procs;
+    procs_per_node[1] = -local_procs;
+    ret = hier_module->previous.coll_allreduce(MPI_IN_PLACE, procs_per_node, 2, MPI_INT, MPI_MAX,
+                                               comm, hier_module->previous.coll_allreduce_module);
+    if (OMPI_SUCCESS != ret) {
+        return ret;
+    }
+    if (1 == procs_per_node[0] || size == -procs_per_node[1]) {
+        /* One process per node, or a single node */
+        opal_output_verbose(10, ompi_coll_base_framework.framework_output,
+                            "coll:hier:lazy_enable (%d/%s): no hierarchy to exploit; using the previous module",
+                            comm->c_contextid, comm->c_name);
+        return OMPI_SUCCESS;
+    }
+
+    /* Creating the sub-communicators involves collectives on comm:
+       route them to the previous module meanwhile. */
+    current = *comm->c_coll;
+    comm->c_coll->coll_allgather = hier_module->previous.coll_allgather;
+    comm->c_coll->coll_allgather_module = hier_module->previous.coll_allgather_module;
+    comm->c_coll->coll_allreduce = hier_module->previous.coll_allreduce;
+    comm->c_coll->coll_allreduce_module = hier_module->previous.coll_allreduce_module;
+    comm->c_coll->coll_barrier = hier_module->previous.coll_barrier;
+    comm->c_coll->coll_barrier_module = hier_module->previous.coll_barrier_module;
+    comm->c_coll->coll_bcast = hier_module->previous.coll_bcast;
+    comm->c_coll->coll_bcast_module = hier_module->previous.coll_bcast_module;
+
+    ret = ompi_comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, NULL,
+                               &hier_module->low_comm);
+    if (OMPI_SUCCESS == ret) {
+        low_rank = ompi_comm_rank(hier_module->low_comm);
+        ret = ompi_comm_split(comm, 0 == low_rank ? 0 : MPI_UNDEFINED, 0,
+                              &hier_module->up_comm, false);
+    }
+    *comm->c_coll = current;
+    if (OMPI_SUCCESS != ret) {
+        goto cleanup;
+    }
+
+    /* The leaders know their node number (their rank among the
+       leaders); share it with the rest of the node, and then the
+       placement of everybody with everybody. */
+    if (MPI_COMM_NULL != hier_module->up_comm) {
+        my_node = ompi_comm_rank(hier_module->up_comm);
+    }
+    ret = hier_module->low_comm->c_coll->coll_bcast(&my_node, 1, MPI_INT, 0, hier_module->low_comm,
+                                                    hier_module->low_comm->c_coll->coll_bcast_module);
+    if (OMPI_SUCCESS != ret) {
+        goto cleanup;
+    }
+
+    all_info = (int *) malloc(2 * size * sizeof(int));
+    hier_module->node_of = (int *) malloc(size * sizeof(int));
+    hier_module->low_rank_of = (int *) malloc(size * sizeof(int));
+    hier_module->node_order = (int *) malloc(size * sizeof(int));
+    if (NULL == all_info || NULL == hier_module->node_of ||
+        NULL == hier_module->low_rank_of || NULL == hier_module->node_order) {
+        ret = OMPI_ERR_OUT_OF_RESOURCE;
+        goto cleanup;
+    }
+
+    my_info[0] = my_node;
+    my_info[1] = low_rank;
+    ret = hier_module->previous.coll_allgather(my_info, 2, MPI_INT, all_info, 2, MPI_INT,
+                                               comm, hier_module->previous.coll_allgather_module);
+    if (OMPI_SUCCESS != ret) {
+        goto cleanup;
+    }
+
+    hier_module->num_nodes = 0;
+    for (i = 0; i < size; ++i) {
+        hier_module->node_of[i] = all_info[2 * i];
+        hier_module->low_rank_of[i] = all_info[2 * i + 1];
+        if (hier_module->node_of[i] >= hier_module->num_nodes) {
+            hier_module->num_nodes = hier_module->node_of[i] + 1;
+        }
+    }
+
+    hier_module->node_size = (int *) calloc(hier_module->num_nodes, sizeof(int));
+    hier_module->node_disp = (int *) malloc(hier_module->num_nodes * sizeof(int));
+    if (NULL == hier_module->node_size || NULL == hier_module->node_disp) {
+        ret = OMPI_ERR_OUT_OF_RESOURCE;
+        goto cleanup;
+    }
+    for (i = 0; i < size; ++i) {
+        hier_module->node_size[hier_module->node_of[i]]++;
+    }
+    hier_module->node_disp[0] = 0;
+    for (i = 1; i < hier_module->num_nodes; ++i) {
+        hier_module->node_disp[i] = hier_module->node_disp[i - 1] + hier_module->node_size[i - 1];
+    }
+    hier_module->block_ordered = true;
+    for (i = 0; i < size; ++i) {
+        int pos = hier_module->node_disp[hier_module->node_of[i]] + hier_module->low_rank_of[i];
+        hier_module->node_order[pos] = i;
+        if (pos != i) {
+            hier_module->block_ordered = false;
+        }
+    }
+    free(all_info);
+
+    opal_output_verbose(10, ompi_coll_base_framework.framework_output,
+                        "coll:hier:lazy_enable (%d/%s): %d nodes, up to %d processes per node%s",
+                        comm->c_contextid, comm->c_name, hier_module->num_nodes,
+                        procs_per_node[0], hier_module->block_ordered ? " (block ordered)" : "");
+    hier_module->state = MCA_COLL_HIER_ENABLED;
+    return OMPI_SUCCESS;
+
+ cleanup:
+    free(all_info);
+    if (NULL != hier_module->low_comm && MPI_COMM_NULL != hier_module->low_comm) {
+        ompi_comm_free(&hier_module->low_comm);
+    }
+    if (NULL != hier_module->up_comm && MPI_COMM_NULL != hier_module->up_comm) {
+        ompi_comm_free(&hier_module->up_comm);
+    }
+    hier_module->low_comm = NULL;
+    hier_module->up_comm = NULL;
+    return ret;
+}
+
+
+char *mca_coll_hier_alloc_buffer(struct ompi_datatype_t *dtype, size_t count,
+                                 char **to_free)
+{
+    ptrdiff_t gap = 0;
+    size_t span = opal_datatype_span(&dtype->super, count, &gap);
+
+    /* Always allocate something, even for empty messages */
+    *to_free = (char *) malloc(0 == span ? 1 : span);
+    if (NULL == *to_free) {
+        return NULL;
+    }
+    return *to_free - gap;
+}
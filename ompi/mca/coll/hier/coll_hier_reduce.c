@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include "mpi.h"
+#include "ompi/op/op.h"
+#include "ompi/mca/pml/pml.h"
+#include "ompi/mca/coll/base/coll_tags.h"
+#include "coll_hier.h"
+
+
+/*
+ *	reduce
+ *
+ *	Function:	- reduce
+ *	Accepts:	- same arguments as MPI_Reduce()
+ *	Returns:	- MPI_SUCCESS or error code
+ *
+ *	Each node reduces toward its leader, then the leaders reduce
+ *	toward the leader of the node of the root, which forwards the
+ *	result to the root if needed.  The hierarchy changes the order
+ *	in which the contributions are combined, so it is only used
+ *	for commutative operations.
+ */
+int mca_coll_hier_reduce(const void *sbuf, void *rbuf, int count,
+                         struct ompi_datatype_t *dtype,
+                         struct ompi_op_t *op,
+                         int root, struct ompi_communicator_t *comm,
+                         mca_coll_base_module_t *module)
+{
+    mca_coll_hier_module_t *s = (mca_coll_hier_module_t*) module;
+    ompi_communicator_t *low_comm, *up_comm;
+    int rank, root_node, root_leader, err;
+    char *node_buf = NULL, *free_buf = NULL;
+    const void *low_sbuf = sbuf;
+
+    if (!ompi_op_is_commute(op) || !mca_coll_hier_is_enabled(s, comm)) {
+        return s->previous.coll_reduce(sbuf, rbuf, count, dtype, op, root, comm,
+                                       s->previous.coll_reduce_module);
+    }
+
+    low_comm = s->low_comm;
+    up_comm = s->up_comm;
+    rank = ompi_comm_rank(comm);
+    root_node = s->node_of[root];
+    root_leader = s->node_order[s->node_disp[root_node]];
+
+    /* The leaders need a buffer for the partial result of their node */
+    if (MPI_COMM_NULL != up_comm) {
+        if (rank == root) {
+            node_buf = (char *) rbuf;
+        } else {
+            node_buf = mca_coll_hier_alloc_buffer(dtype, count, &free_buf);
+            if (NULL == node_buf) {
+                return OMPI_ERR_OUT_OF_RESOURCE;
+            }
+        }
+    }
+    if (MPI_IN_PLACE == sbuf) {
+        /* Only valid on the root; its contribution is in rbuf */
+        low_sbuf = (rank == root_leader) ? MPI_IN_PLACE : rbuf;
+    }
+
+    err = low_comm->c_coll->coll_reduce(low_sbuf, node_buf, count, dtype, op, 0,
+                                        low_comm, low_comm->c_coll->coll_reduce_module);
+    if (OMPI_SUCCESS != err) {
+        goto cleanup;
+    }
+
+    if (MPI_COMM_NULL != up_comm) {
+        err = up_comm->c_coll->coll_reduce((rank == root_leader) ? MPI_IN_PLACE : node_buf,
+                                           node_buf, count, dtype, op, root_node,
+                                           up_comm, up_comm->c_coll->coll_reduce_module);
+        if (OMPI_SUCCESS != err) {
+            goto cleanup;
+        }
+    }
+
+    if (root != root_leader) {
+        if (rank == root_leader) {
+            err = MCA_PML_CALL(send(node_buf, count, dtype, root,
+                                    MCA_COLL_BASE_TAG_REDUCE,
+                                    MCA_PML_BASE_SEND_STANDARD, comm));
+        } else if (rank == root) {
+            err = MCA_PML_CALL(recv(rbuf, count, dtype, root_leader,
+                                    MCA_COLL_BASE_TAG_REDUCE, comm,
+                                    MPI_STATUS_IGNORE));
+        }
+    }
+
+ cleanup:
+    if (NULL != free_buf) {
+        free(free_buf);
+    }
+    return err;
+}
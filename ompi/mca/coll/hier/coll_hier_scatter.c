@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include "mpi.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "ompi/mca/pml/pml.h"
+#include "ompi/mca/coll/base/coll_tags.h"
+#include "coll_hier.h"
+
+
+/*
+ *	scatter
+ *
+ *	Function:	- scatter
+ *	Accepts:	- same arguments as MPI_Scatter()
+ *	Returns:	- MPI_SUCCESS or error code
+ *
+ *	The reverse of the gather: the root puts the blocks in node
+ *	order and hands them to the leader of its node, which scatters
+ *	them among the leaders; each leader then scatters the blocks of
+ *	its node.  Only the root knows about the send datatype: the
+ *	other processes describe the blocks with their receive
+ *	datatype.
+ */
+int mca_coll_hier_scatter(const void *sbuf, int scount,
+                          struct ompi_datatype_t *sdtype,
+                          void *rbuf, int rcount,
+                          struct ompi_datatype_t *rdtype,
+                          int root, struct ompi_communicator_t *comm,
+                          mca_coll_base_module_t *module)
+{
+    mca_coll_hier_module_t *s = (mca_coll_hier_module_t*) module;
+    ompi_communicator_t *low_comm, *up_comm;
+    int rank, size, my_node, root_node, root_leader, i, err = OMPI_SUCCESS, ucount;
+    int *counts = NULL, *displs = NULL;
+    struct ompi_datatype_t *udtype;
+    char *gbuf = NULL, *node_block = NULL, *free_buf = NULL, *free_scratch = NULL;
+    ptrdiff_t lb, extent, ublock;
+
+    if (!mca_coll_hier_is_enabled(s, comm)) {
+        return s->previous.coll_scatter(sbuf, scount, sdtype, rbuf, rcount, rdtype,
+                                        root, comm, s->previous.coll_scatter_module);
+    }
+
+    low_comm = s->low_comm;
+    up_comm = s->up_comm;
+    rank = ompi_comm_rank(comm);
+    size = ompi_comm_size(comm);
+    my_node = s->node_of[rank];
+    root_node = s->node_of[root];
+    root_leader = s->node_order[s->node_disp[root_node]];
+
+    if (rank == root) {
+        udtype = sdtype;
+        ucount = scount;
+    } else {
+        udtype = rdtype;
+        ucount = rcount;
+    }
+    ompi_datatype_get_extent(udtype, &lb, &extent);
+    ublock = (ptrdiff_t) ucount * extent;
+
+    if (rank == root) {
+        /* Put the blocks in node order */
+        gbuf = mca_coll_hier_alloc_buffer(sdtype, (size_t) size * scount, &free_buf);
+        if (NULL == gbuf) {
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+        for (i = 0; i < size; ++i) {
+            err = ompi_datatype_copy_content_same_ddt(sdtype, scount, gbuf + i * ublock,
+                                                      (char *) sbuf + s->node_order[i] * ublock);
+            if (OMPI_SUCCESS != err) {
+                goto cleanup;
+            }
+        }
+        if (root != root_leader) {
+            err = MCA_PML_CALL(send(gbuf, size * scount, sdtype, root_leader,
+                                    MCA_COLL_BASE_TAG_SCATTER,
+                                    MCA_PML_BASE_SEND_STANDARD, comm));
+            if (OMPI_SUCCESS != err) {
+                goto cleanup;
+            }
+        }
+    } else if (rank == root_leader) {
+        gbuf = mca_coll_hier_alloc_buffer(udtype, (size_t) size * ucount, &free_buf);
+        if (NULL == gbuf) {
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+        err = MCA_PML_CALL(recv(gbuf, size * ucount, udtype, root,
+                                MCA_COLL_BASE_TAG_SCATTER, comm,
+                                MPI_STATUS_IGNORE));
+        if (OMPI_SUCCESS != err) {
+            goto cleanup;
+        }
+    } else if (MPI_COMM_NULL != up_comm) {
+        gbuf = mca_coll_hier_alloc_buffer(udtype, (size_t) s->node_size[my_node] * ucount,
+                                          &free_buf);
+        if (NULL == gbuf) {
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+    }
+
+    if (MPI_COMM_NULL != up_comm) {
+        if (my_node == root_node) {
+            counts = (int *) malloc(2 * s->num_nodes * sizeof(int));
+            if (NULL == counts) {
+                err = OMPI_ERR_OUT_OF_RESOURCE;
+                goto cleanup;
+            }
+            displs = counts + s->num_nodes;
+            for (i = 0; i < s->num_nodes; ++i) {
+                counts[i] = s->node_size[i] * ucount;
+                displs[i] = s->node_disp[i] * ucount;
+            }
+            err = up_comm->c_coll->coll_scatterv(gbuf, counts, displs, udtype,
+                                                 MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, root_node,
+                                                 up_comm, up_comm->c_coll->coll_scatterv_module);
+            node_block = gbuf + s->node_disp[my_node] * ublock;
+        } else {
+            err = up_comm->c_coll->coll_scatterv(NULL, NULL, NULL, udtype,
+                                                 gbuf, s->node_size[my_node] * ucount, udtype, root_node,
+                                                 up_comm, up_comm->c_coll->coll_scatterv_module);
+            node_block = gbuf;
+        }
+        if (OMPI_SUCCESS != err) {
+            goto cleanup;
+        }
+    }
+
+    if (rank == root && MPI_IN_PLACE == rbuf) {
+        if (rank == root_leader) {
+            err = low_comm->c_coll->coll_scatter(node_block, ucount, udtype,
+                                                 MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, 0,
+                                                 low_comm, low_comm->c_coll->coll_scatter_module);
+        } else {
+            /* The root already has its block, but still has to take
+               part in the scatter of its node */
+            char *scratch = mca_coll_hier_alloc_buffer(sdtype, (size_t) scount, &free_scratch);
+            if (NULL == scratch) {
+                err = OMPI_ERR_OUT_OF_RESOURCE;
+                goto cleanup;
+            }
+            err = low_comm->c_coll->coll_scatter(NULL, 0, MPI_DATATYPE_NULL,
+                                                 scratch, scount, sdtype, 0,
+                                                 low_comm, low_comm->c_coll->coll_scatter_module);
+        }
+    } else {
+        err = low_comm->c_coll->coll_scatter(node_block, ucount, udtype,
+                                             rbuf, rcount, rdtype, 0,
+                                             low_comm, low_comm->c_coll->coll_scatter_module);
+    }
+
+ cleanup:
+    if (NULL != counts) {
+        free(counts);
+    }
+    if (NULL != free_buf) {
+        free(free_buf);
+    }
+    if (NULL != free_scratch) {
+        free(free_scratch);
+    }
+    return err;
+}
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2013 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -67,16 +67,23 @@ BEGIN_C_DECLS
 #define NBC_INVALID_TOPOLOGY_COMM 8 /* invalid topology attached to communicator */
 
 /* number of implemented collective functions */
-#define NBC_NUM_COLL 17
+#define NBC_NUM_COLL 22
 
 extern bool libnbc_ibcast_skip_dt_decision;
+extern bool libnbc_persistent_plan;
 extern int libnbc_iallgather_algorithm;
 extern int libnbc_iallreduce_algorithm;
 extern int libnbc_ibcast_algorithm;
 extern int libnbc_ibcast_knomial_radix;
 extern int libnbc_iexscan_algorithm;
+extern int libnbc_ineighbor_allgather_algorithm;
+extern int libnbc_ineighbor_alltoall_algorithm;
 extern int libnbc_ireduce_algorithm;
 extern int libnbc_iscan_algorithm;
+extern int libnbc_pipeline_segsize;
+extern int libnbc_pipeline_depth;
+extern int libnbc_schedule_cache_size;
+extern int libnbc_neighbor_aggregate_max;
 
 struct ompi_coll_libnbc_component_t {
     mca_coll_base_component_2_0_0_t super;
@@ -84,6 +91,8 @@ struct ompi_coll_libnbc_component_t {
     opal_list_t active_requests;
     opal_atomic_int32_t active_comms;
     opal_mutex_t lock;                /* protect access to the active_requests list */
+    opal_atomic_size_t sched_cache_hits;   /* requests created from a cached schedule */
+    opal_atomic_size_t sched_cache_misses; /* requests that had to build their schedule */
 };
 typedef struct ompi_coll_libnbc_component_t ompi_coll_libnbc_component_t;
 
@@ -103,6 +112,9 @@ struct ompi_coll_libnbc_module_t {
                                       it ...*/
   int NBC_Dict_size[NBC_NUM_COLL];
 #endif
+    opal_list_t sched_cache; /* recently used schedules, protected by mutex */
+    bool nbr_plan_done;            /* the node plan of the topology was looked for */
+    struct NBC_Nbr_plan *nbr_plan; /* node plan of the neighborhood collectives, if any */
 };
 typedef struct ompi_coll_libnbc_module_t ompi_coll_libnbc_module_t;
 OBJ_CLASS_DECLARATION(ompi_coll_libnbc_module_t);
@@ -114,6 +126,11 @@ struct NBC_Schedule {
     volatile int size;
     volatile int current_round_offset;
     char *data;
+    /* a pipelined schedule has no round of its own, it runs the
+     * schedules of its segments concurrently */
+    struct NBC_Schedule **segments;
+    ptrdiff_t *segment_tmpoffs; /* temporary buffer of each segment */
+    int segment_count;
 };
 
 typedef struct NBC_Schedule NBC_Schedule;
@@ -131,6 +148,17 @@ struct ompi_coll_libnbc_request_t {
     NBC_Comminfo *comminfo;
     NBC_Schedule *schedule;
     void *tmpbuf; /* temporary buffer e.g. used for Reduce */
+    ompi_request_t **plan_reqs; /* persistent point-to-point requests of a
+                                 * persistent collective, in schedule order */
+    int plan_size;   /* number of requests in plan_reqs */
+    int plan_offset; /* first request of the current round in plan_reqs */
+    struct ompi_coll_libnbc_request_t **segments; /* requests of the segments of a
+                                                   * pipelined schedule */
+    int segment_count;   /* number of segments */
+    int segment_started; /* segments started so far */
+    int segment_done;    /* segments completed so far */
+    struct ompi_coll_libnbc_request_t *parent; /* pipelined request this segment belongs to */
+    struct NBC_Sched_cache_entry *cache_entry; /* cached schedule and tmpbuf in use */
     /* TODO: we should make a handle pointer to a state later (that the user
      * can move request handles) */
 };
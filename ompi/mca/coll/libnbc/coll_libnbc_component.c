@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -34,6 +34,7 @@
 #include "mpi.h"
 #include "ompi/mca/coll/coll.h"
 #include "ompi/communicator/communicator.h"
+#include "opal/mca/base/mca_base_pvar.h"
 
 /*
  * Public string showing the coll ompi_libnbc component version number
@@ -45,6 +46,7 @@ const char *mca_coll_libnbc_component_version_string =
 static int libnbc_priority = 10;
 static bool libnbc_in_progress = false;     /* protect from recursive calls */
 bool libnbc_ibcast_skip_dt_decision = true;
+bool libnbc_persistent_plan = true;
 
 int libnbc_iallgather_algorithm = 0;             /* iallgather user forced algorithm */
 static mca_base_var_enum_value_t iallgather_algorithms[] = {
@@ -61,6 +63,7 @@ static mca_base_var_enum_value_t iallreduce_algorithms[] = {
     {2, "binomial"},
     {3, "rabenseifner"},
     {4, "recursive_doubling"},
+    {5, "pipeline"},
     {0, NULL}
 };
 
@@ -72,6 +75,7 @@ static mca_base_var_enum_value_t ibcast_algorithms[] = {
     {2, "binomial"},
     {3, "chain"},
     {4, "knomial"},
+    {5, "pipeline"},
     {0, NULL}
 };
 
@@ -83,12 +87,22 @@ static mca_base_var_enum_value_t iexscan_algorithms[] = {
     {0, NULL}
 };
 
+int libnbc_ineighbor_allgather_algorithm = 0;  /* ineighbor_allgather user forced algorithm */
+int libnbc_ineighbor_alltoall_algorithm = 0;   /* ineighbor_alltoall user forced algorithm */
+static mca_base_var_enum_value_t ineighbor_algorithms[] = {
+    {0, "ignore"},
+    {1, "linear"},
+    {2, "node_aggregate"},
+    {0, NULL}
+};
+
 int libnbc_ireduce_algorithm = 0;            /* ireduce user forced algorithm */
 static mca_base_var_enum_value_t ireduce_algorithms[] = {
     {0, "ignore"},
     {1, "chain"},
     {2, "binomial"},
     {3, "rabenseifner"},
+    {4, "pipeline"},
     {0, NULL}
 };
 
@@ -100,6 +114,11 @@ static mca_base_var_enum_value_t iscan_algorithms[] = {
     {0, NULL}
 };
 
+int libnbc_pipeline_segsize = 262144;      /* size of the segments of pipelined collectives */
+int libnbc_pipeline_depth = 4;             /* segments of a pipelined collective in flight */
+int libnbc_schedule_cache_size = 16;       /* schedules cached per communicator (LRU) */
+int libnbc_neighbor_aggregate_max = 0;     /* largest neighborhood block aggregated per node */
+
 static int libnbc_open(void);
 static int libnbc_close(void);
 static int libnbc_register(void);
@@ -212,6 +231,15 @@ libnbc_register(void)
                                            MCA_BASE_VAR_SCOPE_READONLY,
                                            &libnbc_ibcast_skip_dt_decision);
 
+    libnbc_persistent_plan = true;
+    (void) mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
+                                           "persistent_plan",
+                                           "Create the point-to-point requests of persistent collectives once, when the collective is initialized, and only restart them on each MPI_Start",
+                                           MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &libnbc_persistent_plan);
+
     libnbc_iallgather_algorithm = 0;
     (void) mca_base_var_enum_create("coll_libnbc_iallgather_algorithms", iallgather_algorithms, &new_enum);
     mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
@@ -226,7 +254,7 @@ libnbc_register(void)
     (void) mca_base_var_enum_create("coll_libnbc_iallreduce_algorithms", iallreduce_algorithms, &new_enum);
     mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
                                     "iallreduce_algorithm",
-                                    "Which iallreduce algorithm is used: 0 ignore, 1 ring, 2 binomial, 3 rabenseifner, 4 recursive_doubling",
+                                    "Which iallreduce algorithm is used: 0 ignore, 1 ring, 2 binomial, 3 rabenseifner, 4 recursive_doubling, 5 pipeline",
                                     MCA_BASE_VAR_TYPE_INT, new_enum, 0, MCA_BASE_VAR_FLAG_SETTABLE,
                                     OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_ALL,
                                     &libnbc_iallreduce_algorithm);
@@ -236,7 +264,7 @@ libnbc_register(void)
     (void) mca_base_var_enum_create("coll_libnbc_ibcast_algorithms", ibcast_algorithms, &new_enum);
     mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
                                     "ibcast_algorithm",
-                                    "Which ibcast algorithm is used: 0 ignore, 1 linear, 2 binomial, 3 chain, 4 knomial",
+                                    "Which ibcast algorithm is used: 0 ignore, 1 linear, 2 binomial, 3 chain, 4 knomial, 5 pipeline",
                                     MCA_BASE_VAR_TYPE_INT, new_enum, 0, MCA_BASE_VAR_FLAG_SETTABLE,
                                     OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_ALL,
                                     &libnbc_ibcast_algorithm);
@@ -260,11 +288,31 @@ libnbc_register(void)
                                     &libnbc_iexscan_algorithm);
     OBJ_RELEASE(new_enum);
 
+    libnbc_ineighbor_allgather_algorithm = 0;
+    (void) mca_base_var_enum_create("coll_libnbc_ineighbor_allgather_algorithms", ineighbor_algorithms, &new_enum);
+    mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
+                                    "ineighbor_allgather_algorithm",
+                                    "Which ineighbor_allgather algorithm is used: 0 ignore, 1 linear, 2 node_aggregate",
+                                    MCA_BASE_VAR_TYPE_INT, new_enum, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                    OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_ALL,
+                                    &libnbc_ineighbor_allgather_algorithm);
+    OBJ_RELEASE(new_enum);
+
+    libnbc_ineighbor_alltoall_algorithm = 0;
+    (void) mca_base_var_enum_create("coll_libnbc_ineighbor_alltoall_algorithms", ineighbor_algorithms, &new_enum);
+    mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
+                                    "ineighbor_alltoall_algorithm",
+                                    "Which ineighbor_alltoall algorithm is used: 0 ignore, 1 linear, 2 node_aggregate",
+                                    MCA_BASE_VAR_TYPE_INT, new_enum, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                    OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_ALL,
+                                    &libnbc_ineighbor_alltoall_algorithm);
+    OBJ_RELEASE(new_enum);
+
     libnbc_ireduce_algorithm = 0;
     (void) mca_base_var_enum_create("coll_libnbc_ireduce_algorithms", ireduce_algorithms, &new_enum);
     mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
                                     "ireduce_algorithm",
-                                    "Which ireduce algorithm is used: 0 ignore, 1 chain, 2 binomial, 3 rabenseifner",
+                                    "Which ireduce algorithm is used: 0 ignore, 1 chain, 2 binomial, 3 rabenseifner, 4 pipeline",
                                     MCA_BASE_VAR_TYPE_INT, new_enum, 0, MCA_BASE_VAR_FLAG_SETTABLE,
                                     OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_ALL,
                                     &libnbc_ireduce_algorithm);
@@ -280,6 +328,59 @@ libnbc_register(void)
                                     &libnbc_iscan_algorithm);
     OBJ_RELEASE(new_enum);
 
+    libnbc_pipeline_segsize = 262144;
+    (void) mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
+                                           "pipeline_segsize",
+                                           "Size in bytes of the segments of the pipelined iallreduce, ibcast and ireduce. Each segment runs its own schedule, and the rounds of different segments overlap. Messages of at least four segments are pipelined by default (0: never pipeline by default)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_5,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &libnbc_pipeline_segsize);
+
+    libnbc_pipeline_depth = 4;
+    (void) mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
+                                           "pipeline_depth",
+                                           "Number of segments of a pipelined collective in flight at the same time",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_5,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &libnbc_pipeline_depth);
+
+    libnbc_schedule_cache_size = 16;
+    (void) mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
+                                           "schedule_cache_size",
+                                           "Number of schedules of nonblocking collectives kept per communicator, to be reused by the next call with the same arguments. The least recently used schedule is dropped first. Each cached schedule keeps its temporary buffer (0: no cache)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_5,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &libnbc_schedule_cache_size);
+
+    libnbc_neighbor_aggregate_max = 0;
+    (void) mca_base_component_var_register(&mca_coll_libnbc_component.super.collm_version,
+                                           "neighbor_aggregate_max",
+                                           "Largest block in bytes of ineighbor_allgather and ineighbor_alltoall that is aggregated per node: the blocks a process sends to several neighbors on the same remote node go in a single message to one of them, which forwards the others inside the node. The plan is built by the first neighborhood collective on a communicator, which then synchronizes all its processes (0: only aggregate when the node_aggregate algorithm is selected)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_5,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &libnbc_neighbor_aggregate_max);
+
+    mca_coll_libnbc_component.sched_cache_hits = 0;
+    (void) mca_base_component_pvar_register(&mca_coll_libnbc_component.super.collm_version,
+                                            "schedule_cache_hits", "Number of nonblocking collectives that "
+                                            "reused a cached schedule", OPAL_INFO_LVL_4, MCA_BASE_PVAR_CLASS_COUNTER,
+                                            MCA_BASE_VAR_TYPE_UNSIGNED_LONG, NULL, MCA_BASE_VAR_BIND_NO_OBJECT,
+                                            MCA_BASE_PVAR_FLAG_READONLY | MCA_BASE_PVAR_FLAG_CONTINUOUS,
+                                            NULL, NULL, NULL, (void *) &mca_coll_libnbc_component.sched_cache_hits);
+
+    mca_coll_libnbc_component.sched_cache_misses = 0;
+    (void) mca_base_component_pvar_register(&mca_coll_libnbc_component.super.collm_version,
+                                            "schedule_cache_misses", "Number of nonblocking collectives that "
+                                            "found no cached schedule and built one", OPAL_INFO_LVL_4,
+                                            MCA_BASE_PVAR_CLASS_COUNTER, MCA_BASE_VAR_TYPE_UNSIGNED_LONG, NULL,
+                                            MCA_BASE_VAR_BIND_NO_OBJECT,
+                                            MCA_BASE_PVAR_FLAG_READONLY | MCA_BASE_PVAR_FLAG_CONTINUOUS,
+                                            NULL, NULL, NULL, (void *) &mca_coll_libnbc_component.sched_cache_misses);
+
     return OMPI_SUCCESS;
 }
 
@@ -460,6 +561,7 @@ ompi_coll_libnbc_progress(void)
                 if(request->super.super.req_persistent) {
                     /* reset for the next communication */
                     request->row_offset = 0;
+                    request->plan_offset = 0;
                 }
                 if(!request->super.super.req_persistent || !REQUEST_COMPLETE(&request->super.super)) {
             	    ompi_request_complete(&request->super.super, true);
@@ -479,7 +581,10 @@ static void
 libnbc_module_construct(ompi_coll_libnbc_module_t *module)
 {
     OBJ_CONSTRUCT(&module->mutex, opal_mutex_t);
+    OBJ_CONSTRUCT(&module->sched_cache, opal_list_t);
     module->comm_registered = false;
+    module->nbr_plan_done = false;
+    module->nbr_plan = NULL;
 }
 
 
@@ -487,6 +592,9 @@ static void
 libnbc_module_destruct(ompi_coll_libnbc_module_t *module)
 {
     OBJ_DESTRUCT(&module->mutex);
+    /* the requests still using a cached schedule hold a reference on it */
+    OPAL_LIST_DESTRUCT(&module->sched_cache);
+    NBC_Nbr_plan_free (module->nbr_plan);
 
     /* if we ever were used for a collective op, do the progress cleanup. */
     if (true == module->comm_registered) {
@@ -561,7 +669,9 @@ request_free(struct ompi_request_t **ompi_req)
         return MPI_ERR_REQUEST;
     }
 
-    OMPI_COLL_LIBNBC_REQUEST_RETURN(request);
+    /* persistent requests keep their schedule, temporary buffer and
+     * plan until they are freed */
+    NBC_Return_handle(request);
     *ompi_req = MPI_REQUEST_NULL;
 
     return OMPI_SUCCESS;
@@ -3,7 +3,7 @@
  * Copyright (c) 2006      The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2013-2018 The University of Tennessee and The University
+ * Copyright (c) 2013-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2006      The Technical University of Chemnitz. All
@@ -49,11 +49,23 @@ static void nbc_schedule_constructor (NBC_Schedule *schedule) {
   schedule->size = sizeof (int);
   schedule->current_round_offset = 0;
   schedule->data = calloc (1, schedule->size);
+  schedule->segments = NULL;
+  schedule->segment_tmpoffs = NULL;
+  schedule->segment_count = 0;
 }
 
 static void nbc_schedule_destructor (NBC_Schedule *schedule) {
   free (schedule->data);
   schedule->data = NULL;
+
+  for (int i = 0 ; i < schedule->segment_count ; ++i) {
+    OBJ_RELEASE(schedule->segments[i]);
+  }
+  free (schedule->segments);
+  free (schedule->segment_tmpoffs);
+  schedule->segments = NULL;
+  schedule->segment_tmpoffs = NULL;
+  schedule->segment_count = 0;
 }
 
 OBJ_CLASS_INSTANCE(NBC_Schedule, opal_object_t, nbc_schedule_constructor,
@@ -291,24 +303,144 @@ int NBC_Sched_commit(NBC_Schedule *schedule) {
   return OMPI_SUCCESS;
 }
 
+/* appends the schedule of a segment to a pipelined schedule, which
+ * takes over the reference on segment. The temporary buffer of the
+ * segment starts at tmpoffset in the temporary buffer of the request. */
+int NBC_Sched_segment (NBC_Schedule *schedule, NBC_Schedule *segment, ptrdiff_t tmpoffset) {
+  NBC_Schedule **segments;
+  ptrdiff_t *tmpoffs;
+
+  segments = (NBC_Schedule **) realloc (schedule->segments, (schedule->segment_count + 1) * sizeof (NBC_Schedule *));
+  if (NULL == segments) {
+    return OMPI_ERR_OUT_OF_RESOURCE;
+  }
+  schedule->segments = segments;
+
+  tmpoffs = (ptrdiff_t *) realloc (schedule->segment_tmpoffs, (schedule->segment_count + 1) * sizeof (ptrdiff_t));
+  if (NULL == tmpoffs) {
+    return OMPI_ERR_OUT_OF_RESOURCE;
+  }
+  schedule->segment_tmpoffs = tmpoffs;
+
+  segments[schedule->segment_count] = segment;
+  tmpoffs[schedule->segment_count] = tmpoffset;
+  ++schedule->segment_count;
+
+  NBC_DEBUG(10, "added segment %i to schedule %p\n", schedule->segment_count, schedule);
+
+  return OMPI_SUCCESS;
+}
+
 /* finishes a request
  *
  * to be called *only* from the progress thread !!! */
 static inline void NBC_Free (NBC_Handle* handle) {
 
+  if (NULL != handle->segments) {
+    for (int i = 0 ; i < handle->segment_count ; ++i) {
+      NBC_Return_handle (handle->segments[i]);
+    }
+    free(handle->segments);
+    handle->segments = NULL;
+    handle->segment_count = 0;
+  }
+
+  if (NULL != handle->plan_reqs) {
+    for (int i = 0 ; i < handle->plan_size ; ++i) {
+      if (MPI_REQUEST_NULL != handle->plan_reqs[i]) {
+        ompi_request_free(handle->plan_reqs + i);
+      }
+    }
+    free(handle->plan_reqs);
+    handle->plan_reqs = NULL;
+    handle->plan_size = 0;
+  }
+
   if (NULL != handle->schedule) {
     /* release schedule */
     OBJ_RELEASE (handle->schedule);
     handle->schedule = NULL;
   }
 
-  /* if the nbc_I<collective> attached some data */
-  /* problems with schedule cache here, see comment (TODO) in
-   * nbc_internal.h */
-  if (NULL != handle->tmpbuf) {
+  /* if the nbc_I<collective> attached some data. The temporary buffer
+   * of a segment belongs to the pipelined request, and the one of a
+   * cached schedule to the cache. */
+  if (NULL != handle->cache_entry) {
+    opal_atomic_wmb ();
+    handle->cache_entry->busy = false;
+    OBJ_RELEASE(handle->cache_entry);
+    handle->cache_entry = NULL;
+  } else if (NULL != handle->tmpbuf && NULL == handle->parent) {
     free((void*)handle->tmpbuf);
-    handle->tmpbuf = NULL;
   }
+  handle->tmpbuf = NULL;
+}
+
+/* starts segments of a pipelined request until libnbc_pipeline_depth
+ * of them are in flight */
+static int NBC_Start_segments(NBC_Handle *handle) {
+  int depth = libnbc_pipeline_depth > 0 ? libnbc_pipeline_depth : 1;
+  int res;
+
+  while (handle->segment_started < handle->segment_count &&
+         handle->segment_started - handle->segment_done < depth) {
+    res = NBC_Start_round(handle->segments[handle->segment_started]);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      return res;
+    }
+    ++handle->segment_started;
+  }
+
+  return OMPI_SUCCESS;
+}
+
+/* progresses the segments in flight of a pipelined request: each of
+ * them goes through its rounds on its own, so the rounds of different
+ * segments overlap */
+static int NBC_Progress_segments(NBC_Handle *handle) {
+  int res;
+
+  for (int i = 0 ; i < handle->segment_started ; ++i) {
+    NBC_Handle *segment = handle->segments[i];
+
+    if (segment->nbc_complete) {
+      continue;
+    }
+
+    res = NBC_Progress(segment);
+    if (NBC_CONTINUE == res) {
+      continue;
+    }
+    if (OPAL_UNLIKELY(NBC_OK != res)) {
+      /* the segment is aborted, report the error once all of them are over */
+      segment->nbc_complete = true;
+      handle->super.super.req_status.MPI_ERROR = res;
+    }
+    ++handle->segment_done;
+  }
+
+  if (handle->segment_done < handle->segment_count) {
+    if (OMPI_SUCCESS == handle->super.super.req_status.MPI_ERROR) {
+      res = NBC_Start_segments(handle);
+      if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        NBC_Error ("Error in NBC_Start_segments() (%i)", res);
+        handle->super.super.req_status.MPI_ERROR = res;
+      }
+    }
+    /* do not start anything after an error, wait for the segments in flight */
+    if (handle->segment_done < handle->segment_started ||
+        OMPI_SUCCESS == handle->super.super.req_status.MPI_ERROR) {
+      return NBC_CONTINUE;
+    }
+  }
+
+  res = handle->super.super.req_status.MPI_ERROR;
+  handle->nbc_complete = true;
+  if (!handle->super.super.req_persistent) {
+    NBC_Free(handle);
+  }
+
+  return (OMPI_SUCCESS == res) ? NBC_OK : res;
 }
 
 /* progresses a request
@@ -324,6 +456,10 @@ int NBC_Progress(NBC_Handle *handle) {
     return NBC_OK;
   }
 
+  if (NULL != handle->segments) {
+    return NBC_Progress_segments(handle);
+  }
+
   flag = true;
 
   if ((handle->req_count > 0) && (handle->req_array != NULL)) {
@@ -342,7 +478,9 @@ int NBC_Progress(NBC_Handle *handle) {
                 handle->super.super.req_status.MPI_ERROR = subreq->req_status.MPI_ERROR;
             }
             handle->req_count--;
-            ompi_request_free(&subreq);
+            if (NULL == handle->plan_reqs) {
+                ompi_request_free(&subreq);
+            }
         } else {
             flag = false;
             break;
@@ -357,8 +495,10 @@ int NBC_Progress(NBC_Handle *handle) {
   if (flag) {
     /* reset handle for next round */
     if (NULL != handle->req_array) {
-      /* free request array */
-      free (handle->req_array);
+      /* free request array (the plan of a persistent request is kept) */
+      if (NULL == handle->plan_reqs) {
+        free (handle->req_array);
+      }
       handle->req_array = NULL;
     }
 
@@ -430,6 +570,11 @@ static inline int NBC_Start_round(NBC_Handle *handle) {
   NBC_GET_BYTES(ptr,num);
   NBC_DEBUG(10, "start_round round at offset %d : posting %i operations\n", handle->row_offset, num);
 
+  if (NULL != handle->plan_reqs) {
+    /* the requests of this round were created at init time */
+    handle->req_array = handle->plan_reqs + handle->plan_offset;
+  }
+
   for (int i = 0 ; i < num ; ++i) {
     int offset = (intptr_t)(ptr - handle->schedule->data);
 
@@ -442,6 +587,14 @@ static inline int NBC_Start_round(NBC_Handle *handle) {
                   sendargs.count, sendargs.datatype, sendargs.dest, handle->tag);
         /* get an additional request */
         handle->req_count++;
+        if (NULL != handle->plan_reqs) {
+          res = MCA_PML_CALL(start(1, handle->req_array + handle->req_count - 1));
+          if (OMPI_SUCCESS != res) {
+            NBC_Error ("Error in MPI_Start of a persistent send to %i (%i)", sendargs.dest, res);
+            return res;
+          }
+          break;
+        }
         /* get buffer */
         if(sendargs.tmpbuf) {
           buf1=(char*)handle->tmpbuf+(long)sendargs.buf;
@@ -477,6 +630,14 @@ static inline int NBC_Start_round(NBC_Handle *handle) {
                   recvargs.datatype, recvargs.source, handle->tag);
         /* get an additional request - TODO: req_count NOT thread safe */
         handle->req_count++;
+        if (NULL != handle->plan_reqs) {
+          res = MCA_PML_CALL(start(1, handle->req_array + handle->req_count - 1));
+          if (OMPI_SUCCESS != res) {
+            NBC_Error ("Error in MPI_Start of a persistent receive from %i (%i)", recvargs.source, res);
+            return res;
+          }
+          break;
+        }
         /* get buffer */
         if(recvargs.tmpbuf) {
           buf1=(char*)handle->tmpbuf+(long)recvargs.buf;
@@ -574,6 +735,10 @@ static inline int NBC_Start_round(NBC_Handle *handle) {
     }
   }
 
+  if (NULL != handle->plan_reqs) {
+    handle->plan_offset += handle->req_count;
+  }
+
   /* check if we can make progress - not in the first round, this allows us to leave the
    * initialization faster and to reach more overlap
    *
@@ -646,6 +811,93 @@ int  NBC_Init_comm(MPI_Comm comm, NBC_Comminfo *comminfo) {
   return OMPI_SUCCESS;
 }
 
+/* walks all rounds of the schedule of a persistent request and creates
+ * an inactive persistent request for every send and receive, so that
+ * NBC_Start_round only has to restart them. With reqs == NULL the
+ * point-to-point operations are only counted. */
+static int NBC_Plan_walk(NBC_Handle *handle, ompi_request_t **reqs, int *count) {
+  char *ptr = handle->schedule->data;
+  NBC_Fn_type type;
+  NBC_Args_send sendargs;
+  NBC_Args_recv recvargs;
+  void *buf;
+  int num, res;
+
+  *count = 0;
+  while (1) {
+    NBC_GET_BYTES(ptr,num);
+    for (int i = 0 ; i < num ; ++i) {
+      memcpy (&type, ptr, sizeof (type));
+      switch(type) {
+        case SEND:
+          NBC_GET_BYTES(ptr,sendargs);
+          if (NULL != reqs) {
+            buf = sendargs.tmpbuf ? (char*)handle->tmpbuf+(long)sendargs.buf : (void *)sendargs.buf;
+            res = MCA_PML_CALL(isend_init(buf, sendargs.count, sendargs.datatype, sendargs.dest, handle->tag,
+                                          MCA_PML_BASE_SEND_STANDARD,
+                                          sendargs.local?handle->comm->c_local_comm:handle->comm,
+                                          reqs + *count));
+            if (OMPI_SUCCESS != res) {
+              return res;
+            }
+          }
+          ++*count;
+          break;
+        case RECV:
+          NBC_GET_BYTES(ptr,recvargs);
+          if (NULL != reqs) {
+            buf = recvargs.tmpbuf ? (char*)handle->tmpbuf+(long)recvargs.buf : recvargs.buf;
+            res = MCA_PML_CALL(irecv_init(buf, recvargs.count, recvargs.datatype, recvargs.source, handle->tag,
+                                          recvargs.local?handle->comm->c_local_comm:handle->comm,
+                                          reqs + *count));
+            if (OMPI_SUCCESS != res) {
+              return res;
+            }
+          }
+          ++*count;
+          break;
+        case OP:
+          ptr += sizeof (NBC_Args_op);
+          break;
+        case COPY:
+          ptr += sizeof (NBC_Args_copy);
+          break;
+        case UNPACK:
+          ptr += sizeof (NBC_Args_unpack);
+          break;
+        default:
+          NBC_Error ("NBC_Plan_walk: bad type %li", (long)type);
+          return OMPI_ERROR;
+      }
+    }
+    /* round delimiter: 0 ends the schedule */
+    if (0 == *ptr) {
+      return OMPI_SUCCESS;
+    }
+    ++ptr;
+  }
+}
+
+static int NBC_Plan_build(NBC_Handle *handle) {
+  int res, count;
+
+  res = NBC_Plan_walk(handle, NULL, &count);
+  if (OMPI_SUCCESS != res || 0 == count) {
+    return res;
+  }
+
+  handle->plan_reqs = (ompi_request_t **) malloc (count * sizeof (ompi_request_t *));
+  if (NULL == handle->plan_reqs) {
+    return OMPI_ERR_OUT_OF_RESOURCE;
+  }
+  for (int i = 0 ; i < count ; ++i) {
+    handle->plan_reqs[i] = MPI_REQUEST_NULL;
+  }
+  handle->plan_size = count;
+
+  return NBC_Plan_walk(handle, handle->plan_reqs, &count);
+}
+
 int NBC_Start(NBC_Handle *handle) {
   int res;
 
@@ -657,7 +909,11 @@ int NBC_Start(NBC_Handle *handle) {
   /* kick off first round */
   handle->super.super.req_state = OMPI_REQUEST_ACTIVE;
   handle->super.super.req_status.MPI_ERROR = OMPI_SUCCESS;
-  res = NBC_Start_round(handle);
+  if (NULL != handle->segments) {
+    res = NBC_Start_segments(handle);
+  } else {
+    res = NBC_Start_round(handle);
+  }
   if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
     return res;
   }
@@ -669,6 +925,74 @@ int NBC_Start(NBC_Handle *handle) {
   return OMPI_SUCCESS;
 }
 
+/* reserves ntags tags, from the returned one downwards, for the next
+ * collective. All the processes reserve the same number of tags for a
+ * given collective, so they keep agreeing on the tags.
+ *
+ * to be called with module->mutex held */
+static int nbc_get_tags(ompi_coll_libnbc_module_t *module, int ntags) {
+  int tag = module->tag;
+
+  if (tag - ntags < MCA_COLL_BASE_TAG_NONBLOCKING_END) {
+    tag = MCA_COLL_BASE_TAG_NONBLOCKING_BASE;
+    NBC_DEBUG(2,"resetting tags ...\n");
+  }
+  module->tag = tag - ntags;
+
+  return tag;
+}
+
+static void nbc_handle_init(NBC_Handle *handle, ompi_communicator_t *comm,
+                            ompi_coll_libnbc_module_t *module, bool persistent) {
+  handle->tmpbuf = NULL;
+  handle->req_count = 0;
+  handle->req_array = NULL;
+  handle->plan_reqs = NULL;
+  handle->plan_size = 0;
+  handle->plan_offset = 0;
+  handle->segments = NULL;
+  handle->segment_count = 0;
+  handle->segment_started = 0;
+  handle->segment_done = 0;
+  handle->parent = NULL;
+  handle->cache_entry = NULL;
+  handle->comm = comm;
+  handle->comminfo = module;
+  handle->schedule = NULL;
+  handle->row_offset = 0;
+  handle->nbc_complete = persistent ? true : false;
+}
+
+/* creates a request for every segment of the pipelined schedule of
+ * handle. The segments use the tags reserved below the one of handle,
+ * and share its temporary buffer. */
+static int NBC_Segments_create(NBC_Handle *handle, NBC_Schedule *schedule) {
+  ompi_communicator_t *comm = handle->comm;
+  NBC_Handle *segment;
+
+  handle->segments = (NBC_Handle **) calloc (schedule->segment_count, sizeof (NBC_Handle *));
+  if (NULL == handle->segments) {
+    return OMPI_ERR_OUT_OF_RESOURCE;
+  }
+
+  for (int i = 0 ; i < schedule->segment_count ; ++i) {
+    OMPI_COLL_LIBNBC_REQUEST_ALLOC(comm, false, segment);
+    if (NULL == segment) {
+      return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    nbc_handle_init(segment, comm, handle->comminfo, false);
+    segment->tag = handle->tag - i;
+    segment->parent = handle;
+    segment->schedule = schedule->segments[i];
+    OBJ_RETAIN(segment->schedule);
+    segment->tmpbuf = (char *) handle->tmpbuf + schedule->segment_tmpoffs[i];
+    handle->segments[i] = segment;
+    ++handle->segment_count;
+  }
+
+  return OMPI_SUCCESS;
+}
+
 int NBC_Schedule_request(NBC_Schedule *schedule, ompi_communicator_t *comm,
                          ompi_coll_libnbc_module_t *module, bool persistent,
                          ompi_request_t **request, void *tmpbuf) {
@@ -677,7 +1001,8 @@ int NBC_Schedule_request(NBC_Schedule *schedule, ompi_communicator_t *comm,
   ompi_coll_libnbc_request_t *handle;
 
   /* no operation (e.g. one process barrier)? */
-  if (((int *)schedule->data)[0] == 0 && schedule->data[sizeof(int)] == 0) {
+  if (0 == schedule->segment_count &&
+      ((int *)schedule->data)[0] == 0 && schedule->data[sizeof(int)] == 0) {
     ret = nbc_get_noop_request(persistent, request);
     if (OMPI_SUCCESS != ret) {
       return OMPI_ERR_OUT_OF_RESOURCE;
@@ -686,11 +1011,7 @@ int NBC_Schedule_request(NBC_Schedule *schedule, ompi_communicator_t *comm,
     /* update the module->tag here because other processes may have operations
      * and they may update the module->tag */
     OPAL_THREAD_LOCK(&module->mutex);
-    tmp_tag = module->tag--;
-    if (tmp_tag == MCA_COLL_BASE_TAG_NONBLOCKING_END) {
-      tmp_tag = module->tag = MCA_COLL_BASE_TAG_NONBLOCKING_BASE;
-      NBC_DEBUG(2,"resetting tags ...\n");
-    }
+    (void) nbc_get_tags(module, 1);
     OPAL_THREAD_UNLOCK(&module->mutex);
 
     OBJ_RELEASE(schedule);
@@ -702,22 +1023,13 @@ int NBC_Schedule_request(NBC_Schedule *schedule, ompi_communicator_t *comm,
   OMPI_COLL_LIBNBC_REQUEST_ALLOC(comm, persistent, handle);
   if (NULL == handle) return OMPI_ERR_OUT_OF_RESOURCE;
 
-  handle->tmpbuf = NULL;
-  handle->req_count = 0;
-  handle->req_array = NULL;
-  handle->comm = comm;
-  handle->schedule = NULL;
-  handle->row_offset = 0;
-  handle->nbc_complete = persistent ? true : false;
+  nbc_handle_init(handle, comm, module, persistent);
 
   /******************** Do the tag and shadow comm administration ...  ***************/
 
+  /* every segment of a pipelined schedule communicates with its own tag */
   OPAL_THREAD_LOCK(&module->mutex);
-  tmp_tag = module->tag--;
-  if (tmp_tag == MCA_COLL_BASE_TAG_NONBLOCKING_END) {
-      tmp_tag = module->tag = MCA_COLL_BASE_TAG_NONBLOCKING_BASE;
-      NBC_DEBUG(2,"resetting tags ...\n");
-  }
+  tmp_tag = nbc_get_tags(module, schedule->segment_count > 0 ? schedule->segment_count : 1);
 
   if (true != module->comm_registered) {
       module->comm_registered = true;
@@ -746,11 +1058,271 @@ int NBC_Schedule_request(NBC_Schedule *schedule, ompi_communicator_t *comm,
 
   handle->tmpbuf = tmpbuf;
   handle->schedule = schedule;
+
+  /* pipelined schedules are only built for non persistent requests */
+  if (schedule->segment_count > 0) {
+    ret = NBC_Segments_create(handle, schedule);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != ret)) {
+      handle->schedule = NULL;
+      handle->tmpbuf = NULL;
+      NBC_Return_handle(handle);
+      return ret;
+    }
+  }
+
+  if (persistent && libnbc_persistent_plan) {
+    ret = NBC_Plan_build(handle);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != ret)) {
+      /* the caller still owns the schedule and the temporary buffer */
+      handle->schedule = NULL;
+      handle->tmpbuf = NULL;
+      NBC_Return_handle(handle);
+      return ret;
+    }
+  }
+
   *request = (ompi_request_t *) handle;
 
   return OMPI_SUCCESS;
 }
 
+void NBC_Sched_key_init (NBC_Sched_key *key, int coll) {
+  key->coll = coll;
+  key->valid = libnbc_schedule_cache_size > 0;
+  key->hash = 2166136261u;
+  key->size = 0;
+  key->alloc = sizeof (key->inline_args);
+  key->args = key->inline_args;
+  key->ntypes = 0;
+  key->types_alloc = 2;
+  key->types = key->inline_types;
+  key->op = NULL;
+}
+
+/* appends size bytes to the packed arguments of key (FNV-1a hash) */
+void NBC_Sched_key_add (NBC_Sched_key *key, const void *data, size_t size) {
+  const unsigned char *bytes = (const unsigned char *) data;
+
+  if (!key->valid) {
+    return;
+  }
+
+  if (key->size + size > key->alloc) {
+    size_t alloc = 2 * key->alloc > key->size + size ? 2 * key->alloc : key->size + size;
+    char *args;
+
+    if (key->args == key->inline_args) {
+      args = (char *) malloc (alloc);
+      if (NULL != args) {
+        memcpy (args, key->inline_args, key->size);
+      }
+    } else {
+      args = (char *) realloc (key->args, alloc);
+    }
+    if (OPAL_UNLIKELY(NULL == args)) {
+      /* not worth failing the collective, just do not cache it */
+      key->valid = false;
+      return;
+    }
+    key->args = args;
+    key->alloc = alloc;
+  }
+
+  memcpy (key->args + key->size, data, size);
+  key->size += size;
+  for (size_t i = 0 ; i < size ; ++i) {
+    key->hash = (key->hash ^ bytes[i]) * 16777619u;
+  }
+}
+
+void NBC_Sched_key_add_types (NBC_Sched_key *key, const MPI_Datatype *types, int count) {
+  NBC_Sched_key_add (key, types, count * sizeof (MPI_Datatype));
+  if (!key->valid) {
+    return;
+  }
+
+  if (key->ntypes + count > key->types_alloc) {
+    int alloc = 2 * key->types_alloc > key->ntypes + count ? 2 * key->types_alloc : key->ntypes + count;
+    MPI_Datatype *tmp;
+
+    if (key->types == key->inline_types) {
+      tmp = (MPI_Datatype *) malloc (alloc * sizeof (MPI_Datatype));
+      if (NULL != tmp) {
+        memcpy (tmp, key->inline_types, key->ntypes * sizeof (MPI_Datatype));
+      }
+    } else {
+      tmp = (MPI_Datatype *) realloc (key->types, alloc * sizeof (MPI_Datatype));
+    }
+    if (OPAL_UNLIKELY(NULL == tmp)) {
+      key->valid = false;
+      return;
+    }
+    key->types = tmp;
+    key->types_alloc = alloc;
+  }
+
+  memcpy (key->types + key->ntypes, types, count * sizeof (MPI_Datatype));
+  key->ntypes += count;
+}
+
+void NBC_Sched_key_add_op (NBC_Sched_key *key, MPI_Op op) {
+  NBC_Sched_key_add (key, &op, sizeof (op));
+  key->op = op;
+}
+
+void NBC_Sched_key_fini (NBC_Sched_key *key) {
+  if (key->args != key->inline_args) {
+    free (key->args);
+  }
+  if (key->types != key->inline_types) {
+    free (key->types);
+  }
+  key->args = key->inline_args;
+  key->types = key->inline_types;
+  key->valid = false;
+}
+
+static void nbc_sched_cache_entry_constructor (NBC_Sched_cache_entry *entry) {
+  entry->args = NULL;
+  entry->ntypes = 0;
+  entry->types = NULL;
+  entry->op = NULL;
+  entry->schedule = NULL;
+  entry->tmpbuf = NULL;
+  entry->busy = false;
+}
+
+static void nbc_sched_cache_entry_destructor (NBC_Sched_cache_entry *entry) {
+  if (NULL != entry->schedule) {
+    OBJ_RELEASE(entry->schedule);
+  }
+  free (entry->tmpbuf);
+  for (int i = 0 ; i < entry->ntypes ; ++i) {
+    OBJ_RELEASE(entry->types[i]);
+  }
+  free (entry->types);
+  if (NULL != entry->op) {
+    OBJ_RELEASE(entry->op);
+  }
+  free (entry->args);
+}
+
+OBJ_CLASS_INSTANCE(NBC_Sched_cache_entry, opal_list_item_t, nbc_sched_cache_entry_constructor,
+                   nbc_sched_cache_entry_destructor);
+
+static inline bool nbc_sched_key_equal (const NBC_Sched_cache_entry *entry, const NBC_Sched_key *key) {
+  return entry->hash == key->hash && entry->coll == key->coll && entry->size == key->size &&
+    0 == memcmp (entry->args, key->args, key->size);
+}
+
+/* creates a request from a cached schedule built for the same
+ * arguments, if there is one that no other request uses. The cache is
+ * kept in least recently used order, the entry found moves to the
+ * front. Returns OMPI_ERR_NOT_FOUND otherwise. */
+int NBC_Sched_cache_request (NBC_Sched_key *key, ompi_communicator_t *comm,
+                             ompi_coll_libnbc_module_t *module, ompi_request_t **request) {
+  NBC_Sched_cache_entry *entry, *found = NULL;
+  int res;
+
+  if (!key->valid) {
+    return OMPI_ERR_NOT_FOUND;
+  }
+
+  OPAL_THREAD_LOCK(&module->mutex);
+  OPAL_LIST_FOREACH(entry, &module->sched_cache, NBC_Sched_cache_entry) {
+    if (!entry->busy && nbc_sched_key_equal (entry, key)) {
+      entry->busy = true;
+      found = entry;
+      opal_list_remove_item (&module->sched_cache, &entry->super);
+      opal_list_prepend (&module->sched_cache, &entry->super);
+      break;
+    }
+  }
+  OPAL_THREAD_UNLOCK(&module->mutex);
+
+  if (NULL == found) {
+    (void) opal_atomic_fetch_add_size_t (&mca_coll_libnbc_component.sched_cache_misses, 1);
+    return OMPI_ERR_NOT_FOUND;
+  }
+
+  OBJ_RETAIN(found->schedule);
+  res = NBC_Schedule_request (found->schedule, comm, module, false, request, found->tmpbuf);
+  if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+    OBJ_RELEASE(found->schedule);
+    found->busy = false;
+    return res;
+  }
+
+  /* the request gives the temporary buffer back to the cache */
+  OBJ_RETAIN(found);
+  ((NBC_Handle *) *request)->cache_entry = found;
+  (void) opal_atomic_fetch_add_size_t (&mca_coll_libnbc_component.sched_cache_hits, 1);
+
+  return OMPI_SUCCESS;
+}
+
+/* keeps the schedule and the temporary buffer of a request that was
+ * just created for the arguments in key, so that the next identical
+ * collective on the communicator does not have to build them again.
+ * Once the cache holds libnbc_schedule_cache_size schedules, the least
+ * recently used one that is not in use is dropped. */
+void NBC_Sched_cache_insert (NBC_Sched_key *key, ompi_coll_libnbc_module_t *module,
+                             ompi_request_t *request) {
+  NBC_Handle *handle = (NBC_Handle *) request;
+  NBC_Sched_cache_entry *entry;
+
+  if (!key->valid || &ompi_request_empty == request || NULL != handle->cache_entry) {
+    return;
+  }
+
+  entry = OBJ_NEW(NBC_Sched_cache_entry);
+  if (OPAL_UNLIKELY(NULL == entry)) {
+    return;
+  }
+
+  entry->args = (char *) malloc (key->size);
+  entry->types = (MPI_Datatype *) malloc (key->ntypes * sizeof (MPI_Datatype));
+  if (OPAL_UNLIKELY(NULL == entry->args || (key->ntypes > 0 && NULL == entry->types))) {
+    OBJ_RELEASE(entry);
+    return;
+  }
+
+  entry->coll = key->coll;
+  entry->hash = key->hash;
+  entry->size = key->size;
+  memcpy (entry->args, key->args, key->size);
+  entry->ntypes = key->ntypes;
+  for (int i = 0 ; i < key->ntypes ; ++i) {
+    entry->types[i] = key->types[i];
+    OBJ_RETAIN(entry->types[i]);
+  }
+  if (NULL != key->op) {
+    entry->op = key->op;
+    OBJ_RETAIN(entry->op);
+  }
+  entry->schedule = handle->schedule;
+  OBJ_RETAIN(entry->schedule);
+  entry->tmpbuf = handle->tmpbuf;
+  entry->busy = true;
+
+  /* one reference for the cache, one for the request */
+  OBJ_RETAIN(entry);
+  handle->cache_entry = entry;
+
+  OPAL_THREAD_LOCK(&module->mutex);
+  opal_list_prepend (&module->sched_cache, &entry->super);
+  if ((int) opal_list_get_size (&module->sched_cache) > libnbc_schedule_cache_size) {
+    OPAL_LIST_FOREACH_REV(entry, &module->sched_cache, NBC_Sched_cache_entry) {
+      if (!entry->busy) {
+        opal_list_remove_item (&module->sched_cache, &entry->super);
+        OBJ_RELEASE(entry);
+        break;
+      }
+    }
+  }
+  OPAL_THREAD_UNLOCK(&module->mutex);
+}
+
 #ifdef NBC_CACHE_SCHEDULE
 void NBC_SchedCache_args_delete_key_dummy(void *k) {
     /* do nothing because the key and the data element are identical :-)
@@ -49,6 +49,28 @@ int NBC_Allgather_args_compare(NBC_Allgather_args *a, NBC_Allgather_args *b, voi
 }
 #endif
 
+/* a nonblocking allgather copies the block of the calling process to
+ * the receive buffer at once, rather than in its schedule */
+static int nbc_allgather_copy_local(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf,
+                                    int recvcount, MPI_Datatype recvtype, struct ompi_communicator_t *comm)
+{
+  MPI_Aint rcvext;
+  char *rbuf;
+  int res;
+
+  if (MPI_IN_PLACE == sendbuf || sendbuf == recvbuf) {
+    return OMPI_SUCCESS;
+  }
+
+  res = ompi_datatype_type_extent(recvtype, &rcvext);
+  if (MPI_SUCCESS != res) {
+    return res;
+  }
+
+  rbuf = (char *) recvbuf + ompi_comm_rank (comm) * recvcount * rcvext;
+  return NBC_Copy (sendbuf, sendcount, sendtype, rbuf, recvcount, recvtype, comm);
+}
+
 static int nbc_allgather_init(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
                               MPI_Datatype recvtype, struct ompi_communicator_t *comm, ompi_request_t ** request,
                               struct mca_coll_base_module_2_3_0_t *module, bool persistent)
@@ -92,8 +114,7 @@ static int nbc_allgather_init(const void* sendbuf, int sendcount, MPI_Datatype s
     sendcount = recvcount;
   } else if (!persistent) { /* for persistent, the copy must be scheduled */
     /* copy my data to receive buffer */
-    rbuf = (char *) recvbuf + rank * recvcount * rcvext;
-    res = NBC_Copy (sendbuf, sendcount, sendtype, rbuf, recvcount, recvtype, comm);
+    res = nbc_allgather_copy_local (sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
       return res;
     }
@@ -194,8 +215,34 @@ int ompi_coll_libnbc_iallgather(const void* sendbuf, int sendcount, MPI_Datatype
                                 MPI_Datatype recvtype, struct ompi_communicator_t *comm, ompi_request_t ** request,
                                 struct mca_coll_base_module_2_3_0_t *module)
 {
-    int res = nbc_allgather_init(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype,
+    NBC_Sched_key key;
+    int res;
+
+    NBC_Sched_key_init (&key, NBC_ALLGATHER);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    if (MPI_IN_PLACE != sendbuf) {
+        NBC_SCHED_KEY_ADD(&key, sendcount);
+        NBC_Sched_key_add_types (&key, &sendtype, 1);
+    }
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    NBC_SCHED_KEY_ADD(&key, recvcount);
+    NBC_Sched_key_add_types (&key, &recvtype, 1);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_SUCCESS == res) {
+        /* the local block is not part of the schedule */
+        res = nbc_allgather_copy_local(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+        if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+            NBC_Return_handle (*(ompi_coll_libnbc_request_t **)request);
+            *request = &ompi_request_null.request;
+        }
+    } else if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_allgather_init(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype,
                                  comm, request, module, false);
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
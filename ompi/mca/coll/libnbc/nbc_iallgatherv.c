@@ -22,9 +22,29 @@
  */
 #include "nbc_internal.h"
 
-/* an allgatherv schedule can not be cached easily because the contents
- * ot the recvcounts array may change, so a comparison of the address
- * would not be sufficient ... we simply do not cache it */
+/* a nonblocking allgatherv copies the block of the calling process to
+ * the receive buffer at once, rather than in its schedule */
+static int nbc_allgatherv_copy_local(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf,
+                                     const int *recvcounts, const int *displs, MPI_Datatype recvtype,
+                                     struct ompi_communicator_t *comm)
+{
+  int rank = ompi_comm_rank (comm), res;
+  MPI_Aint rcvext;
+  char *rbuf;
+
+  if (MPI_IN_PLACE == sendbuf || sendbuf == recvbuf) {
+    return OMPI_SUCCESS;
+  }
+
+  res = ompi_datatype_type_extent (recvtype, &rcvext);
+  if (OPAL_UNLIKELY(MPI_SUCCESS != res)) {
+    NBC_Error ("MPI Error in ompi_datatype_type_extent() (%i)", res);
+    return res;
+  }
+
+  rbuf = (char *) recvbuf + displs[rank] * rcvext;
+  return NBC_Copy (sendbuf, sendcount, sendtype, rbuf, recvcounts[rank], recvtype, comm);
+}
 
 /* simple linear MPI_Iallgatherv
  * the algorithm uses p-1 rounds
@@ -60,8 +80,7 @@ static int nbc_allgatherv_init(const void* sendbuf, int sendcount, MPI_Datatype
       sendcount = recvcounts[rank];
   } else if (!persistent) { /* for persistent, the copy must be scheduled */
     /* copy my data to receive buffer */
-    rbuf = (char *) recvbuf + displs[rank] * rcvext;
-    res = NBC_Copy (sendbuf, sendcount, sendtype, rbuf, recvcounts[rank], recvtype, comm);
+    res = nbc_allgatherv_copy_local (sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
       return res;
     }
@@ -122,8 +141,35 @@ static int nbc_allgatherv_init(const void* sendbuf, int sendcount, MPI_Datatype
 int ompi_coll_libnbc_iallgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int *recvcounts, const int *displs,
                                  MPI_Datatype recvtype, struct ompi_communicator_t *comm, ompi_request_t ** request,
                                  struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_allgatherv_init(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype,
+    NBC_Sched_key key;
+    int res, p = ompi_comm_size (comm);
+
+    NBC_Sched_key_init (&key, NBC_ALLGATHERV);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    if (MPI_IN_PLACE != sendbuf) {
+        NBC_SCHED_KEY_ADD(&key, sendcount);
+        NBC_Sched_key_add_types (&key, &sendtype, 1);
+    }
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    NBC_Sched_key_add (&key, recvcounts, p * sizeof (int));
+    NBC_Sched_key_add (&key, displs, p * sizeof (int));
+    NBC_Sched_key_add_types (&key, &recvtype, 1);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_SUCCESS == res) {
+        /* the local block is not part of the schedule */
+        res = nbc_allgatherv_copy_local(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+        if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+            NBC_Return_handle (*(ompi_coll_libnbc_request_t **)request);
+            *request = &ompi_request_null.request;
+        }
+    } else if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_allgatherv_init(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype,
                                   comm, request, module, false);
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
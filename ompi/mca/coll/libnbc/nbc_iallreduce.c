@@ -11,6 +11,9 @@
  *                         and Technology (RIST).  All rights reserved.
  * Copyright (c) 2017      IBM Corporation.  All rights reserved.
  * Copyright (c) 2018      FUJITSU LIMITED.  All rights reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -22,6 +25,7 @@
 #include "ompi/communicator/communicator.h"
 #include "ompi/datatype/ompi_datatype.h"
 #include "ompi/op/op.h"
+#include "opal/align.h"
 #include "opal/util/bit_ops.h"
 
 #include <assert.h>
@@ -41,6 +45,10 @@ static inline int allred_sched_redscat_allgather(
     int rank, int comm_size, int count, MPI_Datatype datatype, ptrdiff_t gap,
     const void *sbuf, void *rbuf, MPI_Op op, char inplace,
     NBC_Schedule *schedule, void *tmpbuf, struct ompi_communicator_t *comm);
+static inline int allred_sched_pipeline(int rank, int p, int count, int segcount, MPI_Datatype datatype,
+                                        ptrdiff_t gap, ptrdiff_t segstride, const void *sendbuf, void *recvbuf,
+                                        MPI_Op op, char inplace, int size, int ext, NBC_Schedule *schedule,
+                                        void *tmpbuf);
 
 #ifdef NBC_CACHE_SCHEDULE
 /* tree comparison function for schedule cache */
@@ -72,11 +80,12 @@ static int nbc_allreduce_init(const void* sendbuf, void* recvbuf, int count, MPI
 #ifdef NBC_CACHE_SCHEDULE
   NBC_Allreduce_args *args, *found, search;
 #endif
-  enum { NBC_ARED_BINOMIAL, NBC_ARED_RING, NBC_ARED_REDSCAT_ALLGATHER, NBC_ARED_RDBL } alg;
+  enum { NBC_ARED_BINOMIAL, NBC_ARED_RING, NBC_ARED_REDSCAT_ALLGATHER, NBC_ARED_RDBL, NBC_ARED_PIPELINE } alg;
   char inplace;
   void *tmpbuf = NULL;
   ompi_coll_libnbc_module_t *libnbc_module = (ompi_coll_libnbc_module_t*) module;
-  ptrdiff_t span, gap;
+  ptrdiff_t span, gap, segstride = 0;
+  int segcount = 0;
 
   NBC_IN_PLACE(sendbuf, recvbuf, inplace);
 
@@ -106,16 +115,16 @@ static int nbc_allreduce_init(const void* sendbuf, void* recvbuf, int count, MPI
     return nbc_get_noop_request(persistent, request);
   }
 
-  span = opal_datatype_span(&datatype->super, count, &gap);
-  tmpbuf = malloc (span);
-  if (OPAL_UNLIKELY(NULL == tmpbuf)) {
-    return OMPI_ERR_OUT_OF_RESOURCE;
-  }
-
   /* algorithm selection */
   int nprocs_pof2 = opal_next_poweroftwo(p) >> 1;
   if (libnbc_iallreduce_algorithm == 0) {
-    if(p < 4 || size*count < 65536 || !ompi_op_is_commute(op) || inplace) {
+    if (!persistent && NBC_Pipeline_worthwhile(size * count)) {
+      alg = NBC_ARED_PIPELINE;
+    } else if (persistent && size*count < 65536) {
+      /* the schedule of a persistent request is replayed many times,
+       * favor the latency of the log(p) rounds of recursive doubling */
+      alg = NBC_ARED_RDBL;
+    } else if(p < 4 || size*count < 65536 || !ompi_op_is_commute(op) || inplace) {
       alg = NBC_ARED_BINOMIAL;
     } else if (count >= nprocs_pof2 && ompi_op_is_commute(op)) {
       alg = NBC_ARED_REDSCAT_ALLGATHER;
@@ -131,9 +140,25 @@ static int nbc_allreduce_init(const void* sendbuf, void* recvbuf, int count, MPI
       alg = NBC_ARED_REDSCAT_ALLGATHER;
     else if (libnbc_iallreduce_algorithm == 4)
       alg = NBC_ARED_RDBL;
+    else if (libnbc_iallreduce_algorithm == 5 && !persistent)
+      alg = NBC_ARED_PIPELINE;
     else
       alg = NBC_ARED_RING;
   }
+
+  if (alg == NBC_ARED_PIPELINE) {
+    /* every segment gets its own temporary buffer */
+    segcount = NBC_Pipeline_segcount(count, size);
+    span = opal_datatype_span(&datatype->super, segcount, &gap);
+    segstride = OPAL_ALIGN(span, datatype->super.align, ptrdiff_t);
+    span = segstride * ((count + segcount - 1) / segcount);
+  } else {
+    span = opal_datatype_span(&datatype->super, count, &gap);
+  }
+  tmpbuf = malloc (span);
+  if (OPAL_UNLIKELY(NULL == tmpbuf)) {
+    return OMPI_ERR_OUT_OF_RESOURCE;
+  }
 #ifdef NBC_CACHE_SCHEDULE
   /* search schedule in communicator specific tree */
   search.sendbuf = sendbuf;
@@ -167,6 +192,10 @@ static int nbc_allreduce_init(const void* sendbuf, void* recvbuf, int count, MPI
         case NBC_ARED_RDBL:
           res = allred_sched_recursivedoubling(rank, p, sendbuf, recvbuf, count, datatype, gap, op, inplace, schedule, tmpbuf);
           break;
+        case NBC_ARED_PIPELINE:
+          res = allred_sched_pipeline(rank, p, count, segcount, datatype, gap, segstride, sendbuf, recvbuf,
+                                      op, inplace, size, ext, schedule, tmpbuf);
+          break;
       }
     }
 
@@ -227,8 +256,24 @@ static int nbc_allreduce_init(const void* sendbuf, void* recvbuf, int count, MPI
 int ompi_coll_libnbc_iallreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op,
                                 struct ompi_communicator_t *comm, ompi_request_t ** request,
                                 struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_allreduce_init(sendbuf, recvbuf, count, datatype, op,
+    NBC_Sched_key key;
+    int res;
+
+    NBC_Sched_key_init (&key, NBC_ALLREDUCE);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    NBC_SCHED_KEY_ADD(&key, count);
+    NBC_Sched_key_add_types (&key, &datatype, 1);
+    NBC_Sched_key_add_op (&key, op);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_allreduce_init(sendbuf, recvbuf, count, datatype, op,
                                  comm, request, module, false);
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
@@ -833,6 +878,53 @@ static inline int allred_sched_ring (int r, int p, int count, MPI_Datatype datat
   return res;
 }
 
+/* pipelined allreduce: the buffers are cut in segments of segcount
+ * elements, and every segment is reduced by its own schedule, a ring
+ * (or a binomial tree for non commutative operations and in place
+ * reductions, which the ring does not support). Up to
+ * libnbc_pipeline_depth segments progress at the same time, so the
+ * reductions of one segment overlap the transfers of the others,
+ * instead of waiting for all the receives of a round. The temporary
+ * buffer of segment i starts at i * segstride in tmpbuf. */
+static inline int allred_sched_pipeline(int rank, int p, int count, int segcount, MPI_Datatype datatype,
+                                        ptrdiff_t gap, ptrdiff_t segstride, const void *sendbuf, void *recvbuf,
+                                        MPI_Op op, char inplace, int size, int ext, NBC_Schedule *schedule,
+                                        void *tmpbuf) {
+  NBC_Schedule *segment;
+  int res;
+
+  for (int first = 0, seg = 0 ; first < count ; first += segcount, ++seg) {
+    int thiscount = (count - first < segcount) ? count - first : segcount;
+    ptrdiff_t offset = (ptrdiff_t) first * ext;
+    char *segtmpbuf = (char *) tmpbuf + seg * segstride;
+
+    segment = OBJ_NEW(NBC_Schedule);
+    if (OPAL_UNLIKELY(NULL == segment)) {
+      return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+
+    if (ompi_op_is_commute(op) && !inplace) {
+      res = allred_sched_ring(rank, p, thiscount, datatype, (char *) sendbuf + offset, (char *) recvbuf + offset,
+                              op, size, ext, segment, segtmpbuf);
+    } else {
+      res = allred_sched_diss(rank, p, thiscount, datatype, gap, (char *) sendbuf + offset, (char *) recvbuf + offset,
+                              op, inplace, segment, segtmpbuf);
+    }
+    if (OPAL_LIKELY(OMPI_SUCCESS == res)) {
+      res = NBC_Sched_commit(segment);
+    }
+    if (OPAL_LIKELY(OMPI_SUCCESS == res)) {
+      res = NBC_Sched_segment(schedule, segment, seg * segstride);
+    }
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      OBJ_RELEASE(segment);
+      return res;
+    }
+  }
+
+  return OMPI_SUCCESS;
+}
+
 static inline int allred_sched_linear(int rank, int rsize, const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
 				      ptrdiff_t gap, MPI_Op op, int ext, int size, NBC_Schedule *schedule, void *tmpbuf) {
   int res;
@@ -284,8 +284,27 @@ static int nbc_alltoall_init(const void* sendbuf, int sendcount, MPI_Datatype se
 int ompi_coll_libnbc_ialltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
                                MPI_Datatype recvtype, struct ompi_communicator_t *comm, ompi_request_t ** request,
                                struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_alltoall_init(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype,
+    NBC_Sched_key key;
+    int res;
+
+    NBC_Sched_key_init (&key, NBC_ALLTOALL);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    if (MPI_IN_PLACE != sendbuf) {
+        NBC_SCHED_KEY_ADD(&key, sendcount);
+        NBC_Sched_key_add_types (&key, &sendtype, 1);
+    }
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    NBC_SCHED_KEY_ADD(&key, recvcount);
+    NBC_Sched_key_add_types (&key, &recvtype, 1);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_alltoall_init(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype,
                                 comm, request, module, false);
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
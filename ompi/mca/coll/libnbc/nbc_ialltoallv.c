@@ -144,9 +144,30 @@ int ompi_coll_libnbc_ialltoallv(const void* sendbuf, const int *sendcounts, cons
                                 MPI_Datatype sendtype, void* recvbuf, const int *recvcounts, const int *rdispls,
                                 MPI_Datatype recvtype, struct ompi_communicator_t *comm, ompi_request_t ** request,
                                 struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_alltoallv_init(sendbuf, sendcounts, sdispls, sendtype,
+    NBC_Sched_key key;
+    int res, p = ompi_comm_size (comm);
+
+    NBC_Sched_key_init (&key, NBC_ALLTOALLV);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    if (MPI_IN_PLACE != sendbuf) {
+        NBC_Sched_key_add (&key, sendcounts, p * sizeof (int));
+        NBC_Sched_key_add (&key, sdispls, p * sizeof (int));
+        NBC_Sched_key_add_types (&key, &sendtype, 1);
+    }
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    NBC_Sched_key_add (&key, recvcounts, p * sizeof (int));
+    NBC_Sched_key_add (&key, rdispls, p * sizeof (int));
+    NBC_Sched_key_add_types (&key, &recvtype, 1);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_alltoallv_init(sendbuf, sendcounts, sdispls, sendtype,
                                  recvbuf, recvcounts, rdispls, recvtype,
                                  comm, request, module, false);
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
@@ -101,7 +101,17 @@ static int nbc_barrier_init(struct ompi_communicator_t *comm, ompi_request_t **
 
 int ompi_coll_libnbc_ibarrier(struct ompi_communicator_t *comm, ompi_request_t ** request,
                               struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_barrier_init(comm, request, module, false);
+    NBC_Sched_key key;
+    int res;
+
+    NBC_Sched_key_init (&key, NBC_BARRIER);    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_barrier_init(comm, request, module, false);
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
@@ -11,6 +11,9 @@
  *                         reserved.
  * Copyright (c) 2016-2017 IBM Corporation.  All rights reserved.
  * Copyright (c) 2018      FUJITSU LIMITED.  All rights reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -28,6 +31,8 @@ static inline int bcast_sched_chain(int rank, int p, int root, NBC_Schedule *sch
                                     MPI_Datatype datatype, int fragsize, size_t size);
 static inline int bcast_sched_knomial(int rank, int comm_size, int root, NBC_Schedule *schedule, void *buf,
                                       int count, MPI_Datatype datatype, int knomial_radix);
+static inline int bcast_sched_pipeline(int rank, int p, int root, NBC_Schedule *schedule, void *buffer, int count,
+                                       MPI_Datatype datatype, int segcount);
 
 #ifdef NBC_CACHE_SCHEDULE
 /* tree comparison function for schedule cache */
@@ -57,7 +62,7 @@ static int nbc_bcast_init(void *buffer, int count, MPI_Datatype datatype, int ro
 #ifdef NBC_CACHE_SCHEDULE
   NBC_Bcast_args *args, *found, search;
 #endif
-  enum { NBC_BCAST_LINEAR, NBC_BCAST_BINOMIAL, NBC_BCAST_CHAIN, NBC_BCAST_KNOMIAL } alg;
+  enum { NBC_BCAST_LINEAR, NBC_BCAST_BINOMIAL, NBC_BCAST_CHAIN, NBC_BCAST_KNOMIAL, NBC_BCAST_PIPELINE } alg;
   ompi_coll_libnbc_module_t *libnbc_module = (ompi_coll_libnbc_module_t*) module;
 
   rank = ompi_comm_rank (comm);
@@ -85,7 +90,9 @@ static int nbc_bcast_init(void *buffer, int count, MPI_Datatype datatype, int ro
       }
     }
     else {
-      if (p <= 4) {
+      if (!persistent && NBC_Pipeline_worthwhile(size * count)) {
+        alg = NBC_BCAST_PIPELINE;
+      } else if (p <= 4) {
         alg = NBC_BCAST_LINEAR;
       } else if (size * count < 65536) {
         alg = NBC_BCAST_BINOMIAL;
@@ -107,6 +114,8 @@ static int nbc_bcast_init(void *buffer, int count, MPI_Datatype datatype, int ro
       alg = NBC_BCAST_CHAIN;
     } else if (libnbc_ibcast_algorithm == 4 && libnbc_ibcast_knomial_radix > 1) {
       alg = NBC_BCAST_KNOMIAL;
+    } else if (libnbc_ibcast_algorithm == 5 && !persistent) {
+      alg = NBC_BCAST_PIPELINE;
     } else {
       alg = NBC_BCAST_LINEAR;
     }
@@ -139,6 +148,10 @@ static int nbc_bcast_init(void *buffer, int count, MPI_Datatype datatype, int ro
       case NBC_BCAST_KNOMIAL:
         res = bcast_sched_knomial(rank, p, root, schedule, buffer, count, datatype, libnbc_ibcast_knomial_radix);
         break;
+      case NBC_BCAST_PIPELINE:
+        res = bcast_sched_pipeline(rank, p, root, schedule, buffer, count, datatype,
+                                   NBC_Pipeline_segcount(count, size));
+        break;
     }
 
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
@@ -195,9 +208,24 @@ int ompi_coll_libnbc_ibcast(void *buffer, int count, MPI_Datatype datatype, int
                             struct ompi_communicator_t *comm, ompi_request_t ** request,
                             struct mca_coll_base_module_2_3_0_t *module)
 {
-    int res = nbc_bcast_init(buffer, count, datatype, root,
+    NBC_Sched_key key;
+    int res;
+
+    NBC_Sched_key_init (&key, NBC_BCAST);
+    NBC_SCHED_KEY_ADD(&key, buffer);
+    NBC_SCHED_KEY_ADD(&key, count);
+    NBC_Sched_key_add_types (&key, &datatype, 1);
+    NBC_SCHED_KEY_ADD(&key, root);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_bcast_init(buffer, count, datatype, root,
                              comm, request, module, false);
-    if (OPAL_LIKELY(OMPI_SUCCESS != res)) {
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
     res = NBC_Start(*(ompi_coll_libnbc_request_t **)request);
@@ -362,6 +390,47 @@ static inline int bcast_sched_chain(int rank, int p, int root, NBC_Schedule *sch
   return OMPI_SUCCESS;
 }
 
+/* pipelined MPI_Ibcast: every segment of segcount elements goes down
+ * its own binomial tree schedule, and up to libnbc_pipeline_depth
+ * segments are in flight, so the inner nodes forward a segment while
+ * the next ones are still arriving */
+static inline int bcast_sched_pipeline(int rank, int p, int root, NBC_Schedule *schedule, void *buffer, int count,
+                                       MPI_Datatype datatype, int segcount) {
+  NBC_Schedule *segment;
+  MPI_Aint ext;
+  int res;
+
+  res = ompi_datatype_type_extent(datatype, &ext);
+  if (MPI_SUCCESS != res) {
+    NBC_Error("MPI Error in ompi_datatype_type_extent() (%i)", res);
+    return res;
+  }
+
+  for (int first = 0 ; first < count ; first += segcount) {
+    int thiscount = (count - first < segcount) ? count - first : segcount;
+
+    segment = OBJ_NEW(NBC_Schedule);
+    if (OPAL_UNLIKELY(NULL == segment)) {
+      return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+
+    res = bcast_sched_binomial(rank, p, root, segment, (char *) buffer + (ptrdiff_t) first * ext,
+                               thiscount, datatype);
+    if (OPAL_LIKELY(OMPI_SUCCESS == res)) {
+      res = NBC_Sched_commit(segment);
+    }
+    if (OPAL_LIKELY(OMPI_SUCCESS == res)) {
+      res = NBC_Sched_segment(schedule, segment, 0);
+    }
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      OBJ_RELEASE(segment);
+      return res;
+    }
+  }
+
+  return OMPI_SUCCESS;
+}
+
 /*
  * bcast_sched_knomial:
  *
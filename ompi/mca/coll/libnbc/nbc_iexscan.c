@@ -168,8 +168,24 @@ static int nbc_exscan_init(const void* sendbuf, void* recvbuf, int count, MPI_Da
 int ompi_coll_libnbc_iexscan(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op,
                              struct ompi_communicator_t *comm, ompi_request_t ** request,
                              struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_exscan_init(sendbuf, recvbuf, count, datatype, op,
+    NBC_Sched_key key;
+    int res;
+
+    NBC_Sched_key_init (&key, NBC_EXSCAN);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    NBC_SCHED_KEY_ADD(&key, count);
+    NBC_Sched_key_add_types (&key, &datatype, 1);
+    NBC_Sched_key_add_op (&key, op);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_exscan_init(sendbuf, recvbuf, count, datatype, op,
                               comm, request, module, false);
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
@@ -177,8 +177,30 @@ int ompi_coll_libnbc_igather(const void* sendbuf, int sendcount, MPI_Datatype se
                              int recvcount, MPI_Datatype recvtype, int root,
                              struct ompi_communicator_t *comm, ompi_request_t ** request,
                              struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_gather_init(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root,
+    NBC_Sched_key key;
+    int res, rank = ompi_comm_rank (comm);
+
+    NBC_Sched_key_init (&key, NBC_GATHER);
+    NBC_SCHED_KEY_ADD(&key, root);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    if (MPI_IN_PLACE != sendbuf) {
+        NBC_SCHED_KEY_ADD(&key, sendcount);
+        NBC_Sched_key_add_types (&key, &sendtype, 1);
+    }
+    if (rank == root) {
+        NBC_SCHED_KEY_ADD(&key, recvbuf);
+        NBC_SCHED_KEY_ADD(&key, recvcount);
+        NBC_Sched_key_add_types (&key, &recvtype, 1);
+    }
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_gather_init(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root,
                               comm, request, module, false);
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
@@ -51,7 +51,10 @@ static int nbc_neighbor_allgather_init(const void *sbuf, int scount, MPI_Datatyp
   int res, indegree, outdegree, *srcs, *dsts;
   MPI_Aint rcvext;
   ompi_coll_libnbc_module_t *libnbc_module = (ompi_coll_libnbc_module_t*) module;
+  NBC_Nbr_plan *plan = NULL;
   NBC_Schedule *schedule;
+  size_t ssize, rsize;
+  void *tmpbuf = NULL;
 
   res = ompi_datatype_type_extent (rtype, &rcvext);
   if (MPI_SUCCESS != res) {
@@ -59,6 +62,28 @@ static int nbc_neighbor_allgather_init(const void *sbuf, int scount, MPI_Datatyp
     return res;
   }
 
+  res = ompi_datatype_type_size (stype, &ssize);
+  if (MPI_SUCCESS != res) {
+    NBC_Error("MPI Error in ompi_datatype_type_size() (%i)", res);
+    return res;
+  }
+  ssize *= scount;
+
+  res = ompi_datatype_type_size (rtype, &rsize);
+  if (MPI_SUCCESS != res) {
+    NBC_Error("MPI Error in ompi_datatype_type_size() (%i)", res);
+    return res;
+  }
+  rsize *= rcount;
+
+  /* the first call builds the node plan, on all the processes */
+  if (NBC_Nbr_plan_wanted (libnbc_ineighbor_allgather_algorithm)) {
+    res = NBC_Nbr_plan_get (comm, libnbc_module, &plan);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      return res;
+    }
+  }
+
 #ifdef NBC_CACHE_SCHEDULE
   NBC_Ineighbor_allgather_args *args, *found, search;
 
@@ -84,42 +109,55 @@ static int nbc_neighbor_allgather_init(const void *sbuf, int scount, MPI_Datatyp
       return res;
     }
 
-    for (int i = 0 ; i < indegree ; ++i) {
-      if (MPI_PROC_NULL != srcs[i]) {
-        res = NBC_Sched_recv ((char *) rbuf + i * rcount * rcvext, true, rcount, rtype, srcs[i], schedule, false);
-        if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
-          break;
+    if (NULL != plan && (NBC_Nbr_aggregate (libnbc_ineighbor_allgather_algorithm, ssize) ||
+                         NBC_Nbr_aggregate (libnbc_ineighbor_allgather_algorithm, rsize))) {
+      res = NBC_Nbr_sched_aggregate (plan, libnbc_ineighbor_allgather_algorithm, false, sbuf, scount, stype, ssize,
+                                     rbuf, rcount, rtype, rsize, srcs, indegree, dsts, outdegree, schedule, &tmpbuf);
+      free (srcs);
+      free (dsts);
+      if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        OBJ_RELEASE(schedule);
+        return res;
+      }
+    } else {
+      for (int i = 0 ; i < indegree ; ++i) {
+        if (MPI_PROC_NULL != srcs[i]) {
+          res = NBC_Sched_recv ((char *) rbuf + i * rcount * rcvext, true, rcount, rtype, srcs[i], schedule, false);
+          if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+            break;
+          }
         }
       }
-    }
 
-    free (srcs);
+      free (srcs);
 
-    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
-      OBJ_RELEASE(schedule);
-      free (dsts);
-      return res;
-    }
+      if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        OBJ_RELEASE(schedule);
+        free (dsts);
+        return res;
+      }
 
-    for (int i = 0 ; i < outdegree ; ++i) {
-      if (MPI_PROC_NULL != dsts[i]) {
-        res = NBC_Sched_send ((char *) sbuf, false, scount, stype, dsts[i], schedule, false);
-        if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
-          break;
+      for (int i = 0 ; i < outdegree ; ++i) {
+        if (MPI_PROC_NULL != dsts[i]) {
+          res = NBC_Sched_send ((char *) sbuf, false, scount, stype, dsts[i], schedule, false);
+          if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+            break;
+          }
         }
       }
-    }
 
-    free (dsts);
+      free (dsts);
 
-    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
-      OBJ_RELEASE(schedule);
-      return res;
+      if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        OBJ_RELEASE(schedule);
+        return res;
+      }
     }
 
     res = NBC_Sched_commit (schedule);
     if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
       OBJ_RELEASE(schedule);
+      free (tmpbuf);
       return res;
     }
 
@@ -154,9 +192,10 @@ static int nbc_neighbor_allgather_init(const void *sbuf, int scount, MPI_Datatyp
   }
 #endif
 
-  res = NBC_Schedule_request(schedule, comm, libnbc_module, persistent, request, NULL);
+  res = NBC_Schedule_request(schedule, comm, libnbc_module, persistent, request, tmpbuf);
   if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
     OBJ_RELEASE(schedule);
+    free (tmpbuf);
     return res;
   }
 
@@ -166,9 +205,26 @@ static int nbc_neighbor_allgather_init(const void *sbuf, int scount, MPI_Datatyp
 int ompi_coll_libnbc_ineighbor_allgather(const void *sbuf, int scount, MPI_Datatype stype, void *rbuf,
                                          int rcount, MPI_Datatype rtype, struct ompi_communicator_t *comm,
                                          ompi_request_t ** request, struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_neighbor_allgather_init(sbuf, scount, stype, rbuf, rcount, rtype,
+    NBC_Sched_key key;
+    int res;
+
+    NBC_Sched_key_init (&key, NBC_NEIGHBOR_ALLGATHER);
+    NBC_SCHED_KEY_ADD(&key, sbuf);
+    NBC_SCHED_KEY_ADD(&key, scount);
+    NBC_Sched_key_add_types (&key, &stype, 1);
+    NBC_SCHED_KEY_ADD(&key, rbuf);
+    NBC_SCHED_KEY_ADD(&key, rcount);
+    NBC_Sched_key_add_types (&key, &rtype, 1);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_neighbor_allgather_init(sbuf, scount, stype, rbuf, rcount, rtype,
                                           comm, request, module, false);
-    if (OPAL_LIKELY(OMPI_SUCCESS != res)) {
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
     res = NBC_Start(*(ompi_coll_libnbc_request_t **)request);
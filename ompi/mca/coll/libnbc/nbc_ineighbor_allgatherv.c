@@ -168,9 +168,31 @@ int ompi_coll_libnbc_ineighbor_allgatherv(const void *sbuf, int scount, MPI_Data
 					  const int *rcounts, const int *displs, MPI_Datatype rtype,
 					  struct ompi_communicator_t *comm, ompi_request_t ** request,
 					  struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_neighbor_allgatherv_init(sbuf, scount, stype, rbuf, rcounts, displs, rtype,
+    NBC_Sched_key key;
+    int res, indegree, outdegree;
+
+    res = NBC_Comm_neighbors_count (comm, &indegree, &outdegree);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        return res;
+    }
+    NBC_Sched_key_init (&key, NBC_NEIGHBOR_ALLGATHERV);
+    NBC_SCHED_KEY_ADD(&key, sbuf);
+    NBC_SCHED_KEY_ADD(&key, scount);
+    NBC_Sched_key_add_types (&key, &stype, 1);
+    NBC_SCHED_KEY_ADD(&key, rbuf);
+    NBC_Sched_key_add (&key, rcounts, indegree * sizeof (int));
+    NBC_Sched_key_add (&key, displs, indegree * sizeof (int));
+    NBC_Sched_key_add_types (&key, &rtype, 1);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_neighbor_allgatherv_init(sbuf, scount, stype, rbuf, rcounts, displs, rtype,
                                            comm, request, module, false);
-    if (OPAL_LIKELY(OMPI_SUCCESS != res)) {
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
     res = NBC_Start(*(ompi_coll_libnbc_request_t **)request);
@@ -175,9 +175,32 @@ int ompi_coll_libnbc_ineighbor_alltoallv(const void *sbuf, const int *scounts, c
                                          void *rbuf, const int *rcounts, const int *rdispls, MPI_Datatype rtype,
                                          struct ompi_communicator_t *comm, ompi_request_t ** request,
                                          struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_neighbor_alltoallv_init(sbuf, scounts, sdispls, stype, rbuf, rcounts, rdispls, rtype,
+    NBC_Sched_key key;
+    int res, indegree, outdegree;
+
+    res = NBC_Comm_neighbors_count (comm, &indegree, &outdegree);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        return res;
+    }
+    NBC_Sched_key_init (&key, NBC_NEIGHBOR_ALLTOALLV);
+    NBC_SCHED_KEY_ADD(&key, sbuf);
+    NBC_Sched_key_add (&key, scounts, outdegree * sizeof (int));
+    NBC_Sched_key_add (&key, sdispls, outdegree * sizeof (int));
+    NBC_Sched_key_add_types (&key, &stype, 1);
+    NBC_SCHED_KEY_ADD(&key, rbuf);
+    NBC_Sched_key_add (&key, rcounts, indegree * sizeof (int));
+    NBC_Sched_key_add (&key, rdispls, indegree * sizeof (int));
+    NBC_Sched_key_add_types (&key, &rtype, 1);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_neighbor_alltoallv_init(sbuf, scounts, sdispls, stype, rbuf, rcounts, rdispls, rtype,
                                           comm, request, module, false);
-    if (OPAL_LIKELY(OMPI_SUCCESS != res)) {
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
     res = NBC_Start(*(ompi_coll_libnbc_request_t **)request);
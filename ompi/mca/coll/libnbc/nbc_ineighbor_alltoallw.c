@@ -160,9 +160,32 @@ int ompi_coll_libnbc_ineighbor_alltoallw(const void *sbuf, const int *scounts, c
                                          void *rbuf, const int *rcounts, const MPI_Aint *rdisps, struct ompi_datatype_t * const *rtypes,
                                          struct ompi_communicator_t *comm, ompi_request_t ** request,
                                          struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_neighbor_alltoallw_init(sbuf, scounts, sdisps, stypes, rbuf, rcounts, rdisps, rtypes,
+    NBC_Sched_key key;
+    int res, indegree, outdegree;
+
+    res = NBC_Comm_neighbors_count (comm, &indegree, &outdegree);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        return res;
+    }
+    NBC_Sched_key_init (&key, NBC_NEIGHBOR_ALLTOALLW);
+    NBC_SCHED_KEY_ADD(&key, sbuf);
+    NBC_Sched_key_add (&key, scounts, outdegree * sizeof (int));
+    NBC_Sched_key_add (&key, sdisps, outdegree * sizeof (MPI_Aint));
+    NBC_Sched_key_add_types (&key, stypes, outdegree);
+    NBC_SCHED_KEY_ADD(&key, rbuf);
+    NBC_Sched_key_add (&key, rcounts, indegree * sizeof (int));
+    NBC_Sched_key_add (&key, rdisps, indegree * sizeof (MPI_Aint));
+    NBC_Sched_key_add_types (&key, rtypes, indegree);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_neighbor_alltoallw_init(sbuf, scounts, sdisps, stypes, rbuf, rcounts, rdisps, rtypes,
                                           comm, request, module, false);
-    if (OPAL_LIKELY(OMPI_SUCCESS != res)) {
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
     res = NBC_Start(*(ompi_coll_libnbc_request_t **)request);
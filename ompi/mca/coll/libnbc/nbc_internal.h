@@ -15,6 +15,9 @@
  * Copyright (c) 2015      Los Alamos National Security, LLC. All rights
  *                         reserved.
  * Copyright (c) 2018      FUJITSU LIMITED.  All rights reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -74,6 +77,12 @@ extern "C" {
 #define NBC_SCAN 13
 #define NBC_SCATTER 14
 #define NBC_SCATTERV 15
+#define NBC_REDUCESCAT_BLOCK 16
+#define NBC_NEIGHBOR_ALLGATHER 17
+#define NBC_NEIGHBOR_ALLGATHERV 18
+#define NBC_NEIGHBOR_ALLTOALL 19
+#define NBC_NEIGHBOR_ALLTOALLV 20
+#define NBC_NEIGHBOR_ALLTOALLW 21
 /* set the number of collectives in nbc.h !!!! */
 
 /* several typedefs for NBC */
@@ -159,6 +168,66 @@ int NBC_Sched_unpack (void *inbuf, char tmpinbuf, int count, MPI_Datatype dataty
 
 int NBC_Sched_barrier (NBC_Schedule *schedule);
 int NBC_Sched_commit (NBC_Schedule *schedule);
+int NBC_Sched_segment (NBC_Schedule *schedule, NBC_Schedule *segment, ptrdiff_t tmpoffset);
+
+/* arguments a cached schedule was built for: the collective and a
+ * packed copy of its significant arguments (buffers, counts,
+ * displacements, datatypes, operation and root). The datatypes and
+ * the operation are also recorded apart, a cached schedule holds a
+ * reference on them so that their handles cannot be reused for other
+ * objects while it is in the cache. Keys are built with
+ * NBC_Sched_key_init() and the NBC_Sched_key_add*() functions, a key
+ * that could not be built is simply never found. */
+#define NBC_SCHED_KEY_INLINE 64
+
+typedef struct {
+  int coll;
+  bool valid;
+  unsigned int hash;
+  size_t size;       /* bytes of packed arguments */
+  size_t alloc;      /* bytes available in args */
+  char *args;
+  int ntypes;
+  int types_alloc;
+  MPI_Datatype *types;
+  MPI_Op op;
+  char inline_args[NBC_SCHED_KEY_INLINE];
+  MPI_Datatype inline_types[2];
+} NBC_Sched_key;
+
+/* a schedule of the per communicator cache. The schedule may refer to
+ * its temporary buffer with absolute addresses, so the buffer is kept
+ * with it, and a cached schedule is only given to one request at a
+ * time. */
+struct NBC_Sched_cache_entry {
+  opal_list_item_t super;
+  int coll;
+  unsigned int hash;
+  size_t size;
+  char *args;
+  int ntypes;
+  MPI_Datatype *types;
+  MPI_Op op;
+  NBC_Schedule *schedule;
+  void *tmpbuf;
+  volatile bool busy;
+};
+typedef struct NBC_Sched_cache_entry NBC_Sched_cache_entry;
+OBJ_CLASS_DECLARATION(NBC_Sched_cache_entry);
+
+void NBC_Sched_key_init (NBC_Sched_key *key, int coll);
+void NBC_Sched_key_add (NBC_Sched_key *key, const void *data, size_t size);
+void NBC_Sched_key_add_types (NBC_Sched_key *key, const MPI_Datatype *types, int count);
+void NBC_Sched_key_add_op (NBC_Sched_key *key, MPI_Op op);
+void NBC_Sched_key_fini (NBC_Sched_key *key);
+
+/* adds an argument passed by value (a buffer address, a count or a root) */
+#define NBC_SCHED_KEY_ADD(key, arg) NBC_Sched_key_add ((key), &(arg), sizeof (arg))
+
+int NBC_Sched_cache_request (NBC_Sched_key *key, ompi_communicator_t *comm,
+                             ompi_coll_libnbc_module_t *module, ompi_request_t **request);
+void NBC_Sched_cache_insert (NBC_Sched_key *key, ompi_coll_libnbc_module_t *module,
+                             ompi_request_t *request);
 
 #ifdef NBC_CACHE_SCHEDULE
 /* this is a dummy structure which is used to get the schedule out of
@@ -369,6 +438,30 @@ static inline void nbc_schedule_inc_round (NBC_Schedule *schedule) {
   memcpy (lastround, &last_round_num, sizeof (last_round_num));
 }
 
+/* a message of size bytes is pipelined by default if it makes at
+ * least four segments */
+static inline bool NBC_Pipeline_worthwhile (size_t size) {
+  return libnbc_pipeline_segsize > 0 && size >= 4 * (size_t) libnbc_pipeline_segsize;
+}
+
+/* number of elements of datatype size in a segment of a pipelined
+ * collective of count elements */
+static inline int NBC_Pipeline_segcount (int count, size_t size) {
+  int segcount = count;
+
+  if (libnbc_pipeline_segsize > 0 && size > 0) {
+    segcount = (int) (libnbc_pipeline_segsize / size);
+  }
+  if (segcount < 1) {
+    segcount = 1;
+  }
+  if (segcount > count) {
+    segcount = (count > 0) ? count : 1;
+  }
+
+  return segcount;
+}
+
 /* returns a no-operation request (e.g. for one process barrier) */
 static inline int nbc_get_noop_request(bool persistent, ompi_request_t **request) {
   if (persistent) {
@@ -580,6 +673,59 @@ static inline void NBC_SchedCache_dictwipe(hb_tree *dict, int *size) {
 int NBC_Comm_neighbors_count (ompi_communicator_t *comm, int *indegree, int *outdegree);
 int NBC_Comm_neighbors (ompi_communicator_t *comm, int **sources, int *source_count, int **destinations, int *dest_count);
 
+/* node-aware plan of the neighborhood collectives of a communicator
+ * with a process topology. The blocks a process sends to several
+ * neighbors on the same remote node travel in a single (aggregated)
+ * message to the first of these neighbors, the proxy, which forwards
+ * the others to their destination inside the node. Blocks for
+ * neighbors on the same node are always sent directly. The plan does
+ * not depend on the buffers or the datatypes, it is built once per
+ * communicator by NBC_Nbr_plan_get(). */
+struct NBC_Nbr_plan {
+  /* sending side */
+  int ngroups;      /* aggregated messages sent */
+  int *out_group;   /* [outdegree] aggregated message of each out edge, -1 if sent directly */
+  int *group_proxy; /* [ngroups] destination of each aggregated message */
+  int *group_count; /* [ngroups] number of out edges of each aggregated message */
+  /* receiving side */
+  int *in_proxy;    /* [indegree] process the block of each in edge is received
+                     * from after the aggregated messages arrived, -1 if it is
+                     * received directly from its source */
+  int nfwd;         /* blocks forwarded to this process by proxies */
+  int *fwd_in;      /* [nfwd] in edge of each of them, in forwarding order */
+  /* proxy side */
+  int nagg;         /* aggregated messages received as a proxy */
+  int *agg_source;  /* [nagg] sender of each aggregated message, in increasing order */
+  int *agg_disp;    /* [nagg + 1] first block of each aggregated message */
+  int *agg_dest;    /* [agg_disp[nagg]] destination of each block */
+  int *agg_in;      /* [agg_disp[nagg]] in edge of the block if it is for this
+                     * process, -1 if it is forwarded */
+};
+typedef struct NBC_Nbr_plan NBC_Nbr_plan;
+
+int NBC_Nbr_plan_get (ompi_communicator_t *comm, ompi_coll_libnbc_module_t *module, NBC_Nbr_plan **plan);
+void NBC_Nbr_plan_free (NBC_Nbr_plan *plan);
+int NBC_Nbr_sched_aggregate (const NBC_Nbr_plan *plan, int algorithm, bool alltoall, const void *sbuf,
+                             int scount, MPI_Datatype stype, size_t ssize, void *rbuf, int rcount,
+                             MPI_Datatype rtype, size_t rsize, const int *srcs, int indegree,
+                             const int *dsts, int outdegree, NBC_Schedule *schedule, void **tmpbuf);
+
+/* the neighborhood collectives that may aggregate need the node plan.
+ * Building it is collective, so this may not depend on the arguments,
+ * which differ from one process to the other. */
+static inline bool NBC_Nbr_plan_wanted (int algorithm) {
+  return 2 == algorithm || (0 == algorithm && libnbc_neighbor_aggregate_max > 0);
+}
+
+/* blocks of size bytes are aggregated. Every pair of neighbors agrees,
+ * the type signatures of the blocks they exchange have to match. */
+static inline bool NBC_Nbr_aggregate (int algorithm, size_t size) {
+  if (0 == size || !NBC_Nbr_plan_wanted (algorithm)) {
+    return false;
+  }
+  return 2 == algorithm || (size_t) libnbc_neighbor_aggregate_max >= size;
+}
+
 #ifdef __cplusplus
 }
 #endif
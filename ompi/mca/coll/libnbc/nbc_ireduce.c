@@ -11,6 +11,9 @@
  *                         and Technology (RIST).  All rights reserved.
  * Copyright (c) 2017      IBM Corporation.  All rights reserved.
  * Copyright (c) 2018      FUJITSU LIMITED.  All rights reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -37,6 +40,9 @@ static inline int red_sched_redscat_gather(
     int rank, int comm_size, int root, const void *sbuf, void *rbuf,
     char tmpredbuf, int count, MPI_Datatype datatype, MPI_Op op, char inplace,
     NBC_Schedule *schedule, void *tmp_buf, struct ompi_communicator_t *comm);
+static inline int red_sched_pipeline (int rank, int p, int root, const void *sendbuf, void *recvbuf, int count,
+                                      int segcount, MPI_Datatype datatype, MPI_Op op, char inplace, ptrdiff_t segstride,
+                                      NBC_Schedule *schedule, void *tmpbuf);
 
 #ifdef NBC_CACHE_SCHEDULE
 /* tree comparison function for schedule cache */
@@ -69,9 +75,10 @@ static int nbc_reduce_init(const void* sendbuf, void* recvbuf, int count, MPI_Da
   char *redbuf=NULL, inplace;
   void *tmpbuf;
   char tmpredbuf = 0;
-  enum { NBC_RED_BINOMIAL, NBC_RED_CHAIN, NBC_RED_REDSCAT_GATHER} alg;
+  enum { NBC_RED_BINOMIAL, NBC_RED_CHAIN, NBC_RED_REDSCAT_GATHER, NBC_RED_PIPELINE} alg;
   ompi_coll_libnbc_module_t *libnbc_module = (ompi_coll_libnbc_module_t*) module;
-  ptrdiff_t span, gap;
+  ptrdiff_t span, gap, segstride = 0;
+  int segcount = 0;
 
   NBC_IN_PLACE(sendbuf, recvbuf, inplace);
 
@@ -106,7 +113,9 @@ static int nbc_reduce_init(const void* sendbuf, void* recvbuf, int count, MPI_Da
   /* algorithm selection */
   int nprocs_pof2 = opal_next_poweroftwo(p) >> 1;
   if (libnbc_ireduce_algorithm == 0) {
-    if (ompi_op_is_commute(op) && p > 2 && count >= nprocs_pof2) {
+    if (!persistent && NBC_Pipeline_worthwhile(size * count)) {
+      alg = NBC_RED_PIPELINE;
+    } else if (ompi_op_is_commute(op) && p > 2 && count >= nprocs_pof2) {
       alg = NBC_RED_REDSCAT_GATHER;
     } else if (p > 4 || size * count < 65536 || !ompi_op_is_commute(op)) {
       alg = NBC_RED_BINOMIAL;
@@ -120,13 +129,24 @@ static int nbc_reduce_init(const void* sendbuf, void* recvbuf, int count, MPI_Da
       alg = NBC_RED_BINOMIAL;
     } else if (libnbc_ireduce_algorithm == 3 && ompi_op_is_commute(op) && p > 2 && count >= nprocs_pof2) {
       alg = NBC_RED_REDSCAT_GATHER;
+    } else if (libnbc_ireduce_algorithm == 4 && !persistent) {
+      alg = NBC_RED_PIPELINE;
     } else {
       alg = NBC_RED_CHAIN;
     }
   }
 
   /* allocate temporary buffers */
-  if (alg == NBC_RED_REDSCAT_GATHER || alg == NBC_RED_BINOMIAL) {
+  if (alg == NBC_RED_PIPELINE) {
+    /* every segment gets the temporary buffers of a binomial reduction */
+    segcount = NBC_Pipeline_segcount(count, size);
+    span = opal_datatype_span(&datatype->super, segcount, &gap);
+    if (rank != root) {
+      span += OPAL_ALIGN(span, datatype->super.align, ptrdiff_t);
+    }
+    segstride = OPAL_ALIGN(span, datatype->super.align, ptrdiff_t);
+    tmpbuf = malloc(segstride * ((count + segcount - 1) / segcount));
+  } else if (alg == NBC_RED_REDSCAT_GATHER || alg == NBC_RED_BINOMIAL) {
     if (rank == root) {
       /* root reduces in receive buffer */
       tmpbuf = malloc(span);
@@ -180,6 +200,10 @@ static int nbc_reduce_init(const void* sendbuf, void* recvbuf, int count, MPI_Da
         case NBC_RED_REDSCAT_GATHER:
           res = red_sched_redscat_gather(rank, p, root, sendbuf, redbuf, tmpredbuf, count, datatype, op, inplace, schedule, tmpbuf, comm);
           break;
+        case NBC_RED_PIPELINE:
+          res = red_sched_pipeline(rank, p, root, sendbuf, recvbuf, count, segcount, datatype, op, inplace,
+                                   segstride, schedule, tmpbuf);
+          break;
       }
     }
 
@@ -240,9 +264,26 @@ static int nbc_reduce_init(const void* sendbuf, void* recvbuf, int count, MPI_Da
 int ompi_coll_libnbc_ireduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype,
                              MPI_Op op, int root, struct ompi_communicator_t *comm, ompi_request_t ** request,
                              struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_reduce_init(sendbuf, recvbuf, count, datatype, op, root,
+    NBC_Sched_key key;
+    int res;
+
+    NBC_Sched_key_init (&key, NBC_REDUCE);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    NBC_SCHED_KEY_ADD(&key, count);
+    NBC_Sched_key_add_types (&key, &datatype, 1);
+    NBC_Sched_key_add_op (&key, op);
+    NBC_SCHED_KEY_ADD(&key, root);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_reduce_init(sendbuf, recvbuf, count, datatype, op, root,
                               comm, request, module, false);
-    if (OPAL_LIKELY(OMPI_SUCCESS != res)) {
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
     res = NBC_Start(*(ompi_coll_libnbc_request_t **)request);
@@ -535,6 +576,59 @@ static inline int red_sched_chain (int rank, int p, int root, const void *sendbu
   return OMPI_SUCCESS;
 }
 
+/* pipelined reduce: every segment of segcount elements is reduced by
+ * its own binomial tree schedule, and up to libnbc_pipeline_depth
+ * segments are in flight, so that the reduction of a segment overlaps
+ * the transfers of the next ones. The temporary buffers of segment i
+ * start at i * segstride in tmpbuf, the non root processes reduce in
+ * the second half of them. */
+static inline int red_sched_pipeline (int rank, int p, int root, const void *sendbuf, void *recvbuf, int count,
+                                      int segcount, MPI_Datatype datatype, MPI_Op op, char inplace, ptrdiff_t segstride,
+                                      NBC_Schedule *schedule, void *tmpbuf) {
+  NBC_Schedule *segment;
+  ptrdiff_t ext, lb, span, gap;
+  char *redbuf = NULL, tmpredbuf = 0;
+  int res;
+
+  res = ompi_datatype_get_extent(datatype, &lb, &ext);
+  if (MPI_SUCCESS != res) {
+    NBC_Error("MPI Error in ompi_datatype_get_extent() (%i)", res);
+    return res;
+  }
+
+  if (rank != root) {
+    span = opal_datatype_span(&datatype->super, segcount, &gap);
+    redbuf = (char *) OPAL_ALIGN(span, datatype->super.align, ptrdiff_t) - gap;
+    tmpredbuf = 1;
+  }
+
+  for (int first = 0, seg = 0 ; first < count ; first += segcount, ++seg) {
+    int thiscount = (count - first < segcount) ? count - first : segcount;
+    ptrdiff_t offset = (ptrdiff_t) first * ext;
+
+    segment = OBJ_NEW(NBC_Schedule);
+    if (OPAL_UNLIKELY(NULL == segment)) {
+      return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+
+    res = red_sched_binomial(rank, p, root, (char *) sendbuf + offset,
+                             (rank == root) ? (char *) recvbuf + offset : redbuf, tmpredbuf,
+                             thiscount, datatype, op, inplace, segment, (char *) tmpbuf + seg * segstride);
+    if (OPAL_LIKELY(OMPI_SUCCESS == res)) {
+      res = NBC_Sched_commit(segment);
+    }
+    if (OPAL_LIKELY(OMPI_SUCCESS == res)) {
+      res = NBC_Sched_segment(schedule, segment, seg * segstride);
+    }
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      OBJ_RELEASE(segment);
+      return res;
+    }
+  }
+
+  return OMPI_SUCCESS;
+}
+
 /* simple linear algorithm for intercommunicators */
 static inline int red_sched_linear (int rank, int rsize, int root, const void *sendbuf, void *recvbuf, void *tmpbuf, int count, MPI_Datatype datatype,
                                     MPI_Op op, NBC_Schedule *schedule) {
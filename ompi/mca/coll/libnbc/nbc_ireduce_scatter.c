@@ -212,9 +212,25 @@ static int nbc_reduce_scatter_init(const void* sendbuf, void* recvbuf, const int
 int ompi_coll_libnbc_ireduce_scatter (const void* sendbuf, void* recvbuf, const int *recvcounts, MPI_Datatype datatype,
                                       MPI_Op op, struct ompi_communicator_t *comm, ompi_request_t ** request,
                                       struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_reduce_scatter_init(sendbuf, recvbuf, recvcounts, datatype, op,
+    NBC_Sched_key key;
+    int res, p = ompi_comm_size (comm);
+
+    NBC_Sched_key_init (&key, NBC_REDUCESCAT);
+    NBC_SCHED_KEY_ADD(&key, sendbuf);
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    NBC_Sched_key_add (&key, recvcounts, p * sizeof (int));
+    NBC_Sched_key_add_types (&key, &datatype, 1);
+    NBC_Sched_key_add_op (&key, op);
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_reduce_scatter_init(sendbuf, recvbuf, recvcounts, datatype, op,
                                       comm, request, module, false);
-    if (OPAL_LIKELY(OMPI_SUCCESS != res)) {
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
     res = NBC_Start(*(ompi_coll_libnbc_request_t **)request);
@@ -107,9 +107,32 @@ int ompi_coll_libnbc_iscatterv(const void* sendbuf, const int *sendcounts, const
                                void* recvbuf, int recvcount, MPI_Datatype recvtype, int root,
                                struct ompi_communicator_t *comm, ompi_request_t ** request,
                                struct mca_coll_base_module_2_3_0_t *module) {
-    int res = nbc_scatterv_init(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root,
+    NBC_Sched_key key;
+    int res, rank = ompi_comm_rank (comm), p = ompi_comm_size (comm);
+
+    NBC_Sched_key_init (&key, NBC_SCATTERV);
+    NBC_SCHED_KEY_ADD(&key, root);
+    if (rank == root) {
+        NBC_SCHED_KEY_ADD(&key, sendbuf);
+        NBC_Sched_key_add (&key, sendcounts, p * sizeof (int));
+        NBC_Sched_key_add (&key, displs, p * sizeof (int));
+        NBC_Sched_key_add_types (&key, &sendtype, 1);
+    }
+    NBC_SCHED_KEY_ADD(&key, recvbuf);
+    if (MPI_IN_PLACE != recvbuf) {
+        NBC_SCHED_KEY_ADD(&key, recvcount);
+        NBC_Sched_key_add_types (&key, &recvtype, 1);
+    }
+    res = NBC_Sched_cache_request (&key, comm, (ompi_coll_libnbc_module_t *) module, request);
+    if (OMPI_ERR_NOT_FOUND == res) {
+        res = nbc_scatterv_init(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root,
                                 comm, request, module, false);
-    if (OPAL_LIKELY(OMPI_SUCCESS != res)) {
+        if (OMPI_SUCCESS == res) {
+            NBC_Sched_cache_insert (&key, (ompi_coll_libnbc_module_t *) module, *request);
+        }
+    }
+    NBC_Sched_key_fini (&key);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
         return res;
     }
     res = NBC_Start(*(ompi_coll_libnbc_request_t **)request);
@@ -7,12 +7,17 @@
  *                    rights reserved.
  * Copyright (c) 2015      Los Alamos National Security, LLC.  All rights
  *                         reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  *
  * Author(s): Torsten Hoefler <htor@cs.indiana.edu>
  *
  */
 
 #include "nbc_internal.h"
+#include "ompi/group/group.h"
+#include "ompi/proc/proc.h"
 #include "ompi/mca/topo/base/base.h"
 
 int NBC_Comm_neighbors_count (ompi_communicator_t *comm, int *indegree, int *outdegree) {
@@ -101,3 +106,552 @@ int NBC_Comm_neighbors (ompi_communicator_t *comm, int **sources, int *source_co
 
   return OMPI_SUCCESS;
 }
+
+void NBC_Nbr_plan_free (NBC_Nbr_plan *plan) {
+  if (NULL == plan) {
+    return;
+  }
+
+  free (plan->out_group);
+  free (plan->group_proxy);
+  free (plan->group_count);
+  free (plan->in_proxy);
+  free (plan->fwd_in);
+  free (plan->agg_source);
+  free (plan->agg_disp);
+  free (plan->agg_dest);
+  free (plan->agg_in);
+  free (plan);
+}
+
+/* a block forwarded by a proxy: the order of the blocks is the one
+ * of their sources, and then of their position in the out edges of
+ * the source, which both the proxy and the destination know */
+typedef struct {
+  int source;
+  int pos;
+  int in;
+} nbc_nbr_fwd_t;
+
+static int nbc_nbr_fwd_compare (const void *a, const void *b) {
+  const nbc_nbr_fwd_t *fa = (const nbc_nbr_fwd_t *) a, *fb = (const nbc_nbr_fwd_t *) b;
+
+  if (fa->source != fb->source) {
+    return (fa->source < fb->source) ? -1 : 1;
+  }
+  return (fa->pos < fb->pos) ? -1 : (fa->pos > fb->pos);
+}
+
+/* the node of a process is identified by the lowest rank on it */
+static int nbc_nbr_my_node (ompi_communicator_t *comm) {
+  int rank = ompi_comm_rank (comm);
+
+  for (int r = 0 ; r < rank ; ++r) {
+    ompi_proc_t *proc = ompi_group_peer_lookup (comm->c_local_group, r);
+    if (OPAL_PROC_ON_LOCAL_NODE(proc->super.proc_flags)) {
+      return r;
+    }
+  }
+
+  return rank;
+}
+
+/* computes the plan of this process from the node of every process
+ * and the out edges of each of its sources (in_dsts[in_displs[i]]
+ * are the out edges of srcs[i]). Returns OMPI_ERR_BAD_PARAM if the
+ * edges do not match, and an empty plan (no aggregated message at
+ * all) in *plan if there is nothing to aggregate. */
+static int nbc_nbr_plan_build (int rank, int size, const int *node_of, const int *srcs, int indegree,
+                               const int *dsts, int outdegree, const int *in_dsts, const int *in_counts,
+                               const int *in_displs, NBC_Nbr_plan *plan) {
+  int my_node = node_of[rank], *group_node = NULL, nblocks = 0;
+  nbc_nbr_fwd_t *fwd = NULL;
+
+  /* sending side: group the out edges to other nodes by node, the
+   * first neighbor of each node is the proxy of the group */
+  if (outdegree > 0) {
+    plan->out_group = (int *) malloc (outdegree * sizeof (int));
+    plan->group_proxy = (int *) malloc (outdegree * sizeof (int));
+    plan->group_count = (int *) malloc (outdegree * sizeof (int));
+    group_node = (int *) malloc (outdegree * sizeof (int));
+    if (NULL == plan->out_group || NULL == plan->group_proxy || NULL == plan->group_count ||
+        NULL == group_node) {
+      free (group_node);
+      return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+  }
+
+  for (int i = 0 ; i < outdegree ; ++i) {
+    int d = dsts[i], g;
+
+    plan->out_group[i] = -1;
+    if (MPI_PROC_NULL == d || node_of[d] == my_node) {
+      continue;
+    }
+
+    for (g = 0 ; g < plan->ngroups ; ++g) {
+      if (group_node[g] == node_of[d]) {
+        break;
+      }
+    }
+    if (g == plan->ngroups) {
+      group_node[g] = node_of[d];
+      plan->group_proxy[g] = d;
+      plan->group_count[g] = 0;
+      ++plan->ngroups;
+    }
+    plan->out_group[i] = g;
+    ++plan->group_count[g];
+  }
+
+  free (group_node);
+
+  /* a single block is sent directly */
+  for (int g = 0, ngroups = plan->ngroups ; g < ngroups ; ++g) {
+    if (plan->group_count[g] < 2) {
+      for (int i = 0 ; i < outdegree ; ++i) {
+        if (plan->out_group[i] == g) {
+          plan->out_group[i] = -1;
+        }
+      }
+      --plan->ngroups;
+    }
+  }
+
+  /* renumber the remaining groups */
+  for (int g = 0, n = 0 ; n < plan->ngroups ; ++g) {
+    if (plan->group_count[g] < 2) {
+      continue;
+    }
+    for (int i = 0 ; i < outdegree ; ++i) {
+      if (plan->out_group[i] == g) {
+        plan->out_group[i] = n;
+      }
+    }
+    plan->group_proxy[n] = plan->group_proxy[g];
+    plan->group_count[n] = plan->group_count[g];
+    ++n;
+  }
+
+  /* receiving side: an in edge whose source sends several blocks to
+   * this node is received from the proxy of the source, the k-th in
+   * edge from a source matches the k-th out edge of the source to this
+   * process */
+  if (indegree > 0) {
+    plan->in_proxy = (int *) malloc (indegree * sizeof (int));
+    fwd = (nbc_nbr_fwd_t *) malloc (indegree * sizeof (nbc_nbr_fwd_t));
+    if (NULL == plan->in_proxy || NULL == fwd) {
+      free (fwd);
+      return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+  }
+
+  for (int i = 0 ; i < indegree ; ++i) {
+    const int *list = in_dsts + in_displs[i];
+    int s = srcs[i], on_node = 0, proxy = -1, k = 0, pos = -1;
+
+    plan->in_proxy[i] = -1;
+    if (MPI_PROC_NULL == s || node_of[s] == my_node) {
+      continue;
+    }
+
+    for (int j = 0 ; j < in_counts[i] ; ++j) {
+      if (MPI_PROC_NULL != list[j] && (list[j] < 0 || list[j] >= size)) {
+        free (fwd);
+        return OMPI_ERR_BAD_PARAM;
+      }
+      if (MPI_PROC_NULL != list[j] && node_of[list[j]] == my_node) {
+        if (-1 == proxy) {
+          proxy = list[j];
+        }
+        ++on_node;
+      }
+    }
+
+    if (on_node < 2) {
+      continue;
+    }
+
+    for (int j = 0 ; j < i ; ++j) {
+      if (srcs[j] == s) {
+        ++k;
+      }
+    }
+    for (int j = 0, n = 0 ; j < in_counts[i] ; ++j) {
+      if (list[j] == rank && n++ == k) {
+        pos = j;
+        break;
+      }
+    }
+    if (-1 == pos) {
+      free (fwd);
+      return OMPI_ERR_BAD_PARAM;
+    }
+
+    plan->in_proxy[i] = proxy;
+    if (proxy != rank) {
+      fwd[plan->nfwd].source = s;
+      fwd[plan->nfwd].pos = pos;
+      fwd[plan->nfwd].in = i;
+      ++plan->nfwd;
+    } else if (0 == k) {
+      /* first in edge from a source this process is the proxy of */
+      ++plan->nagg;
+      nblocks += on_node;
+    }
+  }
+
+  if (plan->nfwd > 0) {
+    qsort (fwd, plan->nfwd, sizeof (nbc_nbr_fwd_t), nbc_nbr_fwd_compare);
+    plan->fwd_in = (int *) malloc (plan->nfwd * sizeof (int));
+    if (NULL == plan->fwd_in) {
+      free (fwd);
+      return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    for (int f = 0 ; f < plan->nfwd ; ++f) {
+      plan->fwd_in[f] = fwd[f].in;
+    }
+  }
+
+  free (fwd);
+
+  if (0 == plan->nagg) {
+    return OMPI_SUCCESS;
+  }
+
+  /* proxy side: the blocks of each aggregated message, in the order of
+   * the out edges of its sender */
+  plan->agg_source = (int *) malloc (plan->nagg * sizeof (int));
+  plan->agg_disp = (int *) malloc ((plan->nagg + 1) * sizeof (int));
+  plan->agg_dest = (int *) malloc (nblocks * sizeof (int));
+  plan->agg_in = (int *) malloc (nblocks * sizeof (int));
+  if (NULL == plan->agg_source || NULL == plan->agg_disp || NULL == plan->agg_dest ||
+      NULL == plan->agg_in) {
+    return OMPI_ERR_OUT_OF_RESOURCE;
+  }
+
+  for (int i = 0, a = 0 ; i < indegree ; ++i) {
+    int s = srcs[i], j;
+
+    if (rank != plan->in_proxy[i]) {
+      continue;
+    }
+    for (j = 0 ; j < i ; ++j) {
+      if (srcs[j] == s) {
+        break;
+      }
+    }
+    if (j < i) {
+      continue;
+    }
+
+    /* keep the aggregated messages ordered by sender */
+    for (j = a ; j > 0 && plan->agg_source[j - 1] > s ; --j) {
+      plan->agg_source[j] = plan->agg_source[j - 1];
+    }
+    plan->agg_source[j] = s;
+    ++a;
+  }
+
+  plan->agg_disp[0] = 0;
+  for (int a = 0 ; a < plan->nagg ; ++a) {
+    int s = plan->agg_source[a], i, n = plan->agg_disp[a], next_in = 0;
+    const int *list;
+
+    for (i = 0 ; srcs[i] != s ; ++i) {
+    }
+    list = in_dsts + in_displs[i];
+
+    for (int j = 0 ; j < in_counts[i] ; ++j) {
+      if (MPI_PROC_NULL == list[j] || node_of[list[j]] != my_node) {
+        continue;
+      }
+      plan->agg_dest[n] = list[j];
+      plan->agg_in[n] = -1;
+      if (rank == list[j]) {
+        /* the next in edge from s */
+        while (next_in < indegree && srcs[next_in] != s) {
+          ++next_in;
+        }
+        if (next_in == indegree) {
+          return OMPI_ERR_BAD_PARAM;
+        }
+        plan->agg_in[n] = next_in++;
+      }
+      ++n;
+    }
+    plan->agg_disp[a + 1] = n;
+  }
+
+  return OMPI_SUCCESS;
+}
+
+/* returns the node plan of the neighborhood collectives of comm in
+ * *plan, building it on the first call. This is collective, all the
+ * processes of comm have to call it the first time. *plan is NULL if
+ * there is nothing to aggregate for this process. */
+int NBC_Nbr_plan_get (ompi_communicator_t *comm, ompi_coll_libnbc_module_t *module, NBC_Nbr_plan **plan) {
+  int res, rank, size, indegree, outdegree, total = 0, ok = 1, my_node;
+  int *srcs = NULL, *dsts = NULL, *node_of = NULL, *in_counts = NULL, *in_displs = NULL, *in_dsts = NULL;
+  NBC_Nbr_plan *new_plan = NULL;
+
+  if (module->nbr_plan_done) {
+    *plan = module->nbr_plan;
+    return OMPI_SUCCESS;
+  }
+
+  *plan = NULL;
+
+  /* the same answer on all the processes */
+  if (!ompi_group_have_remote_peers (comm->c_local_group)) {
+    module->nbr_plan_done = true;
+    return OMPI_SUCCESS;
+  }
+
+  rank = ompi_comm_rank (comm);
+  size = ompi_comm_size (comm);
+
+  res = NBC_Comm_neighbors (comm, &srcs, &indegree, &dsts, &outdegree);
+  if (OMPI_SUCCESS != res) {
+    return res;
+  }
+
+  node_of = (int *) malloc (size * sizeof (int));
+  in_counts = (int *) calloc (indegree + 1, sizeof (int));
+  in_displs = (int *) malloc ((indegree + 1) * sizeof (int));
+  new_plan = (NBC_Nbr_plan *) calloc (1, sizeof (NBC_Nbr_plan));
+  if (NULL == node_of || NULL == in_counts || NULL == in_displs || NULL == new_plan) {
+    res = OMPI_ERR_OUT_OF_RESOURCE;
+    goto cleanup;
+  }
+
+  /* the node of every process, and the out edges of every source */
+  my_node = nbc_nbr_my_node (comm);
+  res = comm->c_coll->coll_allgather (&my_node, 1, MPI_INT, node_of, 1, MPI_INT, comm,
+                                      comm->c_coll->coll_allgather_module);
+  if (OMPI_SUCCESS != res) {
+    goto cleanup;
+  }
+
+  res = comm->c_coll->coll_neighbor_allgather (&outdegree, 1, MPI_INT, in_counts, 1, MPI_INT, comm,
+                                               comm->c_coll->coll_neighbor_allgather_module);
+  if (OMPI_SUCCESS != res) {
+    goto cleanup;
+  }
+
+  for (int i = 0 ; i < indegree ; ++i) {
+    if (MPI_PROC_NULL == srcs[i]) {
+      in_counts[i] = 0;
+    }
+    in_displs[i] = total;
+    total += in_counts[i];
+  }
+  in_displs[indegree] = total;
+
+  in_dsts = (int *) malloc ((total + 1) * sizeof (int));
+  if (NULL == in_dsts) {
+    res = OMPI_ERR_OUT_OF_RESOURCE;
+    goto cleanup;
+  }
+
+  res = comm->c_coll->coll_neighbor_allgatherv (dsts, outdegree, MPI_INT, in_dsts, in_counts, in_displs,
+                                                MPI_INT, comm, comm->c_coll->coll_neighbor_allgatherv_module);
+  if (OMPI_SUCCESS != res) {
+    goto cleanup;
+  }
+
+  if (OMPI_SUCCESS != nbc_nbr_plan_build (rank, size, node_of, srcs, indegree, dsts, outdegree, in_dsts,
+                                          in_counts, in_displs, new_plan)) {
+    ok = 0;
+  }
+
+  /* all the processes use the plan, or none does */
+  res = comm->c_coll->coll_allreduce (MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm,
+                                      comm->c_coll->coll_allreduce_module);
+  if (OMPI_SUCCESS != res) {
+    goto cleanup;
+  }
+
+  module->nbr_plan_done = true;
+  if (ok && (new_plan->ngroups > 0 || new_plan->nfwd > 0 || new_plan->nagg > 0)) {
+    module->nbr_plan = new_plan;
+    *plan = new_plan;
+    new_plan = NULL;
+  }
+
+  NBC_DEBUG(1, "node plan of the neighborhood collectives: %s\n", ok ? "built" : "failed");
+
+ cleanup:
+  NBC_Nbr_plan_free (new_plan);
+  free (in_dsts);
+  free (in_displs);
+  free (in_counts);
+  free (node_of);
+  free (srcs);
+  free (dsts);
+
+  return res;
+}
+
+/* fills schedule with the node aggregated exchange of a neighborhood
+ * allgather (the same block sbuf goes to every out edge) or alltoall
+ * (alltoall true, the i-th block of sbuf goes to the i-th out edge).
+ * The blocks sent are ssize bytes and the ones received rsize bytes,
+ * each side is aggregated if NBC_Nbr_aggregate() agrees for its size:
+ * a process with no out edges may pass any send count. In the first
+ * round the blocks for the neighbors on this node and for lone
+ * neighbors on other nodes are sent directly, the others in one
+ * message per node to its proxy, which forwards them in the second
+ * round. The temporary buffer of the schedule is returned in *tmpbuf. */
+int NBC_Nbr_sched_aggregate (const NBC_Nbr_plan *plan, int algorithm, bool alltoall, const void *sbuf,
+                             int scount, MPI_Datatype stype, size_t ssize, void *rbuf, int rcount,
+                             MPI_Datatype rtype, size_t rsize, const int *srcs, int indegree,
+                             const int *dsts, int outdegree, NBC_Schedule *schedule, void **tmpbuf) {
+  bool send_agg = NBC_Nbr_aggregate (algorithm, ssize), recv_agg = NBC_Nbr_aggregate (algorithm, rsize);
+  int res, *fill = NULL, ngroups = send_agg ? plan->ngroups : 0;
+  int nagg = recv_agg ? plan->nagg : 0, nfwd = recv_agg ? plan->nfwd : 0;
+  ptrdiff_t *group_off = NULL, *agg_off = NULL, off = 0;
+  MPI_Aint sndext, rcvext;
+
+  *tmpbuf = NULL;
+
+  res = ompi_datatype_type_extent (stype, &sndext);
+  if (MPI_SUCCESS != res) {
+    NBC_Error("MPI Error in ompi_datatype_type_extent() (%i)", res);
+    return res;
+  }
+
+  res = ompi_datatype_type_extent (rtype, &rcvext);
+  if (MPI_SUCCESS != res) {
+    NBC_Error("MPI Error in ompi_datatype_type_extent() (%i)", res);
+    return res;
+  }
+
+  /* the temporary buffer holds the packed aggregated messages to send
+   * (alltoall only, an allgather sends sbuf) and the ones received */
+  group_off = (ptrdiff_t *) malloc ((ngroups + 1) * sizeof (ptrdiff_t));
+  fill = (int *) calloc (ngroups + 1, sizeof (int));
+  agg_off = (ptrdiff_t *) malloc ((nagg + 1) * sizeof (ptrdiff_t));
+  if (NULL == group_off || NULL == fill || NULL == agg_off) {
+    res = OMPI_ERR_OUT_OF_RESOURCE;
+    goto cleanup;
+  }
+
+  for (int g = 0 ; g < ngroups ; ++g) {
+    group_off[g] = off;
+    if (alltoall) {
+      off += plan->group_count[g] * ssize;
+    }
+  }
+  for (int a = 0 ; a < nagg ; ++a) {
+    agg_off[a] = off;
+    off += (alltoall ? plan->agg_disp[a + 1] - plan->agg_disp[a] : 1) * rsize;
+  }
+
+  if (off > 0) {
+    *tmpbuf = malloc (off);
+    if (NULL == *tmpbuf) {
+      res = OMPI_ERR_OUT_OF_RESOURCE;
+      goto cleanup;
+    }
+  }
+
+  /* first round: direct and aggregated messages */
+  for (int i = 0 ; i < indegree ; ++i) {
+    if (MPI_PROC_NULL != srcs[i] && (!recv_agg || -1 == plan->in_proxy[i])) {
+      res = NBC_Sched_recv ((char *) rbuf + i * rcount * rcvext, false, rcount, rtype, srcs[i], schedule, false);
+      if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        goto cleanup;
+      }
+    }
+  }
+
+  for (int a = 0 ; a < nagg ; ++a) {
+    int count = (alltoall ? plan->agg_disp[a + 1] - plan->agg_disp[a] : 1) * (int) rsize;
+    res = NBC_Sched_recv ((void *) agg_off[a], true, count, MPI_PACKED, plan->agg_source[a], schedule, false);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      goto cleanup;
+    }
+  }
+
+  for (int i = 0 ; i < outdegree ; ++i) {
+    int g = send_agg ? plan->out_group[i] : -1;
+    const char *block = (const char *) sbuf + (alltoall ? i * scount * sndext : 0);
+
+    if (MPI_PROC_NULL == dsts[i]) {
+      continue;
+    }
+
+    if (-1 == g) {
+      res = NBC_Sched_send (block, false, scount, stype, dsts[i], schedule, false);
+    } else if (alltoall) {
+      res = NBC_Sched_copy ((void *) block, false, scount, stype, (void *) (group_off[g] + fill[g]++ * ssize),
+                            true, (int) ssize, MPI_PACKED, schedule, false);
+    }
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      goto cleanup;
+    }
+  }
+
+  for (int g = 0 ; g < ngroups ; ++g) {
+    if (alltoall) {
+      res = NBC_Sched_send ((void *) group_off[g], true, plan->group_count[g] * (int) ssize, MPI_PACKED,
+                            plan->group_proxy[g], schedule, false);
+    } else {
+      res = NBC_Sched_send (sbuf, false, scount, stype, plan->group_proxy[g], schedule, false);
+    }
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      goto cleanup;
+    }
+  }
+
+  if (0 == nagg && 0 == nfwd) {
+    /* nothing to forward or to receive from a proxy */
+    res = OMPI_SUCCESS;
+    goto cleanup;
+  }
+
+  res = NBC_Sched_barrier (schedule);
+  if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+    goto cleanup;
+  }
+
+  /* second round: the proxies forward the blocks of the aggregated
+   * messages inside the node, in the order of their senders */
+  for (int a = 0 ; a < nagg ; ++a) {
+    for (int b = plan->agg_disp[a] ; b < plan->agg_disp[a + 1] ; ++b) {
+      ptrdiff_t block = agg_off[a] + (alltoall ? (b - plan->agg_disp[a]) * rsize : 0);
+
+      if (-1 != plan->agg_in[b]) {
+        res = NBC_Sched_copy ((void *) block, true, (int) rsize, MPI_PACKED,
+                              (char *) rbuf + plan->agg_in[b] * rcount * rcvext, false, rcount, rtype,
+                              schedule, false);
+      } else {
+        res = NBC_Sched_send ((void *) block, true, (int) rsize, MPI_PACKED, plan->agg_dest[b], schedule, false);
+      }
+      if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+        goto cleanup;
+      }
+    }
+  }
+
+  for (int f = 0 ; f < nfwd ; ++f) {
+    int i = plan->fwd_in[f];
+    res = NBC_Sched_recv ((char *) rbuf + i * rcount * rcvext, false, rcount, rtype, plan->in_proxy[i],
+                          schedule, false);
+    if (OPAL_UNLIKELY(OMPI_SUCCESS != res)) {
+      goto cleanup;
+    }
+  }
+
+ cleanup:
+  if (OMPI_SUCCESS != res) {
+    free (*tmpbuf);
+    *tmpbuf = NULL;
+  }
+  free (group_off);
+  free (fill);
+  free (agg_off);
+
+  return res;
+}
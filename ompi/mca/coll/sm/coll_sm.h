@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2014 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -117,6 +117,10 @@ BEGIN_C_DECLS
         opal_atomic_uint32_t mcsiuf_num_procs_using;
         /** Must match data->mcb_count */
         volatile uint32_t mcsiuf_operation_count;
+        /** Number of sets of segments used by the operation starting
+            with this flag, for the operations where the non-root
+            processes cannot compute it by themselves */
+        volatile uint32_t mcsiuf_num_sets;
     } mca_coll_sm_in_use_flag_t;
 
     /**
@@ -195,6 +199,25 @@ BEGIN_C_DECLS
         /* Underlying reduce function and module */
 	mca_coll_base_module_reduce_fn_t previous_reduce;
 	mca_coll_base_module_t *previous_reduce_module;
+
+        /* Underlying functions and modules for the cases the flat
+           algorithms cannot handle (see MCA_COLL_SM_FLAT_MAX_PROCS) */
+        mca_coll_base_module_allgather_fn_t previous_allgather;
+        mca_coll_base_module_t *previous_allgather_module;
+        mca_coll_base_module_allgatherv_fn_t previous_allgatherv;
+        mca_coll_base_module_t *previous_allgatherv_module;
+        mca_coll_base_module_alltoall_fn_t previous_alltoall;
+        mca_coll_base_module_t *previous_alltoall_module;
+        mca_coll_base_module_alltoallv_fn_t previous_alltoallv;
+        mca_coll_base_module_t *previous_alltoallv_module;
+        mca_coll_base_module_gather_fn_t previous_gather;
+        mca_coll_base_module_t *previous_gather_module;
+        mca_coll_base_module_gatherv_fn_t previous_gatherv;
+        mca_coll_base_module_t *previous_gatherv_module;
+        mca_coll_base_module_scatter_fn_t previous_scatter;
+        mca_coll_base_module_t *previous_scatter_module;
+        mca_coll_base_module_scatterv_fn_t previous_scatterv;
+        mca_coll_base_module_t *previous_scatterv_module;
     } mca_coll_sm_module_t;
     OBJ_CLASS_DECLARATION(mca_coll_sm_module_t);
 
@@ -270,14 +293,14 @@ BEGIN_C_DECLS
 				 struct ompi_op_t *op,
 				 struct ompi_communicator_t *comm,
 				 mca_coll_base_module_t *module);
-    int mca_coll_sm_gather_intra(void *sbuf, int scount,
+    int mca_coll_sm_gather_intra(const void *sbuf, int scount,
 				 struct ompi_datatype_t *sdtype, void *rbuf,
 				 int rcount, struct ompi_datatype_t *rdtype,
 				 int root, struct ompi_communicator_t *comm,
 				 mca_coll_base_module_t *module);
-    int mca_coll_sm_gatherv_intra(void *sbuf, int scount,
+    int mca_coll_sm_gatherv_intra(const void *sbuf, int scount,
 				  struct ompi_datatype_t *sdtype, void *rbuf,
-				  int *rcounts, int *disps,
+				  const int *rcounts, const int *disps,
 				  struct ompi_datatype_t *rdtype, int root,
 				  struct ompi_communicator_t *comm,
 				  mca_coll_base_module_t *module);
@@ -316,6 +339,17 @@ BEGIN_C_DECLS
 				   struct ompi_communicator_t *comm,
 				   mca_coll_base_module_t *module);
 
+    /* Body of the alltoallv, also used by the alltoall.  If
+       same_sizes, all the messages have the same size, and the
+       processes do not need to agree on the number of segments to
+       use */
+    int mca_coll_sm_alltoallv_exchange(const void *sbuf, const int *scounts, const int *sdisps,
+                                       struct ompi_datatype_t *sdtype,
+                                       void *rbuf, const int *rcounts, const int *rdisps,
+                                       struct ompi_datatype_t *rdtype, bool same_sizes,
+                                       struct ompi_communicator_t *comm,
+                                       mca_coll_base_module_t *module);
+
     int mca_coll_sm_ft_event(int state);
 
 /**
@@ -325,6 +359,41 @@ BEGIN_C_DECLS
 extern uint32_t mca_coll_sm_one;
 
 
+/**
+ * Largest communicator size supported by the flat (non tree-based)
+ * operations: their receivers need a notification word for each
+ * sender in their control buffer (see CHILD_NOTIFY_PARENT()).
+ */
+#define MCA_COLL_SM_FLAT_MAX_PROCS \
+    ((int) (mca_coll_sm_component.sm_control_size / sizeof(size_t)))
+
+/**
+ * Number of sets of segments needed to move (bytes) bytes, when each
+ * segment carries (frag_bytes) of them
+ */
+#define MCA_COLL_SM_NUM_SETS(bytes, frag_bytes) \
+    ((int) (((bytes) + ((size_t) (frag_bytes) * \
+                        mca_coll_sm_component.sm_segs_per_inuse_flag) - 1) / \
+            ((size_t) (frag_bytes) * mca_coll_sm_component.sm_segs_per_inuse_flag)))
+
+/**
+ * Displacement (in units of the datatype extent) of block i of a
+ * v-operation.  The non-v operations call the v ones without
+ * displacements (NULL), meaning that the blocks are contiguous: this
+ * spares them the computation of displacements that may not fit in
+ * an int.
+ */
+#define MCA_COLL_SM_DISP(disps, counts, i) \
+    ((NULL == (disps)) ? (ptrdiff_t) (i) * (counts)[i] : (ptrdiff_t) (disps)[i])
+
+/**
+ * Size of the chunk of its data area a process dedicates to each of
+ * its peers in the alltoall operations (0 if the communicator is too
+ * large for that scheme).  Chunks are kept cache-line aligned.
+ */
+#define MCA_COLL_SM_ALLTOALL_CHUNK_SIZE(comm_size) \
+    (((size_t) mca_coll_sm_component.sm_fragment_size / (comm_size)) & ~((size_t) 63))
+
 /**
  * Macro to setup flag usage
  */
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -20,16 +20,20 @@
 
 #include "ompi_config.h"
 
+#include <stdlib.h>
+
 #include "ompi/constants.h"
+#include "ompi/communicator/communicator.h"
 #include "coll_sm.h"
 
-
 /*
- *	allgather
+ *	allgather_intra
  *
  *	Function:	- allgather
  *	Accepts:	- same as MPI_Allgather()
  *	Returns:	- MPI_SUCCESS or error code
+ *
+ *	An allgatherv with the same count for everybody.
  */
 int mca_coll_sm_allgather_intra(const void *sbuf, int scount,
                                 struct ompi_datatype_t *sdtype, void *rbuf,
@@ -37,5 +41,25 @@ int mca_coll_sm_allgather_intra(const void *sbuf, int scount,
                                 struct ompi_communicator_t *comm,
                                 mca_coll_base_module_t *module)
 {
-    return OMPI_ERR_NOT_IMPLEMENTED;
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    int i, ret, size = ompi_comm_size(comm);
+    int *counts;
+
+    if (size > MCA_COLL_SM_FLAT_MAX_PROCS) {
+        return sm_module->previous_allgather(sbuf, scount, sdtype, rbuf, rcount, rdtype,
+                                             comm, sm_module->previous_allgather_module);
+    }
+
+    counts = (int*) malloc(size * sizeof(int));
+    if (NULL == counts) {
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    for (i = 0; i < size; ++i) {
+        counts[i] = rcount;
+    }
+
+    ret = mca_coll_sm_allgatherv_intra(sbuf, scount, sdtype, rbuf, counts, NULL, rdtype,
+                                       comm, module);
+    free(counts);
+    return ret;
 }
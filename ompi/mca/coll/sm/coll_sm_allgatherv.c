@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -20,23 +20,212 @@
 
 #include "ompi_config.h"
 
+#include <string.h>
+
+#include "opal/datatype/opal_convertor.h"
+#include "opal/sys/atomic.h"
 #include "ompi/constants.h"
+#include "ompi/communicator/communicator.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "ompi/mca/coll/coll.h"
+#include "ompi/mca/coll/base/coll_base_util.h"
 #include "coll_sm.h"
 
 
-/*
- *	allgatherv_intra
+/**
+ * Shared memory allgatherv.
+ *
+ * For each segment, every process copies a fragment of its buffer
+ * into its own data area of the segment and writes the size of the
+ * fragment in the control buffer of every other process (one entry
+ * per process, as in the reduce).  Then it waits for the fragment of
+ * each of the other processes in turn and copies it into its
+ * output buffer.
  *
- *	Function:	- allgatherv
- *	Accepts:	- same as MPI_Allgatherv()
- *	Returns:	- MPI_SUCCESS or error code
+ * There is no root: rank 0 claims the sets of segments for all the
+ * processes (including itself), and each process releases them once
+ * it has copied everything out.  All the processes know the counts,
+ * so they all know how many sets of segments the operation takes.
  */
 int mca_coll_sm_allgatherv_intra(const void *sbuf, int scount,
                                  struct ompi_datatype_t *sdtype,
-                                 void * rbuf, const int *rcounts, const int *disps,
+                                 void *rbuf, const int *rcounts, const int *disps,
                                  struct ompi_datatype_t *rdtype,
                                  struct ompi_communicator_t *comm,
-                                mca_coll_base_module_t *module)
+                                 mca_coll_base_module_t *module)
 {
-    return OMPI_ERR_NOT_IMPLEMENTED;
+    struct iovec iov;
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    mca_coll_sm_comm_t *data;
+    int ret = OMPI_SUCCESS, rank, size, peer, set, num_sets;
+    int flag_num, segment_num, max_segment_num;
+    size_t max_data, max_bytes, type_size, left, *peer_left = NULL;
+    mca_coll_sm_in_use_flag_t *flag;
+    mca_coll_sm_data_index_t *index;
+    opal_convertor_t convertor, *peer_convertors = NULL;
+    ptrdiff_t lb, extent;
+
+    size = ompi_comm_size(comm);
+    if (size > MCA_COLL_SM_FLAT_MAX_PROCS) {
+        return sm_module->previous_allgatherv(sbuf, scount, sdtype, rbuf, rcounts, disps,
+                                              rdtype, comm,
+                                              sm_module->previous_allgatherv_module);
+    }
+
+    /* Everybody knows the size of the largest contribution */
+    ompi_datatype_type_size(rdtype, &type_size);
+    max_bytes = 0;
+    for (peer = 0; peer < size; ++peer) {
+        if ((size_t) rcounts[peer] * type_size > max_bytes) {
+            max_bytes = (size_t) rcounts[peer] * type_size;
+        }
+    }
+    if (0 == max_bytes) {
+        return OMPI_SUCCESS;
+    }
+    num_sets = MCA_COLL_SM_NUM_SETS(max_bytes, mca_coll_sm_component.sm_fragment_size);
+
+    /* Lazily enable the module the first time we invoke a collective
+       on it */
+    if (!sm_module->enabled) {
+        if (OMPI_SUCCESS != (ret = ompi_coll_sm_lazy_enable(module, comm))) {
+            return ret;
+        }
+    }
+    data = sm_module->sm_comm_data;
+    rank = ompi_comm_rank(comm);
+    ompi_datatype_get_extent(rdtype, &lb, &extent);
+
+    /* A send convertor for my contribution, and a receive convertor
+       for the contribution of each of my peers */
+    peer_convertors = (opal_convertor_t*) malloc(size * sizeof(opal_convertor_t));
+    peer_left = (size_t*) malloc(size * sizeof(size_t));
+    if (NULL == peer_convertors || NULL == peer_left) {
+        free(peer_convertors);
+        free(peer_left);
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    OBJ_CONSTRUCT(&convertor, opal_convertor_t);
+    for (peer = 0; peer < size; ++peer) {
+        OBJ_CONSTRUCT(&peer_convertors[peer], opal_convertor_t);
+        peer_left[peer] = 0;
+    }
+
+    if (MPI_IN_PLACE == sbuf) {
+        ret = opal_convertor_copy_and_prepare_for_send(ompi_mpi_local_convertor,
+                                                       &(rdtype->super),
+                                                       rcounts[rank],
+                                                       (char *) rbuf + MCA_COLL_SM_DISP(disps, rcounts, rank) * extent,
+                                                       0,
+                                                       &convertor);
+    } else {
+        ret = opal_convertor_copy_and_prepare_for_send(ompi_mpi_local_convertor,
+                                                       &(sdtype->super),
+                                                       scount,
+                                                       sbuf,
+                                                       0,
+                                                       &convertor);
+    }
+    if (OMPI_SUCCESS != ret) {
+        goto cleanup;
+    }
+    opal_convertor_get_packed_size(&convertor, &left);
+
+    for (peer = 0; peer < size; ++peer) {
+        if (peer == rank || 0 == rcounts[peer]) {
+            continue;
+        }
+        if (OMPI_SUCCESS !=
+            (ret = opal_convertor_copy_and_prepare_for_recv(ompi_mpi_local_convertor,
+                                                            &(rdtype->super),
+                                                            rcounts[peer],
+                                                            (char *) rbuf + MCA_COLL_SM_DISP(disps, rcounts, peer) * extent,
+                                                            0,
+                                                            &peer_convertors[peer]))) {
+            goto cleanup;
+        }
+        opal_convertor_get_packed_size(&peer_convertors[peer], &peer_left[peer]);
+    }
+
+    /* My own contribution does not go through shared memory */
+    if (MPI_IN_PLACE != sbuf) {
+        ret = ompi_datatype_sndrcv((void *) sbuf, scount, sdtype,
+                                   (char *) rbuf + MCA_COLL_SM_DISP(disps, rcounts, rank) * extent,
+                                   rcounts[rank], rdtype);
+        if (OMPI_SUCCESS != ret) {
+            goto cleanup;
+        }
+    }
+
+    /* Main loop over exchanging fragments */
+
+    for (set = 0; set < num_sets; ++set) {
+        flag_num = (data->mcb_operation_count %
+                    mca_coll_sm_component.sm_comm_num_in_use_flags);
+        FLAG_SETUP(flag_num, flag, data);
+        if (0 == rank) {
+            FLAG_WAIT_FOR_IDLE(flag, allgatherv_flag_label1);
+            FLAG_RETAIN(flag, size, data->mcb_operation_count);
+        } else {
+            FLAG_WAIT_FOR_OP(flag, data->mcb_operation_count, allgatherv_flag_label2);
+        }
+        ++data->mcb_operation_count;
+
+        /* Loop over all the segments in this set */
+
+        segment_num =
+            flag_num * mca_coll_sm_component.sm_segs_per_inuse_flag;
+        max_segment_num =
+            (flag_num + 1) * mca_coll_sm_component.sm_segs_per_inuse_flag;
+        for (; segment_num < max_segment_num; ++segment_num) {
+            index = &(data->mcb_data_index[segment_num]);
+
+            /* Copy my fragment into my shared mem segment, and tell
+               everybody that it is ready */
+            if (left > 0) {
+                max_data = mca_coll_sm_component.sm_fragment_size;
+                COPY_FRAGMENT_IN(convertor, index, rank, iov, max_data);
+                left -= max_data;
+
+                /* Wait for the write to absolutely complete */
+                opal_atomic_wmb();
+
+                for (peer = 0; peer < size; ++peer) {
+                    if (peer != rank) {
+                        CHILD_NOTIFY_PARENT(rank, peer, index, max_data);
+                    }
+                }
+            }
+
+            /* Copy out the fragments of my peers */
+            for (peer = 0; peer < size; ++peer) {
+                if (0 == peer_left[peer]) {
+                    continue;
+                }
+                PARENT_WAIT_FOR_NOTIFY_SPECIFIC(peer, rank, index, max_data,
+                                                allgatherv_peer_label);
+                COPY_FRAGMENT_OUT(peer_convertors[peer], peer, index, iov, max_data);
+                peer_left[peer] -= max_data;
+            }
+        }
+
+        /* Wait for all copy-out writes to complete before I say I'm
+           done with the segments */
+        opal_atomic_wmb();
+
+        /* We're finished with this set of segments */
+        FLAG_RELEASE(flag);
+    }
+
+ cleanup:
+    OBJ_DESTRUCT(&convertor);
+    for (peer = 0; peer < size; ++peer) {
+        OBJ_DESTRUCT(&peer_convertors[peer]);
+    }
+    free(peer_convertors);
+    free(peer_left);
+
+    /* All done */
+
+    return ret;
 }
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -20,22 +20,51 @@
 
 #include "ompi_config.h"
 
+#include <stdlib.h>
+
 #include "ompi/constants.h"
+#include "ompi/communicator/communicator.h"
 #include "coll_sm.h"
 
-
 /*
  *	alltoall_intra
  *
  *	Function:	- MPI_Alltoall
  *	Accepts:	- same as MPI_Alltoall()
  *	Returns:	- MPI_SUCCESS or an MPI error code
+ *
+ *	An alltoallv with the same count for everybody, which spares
+ *	the processes the agreement on the number of segments to use.
  */
 int mca_coll_sm_alltoall_intra(const void *sbuf, int scount,
                                struct ompi_datatype_t *sdtype, void *rbuf,
                                int rcount, struct ompi_datatype_t *rdtype,
                                struct ompi_communicator_t *comm,
-                                mca_coll_base_module_t *module)
+                               mca_coll_base_module_t *module)
 {
-    return OMPI_ERR_NOT_IMPLEMENTED;
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    int i, ret, size = ompi_comm_size(comm);
+    int *scounts, *rcounts;
+
+    if (MPI_IN_PLACE == sbuf || size > MCA_COLL_SM_FLAT_MAX_PROCS ||
+        0 == MCA_COLL_SM_ALLTOALL_CHUNK_SIZE(size)) {
+        return sm_module->previous_alltoall(sbuf, scount, sdtype, rbuf, rcount, rdtype,
+                                            comm, sm_module->previous_alltoall_module);
+    }
+
+    scounts = (int*) malloc(2 * size * sizeof(int));
+    if (NULL == scounts) {
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    rcounts = scounts + size;
+    for (i = 0; i < size; ++i) {
+        scounts[i] = scount;
+        rcounts[i] = rcount;
+    }
+
+    ret = mca_coll_sm_alltoallv_exchange(sbuf, scounts, NULL, sdtype,
+                                         rbuf, rcounts, NULL, rdtype,
+                                         true, comm, module);
+    free(scounts);
+    return ret;
 }
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -20,16 +20,40 @@
 
 #include "ompi_config.h"
 
+#include <string.h>
+
+#include "opal/datatype/opal_convertor.h"
+#include "opal/sys/atomic.h"
 #include "ompi/constants.h"
+#include "ompi/communicator/communicator.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "ompi/mca/coll/coll.h"
+#include "ompi/mca/coll/base/coll_base_util.h"
 #include "coll_sm.h"
 
 
-/*
- *	alltoallv_intra
+/**
+ * Shared memory alltoallv.
+ *
+ * The data area of each process in a segment is divided into size
+ * chunks, chunk q carrying the data for process q.  For each segment,
+ * every process copies a fragment of the data for each of its peers
+ * into the corresponding chunk of its own data area, and writes the
+ * size of the fragment in the control buffer of the peer (one entry
+ * per process, as in the reduce).  Then it waits for the fragment of
+ * each of its peers and copies it into its output buffer.  Small
+ * messages thus travel in a single copy in and a single copy out,
+ * with no per-message matching.
+ *
+ * There is no root: rank 0 claims the sets of segments for all the
+ * processes (including itself), and each process releases them once
+ * it has copied everything out.  As a process only knows the sizes of
+ * its own messages, the processes first agree on the number of sets
+ * of segments the operation takes (unless all the messages have the
+ * same size, as in MPI_Alltoall).
  *
- *	Function:	- MPI_Alltoallv
- *	Accepts:	- same as MPI_Alltoallv()
- *	Returns:	- MPI_SUCCESS or an MPI error code
+ * MPI_IN_PLACE, and communicators too large for a reasonable chunk
+ * size, are left to the previous module.
  */
 int mca_coll_sm_alltoallv_intra(const void *sbuf, const int *scounts, const int *sdisps,
                                 struct ompi_datatype_t *sdtype,
@@ -38,5 +62,201 @@ int mca_coll_sm_alltoallv_intra(const void *sbuf, const int *scounts, const int
                                 struct ompi_communicator_t *comm,
                                 mca_coll_base_module_t *module)
 {
-    return OMPI_ERR_NOT_IMPLEMENTED;
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    int size = ompi_comm_size(comm);
+
+    if (MPI_IN_PLACE == sbuf || size > MCA_COLL_SM_FLAT_MAX_PROCS ||
+        0 == MCA_COLL_SM_ALLTOALL_CHUNK_SIZE(size)) {
+        return sm_module->previous_alltoallv(sbuf, scounts, sdisps, sdtype,
+                                             rbuf, rcounts, rdisps, rdtype, comm,
+                                             sm_module->previous_alltoallv_module);
+    }
+    return mca_coll_sm_alltoallv_exchange(sbuf, scounts, sdisps, sdtype,
+                                          rbuf, rcounts, rdisps, rdtype,
+                                          false, comm, module);
+}
+
+int mca_coll_sm_alltoallv_exchange(const void *sbuf, const int *scounts, const int *sdisps,
+                                   struct ompi_datatype_t *sdtype,
+                                   void *rbuf, const int *rcounts, const int *rdisps,
+                                   struct ompi_datatype_t *rdtype, bool same_sizes,
+                                   struct ompi_communicator_t *comm,
+                                   mca_coll_base_module_t *module)
+{
+    struct iovec iov;
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    mca_coll_sm_comm_t *data;
+    int ret = OMPI_SUCCESS, rank, size, peer, set, num_sets;
+    int flag_num, segment_num, max_segment_num;
+    size_t max_data, max_bytes, chunk_size, *send_left = NULL, *recv_left;
+    mca_coll_sm_in_use_flag_t *flag;
+    mca_coll_sm_data_index_t *index;
+    opal_convertor_t *send_convertors = NULL, *recv_convertors;
+    ptrdiff_t lb, sextent, rextent;
+
+    size = ompi_comm_size(comm);
+    chunk_size = MCA_COLL_SM_ALLTOALL_CHUNK_SIZE(size);
+
+    /* Lazily enable the module the first time we invoke a collective
+       on it */
+    if (!sm_module->enabled) {
+        if (OMPI_SUCCESS != (ret = ompi_coll_sm_lazy_enable(module, comm))) {
+            return ret;
+        }
+    }
+    data = sm_module->sm_comm_data;
+    rank = ompi_comm_rank(comm);
+    ompi_datatype_get_extent(sdtype, &lb, &sextent);
+    ompi_datatype_get_extent(rdtype, &lb, &rextent);
+
+    send_convertors = (opal_convertor_t*) malloc(2 * size * sizeof(opal_convertor_t));
+    send_left = (size_t*) malloc(2 * size * sizeof(size_t));
+    if (NULL == send_convertors || NULL == send_left) {
+        free(send_convertors);
+        free(send_left);
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    recv_convertors = send_convertors + size;
+    recv_left = send_left + size;
+    for (peer = 0; peer < size; ++peer) {
+        OBJ_CONSTRUCT(&send_convertors[peer], opal_convertor_t);
+        OBJ_CONSTRUCT(&recv_convertors[peer], opal_convertor_t);
+        send_left[peer] = recv_left[peer] = 0;
+    }
+
+    max_bytes = 0;
+    for (peer = 0; peer < size; ++peer) {
+        if (peer == rank) {
+            continue;
+        }
+        if (0 != scounts[peer]) {
+            if (OMPI_SUCCESS !=
+                (ret = opal_convertor_copy_and_prepare_for_send(ompi_mpi_local_convertor,
+                                                                &(sdtype->super),
+                                                                scounts[peer],
+                                                                (char *) sbuf + MCA_COLL_SM_DISP(sdisps, scounts, peer) * sextent,
+                                                                0,
+                                                                &send_convertors[peer]))) {
+                goto cleanup;
+            }
+            opal_convertor_get_packed_size(&send_convertors[peer], &send_left[peer]);
+            if (send_left[peer] > max_bytes) {
+                max_bytes = send_left[peer];
+            }
+        }
+        if (0 != rcounts[peer]) {
+            if (OMPI_SUCCESS !=
+                (ret = opal_convertor_copy_and_prepare_for_recv(ompi_mpi_local_convertor,
+                                                                &(rdtype->super),
+                                                                rcounts[peer],
+                                                                (char *) rbuf + MCA_COLL_SM_DISP(rdisps, rcounts, peer) * rextent,
+                                                                0,
+                                                                &recv_convertors[peer]))) {
+                goto cleanup;
+            }
+            opal_convertor_get_packed_size(&recv_convertors[peer], &recv_left[peer]);
+            if (recv_left[peer] > max_bytes) {
+                max_bytes = recv_left[peer];
+            }
+        }
+    }
+
+    /* My own part does not go through shared memory */
+    ret = ompi_datatype_sndrcv((char *) sbuf + MCA_COLL_SM_DISP(sdisps, scounts, rank) * sextent,
+                               scounts[rank], sdtype,
+                               (char *) rbuf + MCA_COLL_SM_DISP(rdisps, rcounts, rank) * rextent,
+                               rcounts[rank], rdtype);
+    if (OMPI_SUCCESS != ret) {
+        goto cleanup;
+    }
+
+    /* Agree on the number of sets of segments */
+    num_sets = MCA_COLL_SM_NUM_SETS(max_bytes, chunk_size);
+    if (!same_sizes) {
+        ret = mca_coll_sm_allreduce_intra(MPI_IN_PLACE, &num_sets, 1, MPI_INT, MPI_MAX,
+                                          comm, module);
+        if (OMPI_SUCCESS != ret) {
+            goto cleanup;
+        }
+    }
+
+    /* Main loop over exchanging fragments */
+
+    for (set = 0; set < num_sets; ++set) {
+        flag_num = (data->mcb_operation_count %
+                    mca_coll_sm_component.sm_comm_num_in_use_flags);
+        FLAG_SETUP(flag_num, flag, data);
+        if (0 == rank) {
+            FLAG_WAIT_FOR_IDLE(flag, alltoallv_flag_label1);
+            FLAG_RETAIN(flag, size, data->mcb_operation_count);
+        } else {
+            FLAG_WAIT_FOR_OP(flag, data->mcb_operation_count, alltoallv_flag_label2);
+        }
+        ++data->mcb_operation_count;
+
+        /* Loop over all the segments in this set */
+
+        segment_num =
+            flag_num * mca_coll_sm_component.sm_segs_per_inuse_flag;
+        max_segment_num =
+            (flag_num + 1) * mca_coll_sm_component.sm_segs_per_inuse_flag;
+        for (; segment_num < max_segment_num; ++segment_num) {
+            index = &(data->mcb_data_index[segment_num]);
+
+            /* Copy a fragment for each of my peers into its chunk of
+               my shared mem segment, and tell it that it is ready */
+            for (peer = 0; peer < size; ++peer) {
+                if (0 == send_left[peer]) {
+                    continue;
+                }
+                iov.iov_base = index->mcbmi_data +
+                    (rank * mca_coll_sm_component.sm_fragment_size) +
+                    (peer * chunk_size);
+                iov.iov_len = max_data = chunk_size;
+                opal_convertor_pack(&send_convertors[peer], &iov, &mca_coll_sm_one,
+                                    &max_data);
+                send_left[peer] -= max_data;
+
+                /* Wait for the write to absolutely complete */
+                opal_atomic_wmb();
+
+                CHILD_NOTIFY_PARENT(rank, peer, index, max_data);
+            }
+
+            /* Copy out the fragments my peers have for me */
+            for (peer = 0; peer < size; ++peer) {
+                if (0 == recv_left[peer]) {
+                    continue;
+                }
+                PARENT_WAIT_FOR_NOTIFY_SPECIFIC(peer, rank, index, max_data,
+                                                alltoallv_peer_label);
+                iov.iov_base = index->mcbmi_data +
+                    (peer * mca_coll_sm_component.sm_fragment_size) +
+                    (rank * chunk_size);
+                iov.iov_len = max_data;
+                opal_convertor_unpack(&recv_convertors[peer], &iov, &mca_coll_sm_one,
+                                      &max_data);
+                recv_left[peer] -= max_data;
+            }
+        }
+
+        /* Wait for all copy-out writes to complete before I say I'm
+           done with the segments */
+        opal_atomic_wmb();
+
+        /* We're finished with this set of segments */
+        FLAG_RELEASE(flag);
+    }
+
+ cleanup:
+    for (peer = 0; peer < size; ++peer) {
+        OBJ_DESTRUCT(&send_convertors[peer]);
+        OBJ_DESTRUCT(&recv_convertors[peer]);
+    }
+    free(send_convertors);
+    free(send_left);
+
+    /* All done */
+
+    return ret;
 }
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -20,16 +20,34 @@
 
 #include "ompi_config.h"
 
+#include <string.h>
+
+#include "opal/datatype/opal_convertor.h"
+#include "opal/sys/atomic.h"
 #include "ompi/constants.h"
+#include "ompi/communicator/communicator.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "ompi/mca/coll/coll.h"
+#include "ompi/mca/coll/base/coll_base_util.h"
 #include "coll_sm.h"
 
 
-/*
- *	gatherv_intra
+/**
+ * Shared memory gatherv.
  *
- *	Function:	- basic gatherv operation
- *	Accepts:	- same arguments as MPI_Gatherb()
- *	Returns:	- MPI_SUCCESS or error code
+ * This is a flat fan in: every non-root process copies a fragment of
+ * its buffer into its own data area of the segment and writes the
+ * size of the fragment in the root's control buffer (one entry per
+ * process, as in the reduce).  The root waits for the fragment of
+ * each process in turn and copies it into the user's buffer.
+ *
+ * The root claims the sets of segments for size processes (i.e.,
+ * including itself), and releases them when it has copied everything
+ * out of them: the non-root processes release them as soon as they
+ * have copied their data in.  As the non-root processes cannot know
+ * how many sets of segments the operation takes (it depends on the
+ * largest contribution), the root writes it in the first in-use
+ * flag of the operation.
  */
 int mca_coll_sm_gatherv_intra(const void *sbuf, int scount,
                               struct ompi_datatype_t *sdtype,
@@ -38,5 +56,206 @@ int mca_coll_sm_gatherv_intra(const void *sbuf, int scount,
                               struct ompi_communicator_t *comm,
                               mca_coll_base_module_t *module)
 {
-    return OMPI_ERR_NOT_IMPLEMENTED;
+    struct iovec iov;
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    mca_coll_sm_comm_t *data;
+    int ret = OMPI_SUCCESS, rank, size, peer, set, num_sets;
+    int flag_num, segment_num, max_segment_num;
+    size_t max_data, max_bytes, left, *peer_left = NULL;
+    mca_coll_sm_in_use_flag_t *flag;
+    mca_coll_sm_data_index_t *index;
+    opal_convertor_t convertor, *peer_convertors = NULL;
+    ptrdiff_t lb, extent;
+
+    size = ompi_comm_size(comm);
+    if (size > MCA_COLL_SM_FLAT_MAX_PROCS) {
+        return sm_module->previous_gatherv(sbuf, scount, sdtype, rbuf, rcounts, disps,
+                                           rdtype, root, comm,
+                                           sm_module->previous_gatherv_module);
+    }
+
+    /* Lazily enable the module the first time we invoke a collective
+       on it */
+    if (!sm_module->enabled) {
+        if (OMPI_SUCCESS != (ret = ompi_coll_sm_lazy_enable(module, comm))) {
+            return ret;
+        }
+    }
+    data = sm_module->sm_comm_data;
+    rank = ompi_comm_rank(comm);
+
+    /*********************************************************************
+     * Root
+     *********************************************************************/
+
+    if (root == rank) {
+        ompi_datatype_get_extent(rdtype, &lb, &extent);
+
+        /* The root needs a receive convertor for each of its peers */
+        peer_convertors = (opal_convertor_t*) malloc(size * sizeof(opal_convertor_t));
+        peer_left = (size_t*) malloc(size * sizeof(size_t));
+        if (NULL == peer_convertors || NULL == peer_left) {
+            free(peer_convertors);
+            free(peer_left);
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+        for (peer = 0; peer < size; ++peer) {
+            OBJ_CONSTRUCT(&peer_convertors[peer], opal_convertor_t);
+            peer_left[peer] = 0;
+        }
+        max_bytes = 0;
+        for (peer = 0; peer < size; ++peer) {
+            if (peer == rank || 0 == rcounts[peer]) {
+                continue;
+            }
+            if (OMPI_SUCCESS !=
+                (ret = opal_convertor_copy_and_prepare_for_recv(ompi_mpi_local_convertor,
+                                                                &(rdtype->super),
+                                                                rcounts[peer],
+                                                                (char *) rbuf + MCA_COLL_SM_DISP(disps, rcounts, peer) * extent,
+                                                                0,
+                                                                &peer_convertors[peer]))) {
+                goto root_cleanup;
+            }
+            opal_convertor_get_packed_size(&peer_convertors[peer], &peer_left[peer]);
+            if (peer_left[peer] > max_bytes) {
+                max_bytes = peer_left[peer];
+            }
+        }
+
+        /* My own contribution does not go through shared memory */
+        if (MPI_IN_PLACE != sbuf) {
+            ret = ompi_datatype_sndrcv((void *) sbuf, scount, sdtype,
+                                       (char *) rbuf + MCA_COLL_SM_DISP(disps, rcounts, rank) * extent,
+                                       rcounts[rank], rdtype);
+            if (OMPI_SUCCESS != ret) {
+                goto root_cleanup;
+            }
+        }
+
+        /* Even if there is nothing to receive, the non-root processes
+           are waiting for at least one set of segments */
+        num_sets = MCA_COLL_SM_NUM_SETS(max_bytes, mca_coll_sm_component.sm_fragment_size);
+        if (0 == num_sets) {
+            num_sets = 1;
+        }
+
+        /* Main loop over receiving fragments */
+
+        for (set = 0; set < num_sets; ++set) {
+            flag_num = (data->mcb_operation_count %
+                        mca_coll_sm_component.sm_comm_num_in_use_flags);
+            FLAG_SETUP(flag_num, flag, data);
+            FLAG_WAIT_FOR_IDLE(flag, gatherv_root_flag_label);
+            if (0 == set) {
+                flag->mcsiuf_num_sets = num_sets;
+                opal_atomic_wmb();
+            }
+            FLAG_RETAIN(flag, size, data->mcb_operation_count);
+            ++data->mcb_operation_count;
+
+            /* Loop over all the segments in this set */
+
+            segment_num =
+                flag_num * mca_coll_sm_component.sm_segs_per_inuse_flag;
+            max_segment_num =
+                (flag_num + 1) * mca_coll_sm_component.sm_segs_per_inuse_flag;
+            for (; segment_num < max_segment_num; ++segment_num) {
+                index = &(data->mcb_data_index[segment_num]);
+
+                for (peer = 0; peer < size; ++peer) {
+                    if (0 == peer_left[peer]) {
+                        continue;
+                    }
+
+                    /* Wait for the peer to tell me that its fragment
+                       is ready, and copy it out */
+                    PARENT_WAIT_FOR_NOTIFY_SPECIFIC(peer, rank, index, max_data,
+                                                    gatherv_root_peer_label);
+                    COPY_FRAGMENT_OUT(peer_convertors[peer], peer, index, iov, max_data);
+                    peer_left[peer] -= max_data;
+                }
+            }
+
+            /* Root is now done with this set of segments */
+            FLAG_RELEASE(flag);
+        }
+
+    root_cleanup:
+        for (peer = 0; peer < size; ++peer) {
+            OBJ_DESTRUCT(&peer_convertors[peer]);
+        }
+        free(peer_convertors);
+        free(peer_left);
+    }
+
+    /*********************************************************************
+     * Non-root
+     *********************************************************************/
+
+    else {
+        OBJ_CONSTRUCT(&convertor, opal_convertor_t);
+        if (OMPI_SUCCESS !=
+            (ret =
+             opal_convertor_copy_and_prepare_for_send(ompi_mpi_local_convertor,
+                                                      &(sdtype->super),
+                                                      scount,
+                                                      sbuf,
+                                                      0,
+                                                      &convertor))) {
+            OBJ_DESTRUCT(&convertor);
+            return ret;
+        }
+        opal_convertor_get_packed_size(&convertor, &left);
+
+        /* Loop over sending fragments to the root; the number of sets
+           is known once the root has claimed the first one */
+
+        num_sets = 1;
+        for (set = 0; set < num_sets; ++set) {
+            flag_num = (data->mcb_operation_count %
+                        mca_coll_sm_component.sm_comm_num_in_use_flags);
+
+            /* Wait for the root to mark this set of segments as
+               ours */
+            FLAG_SETUP(flag_num, flag, data);
+            FLAG_WAIT_FOR_OP(flag, data->mcb_operation_count, gatherv_nonroot_flag_label);
+            ++data->mcb_operation_count;
+            if (0 == set) {
+                opal_atomic_rmb();
+                num_sets = (int) flag->mcsiuf_num_sets;
+            }
+
+            /* Loop over all the segments in this set */
+
+            segment_num =
+                flag_num * mca_coll_sm_component.sm_segs_per_inuse_flag;
+            max_segment_num =
+                (flag_num + 1) * mca_coll_sm_component.sm_segs_per_inuse_flag;
+            for (; left > 0 && segment_num < max_segment_num; ++segment_num) {
+                index = &(data->mcb_data_index[segment_num]);
+
+                /* Copy from the user's buffer to my shared mem
+                   segment */
+                max_data = mca_coll_sm_component.sm_fragment_size;
+                COPY_FRAGMENT_IN(convertor, index, rank, iov, max_data);
+                left -= max_data;
+
+                /* Wait for the write to absolutely complete */
+                opal_atomic_wmb();
+
+                /* Tell the root that this fragment is ready */
+                CHILD_NOTIFY_PARENT(rank, root, index, max_data);
+            }
+
+            /* We're finished with this set of segments */
+            FLAG_RELEASE(flag);
+        }
+
+        OBJ_DESTRUCT(&convertor);
+    }
+
+    /* All done */
+
+    return ret;
 }
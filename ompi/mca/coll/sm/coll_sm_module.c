@@ -90,9 +90,49 @@ static void mca_coll_sm_module_construct(mca_coll_sm_module_t *module)
     module->sm_comm_data = NULL;
     module->previous_reduce = NULL;
     module->previous_reduce_module = NULL;
+    module->previous_allgather = NULL;
+    module->previous_allgather_module = NULL;
+    module->previous_allgatherv = NULL;
+    module->previous_allgatherv_module = NULL;
+    module->previous_alltoall = NULL;
+    module->previous_alltoall_module = NULL;
+    module->previous_alltoallv = NULL;
+    module->previous_alltoallv_module = NULL;
+    module->previous_gather = NULL;
+    module->previous_gather_module = NULL;
+    module->previous_gatherv = NULL;
+    module->previous_gatherv_module = NULL;
+    module->previous_scatter = NULL;
+    module->previous_scatter_module = NULL;
+    module->previous_scatterv = NULL;
+    module->previous_scatterv_module = NULL;
     module->super.coll_module_disable = mca_coll_sm_module_disable;
 }
 
+/*
+ * Release the modules we fall back on
+ */
+static void mca_coll_sm_module_release_previous(mca_coll_sm_module_t *module)
+{
+#define RELEASE_PREVIOUS(name)                                  \
+    if (NULL != module->previous_ ## name ## _module) {         \
+        module->previous_ ## name = NULL;                       \
+        OBJ_RELEASE(module->previous_ ## name ## _module);      \
+        module->previous_ ## name ## _module = NULL;            \
+    }
+
+    RELEASE_PREVIOUS(reduce);
+    RELEASE_PREVIOUS(allgather);
+    RELEASE_PREVIOUS(allgatherv);
+    RELEASE_PREVIOUS(alltoall);
+    RELEASE_PREVIOUS(alltoallv);
+    RELEASE_PREVIOUS(gather);
+    RELEASE_PREVIOUS(gatherv);
+    RELEASE_PREVIOUS(scatter);
+    RELEASE_PREVIOUS(scatterv);
+#undef RELEASE_PREVIOUS
+}
+
 /*
  * Module destructor
  */
@@ -111,10 +151,7 @@ static void mca_coll_sm_module_destruct(mca_coll_sm_module_t *module)
         free(c);
     }
 
-    /* It should always be non-NULL, but just in case */
-    if (NULL != module->previous_reduce_module) {
-        OBJ_RELEASE(module->previous_reduce_module);
-    }
+    mca_coll_sm_module_release_previous(module);
 
     module->enabled = false;
 }
@@ -124,12 +161,7 @@ static void mca_coll_sm_module_destruct(mca_coll_sm_module_t *module)
  */
 static int mca_coll_sm_module_disable(mca_coll_base_module_t *module, struct ompi_communicator_t *comm)
 {
-    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
-    if (NULL != sm_module->previous_reduce_module) {
-	sm_module->previous_reduce = NULL;
-        OBJ_RELEASE(sm_module->previous_reduce_module);
-	sm_module->previous_reduce_module = NULL;
-    }
+    mca_coll_sm_module_release_previous((mca_coll_sm_module_t*) module);
     return OMPI_SUCCESS;
 }
 
@@ -196,22 +228,22 @@ mca_coll_sm_comm_query(struct ompi_communicator_t *comm, int *priority)
     /* All is good -- return a module */
     sm_module->super.coll_module_enable = sm_module_enable;
     sm_module->super.ft_event        = mca_coll_sm_ft_event;
-    sm_module->super.coll_allgather  = NULL;
-    sm_module->super.coll_allgatherv = NULL;
+    sm_module->super.coll_allgather  = mca_coll_sm_allgather_intra;
+    sm_module->super.coll_allgatherv = mca_coll_sm_allgatherv_intra;
     sm_module->super.coll_allreduce  = mca_coll_sm_allreduce_intra;
-    sm_module->super.coll_alltoall   = NULL;
-    sm_module->super.coll_alltoallv  = NULL;
+    sm_module->super.coll_alltoall   = mca_coll_sm_alltoall_intra;
+    sm_module->super.coll_alltoallv  = mca_coll_sm_alltoallv_intra;
     sm_module->super.coll_alltoallw  = NULL;
     sm_module->super.coll_barrier    = mca_coll_sm_barrier_intra;
     sm_module->super.coll_bcast      = mca_coll_sm_bcast_intra;
     sm_module->super.coll_exscan     = NULL;
-    sm_module->super.coll_gather     = NULL;
-    sm_module->super.coll_gatherv    = NULL;
+    sm_module->super.coll_gather     = mca_coll_sm_gather_intra;
+    sm_module->super.coll_gatherv    = mca_coll_sm_gatherv_intra;
     sm_module->super.coll_reduce     = mca_coll_sm_reduce_intra;
     sm_module->super.coll_reduce_scatter = NULL;
     sm_module->super.coll_scan       = NULL;
-    sm_module->super.coll_scatter    = NULL;
-    sm_module->super.coll_scatterv   = NULL;
+    sm_module->super.coll_scatter    = mca_coll_sm_scatter_intra;
+    sm_module->super.coll_scatterv   = mca_coll_sm_scatterv_intra;
 
     opal_output_verbose(10, ompi_coll_base_framework.framework_output,
                         "coll:sm:comm_query (%d/%s): pick me! pick me!",
@@ -226,15 +258,41 @@ mca_coll_sm_comm_query(struct ompi_communicator_t *comm, int *priority)
 static int sm_module_enable(mca_coll_base_module_t *module,
                             struct ompi_communicator_t *comm)
 {
-    if (NULL == comm->c_coll->coll_reduce ||
-        NULL == comm->c_coll->coll_reduce_module) {
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    const char *missing = NULL;
+
+    /* Save the functions of the modules selected before us: this is
+       the only time they are in comm->c_coll */
+#define CHECK_AND_RETAIN(name)                                                  \
+    if (NULL == comm->c_coll->coll_ ## name ||                                  \
+        NULL == comm->c_coll->coll_ ## name ## _module) {                       \
+        missing = #name;                                                        \
+    } else if (NULL == missing) {                                               \
+        sm_module->previous_ ## name = comm->c_coll->coll_ ## name;             \
+        sm_module->previous_ ## name ## _module = comm->c_coll->coll_ ## name ## _module; \
+        OBJ_RETAIN(sm_module->previous_ ## name ## _module);                    \
+    }
+
+    CHECK_AND_RETAIN(reduce);
+    CHECK_AND_RETAIN(allgather);
+    CHECK_AND_RETAIN(allgatherv);
+    CHECK_AND_RETAIN(alltoall);
+    CHECK_AND_RETAIN(alltoallv);
+    CHECK_AND_RETAIN(gather);
+    CHECK_AND_RETAIN(gatherv);
+    CHECK_AND_RETAIN(scatter);
+    CHECK_AND_RETAIN(scatterv);
+#undef CHECK_AND_RETAIN
+
+    if (NULL != missing) {
         opal_output_verbose(10, ompi_coll_base_framework.framework_output,
-                            "coll:sm:enable (%d/%s): no underlying reduce; disqualifying myself",
-                            comm->c_contextid, comm->c_name);
+                            "coll:sm:enable (%d/%s): no underlying %s; disqualifying myself",
+                            comm->c_contextid, comm->c_name, missing);
+        mca_coll_sm_module_release_previous(sm_module);
         return OMPI_ERROR;
     }
 
-    /* We do everything lazily in ompi_coll_sm_enable() */
+    /* We do everything else lazily in ompi_coll_sm_lazy_enable() */
     return OMPI_SUCCESS;
 }
 
@@ -405,14 +463,18 @@ int ompi_coll_sm_lazy_enable(mca_coll_base_module_t *module,
         maffinity[j].mbs_start_addr = base;
         maffinity[j].mbs_len = c->sm_control_size *
             c->sm_comm_num_in_use_flags;
-        /* Set the op counts to 1 (actually any nonzero value will do)
-           so that the first time children/leaf processes come
-           through, they don't see a value of 0 and think that the
+        /* Set the op counts to a value that none of the first
+           operations can have, so that the first time children/leaf
+           processes come through, they don't think that the
            root/parent has already set the count to their op number
-           (i.e., 0 is the first op count value). */
+           (flag i is first used by operation i).  Note that the flags
+           are control_size bytes apart. */
         for (i = 0; i < mca_coll_sm_component.sm_comm_num_in_use_flags; ++i) {
-            ((mca_coll_sm_in_use_flag_t *)base)[i].mcsiuf_operation_count = 1;
-            ((mca_coll_sm_in_use_flag_t *)base)[i].mcsiuf_num_procs_using = 0;
+            mca_coll_sm_in_use_flag_t *flag = (mca_coll_sm_in_use_flag_t *)
+                (base + i * c->sm_control_size);
+            flag->mcsiuf_operation_count = (uint32_t) -1;
+            flag->mcsiuf_num_procs_using = 0;
+            flag->mcsiuf_num_sets = 0;
         }
         ++j;
     }
@@ -459,11 +521,6 @@ int ompi_coll_sm_lazy_enable(mca_coll_base_module_t *module,
                c->sm_control_size);
     }
 
-    /* Save previous component's reduce information */
-    sm_module->previous_reduce = comm->c_coll->coll_reduce;
-    sm_module->previous_reduce_module = comm->c_coll->coll_reduce_module;
-    OBJ_RETAIN(sm_module->previous_reduce_module);
-
     /* Indicate that we have successfully attached and setup */
     opal_atomic_add (&(data->sm_bootstrap_meta->module_seg->seg_inited), 1);
 
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -20,16 +20,20 @@
 
 #include "ompi_config.h"
 
+#include <stdlib.h>
+
 #include "ompi/constants.h"
+#include "ompi/communicator/communicator.h"
 #include "coll_sm.h"
 
-
 /*
  *      scatter
  *
- *      Function:       - shared memory reduce
+ *      Function:       - shared memory scatter
  *      Accepts:        - same as MPI_Scatter()
  *      Returns:        - MPI_SUCCESS or error code
+ *
+ *      A scatterv with the same count for everybody.
  */
 int mca_coll_sm_scatter_intra(const void *sbuf, int scount,
                               struct ompi_datatype_t *sdtype, void *rbuf,
@@ -37,5 +41,27 @@ int mca_coll_sm_scatter_intra(const void *sbuf, int scount,
                               int root, struct ompi_communicator_t *comm,
                               mca_coll_base_module_t *module)
 {
-    return OMPI_ERR_NOT_IMPLEMENTED;
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    int i, ret, size = ompi_comm_size(comm);
+    int *counts = NULL;
+
+    if (size > MCA_COLL_SM_FLAT_MAX_PROCS) {
+        return sm_module->previous_scatter(sbuf, scount, sdtype, rbuf, rcount, rdtype,
+                                           root, comm, sm_module->previous_scatter_module);
+    }
+
+    if (ompi_comm_rank(comm) == root) {
+        counts = (int*) malloc(size * sizeof(int));
+        if (NULL == counts) {
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+        for (i = 0; i < size; ++i) {
+            counts[i] = scount;
+        }
+    }
+
+    ret = mca_coll_sm_scatterv_intra(sbuf, counts, NULL, sdtype, rbuf, rcount, rdtype,
+                                     root, comm, module);
+    free(counts);
+    return ret;
 }
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -20,16 +20,34 @@
 
 #include "ompi_config.h"
 
+#include <string.h>
+
+#include "opal/datatype/opal_convertor.h"
+#include "opal/sys/atomic.h"
 #include "ompi/constants.h"
+#include "ompi/communicator/communicator.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "ompi/mca/coll/coll.h"
+#include "ompi/mca/coll/base/coll_base_util.h"
 #include "coll_sm.h"
 
 
-/*
- *	scatterv_intra
+/**
+ * Shared memory scatterv.
  *
- *	Function:	- scatterv operation
- *	Accepts:	- same arguments as MPI_Scatterv()
- *	Returns:	- MPI_SUCCESS or error code
+ * This is a flat fan out: for each segment, the root copies a
+ * fragment of the data of each process into the data area of that
+ * process in the segment, and writes the size of the fragment in the
+ * control buffer of the process (in the entry of the root).  The
+ * non-root processes wait for their fragment and copy it into their
+ * user's buffer.
+ *
+ * As in the broadcast, the root claims the sets of segments for the
+ * size - 1 non-root processes, which release them once they have
+ * copied their data out.  As the non-root processes cannot know how
+ * many sets of segments the operation takes (it depends on the
+ * largest contribution), the root writes it in the first in-use flag
+ * of the operation.
  */
 int mca_coll_sm_scatterv_intra(const void *sbuf, const int *scounts,
                                const int *disps, struct ompi_datatype_t *sdtype,
@@ -38,5 +56,206 @@ int mca_coll_sm_scatterv_intra(const void *sbuf, const int *scounts,
                                struct ompi_communicator_t *comm,
                                mca_coll_base_module_t *module)
 {
-    return OMPI_ERR_NOT_IMPLEMENTED;
+    struct iovec iov;
+    mca_coll_sm_module_t *sm_module = (mca_coll_sm_module_t*) module;
+    mca_coll_sm_comm_t *data;
+    int ret = OMPI_SUCCESS, rank, size, peer, set, num_sets;
+    int flag_num, segment_num, max_segment_num;
+    size_t max_data, max_bytes, left, *peer_left = NULL;
+    mca_coll_sm_in_use_flag_t *flag;
+    mca_coll_sm_data_index_t *index;
+    opal_convertor_t convertor, *peer_convertors = NULL;
+    ptrdiff_t lb, extent;
+
+    size = ompi_comm_size(comm);
+    if (size > MCA_COLL_SM_FLAT_MAX_PROCS) {
+        return sm_module->previous_scatterv(sbuf, scounts, disps, sdtype, rbuf, rcount,
+                                            rdtype, root, comm,
+                                            sm_module->previous_scatterv_module);
+    }
+
+    /* Lazily enable the module the first time we invoke a collective
+       on it */
+    if (!sm_module->enabled) {
+        if (OMPI_SUCCESS != (ret = ompi_coll_sm_lazy_enable(module, comm))) {
+            return ret;
+        }
+    }
+    data = sm_module->sm_comm_data;
+    rank = ompi_comm_rank(comm);
+
+    /*********************************************************************
+     * Root
+     *********************************************************************/
+
+    if (root == rank) {
+        ompi_datatype_get_extent(sdtype, &lb, &extent);
+
+        /* The root needs a send convertor for each of its peers */
+        peer_convertors = (opal_convertor_t*) malloc(size * sizeof(opal_convertor_t));
+        peer_left = (size_t*) malloc(size * sizeof(size_t));
+        if (NULL == peer_convertors || NULL == peer_left) {
+            free(peer_convertors);
+            free(peer_left);
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+        for (peer = 0; peer < size; ++peer) {
+            OBJ_CONSTRUCT(&peer_convertors[peer], opal_convertor_t);
+            peer_left[peer] = 0;
+        }
+        max_bytes = 0;
+        for (peer = 0; peer < size; ++peer) {
+            if (peer == rank || 0 == scounts[peer]) {
+                continue;
+            }
+            if (OMPI_SUCCESS !=
+                (ret = opal_convertor_copy_and_prepare_for_send(ompi_mpi_local_convertor,
+                                                                &(sdtype->super),
+                                                                scounts[peer],
+                                                                (char *) sbuf + MCA_COLL_SM_DISP(disps, scounts, peer) * extent,
+                                                                0,
+                                                                &peer_convertors[peer]))) {
+                goto root_cleanup;
+            }
+            opal_convertor_get_packed_size(&peer_convertors[peer], &peer_left[peer]);
+            if (peer_left[peer] > max_bytes) {
+                max_bytes = peer_left[peer];
+            }
+        }
+
+        /* My own part does not go through shared memory */
+        if (MPI_IN_PLACE != rbuf) {
+            ret = ompi_datatype_sndrcv((char *) sbuf + MCA_COLL_SM_DISP(disps, scounts, rank) * extent,
+                                       scounts[rank], sdtype, rbuf, rcount, rdtype);
+            if (OMPI_SUCCESS != ret) {
+                goto root_cleanup;
+            }
+        }
+
+        /* Even if there is nothing to send, the non-root processes
+           are waiting for at least one set of segments */
+        num_sets = MCA_COLL_SM_NUM_SETS(max_bytes, mca_coll_sm_component.sm_fragment_size);
+        if (0 == num_sets) {
+            num_sets = 1;
+        }
+
+        /* Main loop over sending fragments */
+
+        for (set = 0; set < num_sets; ++set) {
+            flag_num = (data->mcb_operation_count %
+                        mca_coll_sm_component.sm_comm_num_in_use_flags);
+            FLAG_SETUP(flag_num, flag, data);
+            FLAG_WAIT_FOR_IDLE(flag, scatterv_root_flag_label);
+            if (0 == set) {
+                flag->mcsiuf_num_sets = num_sets;
+                opal_atomic_wmb();
+            }
+            FLAG_RETAIN(flag, size - 1, data->mcb_operation_count);
+            ++data->mcb_operation_count;
+
+            /* Loop over all the segments in this set */
+
+            segment_num =
+                flag_num * mca_coll_sm_component.sm_segs_per_inuse_flag;
+            max_segment_num =
+                (flag_num + 1) * mca_coll_sm_component.sm_segs_per_inuse_flag;
+            for (; segment_num < max_segment_num; ++segment_num) {
+                index = &(data->mcb_data_index[segment_num]);
+
+                for (peer = 0; peer < size; ++peer) {
+                    if (0 == peer_left[peer]) {
+                        continue;
+                    }
+
+                    /* Copy the fragment from the user buffer to the
+                       peer's fragment in the current segment */
+                    max_data = mca_coll_sm_component.sm_fragment_size;
+                    COPY_FRAGMENT_IN(peer_convertors[peer], index, peer, iov, max_data);
+                    peer_left[peer] -= max_data;
+
+                    /* Wait for the write to absolutely complete */
+                    opal_atomic_wmb();
+
+                    /* Tell the peer that this fragment is ready */
+                    CHILD_NOTIFY_PARENT(rank, peer, index, max_data);
+                }
+            }
+        }
+
+    root_cleanup:
+        for (peer = 0; peer < size; ++peer) {
+            OBJ_DESTRUCT(&peer_convertors[peer]);
+        }
+        free(peer_convertors);
+        free(peer_left);
+    }
+
+    /*********************************************************************
+     * Non-root
+     *********************************************************************/
+
+    else {
+        OBJ_CONSTRUCT(&convertor, opal_convertor_t);
+        if (OMPI_SUCCESS !=
+            (ret =
+             opal_convertor_copy_and_prepare_for_recv(ompi_mpi_local_convertor,
+                                                      &(rdtype->super),
+                                                      rcount,
+                                                      rbuf,
+                                                      0,
+                                                      &convertor))) {
+            OBJ_DESTRUCT(&convertor);
+            return ret;
+        }
+        opal_convertor_get_packed_size(&convertor, &left);
+
+        /* Loop over receiving fragments from the root; the number of
+           sets is known once the root has claimed the first one */
+
+        num_sets = 1;
+        for (set = 0; set < num_sets; ++set) {
+            flag_num = (data->mcb_operation_count %
+                        mca_coll_sm_component.sm_comm_num_in_use_flags);
+
+            /* Wait for the root to mark this set of segments as
+               ours */
+            FLAG_SETUP(flag_num, flag, data);
+            FLAG_WAIT_FOR_OP(flag, data->mcb_operation_count, scatterv_nonroot_flag_label);
+            ++data->mcb_operation_count;
+            if (0 == set) {
+                opal_atomic_rmb();
+                num_sets = (int) flag->mcsiuf_num_sets;
+            }
+
+            /* Loop over all the segments in this set */
+
+            segment_num =
+                flag_num * mca_coll_sm_component.sm_segs_per_inuse_flag;
+            max_segment_num =
+                (flag_num + 1) * mca_coll_sm_component.sm_segs_per_inuse_flag;
+            for (; left > 0 && segment_num < max_segment_num; ++segment_num) {
+                index = &(data->mcb_data_index[segment_num]);
+
+                /* Wait for the root to tell me that my fragment is
+                   ready, and copy it to my output buffer */
+                PARENT_WAIT_FOR_NOTIFY_SPECIFIC(root, rank, index, max_data,
+                                                scatterv_nonroot_label);
+                COPY_FRAGMENT_OUT(convertor, rank, index, iov, max_data);
+                left -= max_data;
+            }
+
+            /* Wait for all copy-out writes to complete before I say
+               I'm done with the segments */
+            opal_atomic_wmb();
+
+            /* We're finished with this set of segments */
+            FLAG_RELEASE(flag);
+        }
+
+        OBJ_DESTRUCT(&convertor);
+    }
+
+    /* All done */
+
+    return ret;
 }
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2015 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -584,8 +584,15 @@ int ompi_coll_tuned_gather_intra_dec_dynamic(const void *sbuf, int scount,
         int comsize, alg, faninout, segsize, max_requests;
         size_t dsize;
 
+        /* only the root's receive and the others' send arguments are significant */
         comsize = ompi_comm_size(comm);
-        ompi_datatype_type_size (sdtype, &dsize);
+        if (ompi_comm_rank(comm) == root) {
+            ompi_datatype_type_size (rdtype, &dsize);
+            dsize *= (ptrdiff_t)rcount;
+        } else {
+            ompi_datatype_type_size (sdtype, &dsize);
+            dsize *= (ptrdiff_t)scount;
+        }
         dsize *= comsize;
 
         alg = ompi_coll_tuned_get_target_method_params (tuned_module->com_rules[GATHER],
@@ -633,8 +640,15 @@ int ompi_coll_tuned_scatter_intra_dec_dynamic(const void *sbuf, int scount,
         int comsize, alg, faninout, segsize, max_requests;
         size_t dsize;
 
+        /* only the root's send and the others' receive arguments are significant */
         comsize = ompi_comm_size(comm);
-        ompi_datatype_type_size (sdtype, &dsize);
+        if (ompi_comm_rank(comm) == root) {
+            ompi_datatype_type_size (sdtype, &dsize);
+            dsize *= (ptrdiff_t)scount;
+        } else {
+            ompi_datatype_type_size (rdtype, &dsize);
+            dsize *= (ptrdiff_t)rcount;
+        }
         dsize *= comsize;
 
         alg = ompi_coll_tuned_get_target_method_params (tuned_module->com_rules[SCATTER],
@@ -678,12 +692,11 @@ int ompi_coll_tuned_exscan_intra_dec_dynamic(const void *sbuf, void* rbuf, int c
      * check to see if we have some filebased rules.
      */
     if (tuned_module->com_rules[EXSCAN]) {
-        int comsize, alg, faninout, segsize, max_requests;
+        int alg, faninout, segsize, max_requests;
         size_t dsize;
 
-        comsize = ompi_comm_size(comm);
         ompi_datatype_type_size (dtype, &dsize);
-        dsize *= comsize;
+        dsize *= (ptrdiff_t)count;
 
         alg = ompi_coll_tuned_get_target_method_params (tuned_module->com_rules[EXSCAN],
                                                         dsize, &faninout, &segsize, &max_requests);
@@ -721,12 +734,11 @@ int ompi_coll_tuned_scan_intra_dec_dynamic(const void *sbuf, void* rbuf, int cou
      * check to see if we have some filebased rules.
      */
     if (tuned_module->com_rules[SCAN]) {
-        int comsize, alg, faninout, segsize, max_requests;
+        int alg, faninout, segsize, max_requests;
         size_t dsize;
 
-        comsize = ompi_comm_size(comm);
         ompi_datatype_type_size (dtype, &dsize);
-        dsize *= comsize;
+        dsize *= (ptrdiff_t)count;
 
         alg = ompi_coll_tuned_get_target_method_params (tuned_module->com_rules[SCAN],
                                                         dsize, &faninout, &segsize, &max_requests);
@@ -140,6 +140,10 @@ typedef int (*mca_common_ompio_get_mca_parameter_value_fn_t) ( char *mca_paramet
 
 
 struct mca_common_ompio_print_queue;
+struct mca_common_ompio_node_aggr_t;
+typedef struct mca_common_ompio_node_aggr_t mca_common_ompio_node_aggr_t;
+struct mca_common_ompio_cache_t;
+typedef struct mca_common_ompio_cache_t mca_common_ompio_cache_t;
 
 /**
  * Back-end structure for MPI_File
@@ -175,6 +179,8 @@ struct ompio_file_t {
        Note: Neither f_sharedfp nor f_sharedfp_component seemed appropriate for this.
     */
     void                  *f_sharedfp_data;
+    /* Place for the selected fbtl module to hang its per-file data */
+    void                  *f_fbtl_data;
 
 
     /* File View parameters */
@@ -223,6 +229,12 @@ struct ompio_file_t {
     int *f_procs_in_group;
     int  f_procs_per_group;
 
+    /* node-local pre-aggregation of collective writes */
+    mca_common_ompio_node_aggr_t *f_node_aggr;
+
+    /* read-ahead/write-behind cache of independent operations */
+    mca_common_ompio_cache_t *f_cache;
+
     /* internal ompio functions required by fbtl and fcoll */
     mca_common_ompio_generate_current_file_view_fn_t f_generate_current_file_view;
 
@@ -107,5 +107,15 @@ int mca_common_ompio_merge_initial_groups(ompio_file_t *fh,
 int mca_common_ompio_merge_groups(ompio_file_t *fh, int *merge_aggrs,
                                   int num_merge_aggrs);
 
+/*Node-local pre-aggregation of collective writes*/
+OMPI_DECLSPEC int mca_common_ompio_node_aggr_gather (ompio_file_t *fh,
+                                                     struct iovec **decoded_iov, uint32_t *iov_count,
+                                                     struct iovec **file_iov, int *file_count,
+                                                     size_t *max_data);
+
+OMPI_DECLSPEC int mca_common_ompio_node_aggr_release (ompio_file_t *fh);
+
+int mca_common_ompio_node_aggr_finalize (ompio_file_t *fh);
+
 
 #endif /* MCA_COMMON_AGGREGATORS_H */
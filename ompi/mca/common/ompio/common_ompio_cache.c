@@ -0,0 +1,527 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "opal/class/opal_hash_table.h"
+#include "ompi/mca/fbtl/fbtl.h"
+
+#include "common_ompio.h"
+#include "common_ompio_cache.h"
+
+#define OMPIO_CACHE_DEFAULT_PAGE_SIZE 65536
+
+#define OMPIO_CACHE_PAGE_IS_DIRTY(_p) ((_p)->dirty_end > (_p)->dirty_start)
+
+typedef struct {
+    uint64_t  page;          /* page number within the file */
+    char     *buf;
+    bool      in_use;
+    bool      filled;        /* buf[0,valid) holds the content of the file */
+    size_t    valid;
+    size_t    dirty_start;   /* buf[dirty_start,dirty_end) still has to be written */
+    size_t    dirty_end;
+    uint64_t  stamp;         /* last access, for the LRU replacement */
+} mca_common_ompio_cache_page_t;
+
+struct mca_common_ompio_cache_t {
+    size_t                          page_size;
+    int                             num_pages;
+    int                             readahead;
+    char                           *bufs;
+    mca_common_ompio_cache_page_t  *pages;
+    mca_common_ompio_cache_page_t **batch;        /* scratch space for fills and flushes */
+    mca_common_ompio_io_array_t    *batch_array;
+    opal_hash_table_t               lookup;       /* page number -> cache page */
+    uint64_t                        clock;
+    OMPI_MPI_OFFSET_TYPE            next_offset;  /* end of the last access */
+};
+
+static ssize_t cache_fbtl_io (ompio_file_t *fh, mca_common_ompio_io_array_t *array,
+                              int num_entries, bool is_write)
+{
+    mca_common_ompio_io_array_t *io_array = fh->f_io_array;
+    int num_of_io_entries = fh->f_num_of_io_entries;
+    ssize_t ret;
+
+    fh->f_io_array = array;
+    fh->f_num_of_io_entries = num_entries;
+    ret = is_write ? fh->f_fbtl->fbtl_pwritev (fh) : fh->f_fbtl->fbtl_preadv (fh);
+    fh->f_io_array = io_array;
+    fh->f_num_of_io_entries = num_of_io_entries;
+
+    return ret;
+}
+
+static int cache_page_cmp (const void *a, const void *b)
+{
+    const mca_common_ompio_cache_page_t *pa = *(mca_common_ompio_cache_page_t * const *) a;
+    const mca_common_ompio_cache_page_t *pb = *(mca_common_ompio_cache_page_t * const *) b;
+
+    if ( pa->page < pb->page ) {
+        return -1;
+    }
+    return ( pa->page > pb->page ) ? 1 : 0;
+}
+
+static mca_common_ompio_cache_page_t *cache_lookup (mca_common_ompio_cache_t *cache, uint64_t page)
+{
+    void *value;
+
+    if ( OPAL_SUCCESS != opal_hash_table_get_value_uint64 (&cache->lookup, page, &value) ) {
+        return NULL;
+    }
+    return (mca_common_ompio_cache_page_t *) value;
+}
+
+static void cache_page_drop (mca_common_ompio_cache_t *cache, mca_common_ompio_cache_page_t *p)
+{
+    opal_hash_table_remove_value_uint64 (&cache->lookup, p->page);
+    p->in_use = false;
+}
+
+static int cache_page_flush (ompio_file_t *fh, mca_common_ompio_cache_t *cache,
+                             mca_common_ompio_cache_page_t *p)
+{
+    mca_common_ompio_io_array_t entry;
+
+    if ( !OMPIO_CACHE_PAGE_IS_DIRTY(p) ) {
+        return OMPI_SUCCESS;
+    }
+    entry.memory_address = p->buf + p->dirty_start;
+    entry.offset = (IOVBASE_TYPE *)(intptr_t)(p->page * cache->page_size + p->dirty_start);
+    entry.length = p->dirty_end - p->dirty_start;
+    if ( 0 > cache_fbtl_io (fh, &entry, 1, true) ) {
+        return OMPI_ERROR;
+    }
+    p->dirty_start = p->dirty_end = 0;
+
+    return OMPI_SUCCESS;
+}
+
+static int cache_flush_all (ompio_file_t *fh, mca_common_ompio_cache_t *cache)
+{
+    int i, num_dirty = 0;
+
+    for ( i=0; i<cache->num_pages; i++ ) {
+        if ( cache->pages[i].in_use && OMPIO_CACHE_PAGE_IS_DIRTY(&cache->pages[i]) ) {
+            cache->batch[num_dirty++] = &cache->pages[i];
+        }
+    }
+    if ( 0 == num_dirty ) {
+        return OMPI_SUCCESS;
+    }
+
+    /* write all dirty ranges in offset order with a single fbtl call, which
+       merges the ranges that turn out to be contiguous in the file */
+    qsort (cache->batch, num_dirty, sizeof(mca_common_ompio_cache_page_t *), cache_page_cmp);
+    for ( i=0; i<num_dirty; i++ ) {
+        mca_common_ompio_cache_page_t *p = cache->batch[i];
+
+        cache->batch_array[i].memory_address = p->buf + p->dirty_start;
+        cache->batch_array[i].offset = (IOVBASE_TYPE *)(intptr_t)(p->page * cache->page_size + p->dirty_start);
+        cache->batch_array[i].length = p->dirty_end - p->dirty_start;
+    }
+    if ( 0 > cache_fbtl_io (fh, cache->batch_array, num_dirty, true) ) {
+        return OMPI_ERROR;
+    }
+    for ( i=0; i<num_dirty; i++ ) {
+        cache->batch[i]->dirty_start = cache->batch[i]->dirty_end = 0;
+    }
+
+    return OMPI_SUCCESS;
+}
+
+/* Take an unused page, or write back and evict the least recently used one */
+static int cache_page_alloc (ompio_file_t *fh, mca_common_ompio_cache_t *cache, uint64_t page,
+                             mca_common_ompio_cache_page_t **page_out)
+{
+    mca_common_ompio_cache_page_t *p = NULL;
+    int i, ret;
+
+    for ( i=0; i<cache->num_pages; i++ ) {
+        if ( !cache->pages[i].in_use ) {
+            p = &cache->pages[i];
+            break;
+        }
+        if ( NULL == p || cache->pages[i].stamp < p->stamp ) {
+            p = &cache->pages[i];
+        }
+    }
+
+    if ( p->in_use ) {
+        ret = cache_page_flush (fh, cache, p);
+        if ( OMPI_SUCCESS != ret ) {
+            return ret;
+        }
+        cache_page_drop (cache, p);
+    }
+
+    p->page        = page;
+    p->in_use      = true;
+    p->filled      = false;
+    p->valid       = 0;
+    p->dirty_start = p->dirty_end = 0;
+    p->stamp       = ++cache->clock;
+    opal_hash_table_set_value_uint64 (&cache->lookup, page, p);
+
+    *page_out = p;
+    return OMPI_SUCCESS;
+}
+
+/* Read the content of page p, and of up to readahead following pages that
+   are not cached yet, with a single fbtl call */
+static int cache_page_fill (ompio_file_t *fh, mca_common_ompio_cache_t *cache,
+                            mca_common_ompio_cache_page_t *p, int readahead)
+{
+    ssize_t ret_code;
+    size_t start;
+    int i, num = 1, ret;
+
+    /* an unfilled page only knows the bytes written to it */
+    ret = cache_page_flush (fh, cache, p);
+    if ( OMPI_SUCCESS != ret ) {
+        return ret;
+    }
+
+    /* make sure that p is not the victim of the allocations below */
+    p->stamp = ++cache->clock;
+    cache->batch[0] = p;
+    for ( i=1; i<=readahead; i++ ) {
+        if ( NULL != cache_lookup (cache, p->page + i) ) {
+            break;
+        }
+        ret = cache_page_alloc (fh, cache, p->page + i, &cache->batch[num]);
+        if ( OMPI_SUCCESS != ret ) {
+            break;
+        }
+        num++;
+    }
+
+    for ( i=0; i<num; i++ ) {
+        cache->batch_array[i].memory_address = cache->batch[i]->buf;
+        cache->batch_array[i].offset = (IOVBASE_TYPE *)(intptr_t)(cache->batch[i]->page * cache->page_size);
+        cache->batch_array[i].length = cache->page_size;
+    }
+    ret_code = cache_fbtl_io (fh, cache->batch_array, num, false);
+    if ( 0 > ret_code ) {
+        for ( i=1; i<num; i++ ) {
+            cache_page_drop (cache, cache->batch[i]);
+        }
+        return OMPI_ERROR;
+    }
+
+    /* a short read means that the end of the file was reached */
+    for ( i=0; i<num; i++ ) {
+        mca_common_ompio_cache_page_t *q = cache->batch[i];
+
+        start = i * cache->page_size;
+        q->valid = ( (size_t) ret_code > start ) ? OMPIO_MIN((size_t) ret_code - start, cache->page_size) : 0;
+        memset (q->buf + q->valid, 0, cache->page_size - q->valid);
+        q->filled = true;
+    }
+
+    return OMPI_SUCCESS;
+}
+
+/* Write back the cached pages overlapping [offset,offset+len), and optionally drop them */
+static int cache_range_release (ompio_file_t *fh, mca_common_ompio_cache_t *cache,
+                                OMPI_MPI_OFFSET_TYPE offset, size_t len, bool drop)
+{
+    uint64_t first = offset / cache->page_size;
+    uint64_t last  = (offset + len - 1) / cache->page_size;
+    int i, ret;
+
+    for ( i=0; i<cache->num_pages; i++ ) {
+        mca_common_ompio_cache_page_t *p = &cache->pages[i];
+
+        if ( !p->in_use || p->page < first || p->page > last ) {
+            continue;
+        }
+        ret = cache_page_flush (fh, cache, p);
+        if ( OMPI_SUCCESS != ret ) {
+            return ret;
+        }
+        if ( drop ) {
+            cache_page_drop (cache, p);
+        }
+    }
+
+    return OMPI_SUCCESS;
+}
+
+static ssize_t cache_read (ompio_file_t *fh, mca_common_ompio_cache_t *cache,
+                           OMPI_MPI_OFFSET_TYPE offset, size_t len, char *mem)
+{
+    mca_common_ompio_cache_page_t *p;
+    mca_common_ompio_io_array_t entry;
+    size_t done = 0, in_page, chunk, avail;
+    bool sequential;
+    int ret;
+
+    /* forward accesses with small gaps, e.g. strided reads, count as sequential */
+    sequential = (offset >= cache->next_offset) &&
+                 ((size_t)(offset - cache->next_offset) <= cache->page_size);
+    cache->next_offset = offset + len;
+
+    if ( len >= cache->page_size ) {
+        ret = cache_range_release (fh, cache, offset, len, false);
+        if ( OMPI_SUCCESS != ret ) {
+            return ret;
+        }
+        entry.memory_address = mem;
+        entry.offset = (IOVBASE_TYPE *)(intptr_t) offset;
+        entry.length = len;
+        return cache_fbtl_io (fh, &entry, 1, false);
+    }
+
+    while ( done < len ) {
+        uint64_t page = (offset + done) / cache->page_size;
+
+        in_page = (offset + done) % cache->page_size;
+        chunk   = OMPIO_MIN(len - done, cache->page_size - in_page);
+
+        p = cache_lookup (cache, page);
+        if ( NULL == p ) {
+            ret = cache_page_alloc (fh, cache, page, &p);
+            if ( OMPI_SUCCESS != ret ) {
+                return ret;
+            }
+        }
+        if ( !p->filled ) {
+            ret = cache_page_fill (fh, cache, p, sequential ? cache->readahead : 0);
+            if ( OMPI_SUCCESS != ret ) {
+                return ret;
+            }
+        }
+        p->stamp = ++cache->clock;
+
+        if ( in_page >= p->valid ) {
+            break;
+        }
+        avail = OMPIO_MIN(chunk, p->valid - in_page);
+        memcpy (mem + done, p->buf + in_page, avail);
+        done += avail;
+        if ( avail < chunk ) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+static ssize_t cache_write (ompio_file_t *fh, mca_common_ompio_cache_t *cache,
+                            OMPI_MPI_OFFSET_TYPE offset, size_t len, char *mem)
+{
+    mca_common_ompio_cache_page_t *p;
+    mca_common_ompio_io_array_t entry;
+    size_t done = 0, in_page, chunk;
+    int ret;
+
+    cache->next_offset = offset + len;
+
+    if ( len >= cache->page_size ) {
+        ret = cache_range_release (fh, cache, offset, len, true);
+        if ( OMPI_SUCCESS != ret ) {
+            return ret;
+        }
+        entry.memory_address = mem;
+        entry.offset = (IOVBASE_TYPE *)(intptr_t) offset;
+        entry.length = len;
+        return cache_fbtl_io (fh, &entry, 1, true);
+    }
+
+    while ( done < len ) {
+        uint64_t page = (offset + done) / cache->page_size;
+
+        in_page = (offset + done) % cache->page_size;
+        chunk   = OMPIO_MIN(len - done, cache->page_size - in_page);
+
+        p = cache_lookup (cache, page);
+        if ( NULL == p ) {
+            ret = cache_page_alloc (fh, cache, page, &p);
+            if ( OMPI_SUCCESS != ret ) {
+                return ret;
+            }
+        }
+
+        /* A page tracks a single dirty range. A write that is not adjacent to
+        ** it first writes the current range back, so that the bytes in between,
+        ** which might belong to another process, are never written.
+        */
+        if ( OMPIO_CACHE_PAGE_IS_DIRTY(p) &&
+             (in_page > p->dirty_end || in_page + chunk < p->dirty_start) ) {
+            ret = cache_page_flush (fh, cache, p);
+            if ( OMPI_SUCCESS != ret ) {
+                return ret;
+            }
+        }
+        memcpy (p->buf + in_page, mem + done, chunk);
+        if ( OMPIO_CACHE_PAGE_IS_DIRTY(p) ) {
+            p->dirty_start = OMPIO_MIN(p->dirty_start, in_page);
+            p->dirty_end   = OMPIO_MAX(p->dirty_end, in_page + chunk);
+        }
+        else {
+            p->dirty_start = in_page;
+            p->dirty_end   = in_page + chunk;
+        }
+        if ( p->filled && p->valid < p->dirty_end ) {
+            p->valid = p->dirty_end;
+        }
+        p->stamp = ++cache->clock;
+        done += chunk;
+    }
+
+    return done;
+}
+
+ssize_t mca_common_ompio_cache_preadv (ompio_file_t *fh)
+{
+    mca_common_ompio_cache_t *cache = fh->f_cache;
+    ssize_t ret, total = 0;
+    int i;
+
+    if ( NULL == cache || fh->f_atomicity ) {
+        return fh->f_fbtl->fbtl_preadv (fh);
+    }
+
+    for ( i=0; i<fh->f_num_of_io_entries; i++ ) {
+        ret = cache_read (fh, cache, (OMPI_MPI_OFFSET_TYPE)(intptr_t) fh->f_io_array[i].offset,
+                          fh->f_io_array[i].length, (char *) fh->f_io_array[i].memory_address);
+        if ( 0 > ret ) {
+            return ret;
+        }
+        total += ret;
+        if ( (size_t) ret < fh->f_io_array[i].length ) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+ssize_t mca_common_ompio_cache_pwritev (ompio_file_t *fh)
+{
+    mca_common_ompio_cache_t *cache = fh->f_cache;
+    ssize_t ret, total = 0;
+    int i;
+
+    if ( NULL == cache || fh->f_atomicity ) {
+        return fh->f_fbtl->fbtl_pwritev (fh);
+    }
+
+    for ( i=0; i<fh->f_num_of_io_entries; i++ ) {
+        ret = cache_write (fh, cache, (OMPI_MPI_OFFSET_TYPE)(intptr_t) fh->f_io_array[i].offset,
+                           fh->f_io_array[i].length, (char *) fh->f_io_array[i].memory_address);
+        if ( 0 > ret ) {
+            return ret;
+        }
+        total += ret;
+    }
+
+    return total;
+}
+
+int mca_common_ompio_cache_sync (ompio_file_t *fh)
+{
+    mca_common_ompio_cache_t *cache = fh->f_cache;
+    int i, ret;
+
+    if ( NULL == cache ) {
+        return OMPI_SUCCESS;
+    }
+
+    ret = cache_flush_all (fh, cache);
+    for ( i=0; i<cache->num_pages; i++ ) {
+        cache->pages[i].in_use = false;
+    }
+    opal_hash_table_remove_all (&cache->lookup);
+
+    return ret;
+}
+
+int mca_common_ompio_cache_init (ompio_file_t *fh)
+{
+    mca_common_ompio_cache_t *cache;
+    int cache_size, page_size, num_pages, i;
+
+    cache_size = OMPIO_MCA_GET(fh, cache_size);
+    page_size  = OMPIO_MCA_GET(fh, cache_page_size);
+    if ( 0 >= page_size ) {
+        page_size = OMPIO_CACHE_DEFAULT_PAGE_SIZE;
+    }
+    num_pages = cache_size / page_size;
+    if ( 0 >= num_pages ) {
+        return OMPI_SUCCESS;
+    }
+
+    cache = (mca_common_ompio_cache_t *) calloc (1, sizeof(mca_common_ompio_cache_t));
+    if ( NULL == cache ) {
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    cache->page_size   = page_size;
+    cache->num_pages   = num_pages;
+    cache->bufs        = (char *) malloc ((size_t) num_pages * page_size);
+    cache->pages       = (mca_common_ompio_cache_page_t *) calloc (num_pages, sizeof(mca_common_ompio_cache_page_t));
+    cache->batch       = (mca_common_ompio_cache_page_t **) malloc (num_pages * sizeof(mca_common_ompio_cache_page_t *));
+    cache->batch_array = (mca_common_ompio_io_array_t *) malloc (num_pages * sizeof(mca_common_ompio_io_array_t));
+    if ( NULL == cache->bufs || NULL == cache->pages || NULL == cache->batch || NULL == cache->batch_array ) {
+        free (cache->bufs);
+        free (cache->pages);
+        free (cache->batch);
+        free (cache->batch_array);
+        free (cache);
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    for ( i=0; i<num_pages; i++ ) {
+        cache->pages[i].buf = cache->bufs + (size_t) i * page_size;
+    }
+
+    /* a fill must not evict the pages it reads */
+    cache->readahead = OMPIO_MCA_GET(fh, cache_readahead);
+    if ( 0 > cache->readahead ) {
+        cache->readahead = 0;
+    }
+    if ( cache->readahead > num_pages - 1 ) {
+        cache->readahead = num_pages - 1;
+    }
+
+    OBJ_CONSTRUCT(&cache->lookup, opal_hash_table_t);
+    opal_hash_table_init (&cache->lookup, num_pages);
+
+    fh->f_cache = cache;
+    return OMPI_SUCCESS;
+}
+
+int mca_common_ompio_cache_fini (ompio_file_t *fh)
+{
+    mca_common_ompio_cache_t *cache = fh->f_cache;
+    int ret;
+
+    if ( NULL == cache ) {
+        return OMPI_SUCCESS;
+    }
+
+    ret = cache_flush_all (fh, cache);
+    OBJ_DESTRUCT(&cache->lookup);
+    free (cache->bufs);
+    free (cache->pages);
+    free (cache->batch);
+    free (cache->batch_array);
+    free (cache);
+    fh->f_cache = NULL;
+
+    return ret;
+}
@@ -0,0 +1,38 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef MCA_COMMON_OMPIO_CACHE_H
+#define MCA_COMMON_OMPIO_CACHE_H
+
+#include "common_ompio.h"
+
+/*
+** Per-file, per-process page cache for independent I/O. The cache sits
+** between the individual read/write routines and the fbtl: it takes the
+** fh->f_io_array built for an fbtl_preadv/pwritev call, serves small
+** requests from (or stores them into) cached pages and forwards large
+** ones to the fbtl. Dirty pages are written back on eviction and at every
+** consistency point (sync, close, set_size, atomicity changes, collective
+** and nonblocking operations).
+*/
+
+OMPI_DECLSPEC int mca_common_ompio_cache_init (ompio_file_t *fh);
+OMPI_DECLSPEC int mca_common_ompio_cache_fini (ompio_file_t *fh);
+
+/* Write back all dirty pages and drop the cached content */
+OMPI_DECLSPEC int mca_common_ompio_cache_sync (ompio_file_t *fh);
+
+/* Drop-in replacements for fh->f_fbtl->fbtl_preadv/pwritev */
+OMPI_DECLSPEC ssize_t mca_common_ompio_cache_preadv (ompio_file_t *fh);
+OMPI_DECLSPEC ssize_t mca_common_ompio_cache_pwritev (ompio_file_t *fh);
+
+#endif
@@ -40,6 +40,7 @@
 #include <unistd.h>
 #include <math.h>
 #include "common_ompio.h"
+#include "common_ompio_cache.h"
 #include "ompi/mca/topo/topo.h"
 
 static mca_common_ompio_generate_current_file_view_fn_t generate_current_file_view_fn;
@@ -126,6 +127,7 @@ int mca_common_ompio_file_open (ompi_communicator_t *comm,
         opal_output(1, "mca_fs_base_file_select() failed\n");
         goto fn_fail;
     }
+    ompio_fh->f_fbtl_data = NULL;
     if (OMPI_SUCCESS != (ret = mca_fbtl_base_file_select (ompio_fh,
                                                           NULL))) {
         opal_output(1, "mca_fbtl_base_file_select() failed\n");
@@ -165,6 +167,15 @@ int mca_common_ompio_file_open (ompi_communicator_t *comm,
         goto fn_fail;
     }
 
+    /* internal file handles, e.g. those of the sharedfp components,
+       are accessed by other processes as well and are never cached */
+    if ( true == use_sharedfp && 0 < OMPIO_MCA_GET(ompio_fh, cache_size) ) {
+        ret = mca_common_ompio_cache_init (ompio_fh);
+        if ( OMPI_SUCCESS != ret ) {
+            goto fn_fail;
+        }
+    }
+
     if ( true == use_sharedfp ) {
 	/* open the file once more for the shared file pointer if required.           
         ** Can be disabled by the user if no shared file pointer operations
@@ -235,6 +246,13 @@ int mca_common_ompio_file_close (ompio_file_t *ompio_fh)
     int delete_flag = 0;
     char name[256];
 
+    /* write back the cached data before the other processes are
+       allowed to leave the close */
+    ret = mca_common_ompio_cache_fini (ompio_fh);
+    if ( OMPI_SUCCESS != ret ) {
+        opal_output (1,"mca_common_ompio_file_close: error flushing the cache \n");
+    }
+
     ret = ompio_fh->f_comm->c_coll->coll_barrier ( ompio_fh->f_comm, ompio_fh->f_comm->c_coll->coll_barrier_module);
     if ( OMPI_SUCCESS != ret ) {
         /* Not sure what to do */
@@ -306,6 +324,7 @@ int mca_common_ompio_file_close (ompio_file_t *ompio_fh)
         free (ompio_fh->f_init_aggr_list);
         ompio_fh->f_init_aggr_list = NULL;
     }
+    mca_common_ompio_node_aggr_finalize (ompio_fh);
     if (NULL != ompio_fh->f_aggr_list) {
         free (ompio_fh->f_aggr_list);
         ompio_fh->f_aggr_list = NULL;
@@ -453,6 +472,8 @@ int mca_common_ompio_set_file_defaults (ompio_file_t *fh)
        
        fh->f_num_aggrs = -1;
        fh->f_aggr_list = NULL;
+       fh->f_node_aggr = NULL;
+       fh->f_cache = NULL;
        
        /* Default file View */
        fh->f_iov_type = MPI_DATATYPE_NULL;
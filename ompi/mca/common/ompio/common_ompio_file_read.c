@@ -34,6 +34,7 @@
 #include "common_ompio.h"
 #include "common_ompio_request.h"
 #include "common_ompio_buffer.h"
+#include "common_ompio_cache.h"
 #include <unistd.h>
 #include <math.h>
 
@@ -168,7 +169,7 @@ int mca_common_ompio_file_read (ompio_file_t *fh,
                                           &fh->f_num_of_io_entries);
 
         if (fh->f_num_of_io_entries) {
-            ret_code = fh->f_fbtl->fbtl_preadv (fh);
+            ret_code = mca_common_ompio_cache_preadv (fh);
             if ( 0<= ret_code ) {
                 real_bytes_read+=(size_t)ret_code;
             }
@@ -245,6 +246,12 @@ int mca_common_ompio_file_iread (ompio_file_t *fh,
       return ret;
     }
 
+    /* the fbtl reads directly into the user buffer, bypassing the cache */
+    ret = mca_common_ompio_cache_sync (fh);
+    if ( OMPI_SUCCESS != ret ) {
+        return ret;
+    }
+
     mca_common_ompio_request_alloc ( &ompio_req, MCA_OMPIO_REQUEST_READ);
 
     if ( 0 == count ) {
@@ -411,6 +418,10 @@ int mca_common_ompio_file_read_all (ompio_file_t *fh,
 {
     int ret = OMPI_SUCCESS;
 
+    ret = mca_common_ompio_cache_sync (fh);
+    if ( OMPI_SUCCESS != ret ) {
+        return ret;
+    }
 
     if ( !( fh->f_flags & OMPIO_DATAREP_NATIVE ) &&
          !(datatype == &ompi_mpi_byte.dt  ||
@@ -489,6 +500,11 @@ int mca_common_ompio_file_iread_all (ompio_file_t *fp,
 {
     int ret = OMPI_SUCCESS;
 
+    ret = mca_common_ompio_cache_sync (fp);
+    if ( OMPI_SUCCESS != ret ) {
+        return ret;
+    }
+
     if ( NULL != fp->f_fcoll->fcoll_file_iread_all ) {
 	ret = fp->f_fcoll->fcoll_file_iread_all (fp,
 						 buf,
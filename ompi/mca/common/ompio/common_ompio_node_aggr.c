@@ -0,0 +1,364 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "opal/align.h"
+#include "opal/mca/shmem/base/base.h"
+#include "opal/sys/atomic.h"
+#include "opal/util/output.h"
+#include "opal/util/printf.h"
+#include "opal/util/sys_limits.h"
+#include "ompi/communicator/communicator.h"
+#include "ompi/mca/rte/rte.h"
+
+#include "common_ompio.h"
+
+/*
+** Node-local pre-aggregation for collective writes.
+**
+** The processes of fh->f_comm sharing a node copy the data of a collective
+** write, in file view order, into a shared memory segment owned by the first
+** process of the node. That process sorts the file extents of all local
+** processes, coalesces the adjacent ones and enters the inter-node shuffle of
+** the fcoll component on behalf of the whole node, while the other processes
+** enter it without data. The number of messages received by the aggregators
+** therefore scales with the number of nodes rather than the number of processes.
+**
+** The segment is limited to node_aggregation_max_segment bytes: larger writes
+** go through the regular path of the fcoll component. A segment larger than
+** bytes_per_agg is released once the write completes, smaller ones are kept
+** for the next one.
+*/
+
+struct mca_common_ompio_node_aggr_t {
+    ompi_communicator_t *comm;      /* processes of f_comm sharing this node */
+    opal_shmem_ds_t      seg_ds;
+    char                *seg_base;
+    size_t               seg_size;
+};
+
+typedef struct {
+    OMPI_MPI_OFFSET_TYPE offset;
+    size_t               length;
+    char                *addr;
+} mca_common_ompio_node_extent_t;
+
+static int node_extent_cmp (const void *a, const void *b)
+{
+    const mca_common_ompio_node_extent_t *ea = (const mca_common_ompio_node_extent_t *) a;
+    const mca_common_ompio_node_extent_t *eb = (const mca_common_ompio_node_extent_t *) b;
+
+    if ( ea->offset < eb->offset ) {
+        return -1;
+    }
+    return ( ea->offset > eb->offset ) ? 1 : 0;
+}
+
+static int node_aggr_grow_segment (mca_common_ompio_node_aggr_t *na, size_t size)
+{
+    int ret = OMPI_SUCCESS, all_ret, coll_ret;
+    char *seg_file = NULL;
+    const char *backing_dir;
+
+    if ( NULL != na->seg_base ) {
+        opal_shmem_segment_detach (&na->seg_ds);
+        na->seg_base = NULL;
+        na->seg_size = 0;
+    }
+
+    size = OPAL_ALIGN(size, opal_getpagesize(), size_t);
+    if ( 0 == ompi_comm_rank (na->comm) ) {
+        backing_dir = (0 == access ("/dev/shm", W_OK)) ? "/dev/shm" : ompi_process_info.proc_session_dir;
+        if ( 0 > opal_asprintf (&seg_file, "%s" OPAL_PATH_SEP "ompio_node_aggr.%s.%x.%d.%d",
+                                backing_dir, ompi_process_info.nodename, OMPI_PROC_MY_NAME->jobid,
+                                (int) OMPI_PROC_MY_NAME->vpid, ompi_comm_get_cid (na->comm)) ) {
+            ret = OMPI_ERR_OUT_OF_RESOURCE;
+        }
+        else {
+            ret = opal_shmem_segment_create (&na->seg_ds, seg_file, size);
+            free (seg_file);
+        }
+    }
+
+    coll_ret = na->comm->c_coll->coll_bcast (&ret, 1, MPI_INT, 0, na->comm,
+                                             na->comm->c_coll->coll_bcast_module);
+    if ( OMPI_SUCCESS != coll_ret || OMPI_SUCCESS != ret ) {
+        return ( OMPI_SUCCESS != ret ) ? ret : coll_ret;
+    }
+
+    ret = na->comm->c_coll->coll_bcast (&na->seg_ds, sizeof (na->seg_ds), MPI_BYTE, 0, na->comm,
+                                        na->comm->c_coll->coll_bcast_module);
+    if ( OMPI_SUCCESS != ret ) {
+        return ret;
+    }
+
+    na->seg_base = opal_shmem_segment_attach (&na->seg_ds);
+    ret = ( NULL == na->seg_base ) ? OMPI_ERROR : OMPI_SUCCESS;
+
+    /* wait for all processes to attach before the backing file disappears */
+    coll_ret = na->comm->c_coll->coll_allreduce (&ret, &all_ret, 1, MPI_INT, MPI_MIN, na->comm,
+                                                 na->comm->c_coll->coll_allreduce_module);
+    if ( 0 == ompi_comm_rank (na->comm) ) {
+        opal_shmem_unlink (&na->seg_ds);
+    }
+    if ( OMPI_SUCCESS != ret ) {
+        return ret;
+    }
+    if ( OMPI_SUCCESS != coll_ret || OMPI_SUCCESS != all_ret ) {
+        opal_shmem_segment_detach (&na->seg_ds);
+        na->seg_base = NULL;
+        return OMPI_ERROR;
+    }
+
+    na->seg_size = size;
+    return OMPI_SUCCESS;
+}
+
+int mca_common_ompio_node_aggr_gather (ompio_file_t *fh,
+                                       struct iovec **decoded_iov, uint32_t *iov_count,
+                                       struct iovec **file_iov, int *file_count,
+                                       size_t *max_data)
+{
+    mca_common_ompio_node_aggr_t *na = fh->f_node_aggr;
+    mca_common_ompio_node_extent_t *extents = NULL;
+    struct iovec *all_file_iov = NULL, *merged_mem = NULL, *merged_file = NULL;
+    long my_sizes[2], *sizes = NULL;
+    int *counts = NULL, *displs = NULL;
+    int node_rank, node_size, total_count = 0, num_mem = 0, num_file = 0;
+    size_t total_bytes = 0, max_segment;
+    char *pos;
+    int i, ret = OMPI_SUCCESS;
+
+    if ( NULL == na ) {
+        na = (mca_common_ompio_node_aggr_t *) calloc (1, sizeof (mca_common_ompio_node_aggr_t));
+        if ( NULL == na ) {
+            return OMPI_ERR_OUT_OF_RESOURCE;
+        }
+        ret = ompi_comm_split_type (fh->f_comm, MPI_COMM_TYPE_SHARED, 0, NULL, &na->comm);
+        if ( OMPI_SUCCESS != ret ) {
+            free (na);
+            return ret;
+        }
+        fh->f_node_aggr = na;
+    }
+
+    node_size = ompi_comm_size (na->comm);
+    node_rank = ompi_comm_rank (na->comm);
+    if ( 1 == node_size ) {
+        return OMPI_SUCCESS;
+    }
+
+    /* Besides providing the layout of the segment, this allgather guarantees
+    ** that the node aggregator finished the previous collective write, i.e. that
+    ** its segment can be overwritten.
+    */
+    sizes = (long *) malloc (2 * node_size * sizeof(long));
+    if ( NULL == sizes ) {
+        ret = OMPI_ERR_OUT_OF_RESOURCE;
+        goto exit;
+    }
+    /* The segment is laid out from max_data, and read back by the node aggregator
+    ** from the file extents: both have to describe the same number of bytes. A
+    ** mismatch is reported as a negative size, so that all node ranks bail out.
+    */
+    for ( i=0; i<*file_count; i++ ) {
+        total_bytes += (*file_iov)[i].iov_len;
+    }
+    my_sizes[0] = ( total_bytes == *max_data ) ? (long) *max_data : -1;
+    my_sizes[1] = (long) *file_count;
+    total_bytes = 0;
+    ret = na->comm->c_coll->coll_allgather (my_sizes, 2, MPI_LONG, sizes, 2, MPI_LONG, na->comm,
+                                            na->comm->c_coll->coll_allgather_module);
+    if ( OMPI_SUCCESS != ret ) {
+        goto exit;
+    }
+
+    for ( i=0; i<node_size; i++ ) {
+        if ( 0 > sizes[2*i] ) {
+            opal_output (1, "mca_common_ompio_node_aggr_gather: file extents of node rank %d "
+                         "do not match its data\n", i);
+            ret = OMPI_ERROR;
+            goto exit;
+        }
+        total_bytes += (size_t) sizes[2*i];
+    }
+    /* all node ranks see the same total, and take the same path */
+    max_segment = (size_t) OMPIO_MCA_GET(fh, node_aggregation_max_segment);
+    if ( 0 == total_bytes || total_bytes > max_segment ) {
+        goto exit;
+    }
+    if ( total_bytes > na->seg_size ) {
+        ret = node_aggr_grow_segment (na, total_bytes);
+        if ( OMPI_SUCCESS != ret ) {
+            goto exit;
+        }
+    }
+
+    /* Deposit the local data, in file view order, after the data of the lower node ranks */
+    pos = na->seg_base;
+    for ( i=0; i<node_rank; i++ ) {
+        pos += sizes[2*i];
+    }
+    for ( i=0; i<(int)*iov_count; i++ ) {
+        memcpy (pos, (*decoded_iov)[i].iov_base, (*decoded_iov)[i].iov_len);
+        pos += (*decoded_iov)[i].iov_len;
+    }
+    opal_atomic_wmb ();
+
+    if ( 0 == node_rank ) {
+        counts = (int *) malloc (node_size * sizeof(int));
+        displs = (int *) malloc (node_size * sizeof(int));
+        if ( NULL == counts || NULL == displs ) {
+            ret = OMPI_ERR_OUT_OF_RESOURCE;
+            goto exit;
+        }
+        for ( i=0; i<node_size; i++ ) {
+            counts[i] = (int) sizes[2*i+1];
+            displs[i] = total_count;
+            total_count += counts[i];
+        }
+        all_file_iov = (struct iovec *) malloc (total_count * sizeof(struct iovec));
+        if ( NULL == all_file_iov ) {
+            ret = OMPI_ERR_OUT_OF_RESOURCE;
+            goto exit;
+        }
+    }
+
+    /* The data of a process is in the segment once its file extents reached the node aggregator */
+    ret = na->comm->c_coll->coll_gatherv (*file_iov, *file_count, fh->f_iov_type,
+                                          all_file_iov, counts, displs, fh->f_iov_type,
+                                          0, na->comm, na->comm->c_coll->coll_gatherv_module);
+    if ( OMPI_SUCCESS != ret ) {
+        goto exit;
+    }
+
+    if ( 0 != node_rank ) {
+        /* everything is handled by the node aggregator from here on */
+        free (*decoded_iov);
+        *decoded_iov = NULL;
+        *iov_count = 0;
+        free (*file_iov);
+        *file_iov = NULL;
+        *file_count = 0;
+        *max_data = 0;
+        goto exit;
+    }
+
+    /* The extents of the node ranks are stored back to back in the segment, and
+    ** all_file_iov lists them in the very same order.
+    */
+    extents = (mca_common_ompio_node_extent_t *) malloc (total_count * sizeof(mca_common_ompio_node_extent_t));
+    merged_mem  = (struct iovec *) malloc (total_count * sizeof(struct iovec));
+    merged_file = (struct iovec *) malloc (total_count * sizeof(struct iovec));
+    if ( NULL == extents || NULL == merged_mem || NULL == merged_file ) {
+        ret = OMPI_ERR_OUT_OF_RESOURCE;
+        goto exit;
+    }
+    pos = na->seg_base;
+    for ( i=0; i<total_count; i++ ) {
+        extents[i].offset = (OMPI_MPI_OFFSET_TYPE)(intptr_t) all_file_iov[i].iov_base;
+        extents[i].length = all_file_iov[i].iov_len;
+        extents[i].addr   = pos;
+        pos += extents[i].length;
+    }
+    qsort (extents, total_count, sizeof(mca_common_ompio_node_extent_t), node_extent_cmp);
+
+    /* Coalesce the file extents and the memory pieces independently: both
+    ** describe the same byte stream, ordered by file offset.
+    */
+    for ( i=0; i<total_count; i++ ) {
+        if ( 0 == extents[i].length ) {
+            continue;
+        }
+        if ( 0 < num_file &&
+             (OMPI_MPI_OFFSET_TYPE)(intptr_t) merged_file[num_file-1].iov_base +
+             (OMPI_MPI_OFFSET_TYPE) merged_file[num_file-1].iov_len == extents[i].offset ) {
+            merged_file[num_file-1].iov_len += extents[i].length;
+        }
+        else {
+            merged_file[num_file].iov_base = (void *)(intptr_t) extents[i].offset;
+            merged_file[num_file].iov_len  = extents[i].length;
+            num_file++;
+        }
+        if ( 0 < num_mem &&
+             (char *) merged_mem[num_mem-1].iov_base + merged_mem[num_mem-1].iov_len == extents[i].addr ) {
+            merged_mem[num_mem-1].iov_len += extents[i].length;
+        }
+        else {
+            merged_mem[num_mem].iov_base = extents[i].addr;
+            merged_mem[num_mem].iov_len  = extents[i].length;
+            num_mem++;
+        }
+    }
+
+    free (*decoded_iov);
+    *decoded_iov = merged_mem;
+    *iov_count = num_mem;
+    free (*file_iov);
+    *file_iov = merged_file;
+    *file_count = num_file;
+    *max_data = total_bytes;
+    merged_mem = NULL;
+    merged_file = NULL;
+
+exit:
+    free (sizes);
+    free (counts);
+    free (displs);
+    free (all_file_iov);
+    free (extents);
+    free (merged_mem);
+    free (merged_file);
+
+    return ret;
+}
+
+int mca_common_ompio_node_aggr_release (ompio_file_t *fh)
+{
+    mca_common_ompio_node_aggr_t *na = fh->f_node_aggr;
+
+    /* Detaching is local: the node aggregator of a later write waits in the
+    ** allgather of mca_common_ompio_node_aggr_gather for the others to be done.
+    */
+    if ( NULL != na && NULL != na->seg_base &&
+         na->seg_size > (size_t) OMPIO_MCA_GET(fh, bytes_per_agg) ) {
+        opal_shmem_segment_detach (&na->seg_ds);
+        na->seg_base = NULL;
+        na->seg_size = 0;
+    }
+
+    return OMPI_SUCCESS;
+}
+
+int mca_common_ompio_node_aggr_finalize (ompio_file_t *fh)
+{
+    mca_common_ompio_node_aggr_t *na = fh->f_node_aggr;
+
+    if ( NULL == na ) {
+        return OMPI_SUCCESS;
+    }
+    if ( NULL != na->seg_base ) {
+        opal_shmem_segment_detach (&na->seg_ds);
+    }
+    if ( NULL != na->comm ) {
+        ompi_comm_free (&na->comm);
+    }
+    free (na);
+    fh->f_node_aggr = NULL;
+
+    return OMPI_SUCCESS;
+}
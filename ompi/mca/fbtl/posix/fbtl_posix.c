@@ -112,6 +112,9 @@ int mca_fbtl_posix_module_init (ompio_file_t *file) {
 
 
 int mca_fbtl_posix_module_finalize (ompio_file_t *file) {
+#if OPAL_HAVE_IO_URING
+    mca_fbtl_posix_uring_file_close (file);
+#endif
     return OMPI_SUCCESS;
 }
 
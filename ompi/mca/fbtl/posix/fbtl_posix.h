@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2006 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -42,6 +42,10 @@ int mca_fbtl_posix_module_init (ompio_file_t *file);
 int mca_fbtl_posix_module_finalize (ompio_file_t *file);
 
 extern int fbtl_posix_max_aio_active_reqs;
+extern int mca_fbtl_posix_backend;
+extern int mca_fbtl_posix_uring_entries;
+extern bool mca_fbtl_posix_uring_direct;
+extern int mca_fbtl_posix_uring_direct_alignment;
 
 OMPI_MODULE_DECLSPEC extern mca_fbtl_base_component_2_0_0_t mca_fbtl_posix_component;
 /*
@@ -64,6 +68,13 @@ int mca_fbtl_posix_lock ( struct flock *lock, ompio_file_t *fh, int op,
                           OMPI_MPI_OFFSET_TYPE iov_offset, off_t len, int flags);
 void  mca_fbtl_posix_unlock ( struct flock *lock, ompio_file_t *fh );
 
+#if OPAL_HAVE_IO_URING
+bool    mca_fbtl_posix_uring_usable ( ompio_file_t *fh );
+ssize_t mca_fbtl_posix_uring_submit ( ompio_file_t *fh, ompi_request_t *request, int type );
+void    mca_fbtl_posix_uring_file_close ( ompio_file_t *fh );
+void    mca_fbtl_posix_uring_fini ( void );
+#endif
+
 
 struct mca_fbtl_posix_request_data_t {
     int            aio_req_count;       /* total number of aio reqs */
@@ -87,6 +98,10 @@ typedef struct mca_fbtl_posix_request_data_t mca_fbtl_posix_request_data_t;
 #define FBTL_POSIX_READ 1
 #define FBTL_POSIX_WRITE 2
 
+/* backends for the non-blocking operations */
+#define FBTL_POSIX_BACKEND_AIO      0
+#define FBTL_POSIX_BACKEND_IO_URING 1
+
 
 /*
  * ******************************************************************
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -37,6 +37,19 @@ const char *mca_fbtl_posix_component_version_string =
   "OMPI/MPI posix FBTL MCA component version " OMPI_VERSION;
 
 int mca_fbtl_posix_priority = 10;
+int mca_fbtl_posix_backend = FBTL_POSIX_BACKEND_AIO;
+int mca_fbtl_posix_uring_entries = 256;
+bool mca_fbtl_posix_uring_direct = false;
+int mca_fbtl_posix_uring_direct_alignment = 4096;
+
+static int register_component(void);
+static int close_component(void);
+
+static mca_base_var_enum_value_t posix_backends[] = {
+    {FBTL_POSIX_BACKEND_AIO, "aio"},
+    {FBTL_POSIX_BACKEND_IO_URING, "io_uring"},
+    {0, NULL}
+};
 
 /*
  * Instantiate the public struct with all of our public information
@@ -54,6 +67,8 @@ mca_fbtl_base_component_2_0_0_t mca_fbtl_posix_component = {
         .mca_component_name = "posix",
         MCA_BASE_MAKE_VERSION(component, OMPI_MAJOR_VERSION, OMPI_MINOR_VERSION,
                               OMPI_RELEASE_VERSION),
+        .mca_register_component_params = register_component,
+        .mca_close_component = close_component,
     },
     .fbtlm_data = {
         /* This component is checkpointable */
@@ -63,3 +78,58 @@ mca_fbtl_base_component_2_0_0_t mca_fbtl_posix_component = {
     .fbtlm_file_query = mca_fbtl_posix_component_file_query,      /* get priority and actions */
     .fbtlm_file_unquery = mca_fbtl_posix_component_file_unquery,  /* undo what was done by previous function */
 };
+
+static int register_component(void)
+{
+    mca_base_var_enum_t *new_enum;
+
+    mca_fbtl_posix_backend = FBTL_POSIX_BACKEND_AIO;
+    (void) mca_base_var_enum_create ("fbtl_posix_backends", posix_backends, &new_enum);
+    (void) mca_base_component_var_register(&mca_fbtl_posix_component.fbtlm_version,
+                                           "backend", "Interface used for non-blocking operations: "
+                                           "aio (POSIX aio) or io_uring (only on Linux, falls back "
+                                           "to aio if the ring cannot be set up)",
+                                           MCA_BASE_VAR_TYPE_INT, new_enum, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_fbtl_posix_backend);
+    OBJ_RELEASE(new_enum);
+
+    mca_fbtl_posix_uring_entries = 256;
+    (void) mca_base_component_var_register(&mca_fbtl_posix_component.fbtlm_version,
+                                           "uring_entries", "Number of submission queue entries "
+                                           "of the io_uring shared by all files of a process",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_fbtl_posix_uring_entries);
+
+    mca_fbtl_posix_uring_direct = false;
+    (void) mca_base_component_var_register(&mca_fbtl_posix_component.fbtlm_version,
+                                           "uring_direct", "Issue the aligned parts of non-blocking "
+                                           "operations with O_DIRECT when using io_uring, through "
+                                           "a bounce buffer if the memory is not aligned",
+                                           MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_fbtl_posix_uring_direct);
+
+    mca_fbtl_posix_uring_direct_alignment = 4096;
+    (void) mca_base_component_var_register(&mca_fbtl_posix_component.fbtlm_version,
+                                           "uring_direct_alignment", "Alignment in bytes of offset, "
+                                           "length and memory required for O_DIRECT (power of two)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_fbtl_posix_uring_direct_alignment);
+
+    return OMPI_SUCCESS;
+}
+
+static int close_component(void)
+{
+#if OPAL_HAVE_IO_URING
+    mca_fbtl_posix_uring_fini ();
+#endif
+    return OMPI_SUCCESS;
+}
@@ -35,6 +35,11 @@
 ssize_t  mca_fbtl_posix_ipwritev (ompio_file_t *fh,
 				 ompi_request_t *request)
 {
+#if OPAL_HAVE_IO_URING
+    if ( mca_fbtl_posix_uring_usable (fh) ) {
+        return mca_fbtl_posix_uring_submit (fh, request, FBTL_POSIX_WRITE);
+    }
+#endif
 #if defined(FBTL_POSIX_HAVE_AIO)
     mca_fbtl_posix_request_data_t *data;
     mca_ompio_request_t *req = (mca_ompio_request_t *) request;
@@ -0,0 +1,463 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * io_uring backend for the non-blocking operations of the posix fbtl.
+ *
+ * All iovec entries of an ompio request are queued on a single ring shared by
+ * all files of the process and handed to the kernel with one io_uring_enter()
+ * call, through the raw system call wrappers of opal/util/uring.h.
+ * Completions are reaped from the progress function of the requests, which
+ * ompio calls from opal_progress(), so no helper threads are involved as with
+ * the glibc implementation of POSIX aio.
+ *
+ * If fbtl_posix_uring_direct is set, entries whose offset and length are
+ * multiples of fbtl_posix_uring_direct_alignment are issued on a second
+ * descriptor opened with O_DIRECT, going through an aligned bounce buffer if
+ * the user memory is not aligned. All other entries use the regular file
+ * descriptor.
+ */
+
+#include "ompi_config.h"
+#include "fbtl_posix.h"
+
+#if OPAL_HAVE_IO_URING
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+
+#include "mpi.h"
+#include "opal/threads/mutex.h"
+#include "opal/util/uring.h"
+#include "ompi/constants.h"
+#include "ompi/mca/fbtl/fbtl.h"
+#include "ompi/mca/fbtl/base/base.h"
+
+struct mca_fbtl_posix_uring_data_t;
+
+typedef struct mca_fbtl_posix_uring_entry_t {
+    struct mca_fbtl_posix_uring_data_t *data; /* request this entry belongs to */
+    char          *buf;        /* memory used for the transfer, maybe a bounce buffer */
+    char          *user_buf;   /* user memory if buf is a bounce buffer */
+    size_t         len;        /* total length of the entry */
+    size_t         done;       /* bytes transferred so far */
+    off_t          offset;     /* file offset of the entry */
+    struct iovec   iov;        /* what is currently submitted */
+} mca_fbtl_posix_uring_entry_t;
+
+typedef struct mca_fbtl_posix_uring_data_t {
+    int            req_type;       /* FBTL_POSIX_READ or FBTL_POSIX_WRITE */
+    int            num_entries;    /* total number of entries */
+    int            next_entry;     /* first entry never submitted */
+    int            open_entries;   /* entries not finished yet */
+    int            inflight;       /* entries owned by the kernel */
+    int            nretry;         /* entries to submit again */
+    int           *retry;          /* indices of the entries to submit again */
+    int            error;          /* first error returned by the kernel */
+    ssize_t        total_len;      /* total amount of data transferred */
+    struct flock   lock;           /* lock used for certain file systems */
+    ompio_file_t  *fh;
+    mca_fbtl_posix_uring_entry_t *entries;
+} mca_fbtl_posix_uring_data_t;
+
+typedef struct mca_fbtl_posix_uring_file_t {
+    int            direct_fd;      /* O_DIRECT descriptor, -1 if not usable */
+    int            direct_mode;    /* O_RDONLY, O_WRONLY or O_RDWR */
+} mca_fbtl_posix_uring_file_t;
+
+/* completions reaped at once */
+#define FBTL_POSIX_URING_BATCH 32
+
+/* One ring for the whole process, set up by the first request */
+static opal_uring_t mca_fbtl_posix_ring = OPAL_URING_STATIC_INIT;
+static int mca_fbtl_posix_ring_state = 0;   /* 0 not tried, 1 up, -1 unusable */
+static opal_mutex_t mca_fbtl_posix_ring_lock = OPAL_MUTEX_STATIC_INIT;
+
+#define FBTL_POSIX_IS_ALIGNED(X) (0 == ((uintptr_t)(X) % (uintptr_t)mca_fbtl_posix_uring_direct_alignment))
+
+static bool mca_fbtl_posix_uring_progress (mca_ompio_request_t *req);
+static void mca_fbtl_posix_uring_request_free (mca_ompio_request_t *req);
+
+static bool mca_fbtl_posix_ring_init (void)
+{
+    if (0 == mca_fbtl_posix_ring_state) {
+        if (OPAL_SUCCESS != opal_uring_init (&mca_fbtl_posix_ring, mca_fbtl_posix_uring_entries, false)) {
+            opal_output_verbose(10, ompi_fbtl_base_framework.framework_output,
+                                "fbtl:posix: cannot set up io_uring (%s), using POSIX aio",
+                                strerror(errno));
+            mca_fbtl_posix_ring_state = -1;
+        }
+        else {
+            mca_fbtl_posix_ring_state = 1;
+        }
+    }
+    return (1 == mca_fbtl_posix_ring_state);
+}
+
+bool mca_fbtl_posix_uring_usable (ompio_file_t *fh)
+{
+    bool ret;
+
+    if (FBTL_POSIX_BACKEND_IO_URING != mca_fbtl_posix_backend) {
+        return false;
+    }
+    OPAL_THREAD_LOCK(&mca_fbtl_posix_ring_lock);
+    ret = mca_fbtl_posix_ring_init ();
+    OPAL_THREAD_UNLOCK(&mca_fbtl_posix_ring_lock);
+    return ret;
+}
+
+void mca_fbtl_posix_uring_fini (void)
+{
+    if (1 == mca_fbtl_posix_ring_state) {
+        opal_uring_fini (&mca_fbtl_posix_ring);
+    }
+    mca_fbtl_posix_ring_state = 0;
+}
+
+/* Open the O_DIRECT descriptor of a file the first time it is needed */
+static mca_fbtl_posix_uring_file_t *mca_fbtl_posix_uring_file (ompio_file_t *fh)
+{
+    mca_fbtl_posix_uring_file_t *file = (mca_fbtl_posix_uring_file_t *) fh->f_fbtl_data;
+
+    if (NULL != file) {
+        return file;
+    }
+    file = (mca_fbtl_posix_uring_file_t *) malloc (sizeof(mca_fbtl_posix_uring_file_t));
+    if (NULL == file) {
+        return NULL;
+    }
+
+    if (fh->f_amode & MPI_MODE_RDONLY) {
+        file->direct_mode = O_RDONLY;
+    }
+    else if (fh->f_amode & MPI_MODE_WRONLY) {
+        file->direct_mode = O_WRONLY;
+    }
+    else {
+        file->direct_mode = O_RDWR;
+    }
+    file->direct_fd = open (fh->f_filename, file->direct_mode | O_DIRECT);
+    if (-1 == file->direct_fd) {
+        opal_output_verbose(10, ompi_fbtl_base_framework.framework_output,
+                            "fbtl:posix: could not open %s with O_DIRECT (%s)",
+                            fh->f_filename, strerror(errno));
+    }
+    fh->f_fbtl_data = file;
+    return file;
+}
+
+void mca_fbtl_posix_uring_file_close (ompio_file_t *fh)
+{
+    mca_fbtl_posix_uring_file_t *file = (mca_fbtl_posix_uring_file_t *) fh->f_fbtl_data;
+
+    if (NULL != file) {
+        if (-1 != file->direct_fd) {
+            close (file->direct_fd);
+        }
+        free (file);
+        fh->f_fbtl_data = NULL;
+    }
+}
+
+/* Can the entry go through the O_DIRECT descriptor right now ? */
+static int mca_fbtl_posix_uring_fd (mca_fbtl_posix_uring_data_t *data,
+                                    mca_fbtl_posix_uring_entry_t *entry)
+{
+    mca_fbtl_posix_uring_file_t *file = (mca_fbtl_posix_uring_file_t *) data->fh->f_fbtl_data;
+
+    if (NULL == file || -1 == file->direct_fd) {
+        return data->fh->fd;
+    }
+    if ((FBTL_POSIX_READ == data->req_type && O_WRONLY == file->direct_mode) ||
+        (FBTL_POSIX_WRITE == data->req_type && O_RDONLY == file->direct_mode)) {
+        return data->fh->fd;
+    }
+    if (FBTL_POSIX_IS_ALIGNED(entry->iov.iov_base) && FBTL_POSIX_IS_ALIGNED(entry->iov.iov_len) &&
+        FBTL_POSIX_IS_ALIGNED(entry->offset + entry->done)) {
+        return file->direct_fd;
+    }
+    return data->fh->fd;
+}
+
+/*
+ * Queue as many entries of the request as the ring has room for, retries
+ * first, and submit them all at once. Called with the ring lock held.
+ */
+static int mca_fbtl_posix_uring_queue (mca_fbtl_posix_uring_data_t *data)
+{
+    struct io_uring_sqe *sqe;
+    mca_fbtl_posix_uring_entry_t *entry;
+    int queued = 0;
+
+    while (0 < data->nretry || data->next_entry < data->num_entries) {
+        sqe = opal_uring_get_sqe (&mca_fbtl_posix_ring);
+        if (NULL == sqe) {
+            break;
+        }
+        if (0 < data->nretry) {
+            entry = &data->entries[data->retry[--data->nretry]];
+        }
+        else {
+            entry = &data->entries[data->next_entry++];
+        }
+        entry->iov.iov_base = entry->buf + entry->done;
+        entry->iov.iov_len  = entry->len - entry->done;
+        sqe->opcode    = (FBTL_POSIX_READ == data->req_type) ? IORING_OP_READV : IORING_OP_WRITEV;
+        sqe->fd        = mca_fbtl_posix_uring_fd (data, entry);
+        sqe->addr      = (uint64_t)(uintptr_t) &entry->iov;
+        sqe->len       = 1;
+        sqe->off       = (uint64_t)(entry->offset + entry->done);
+        sqe->user_data = (uint64_t)(uintptr_t) entry;
+        data->inflight++;
+        queued++;
+    }
+
+    if (0 < queued) {
+        opal_uring_publish (&mca_fbtl_posix_ring);
+    }
+    if (OPAL_SUCCESS != opal_uring_flush (&mca_fbtl_posix_ring)) {
+        opal_output(1, "mca_fbtl_posix_uring_queue: error in io_uring_enter(): %s",
+                    strerror(errno));
+        return OMPI_ERROR;
+    }
+    return OMPI_SUCCESS;
+}
+
+/* Account a completion to its request. Called with the ring lock held. */
+static void mca_fbtl_posix_uring_complete (struct io_uring_cqe *cqe)
+{
+    mca_fbtl_posix_uring_entry_t *entry = (mca_fbtl_posix_uring_entry_t *)(uintptr_t) cqe->user_data;
+    mca_fbtl_posix_uring_data_t *data = entry->data;
+    bool finished = true;
+
+    data->inflight--;
+    if (-EAGAIN == cqe->res || -EINTR == cqe->res) {
+        finished = false;
+    }
+    else if (0 > cqe->res) {
+        if (0 == data->error) {
+            data->error = -cqe->res;
+        }
+    }
+    else if (0 == cqe->res) {
+        /* end of file for reads; a write making no progress is an error */
+        if (FBTL_POSIX_WRITE == data->req_type && 0 == data->error) {
+            data->error = EIO;
+        }
+    }
+    else {
+        entry->done += cqe->res;
+        data->total_len += cqe->res;
+        finished = (entry->done == entry->len);
+    }
+
+    if (!finished && 0 == data->error) {
+        /* short transfer, submit the remainder again */
+        data->retry[data->nretry++] = (int)(entry - data->entries);
+        return;
+    }
+
+    if (NULL != entry->user_buf) {
+        if (FBTL_POSIX_READ == data->req_type) {
+            memcpy (entry->user_buf, entry->buf, entry->done);
+        }
+        free (entry->buf);
+        entry->buf = NULL;
+        entry->user_buf = NULL;
+    }
+    data->open_entries--;
+}
+
+/* Reap everything the kernel has completed, whatever request it belongs to */
+static void mca_fbtl_posix_uring_reap (void)
+{
+    struct io_uring_cqe cqes[FBTL_POSIX_URING_BATCH];
+    unsigned i, count;
+
+    do {
+        count = opal_uring_reap (&mca_fbtl_posix_ring, cqes, FBTL_POSIX_URING_BATCH);
+        for (i = 0; i < count; i++) {
+            mca_fbtl_posix_uring_complete (&cqes[i]);
+        }
+    } while (FBTL_POSIX_URING_BATCH == count);
+}
+
+ssize_t mca_fbtl_posix_uring_submit (ompio_file_t *fh, ompi_request_t *request, int type)
+{
+    mca_fbtl_posix_uring_data_t *data;
+    mca_fbtl_posix_uring_entry_t *entry;
+    mca_ompio_request_t *req = (mca_ompio_request_t *) request;
+    off_t start_offset, end_offset, total_length;
+    bool direct = false;
+    int i, ret;
+
+    data = (mca_fbtl_posix_uring_data_t *) calloc (1, sizeof(mca_fbtl_posix_uring_data_t));
+    if (NULL == data) {
+        opal_output(1, "OUT OF MEMORY\n");
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+    data->entries = (mca_fbtl_posix_uring_entry_t *) calloc (fh->f_num_of_io_entries,
+                                                             sizeof(mca_fbtl_posix_uring_entry_t));
+    data->retry = (int *) malloc (fh->f_num_of_io_entries * sizeof(int));
+    if (NULL == data->entries || NULL == data->retry) {
+        opal_output(1, "OUT OF MEMORY\n");
+        ret = OMPI_ERR_OUT_OF_RESOURCE;
+        goto exit;
+    }
+    data->req_type     = type;
+    data->num_entries  = fh->f_num_of_io_entries;
+    data->open_entries = fh->f_num_of_io_entries;
+    data->fh           = fh;
+    data->lock.l_start = -1;
+    data->lock.l_len   = -1;
+
+    if (mca_fbtl_posix_uring_direct && 0 < mca_fbtl_posix_uring_direct_alignment) {
+        mca_fbtl_posix_uring_file_t *file = mca_fbtl_posix_uring_file (fh);
+        direct = (NULL != file && -1 != file->direct_fd);
+    }
+
+    for (i = 0; i < fh->f_num_of_io_entries; i++) {
+        entry = &data->entries[i];
+        entry->data   = data;
+        entry->buf    = (char *) fh->f_io_array[i].memory_address;
+        entry->len    = fh->f_io_array[i].length;
+        entry->offset = (off_t)(intptr_t) fh->f_io_array[i].offset;
+
+        /* O_DIRECT candidates with unaligned user memory use a bounce buffer */
+        if (direct && FBTL_POSIX_IS_ALIGNED(entry->offset) && FBTL_POSIX_IS_ALIGNED(entry->len) &&
+            !FBTL_POSIX_IS_ALIGNED(entry->buf)) {
+            void *bounce;
+            if (0 != posix_memalign (&bounce, mca_fbtl_posix_uring_direct_alignment, entry->len)) {
+                continue;
+            }
+            if (FBTL_POSIX_WRITE == type) {
+                memcpy (bounce, entry->buf, entry->len);
+            }
+            entry->user_buf = entry->buf;
+            entry->buf = (char *) bounce;
+        }
+    }
+
+    start_offset = data->entries[0].offset;
+    end_offset   = data->entries[data->num_entries-1].offset + data->entries[data->num_entries-1].len;
+    total_length = (end_offset - start_offset);
+    ret = mca_fbtl_posix_lock (&data->lock, fh, (FBTL_POSIX_READ == type) ? F_RDLCK : F_WRLCK,
+                               start_offset, total_length, OMPIO_LOCK_ENTIRE_REGION);
+    if (0 < ret) {
+        opal_output(1, "mca_fbtl_posix_uring_submit: error in mca_fbtl_posix_lock() error ret=%d %s",
+                    ret, strerror(errno));
+        mca_fbtl_posix_unlock (&data->lock, fh);
+        ret = OMPI_ERROR;
+        goto exit;
+    }
+
+    OPAL_THREAD_LOCK(&mca_fbtl_posix_ring_lock);
+    ret = mca_fbtl_posix_uring_queue (data);
+    OPAL_THREAD_UNLOCK(&mca_fbtl_posix_ring_lock);
+
+    /* Even on error the request owns the data now, since some entries might
+     * already be in the hands of the kernel. */
+    req->req_data        = data;
+    req->req_progress_fn = mca_fbtl_posix_uring_progress;
+    req->req_free_fn     = mca_fbtl_posix_uring_request_free;
+    if (OMPI_SUCCESS != ret && 0 == data->error) {
+        data->error = EIO;
+    }
+    return OMPI_SUCCESS;
+
+ exit:
+    if (NULL != data->entries) {
+        for (i = 0; i < data->num_entries; i++) {
+            if (NULL != data->entries[i].user_buf) {
+                free (data->entries[i].buf);
+            }
+        }
+        free (data->entries);
+    }
+    free (data->retry);
+    free (data);
+    return ret;
+}
+
+static bool mca_fbtl_posix_uring_progress (mca_ompio_request_t *req)
+{
+    mca_fbtl_posix_uring_data_t *data = (mca_fbtl_posix_uring_data_t *) req->req_data;
+    bool ret = false;
+
+    OPAL_THREAD_LOCK(&mca_fbtl_posix_ring_lock);
+    /* entries the kernel had no room for when they were queued */
+    (void) opal_uring_flush (&mca_fbtl_posix_ring);
+    mca_fbtl_posix_uring_reap ();
+    if (0 == data->error &&
+        (0 < data->nretry || data->next_entry < data->num_entries)) {
+        if (OMPI_SUCCESS != mca_fbtl_posix_uring_queue (data)) {
+            data->error = EIO;
+        }
+    }
+
+    if (0 != data->error && 0 == data->inflight) {
+        /* an error occured, and the kernel is done with our buffers */
+        req->req_ompi.req_status.MPI_ERROR = OMPI_ERROR;
+        req->req_ompi.req_status._ucount = data->total_len;
+        ret = true;
+    }
+    else if (0 == data->open_entries) {
+        req->req_ompi.req_status.MPI_ERROR = OMPI_SUCCESS;
+        req->req_ompi.req_status._ucount = data->total_len;
+        ret = true;
+    }
+    OPAL_THREAD_UNLOCK(&mca_fbtl_posix_ring_lock);
+
+    if (ret) {
+        mca_fbtl_posix_unlock (&data->lock, data->fh);
+    }
+    return ret;
+}
+
+static void mca_fbtl_posix_uring_request_free (mca_ompio_request_t *req)
+{
+    mca_fbtl_posix_uring_data_t *data = (mca_fbtl_posix_uring_data_t *) req->req_data;
+    int i;
+
+    if (NULL == data) {
+        return;
+    }
+
+    /* A request freed while active still has entries in the ring. Wait for
+     * them, the kernel would otherwise write to freed memory. */
+    OPAL_THREAD_LOCK(&mca_fbtl_posix_ring_lock);
+    while (0 < data->inflight) {
+        if (OPAL_SUCCESS != opal_uring_wait (&mca_fbtl_posix_ring)) {
+            break;
+        }
+        mca_fbtl_posix_uring_reap ();
+    }
+    OPAL_THREAD_UNLOCK(&mca_fbtl_posix_ring_lock);
+
+    mca_fbtl_posix_unlock (&data->lock, data->fh);
+    for (i = 0; i < data->num_entries; i++) {
+        if (NULL != data->entries[i].user_buf) {
+            free (data->entries[i].buf);
+        }
+    }
+    free (data->entries);
+    free (data->retry);
+    free (data);
+    req->req_data = NULL;
+}
+
+#endif /* OPAL_HAVE_IO_URING */
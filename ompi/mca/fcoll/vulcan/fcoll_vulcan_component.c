@@ -44,6 +44,7 @@ int mca_fcoll_vulcan_priority = 10;
 int mca_fcoll_vulcan_num_groups = 1;
 int mca_fcoll_vulcan_write_chunksize = -1;
 int mca_fcoll_vulcan_async_io = 0;
+int mca_fcoll_vulcan_pipeline_depth = 2;
 
 /*
  * Local function
@@ -111,5 +112,17 @@ vulcan_register(void)
                                            OPAL_INFO_LVL_9,
                                            MCA_BASE_VAR_SCOPE_READONLY, &mca_fcoll_vulcan_async_io);
 
+    mca_fcoll_vulcan_pipeline_depth = 2;
+    (void) mca_base_component_var_register(&mca_fcoll_vulcan_component.fcollm_version,
+                                           "pipeline_depth", "Number of cycle buffers per aggregator in collective writes. "
+                                           "The data exchange of one cycle overlaps the writes of up to pipeline_depth-1 "
+                                           "previous cycles; the per-aggregator buffer is split evenly among them. "
+                                           "With asynchronous I/O, a depth above 2 keeps up to pipeline_depth-1 "
+                                           "non-blocking writes (fbtl ipwritev) outstanding per aggregator at the same time. "
+                                           "1 serialises the exchange and the write of every cycle. Default: 2",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY, &mca_fcoll_vulcan_pipeline_depth);
+
     return OMPI_SUCCESS;
 }
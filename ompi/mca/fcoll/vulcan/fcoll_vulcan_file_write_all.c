@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2017 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -51,7 +51,7 @@ typedef struct mca_io_ompio_aggregator_data {
     int **blocklen_per_process;
     MPI_Aint **displs_per_process, total_bytes, bytes_per_cycle, total_bytes_written;
     MPI_Comm comm;
-    char *buf, *global_buf, *prev_global_buf;
+    char *buf, *global_buf, **cycle_bufs;
     ompi_datatype_t **recvtype, **prev_recvtype;
     struct iovec *global_iov_array;
     int current_index, current_position;
@@ -78,9 +78,6 @@ typedef struct mca_io_ompio_aggregator_data {
         _aggr[_i]->prev_num_io_entries=_aggr[_i]->num_io_entries; \
         _aggr[_i]->prev_bytes_sent=_aggr[_i]->bytes_sent;         \
         _aggr[_i]->prev_bytes_to_write=_aggr[_i]->bytes_to_write; \
-        _t=_aggr[_i]->prev_global_buf;                            \
-        _aggr[_i]->prev_global_buf=_aggr[_i]->global_buf;         \
-        _aggr[_i]->global_buf=_t;                                 \
         _t=(char *)_aggr[_i]->recvtype;                           \
         _aggr[_i]->recvtype=_aggr[_i]->prev_recvtype;             \
         _aggr[_i]->prev_recvtype=(ompi_datatype_t **)_t;          }                                                             \
@@ -133,7 +130,7 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
     uint32_t total_fview_count = 0;
     int local_count = 0;
     ompi_request_t **reqs = NULL;
-    ompi_request_t *req_iwrite = MPI_REQUEST_NULL;
+    ompi_request_t **write_reqs = NULL;
     mca_io_ompio_aggregator_data **aggr_data=NULL;
     
     int *displs = NULL;
@@ -150,6 +147,7 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
     int aggr_index = NOT_AGGR_INDEX;
     int write_synch_type = 2;
     int write_chunksize, *result_counts=NULL;
+    int pipeline_depth = 1, slot;
     
 #if OMPIO_FCOLL_WANT_TIME_BREAKDOWN
     double write_time = 0.0, start_write_time = 0.0, end_write_time = 0.0;
@@ -175,9 +173,13 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
         goto exit;
     }
 
-    /* since we want to overlap 2 iterations, define the bytes_per_cycle to be half of what
-       the user requested */
-    bytes_per_cycle =bytes_per_cycle/2;
+    /* up to pipeline_depth cycles are in flight at the same time (one being exchanged,
+       the others being written), split the buffer size requested by the user among them */
+    pipeline_depth = mca_fcoll_vulcan_pipeline_depth;
+    if ( 1 > pipeline_depth ) {
+        pipeline_depth = 1;
+    }
+    bytes_per_cycle =bytes_per_cycle/pipeline_depth;
     write_chunksize = bytes_per_cycle;
     
     ret =   mca_common_ompio_decode_datatype ((struct ompio_file_t *) fh,
@@ -232,6 +234,18 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
     if (ret != OMPI_SUCCESS){
 	goto exit;
     }
+
+    /*************************************************************************
+     ** 2a. Optionally merge the data of the processes sharing a node at the
+     **     node aggregator, which takes part in the shuffle for the whole node
+     *************************************************************************/
+    if ( 1 == OMPIO_MCA_GET(fh, node_aggregation) ) {
+        ret = mca_common_ompio_node_aggr_gather (fh, &decoded_iov, &iov_count,
+                                                 &local_iov_array, &local_count, &max_data);
+        if (OMPI_SUCCESS != ret){
+            goto exit;
+        }
+    }
     
     /*************************************************************************
      ** 2b. Separate the local_iov_array entries based on the number of aggregators
@@ -523,13 +537,20 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
             }
         
             
-            aggr_data[i]->global_buf       = (char *) malloc (bytes_per_cycle);
-            aggr_data[i]->prev_global_buf  = (char *) malloc (bytes_per_cycle);
-            if (NULL == aggr_data[i]->global_buf || NULL == aggr_data[i]->prev_global_buf){
+            aggr_data[i]->cycle_bufs = (char **) calloc (pipeline_depth, sizeof(char *));
+            if (NULL == aggr_data[i]->cycle_bufs) {
                 opal_output(1, "OUT OF MEMORY");
                 ret = OMPI_ERR_OUT_OF_RESOURCE;
                 goto exit;
             }
+            for ( l=0; l<pipeline_depth; l++ ) {
+                aggr_data[i]->cycle_bufs[l] = (char *) malloc (bytes_per_cycle);
+                if (NULL == aggr_data[i]->cycle_bufs[l]) {
+                    opal_output(1, "OUT OF MEMORY");
+                    ret = OMPI_ERR_OUT_OF_RESOURCE;
+                    goto exit;
+                }
+            }
         
             aggr_data[i]->recvtype = (ompi_datatype_t **) malloc (fh->f_procs_per_group  * 
                                                                   sizeof(ompi_datatype_t *));
@@ -566,6 +587,16 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
         }
     }
 
+    write_reqs = (ompi_request_t **) malloc (pipeline_depth * sizeof(ompi_request_t *));
+    if ( NULL == write_reqs ) {
+        opal_output (1, "OUT OF MEMORY\n");
+        ret = OMPI_ERR_OUT_OF_RESOURCE;
+        goto exit;
+    }
+    for ( l=0; l<pipeline_depth; l++ ) {
+        write_reqs[l] = MPI_REQUEST_NULL;
+    }
+
     // In fact it should be: if ((1 == mca_fcoll_vulcan_async_io) && (NULL != fh->f_fbtl->fbtl_ipwritev))
     // But we've already tested that.
     if( (1 == mca_fcoll_vulcan_async_io) ||
@@ -573,32 +604,23 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
         write_synch_type = 1;
     }
 
-    if ( cycles > 0 ) {
-        for ( i=0; i<fh->f_num_aggrs; i++ ) {
-            ret = shuffle_init ( 0, cycles, fh->f_aggr_list[i], fh->f_rank, aggr_data[i],
-                                 &reqs[i*(fh->f_procs_per_group + 1)] );
-            if ( OMPI_SUCCESS != ret ) {
-                goto exit;
-            }
-        }
-        // Register progress function that should be used by ompi_request_wait
-        if (NOT_AGGR_INDEX != aggr_index)  {
-            mca_common_ompio_register_progress ();
-        }
+    // Register progress function that should be used by ompi_request_wait
+    if ( (cycles > 0) && (NOT_AGGR_INDEX != aggr_index) ) {
+        mca_common_ompio_register_progress ();
     }
 
-    ret = ompi_request_wait_all ( (fh->f_procs_per_group + 1 )*fh->f_num_aggrs,
-                                  reqs, MPI_STATUS_IGNORE);
-
-    for (index = 1; index < cycles; index++) {
-        SWAP_AGGR_POINTERS(aggr_data, fh->f_num_aggrs);
+    /* Cycle index is exchanged into cycle_bufs[index % pipeline_depth] while the
+    ** writes of the previous pipeline_depth-1 cycles are still in flight. */
+    for (index = 0; index < cycles; index++) {
+        slot = index % pipeline_depth;
 
         if(NOT_AGGR_INDEX != aggr_index) {
+            /* The buffer of this slot was last used by cycle index-pipeline_depth,
+               its write has to complete before the buffer can be reused. */
 #if OMPIO_FCOLL_WANT_TIME_BREAKDOWN
             start_write_time = MPI_Wtime();
 #endif
-            ret = write_init (fh, fh->f_aggr_list[aggr_index], aggr_data[aggr_index],
-                              write_chunksize, write_synch_type, &req_iwrite);
+            ret = ompi_request_wait(&write_reqs[slot], MPI_STATUS_IGNORE);
             if (OMPI_SUCCESS != ret){
                 goto exit;
             }
@@ -606,8 +628,12 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
             end_write_time = MPI_Wtime();
             write_time += end_write_time - start_write_time;
 #endif
+            aggr_data[aggr_index]->global_buf = aggr_data[aggr_index]->cycle_bufs[slot];
         }
 
+#if OMPIO_FCOLL_WANT_TIME_BREAKDOWN
+        start_comm_time = MPI_Wtime();
+#endif
         for ( i=0; i<fh->f_num_aggrs; i++ ) {
             ret = shuffle_init ( index, cycles, fh->f_aggr_list[i], fh->f_rank, aggr_data[i],
                                  &reqs[i*(fh->f_procs_per_group + 1)] );
@@ -621,24 +647,19 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
         if (OMPI_SUCCESS != ret){
             goto exit;
         }
+#if OMPIO_FCOLL_WANT_TIME_BREAKDOWN
+        end_comm_time = MPI_Wtime();
+        comm_time += (end_comm_time - start_comm_time);
+#endif
 
-        if(NOT_AGGR_INDEX != aggr_index) {
-            ret = ompi_request_wait(&req_iwrite, MPI_STATUS_IGNORE);
-            if (OMPI_SUCCESS != ret){
-                goto exit;
-            }
-        }
-    } /* end  for (index = 0; index < cycles; index++) */
-
-    if ( cycles > 0 ) {
-        SWAP_AGGR_POINTERS(aggr_data,fh->f_num_aggrs);
+        SWAP_AGGR_POINTERS(aggr_data, fh->f_num_aggrs);
 
         if(NOT_AGGR_INDEX != aggr_index) {
 #if OMPIO_FCOLL_WANT_TIME_BREAKDOWN
             start_write_time = MPI_Wtime();
 #endif
             ret = write_init (fh, fh->f_aggr_list[aggr_index], aggr_data[aggr_index],
-                              write_chunksize, write_synch_type, &req_iwrite);
+                              write_chunksize, write_synch_type, &write_reqs[slot]);
             if (OMPI_SUCCESS != ret){
                 goto exit;
             }
@@ -647,18 +668,27 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
             write_time += end_write_time - start_write_time;
 #endif
         }
+    } /* end  for (index = 0; index < cycles; index++) */
 
-        if(NOT_AGGR_INDEX != aggr_index) {
-            ret = ompi_request_wait(&req_iwrite, MPI_STATUS_IGNORE);
-            if (OMPI_SUCCESS != ret){
-                goto exit;
-            }
+    if(NOT_AGGR_INDEX != aggr_index) {
+#if OMPIO_FCOLL_WANT_TIME_BREAKDOWN
+        start_write_time = MPI_Wtime();
+#endif
+        ret = ompi_request_wait_all (pipeline_depth, write_reqs, MPI_STATUSES_IGNORE);
+        if (OMPI_SUCCESS != ret){
+            goto exit;
         }
+#if OMPIO_FCOLL_WANT_TIME_BREAKDOWN
+        end_write_time = MPI_Wtime();
+        write_time += end_write_time - start_write_time;
+#endif
     }
         
 #if OMPIO_FCOLL_WANT_TIME_BREAKDOWN
     end_exch = MPI_Wtime();
     exch_write += end_exch - start_exch;
+    /* time[0]: posting the writes and stalling on in-flight ones,
+       time[1]: metadata exchange and data shuffle, time[2]: whole exchange/write phase */
     nentry.time[0] = write_time;
     nentry.time[1] = comm_time;
     nentry.time[2] = exch_write;
@@ -677,6 +707,12 @@ int mca_fcoll_vulcan_file_write_all (ompio_file_t *fh,
     
 exit :
     
+    if ( NULL != write_reqs ) {
+        /* do not release the cycle buffers underneath pending writes */
+        ompi_request_wait_all (pipeline_depth, write_reqs, MPI_STATUSES_IGNORE);
+        free (write_reqs);
+    }
+
     if ( NULL != aggr_data ) {
         
         for ( i=0; i< fh->f_num_aggrs; i++ ) {            
@@ -697,8 +733,12 @@ exit :
                 
                 free (aggr_data[i]->disp_index);
                 free (aggr_data[i]->max_disp_index);
-                free (aggr_data[i]->global_buf);
-                free (aggr_data[i]->prev_global_buf);
+                if (NULL != aggr_data[i]->cycle_bufs) {
+                    for (l=0; l<pipeline_depth; l++) {
+                        free (aggr_data[i]->cycle_bufs[l]);
+                    }
+                    free (aggr_data[i]->cycle_bufs);
+                }
                 for(l=0;l<aggr_data[i]->procs_per_group;l++){
                     free (aggr_data[i]->blocklen_per_process[l]);
                     free (aggr_data[i]->displs_per_process[l]);
@@ -718,6 +758,10 @@ exit :
     }
     free(displs);
     free(decoded_iov);
+    if ( 1 == OMPIO_MCA_GET(fh, node_aggregation) ) {
+        /* the memory iovecs of the node aggregator pointed into the segment */
+        mca_common_ompio_node_aggr_release (fh);
+    }
     free(broken_counts);
     free(broken_total_lengths);
     free(broken_iov_counts);
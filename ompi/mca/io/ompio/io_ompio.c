@@ -548,6 +548,21 @@ int mca_io_ompio_get_mca_parameter_value ( char *mca_parameter_name, int name_le
     else if ( !strncmp ( mca_parameter_name, "coll_timing_info", name_length )) {
         return mca_io_ompio_coll_timing_info;
     }
+    else if ( !strncmp ( mca_parameter_name, "node_aggregation", name_length )) {
+        return mca_io_ompio_node_aggregation;
+    }
+    else if ( !strncmp ( mca_parameter_name, "node_aggregation_max_segment", name_length )) {
+        return mca_io_ompio_node_aggregation_max_segment;
+    }
+    else if ( !strncmp ( mca_parameter_name, "cache_size", name_length )) {
+        return mca_io_ompio_cache_size;
+    }
+    else if ( !strncmp ( mca_parameter_name, "cache_page_size", name_length )) {
+        return mca_io_ompio_cache_page_size;
+    }
+    else if ( !strncmp ( mca_parameter_name, "cache_readahead", name_length )) {
+        return mca_io_ompio_cache_readahead;
+    }
     else {
         opal_output (1, "Error in mca_io_ompio_get_mca_parameter_value: unknown parameter name");
     }
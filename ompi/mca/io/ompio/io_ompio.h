@@ -53,6 +53,11 @@ extern int mca_io_ompio_max_aggregators_ratio;
 extern int mca_io_ompio_aggregators_cutoff_threshold;
 extern int mca_io_ompio_overwrite_amode;
 extern int mca_io_ompio_verbose_info_parsing;
+extern int mca_io_ompio_node_aggregation;
+extern int mca_io_ompio_node_aggregation_max_segment;
+extern int mca_io_ompio_cache_size;
+extern int mca_io_ompio_cache_page_size;
+extern int mca_io_ompio_cache_readahead;
 
 OMPI_DECLSPEC extern int mca_io_ompio_coll_timing_info;
 
@@ -63,6 +68,7 @@ OMPI_DECLSPEC extern int mca_io_ompio_coll_timing_info;
  */
 #define OMPIO_PREALLOC_MAX_BUF_SIZE   33554432
 #define OMPIO_DEFAULT_CYCLE_BUF_SIZE  536870912
+#define OMPIO_NODE_AGGR_MAX_SEGMENT   134217728
 #define OMPIO_TAG_GATHER              -100
 #define OMPIO_TAG_GATHERV             -101
 #define OMPIO_TAG_BCAST               -102
@@ -50,6 +50,11 @@ int mca_io_ompio_max_aggregators_ratio=8;
 int mca_io_ompio_aggregators_cutoff_threshold=3;
 int mca_io_ompio_overwrite_amode = 1;
 int mca_io_ompio_verbose_info_parsing = 0;
+int mca_io_ompio_node_aggregation = 0;
+int mca_io_ompio_node_aggregation_max_segment = OMPIO_NODE_AGGR_MAX_SEGMENT;
+int mca_io_ompio_cache_size = 0;
+int mca_io_ompio_cache_page_size = 65536;
+int mca_io_ompio_cache_readahead = 4;
 
 int mca_io_ompio_grouping_option=5;
 
@@ -248,6 +253,60 @@ static int register_component(void)
                                            MCA_BASE_VAR_SCOPE_READONLY,
                                            &mca_io_ompio_overwrite_amode);
 
+    mca_io_ompio_node_aggregation = 0;
+    (void) mca_base_component_var_register(&mca_io_ompio_component.io_version,
+                                           "node_aggregation",
+                                           "Pre-aggregate the data of the processes sharing a node in shared "
+                                           "memory before the shuffle of collective writes "
+                                           "0: disabled (default) "
+                                           "1: enabled ",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_io_ompio_node_aggregation);
+
+    mca_io_ompio_node_aggregation_max_segment = OMPIO_NODE_AGGR_MAX_SEGMENT;
+    (void) mca_base_component_var_register(&mca_io_ompio_component.io_version,
+                                           "node_aggregation_max_segment",
+                                           "Largest shared memory segment in bytes used by node "
+                                           "aggregation. Collective writes with more data per node "
+                                           "skip the node aggregation (default 128MB). Segments "
+                                           "larger than bytes_per_agg are released after each write",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_io_ompio_node_aggregation_max_segment);
+
+    mca_io_ompio_cache_size = 0;
+    (void) mca_base_component_var_register(&mca_io_ompio_component.io_version,
+                                           "cache_size",
+                                           "Size in bytes of the per-process cache used for independent "
+                                           "read and write operations. 0: no cache (default)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_io_ompio_cache_size);
+
+    mca_io_ompio_cache_page_size = 65536;
+    (void) mca_base_component_var_register(&mca_io_ompio_component.io_version,
+                                           "cache_page_size",
+                                           "Size in bytes of a page of the independent I/O cache. "
+                                           "Requests of at least this size bypass the cache (default: 64KB)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_io_ompio_cache_page_size);
+
+    mca_io_ompio_cache_readahead = 4;
+    (void) mca_base_component_var_register(&mca_io_ompio_component.io_version,
+                                           "cache_readahead",
+                                           "Number of pages read ahead by the independent I/O cache "
+                                           "once a sequential access pattern is detected (default: 4)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_io_ompio_cache_readahead);
+
     mca_io_ompio_verbose_info_parsing = 0;
     (void) mca_base_component_var_register(&mca_io_ompio_component.io_version,
                                            "verbose_info_parsing",
@@ -40,6 +40,7 @@
 #include <math.h>
 #include "io_ompio.h"
 #include "ompi/mca/common/ompio/common_ompio_request.h"
+#include "ompi/mca/common/ompio/common_ompio_cache.h"
 #include "ompi/mca/topo/topo.h"
 
 int mca_io_ompio_file_open (ompi_communicator_t *comm,
@@ -211,6 +212,9 @@ int mca_io_ompio_file_preallocate (ompi_file_t *fh,
 
 exit:     
     free ( buf );
+    if ( OMPI_SUCCESS == ret ) {
+        ret = mca_common_ompio_cache_sync (&data->ompio_fh);
+    }
     fh->f_comm->c_coll->coll_bcast ( &ret, 1, MPI_INT, OMPIO_ROOT, fh->f_comm,
                                    fh->f_comm->c_coll->coll_bcast_module);
     
@@ -251,6 +255,13 @@ int mca_io_ompio_file_set_size (ompi_file_t *fh,
         return OMPI_ERROR;
     }
 
+    /* cached pages might extend beyond the new end of the file */
+    ret = mca_common_ompio_cache_sync (&data->ompio_fh);
+    if ( OMPI_SUCCESS != ret ) {
+        OPAL_THREAD_UNLOCK(&fh->f_lock);
+        return ret;
+    }
+
     ret = data->ompio_fh.f_fs->fs_file_set_size (&data->ompio_fh, size);
     if ( OMPI_SUCCESS != ret ) {
         opal_output(1, ",mca_io_ompio_file_set_size: error in fs->set_size\n");
@@ -278,7 +289,10 @@ int mca_io_ompio_file_get_size (ompi_file_t *fh,
 
     data = (mca_common_ompio_data_t *) fh->f_io_selected_data;
     OPAL_THREAD_LOCK(&fh->f_lock);
-    ret = mca_common_ompio_file_get_size(&data->ompio_fh,size);
+    ret = mca_common_ompio_cache_sync (&data->ompio_fh);
+    if ( OMPI_SUCCESS == ret ) {
+        ret = mca_common_ompio_file_get_size(&data->ompio_fh,size);
+    }
     OPAL_THREAD_UNLOCK(&fh->f_lock);
 
     return ret;
@@ -335,6 +349,12 @@ int mca_io_ompio_file_set_atomicity (ompi_file_t *fh,
         return OMPI_ERROR;
     }
 
+    /* operations in atomic mode are not cached */
+    if ( OMPI_SUCCESS != mca_common_ompio_cache_sync (&data->ompio_fh) ) {
+        OPAL_THREAD_UNLOCK(&fh->f_lock);
+        return OMPI_ERROR;
+    }
+
     data->ompio_fh.f_atomicity = flag;
     OPAL_THREAD_UNLOCK(&fh->f_lock);
 
@@ -368,6 +388,13 @@ int mca_io_ompio_file_sync (ompi_file_t *fh)
         return MPI_ERR_OTHER;
     }
 
+    /* write back the cached data and forget what was read so far */
+    ret = mca_common_ompio_cache_sync (&data->ompio_fh);
+    if ( OMPI_SUCCESS != ret ) {
+        OPAL_THREAD_UNLOCK(&fh->f_lock);
+        return ret;
+    }
+
     if ( data->ompio_fh.f_amode & MPI_MODE_RDONLY ) {
         OPAL_THREAD_UNLOCK(&fh->f_lock);
         return MPI_ERR_ACCESS;
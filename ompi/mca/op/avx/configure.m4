@@ -0,0 +1,116 @@
+# -*- shell-script -*-
+#
+# Copyright (c) 2019-2020 The University of Tennessee and The University
+#                         of Tennessee Research Foundation.  All rights
+#                         reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+# _MCA_ompi_op_avx_CHECK_FLAGS(name, flags, test-program, [action-if-ok], [action-if-not-ok])
+# -------------------------------------------------------------------------------------------
+# Check whether the compiler can build test-program, first without any
+# extra flags and then with the candidate flags.  On success,
+# op_avx_<name>_flags is set to the flags (possibly empty) that were
+# needed.
+AC_DEFUN([_MCA_ompi_op_avx_CHECK_FLAGS],[
+    OPAL_VAR_SCOPE_PUSH([op_avx_cflags_save])
+    op_avx_cflags_save="$CFLAGS"
+    op_avx_$1_flags=
+    op_avx_$1_ok=0
+
+    AC_MSG_CHECKING([for $1 support (no additional flags)])
+    AC_LINK_IFELSE([AC_LANG_PROGRAM([[#include <immintrin.h>]], [$3])],
+                   [op_avx_$1_ok=1
+                    AC_MSG_RESULT([yes])],
+                   [AC_MSG_RESULT([no])])
+
+    AS_IF([test $op_avx_$1_ok -eq 0],
+          [AC_MSG_CHECKING([for $1 support (with $2)])
+           CFLAGS="$op_avx_cflags_save $2"
+           AC_LINK_IFELSE([AC_LANG_PROGRAM([[#include <immintrin.h>]], [$3])],
+                          [op_avx_$1_ok=1
+                           op_avx_$1_flags="$2"
+                           AC_MSG_RESULT([yes])],
+                          [AC_MSG_RESULT([no])])
+           CFLAGS="$op_avx_cflags_save"])
+
+    AS_IF([test $op_avx_$1_ok -eq 1], [$4], [$5])
+    OPAL_VAR_SCOPE_POP
+])
+
+# MCA_ompi_op_avx_CONFIG([action-if-can-compile],
+#                        [action-if-cant-compile])
+# ------------------------------------------------
+# Check for the compiler support of the AVX2 and AVX-512 intrinsics.
+# Each instruction set is compiled into its own convenience library
+# with the corresponding compiler flags; the decision of which one to
+# use is deferred to run-time, when the processor capabilities are
+# known.
+AC_DEFUN([MCA_ompi_op_avx_CONFIG],[
+    AC_CONFIG_FILES([ompi/mca/op/avx/Makefile])
+
+    op_avx_support=0
+    op_avx2_support=0
+    op_avx512_support=0
+
+    AC_ARG_ENABLE([op-avx],
+                  [AS_HELP_STRING([--disable-op-avx],
+                                  [Disable the AVX2/AVX-512 vectorized MPI_Op component (default: enabled when supported by the compiler)])])
+
+    AS_IF([test "$enable_op_avx" != "no"],
+          [case "${host}" in
+               x86_64-*|i?86-*)
+                   op_avx_support=1
+                   ;;
+               *)
+                   AC_MSG_NOTICE([op:avx: not an x86 platform; skipping])
+                   ;;
+           esac])
+
+    AS_IF([test $op_avx_support -eq 1],
+          [_MCA_ompi_op_avx_CHECK_FLAGS([avx512],
+               [-mavx512f -mavx512bw -mavx512dq],
+               [[__m512i vA = _mm512_loadu_si512((void*)0);
+                 __m512i vB = _mm512_mullo_epi64(vA, _mm512_max_epu8(vA, vA));
+                 _mm512_storeu_si512((void*)0, vB);]],
+               [op_avx512_support=1])
+           _MCA_ompi_op_avx_CHECK_FLAGS([avx2],
+               [-mavx2],
+               [[__m256i vA = _mm256_loadu_si256((__m256i*)0);
+                 __m256i vB = _mm256_mullo_epi32(vA, _mm256_max_epu8(vA, vA));
+                 __m256d vC = _mm256_add_pd(_mm256_loadu_pd((double*)0), _mm256_setzero_pd());
+                 _mm256_storeu_si256((__m256i*)0, vB);
+                 _mm256_storeu_pd((double*)0, vC);]],
+               [op_avx2_support=1])])
+
+    AC_SUBST([MCA_BUILD_OP_AVX512_FLAGS], ["$op_avx_avx512_flags"])
+    AC_SUBST([MCA_BUILD_OP_AVX2_FLAGS], ["$op_avx_avx2_flags"])
+
+    AS_IF([test $op_avx512_support -eq 1 || test $op_avx2_support -eq 1],
+          [$1],
+          [$2])
+])dnl
+
+# MCA_ompi_op_avx_POST_CONFIG([should_build])
+# -------------------------------------------
+# The conditionals must be defined regardless of whether the component
+# is built.
+AC_DEFUN([MCA_ompi_op_avx_POST_CONFIG],[
+    AM_CONDITIONAL([MCA_BUILD_ompi_op_has_avx512_support],
+                   [test "$1" = "1" && test "$op_avx512_support" = "1"])
+    AM_CONDITIONAL([MCA_BUILD_ompi_op_has_avx2_support],
+                   [test "$1" = "1" && test "$op_avx2_support" = "1"])
+    AS_IF([test "$1" = "1"],
+          [AC_DEFINE_UNQUOTED([OMPI_MCA_OP_HAVE_AVX512], [$op_avx512_support],
+                              [Whether the op/avx component was built with AVX-512 support])
+           AC_DEFINE_UNQUOTED([OMPI_MCA_OP_HAVE_AVX2], [$op_avx2_support],
+                              [Whether the op/avx component was built with AVX2 support])],
+          [AC_DEFINE([OMPI_MCA_OP_HAVE_AVX512], [0],
+                     [Whether the op/avx component was built with AVX-512 support])
+           AC_DEFINE([OMPI_MCA_OP_HAVE_AVX2], [0],
+                     [Whether the op/avx component was built with AVX2 support])])
+])dnl
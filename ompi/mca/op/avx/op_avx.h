@@ -0,0 +1,76 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2019-2020 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef MCA_OP_AVX_EXPORT_H
+#define MCA_OP_AVX_EXPORT_H
+
+#include "ompi_config.h"
+
+#include "ompi/mca/mca.h"
+#include "opal/class/opal_object.h"
+
+#include "ompi/mca/op/op.h"
+
+BEGIN_C_DECLS
+
+/**
+ * Processor capabilities detected at run-time (and used as a bitmask
+ * by the "support" MCA parameter).
+ */
+#define OMPI_OP_AVX_HAS_AVX2_FLAG     0x00000001
+#define OMPI_OP_AVX_HAS_AVX512_FLAG   0x00000002
+
+/**
+ * Derive a struct from the base op component struct, allowing us to
+ * cache some component-specific information on our well-known
+ * component struct.
+ */
+typedef struct {
+    /** The base op component struct */
+    ompi_op_base_component_1_0_0_t super;
+
+    /** Capabilities of the processor we are running on */
+    uint32_t flags;
+    /** Capabilities the user allows us to use (subset of flags) */
+    int32_t supported;
+    /** Priority of the component when selected */
+    int priority;
+} ompi_op_avx_component_t;
+
+/**
+ * Globally exported variable.  Note that it is an *avx* component
+ * (defined above), which has the ompi_op_base_component_t as its
+ * first member.
+ */
+OMPI_DECLSPEC extern ompi_op_avx_component_t mca_op_avx_component;
+
+/**
+ * Function tables generated from op_avx_functions.c, one pair per
+ * instruction set.  Entries are NULL for the (op, type) pairs that
+ * are not vectorized for a given instruction set.
+ */
+#if OMPI_MCA_OP_HAVE_AVX512
+extern ompi_op_base_handler_fn_t
+    ompi_op_avx_functions_avx512[OMPI_OP_BASE_FORTRAN_OP_MAX][OMPI_OP_BASE_TYPE_MAX];
+extern ompi_op_base_3buff_handler_fn_t
+    ompi_op_avx_3buff_functions_avx512[OMPI_OP_BASE_FORTRAN_OP_MAX][OMPI_OP_BASE_TYPE_MAX];
+#endif  /* OMPI_MCA_OP_HAVE_AVX512 */
+#if OMPI_MCA_OP_HAVE_AVX2
+extern ompi_op_base_handler_fn_t
+    ompi_op_avx_functions_avx2[OMPI_OP_BASE_FORTRAN_OP_MAX][OMPI_OP_BASE_TYPE_MAX];
+extern ompi_op_base_3buff_handler_fn_t
+    ompi_op_avx_3buff_functions_avx2[OMPI_OP_BASE_FORTRAN_OP_MAX][OMPI_OP_BASE_TYPE_MAX];
+#endif  /* OMPI_MCA_OP_HAVE_AVX2 */
+
+END_C_DECLS
+
+#endif /* MCA_OP_AVX_EXPORT_H */
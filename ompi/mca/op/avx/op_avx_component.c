@@ -0,0 +1,261 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2019-2020 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * This is the "avx" component source code.  It provides vectorized
+ * versions of the MAX, MIN, SUM, PROD, BAND, BOR and BXOR reductions
+ * for the C integer and floating point types, using the best
+ * instruction set (AVX-512 or AVX2) supported by both the compiler
+ * (checked at configure time) and the processor (checked at run-time
+ * with cpuid).
+ */
+
+#include "ompi_config.h"
+
+#include "opal/util/output.h"
+
+#include "ompi/constants.h"
+#include "ompi/op/op.h"
+#include "ompi/mca/op/op.h"
+#include "ompi/mca/op/base/base.h"
+#include "ompi/mca/op/avx/op_avx.h"
+
+static int avx_component_open(void);
+static int avx_component_close(void);
+static int avx_component_init_query(bool enable_progress_threads,
+                                    bool enable_mpi_thread_multiple);
+static struct ompi_op_base_module_1_0_0_t *
+    avx_component_op_query(struct ompi_op_t *op, int *priority);
+static int avx_component_register(void);
+
+ompi_op_avx_component_t mca_op_avx_component = {
+    {
+        .opc_version = {
+            OMPI_OP_BASE_VERSION_1_0_0,
+
+            .mca_component_name = "avx",
+            MCA_BASE_MAKE_VERSION(component, OMPI_MAJOR_VERSION, OMPI_MINOR_VERSION,
+                                  OMPI_RELEASE_VERSION),
+            .mca_open_component = avx_component_open,
+            .mca_close_component = avx_component_close,
+            .mca_register_component_params = avx_component_register,
+        },
+        .opc_data = {
+            /* The component is checkpoint ready */
+            MCA_BASE_METADATA_PARAM_CHECKPOINT
+        },
+
+        .opc_init_query = avx_component_init_query,
+        .opc_op_query = avx_component_op_query,
+    },
+};
+
+/*
+ * Query the processor for the instruction sets we know how to use.
+ * Beside the cpuid feature bits, the operating system must have
+ * enabled the saving of the corresponding register state (checked
+ * through xgetbv), otherwise the instructions will fault.
+ */
+static uint32_t avx_component_detect_features(void)
+{
+    uint32_t flags = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t eax, ebx, ecx, edx, xcr0_lo, xcr0_hi;
+
+    __asm__ __volatile__ ("cpuid"
+                          : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                          : "a" (0), "c" (0));
+    if (eax < 7) {
+        return 0;
+    }
+
+    __asm__ __volatile__ ("cpuid"
+                          : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                          : "a" (1), "c" (0));
+    /* OSXSAVE and AVX */
+    if ((ecx & ((1U << 27) | (1U << 28))) != ((1U << 27) | (1U << 28))) {
+        return 0;
+    }
+
+    __asm__ __volatile__ ("xgetbv"
+                          : "=a" (xcr0_lo), "=d" (xcr0_hi)
+                          : "c" (0));
+    /* The OS must save the XMM and YMM registers */
+    if ((xcr0_lo & 0x6) != 0x6) {
+        return 0;
+    }
+
+    __asm__ __volatile__ ("cpuid"
+                          : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                          : "a" (7), "c" (0));
+    if (ebx & (1U << 5)) {
+        flags |= OMPI_OP_AVX_HAS_AVX2_FLAG;
+    }
+    /* AVX512F (bit 16), AVX512DQ (bit 17) and AVX512BW (bit 30), and
+       the OS must save the opmask and ZMM registers */
+    if ((ebx & ((1U << 16) | (1U << 17) | (1U << 30))) == ((1U << 16) | (1U << 17) | (1U << 30)) &&
+        (xcr0_lo & 0xe0) == 0xe0) {
+        flags |= OMPI_OP_AVX_HAS_AVX512_FLAG;
+    }
+#endif  /* defined(__x86_64__) || defined(__i386__) */
+    return flags;
+}
+
+/*
+ * Component open
+ */
+static int avx_component_open(void)
+{
+    return OMPI_SUCCESS;
+}
+
+/*
+ * Component close
+ */
+static int avx_component_close(void)
+{
+    return OMPI_SUCCESS;
+}
+
+/*
+ * Register MCA params.
+ */
+static int avx_component_register(void)
+{
+    uint32_t compiled = 0;
+
+#if OMPI_MCA_OP_HAVE_AVX512
+    compiled |= OMPI_OP_AVX_HAS_AVX512_FLAG;
+#endif
+#if OMPI_MCA_OP_HAVE_AVX2
+    compiled |= OMPI_OP_AVX_HAS_AVX2_FLAG;
+#endif
+    /* Only advertise what both the compiler and the processor support */
+    mca_op_avx_component.flags = avx_component_detect_features() & compiled;
+    mca_op_avx_component.supported = (int32_t) mca_op_avx_component.flags;
+
+    (void) mca_base_component_var_register(&mca_op_avx_component.super.opc_version,
+                                           "capabilities",
+                                           "Level of vectorization supported by the processor and by this build "
+                                           "(bitmask: 1 = AVX2, 2 = AVX-512)",
+                                           MCA_BASE_VAR_TYPE_UNSIGNED_INT, NULL, 0,
+                                           MCA_BASE_VAR_FLAG_DEFAULT_ONLY,
+                                           OPAL_INFO_LVL_4,
+                                           MCA_BASE_VAR_SCOPE_CONSTANT,
+                                           &mca_op_avx_component.flags);
+
+    (void) mca_base_component_var_register(&mca_op_avx_component.super.opc_version,
+                                           "support",
+                                           "Level of vectorization allowed for the reduction operations "
+                                           "(bitmask: 1 = AVX2, 2 = AVX-512). Only the levels also present "
+                                           "in op_avx_capabilities are used",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_4,
+                                           MCA_BASE_VAR_SCOPE_LOCAL,
+                                           &mca_op_avx_component.supported);
+
+    mca_op_avx_component.priority = 50;
+    (void) mca_base_component_var_register(&mca_op_avx_component.super.opc_version,
+                                           "priority",
+                                           "Priority of the avx op component",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           OPAL_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_op_avx_component.priority);
+
+    return OMPI_SUCCESS;
+}
+
+/*
+ * Query whether this component wants to be used in this process.
+ */
+static int avx_component_init_query(bool enable_progress_threads,
+                                    bool enable_mpi_thread_multiple)
+{
+    /* The functions are stateless, so there is no restriction on the
+       threading level. */
+    mca_op_avx_component.supported &= (int32_t) mca_op_avx_component.flags;
+    if (0 == mca_op_avx_component.supported) {
+        return OMPI_ERR_NOT_SUPPORTED;
+    }
+
+    opal_output_verbose(10, ompi_op_base_framework.framework_output,
+                        "op:avx: using%s%s",
+                        (mca_op_avx_component.supported & OMPI_OP_AVX_HAS_AVX512_FLAG) ? " AVX-512" : "",
+                        (mca_op_avx_component.supported & OMPI_OP_AVX_HAS_AVX2_FLAG) ? " AVX2" : "");
+    return OMPI_SUCCESS;
+}
+
+/*
+ * Query whether this component can be used for a specific op.  For
+ * each datatype, pick the function from the widest instruction set
+ * allowed; the types without a vectorized function keep the base (or
+ * any other component's) function.
+ */
+static struct ompi_op_base_module_1_0_0_t *
+    avx_component_op_query(struct ompi_op_t *op, int *priority)
+{
+    ompi_op_base_module_t *module = NULL;
+    bool found = false;
+    int i;
+
+    /* Sanity check -- the framework should never invoke the
+       _component_op_query() on non-intrinsic MPI_Op's */
+    if (0 == (OMPI_OP_FLAGS_INTRINSIC & op->o_flags)) {
+        return NULL;
+    }
+
+    switch (op->o_f_to_c_index) {
+    case OMPI_OP_BASE_FORTRAN_MAX:
+    case OMPI_OP_BASE_FORTRAN_MIN:
+    case OMPI_OP_BASE_FORTRAN_SUM:
+    case OMPI_OP_BASE_FORTRAN_PROD:
+    case OMPI_OP_BASE_FORTRAN_BAND:
+    case OMPI_OP_BASE_FORTRAN_BOR:
+    case OMPI_OP_BASE_FORTRAN_BXOR:
+        break;
+    default:
+        return NULL;
+    }
+
+    module = OBJ_NEW(ompi_op_base_module_t);
+    for (i = 0; i < OMPI_OP_BASE_TYPE_MAX; ++i) {
+#if OMPI_MCA_OP_HAVE_AVX512
+        if (mca_op_avx_component.supported & OMPI_OP_AVX_HAS_AVX512_FLAG) {
+            module->opm_fns[i] = ompi_op_avx_functions_avx512[op->o_f_to_c_index][i];
+            module->opm_3buff_fns[i] = ompi_op_avx_3buff_functions_avx512[op->o_f_to_c_index][i];
+        }
+#endif  /* OMPI_MCA_OP_HAVE_AVX512 */
+#if OMPI_MCA_OP_HAVE_AVX2
+        if (mca_op_avx_component.supported & OMPI_OP_AVX_HAS_AVX2_FLAG) {
+            if (NULL == module->opm_fns[i]) {
+                module->opm_fns[i] = ompi_op_avx_functions_avx2[op->o_f_to_c_index][i];
+            }
+            if (NULL == module->opm_3buff_fns[i]) {
+                module->opm_3buff_fns[i] = ompi_op_avx_3buff_functions_avx2[op->o_f_to_c_index][i];
+            }
+        }
+#endif  /* OMPI_MCA_OP_HAVE_AVX2 */
+        if (NULL != module->opm_fns[i] || NULL != module->opm_3buff_fns[i]) {
+            found = true;
+        }
+    }
+
+    if (!found) {
+        OBJ_RELEASE(module);
+        return NULL;
+    }
+
+    *priority = mca_op_avx_component.priority;
+    return module;
+}
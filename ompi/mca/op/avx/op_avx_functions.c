@@ -0,0 +1,313 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2019-2020 The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * Vectorized versions of the predefined reductions.  This file is
+ * compiled once per instruction set (see Makefile.am), with either
+ * GENERATE_AVX512_CODE or GENERATE_AVX2_CODE defined, and with the
+ * compiler flags that enable the corresponding intrinsics.  Each
+ * compilation exports a pair of function tables (2-buffer and
+ * 3-buffer) named after the instruction set, laid out exactly like
+ * ompi_op_base_functions.
+ *
+ * The processor capabilities are *not* checked here; the component
+ * only hands out these functions after checking at run-time that the
+ * processor supports the corresponding instructions.
+ */
+
+#include "ompi_config.h"
+
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#include <immintrin.h>
+
+#include "ompi/mca/op/op.h"
+#include "ompi/mca/op/avx/op_avx.h"
+
+#define OP_CONCAT_NX(A, B) A ## _ ## B
+#define OP_CONCAT(A, B) OP_CONCAT_NX(A, B)
+
+#if defined(GENERATE_AVX512_CODE)
+#define PREPEND avx512
+#define ISA(name) _mm512_ ## name
+#define VEC_INT __m512i
+#define VEC_FLOAT __m512
+#define VEC_DOUBLE __m512d
+#define LOAD_INT(p) _mm512_loadu_si512((const void *) (p))
+#define STORE_INT(p, v) _mm512_storeu_si512((void *) (p), (v))
+#define LOAD_FLOAT(p) _mm512_loadu_ps((const void *) (p))
+#define STORE_FLOAT(p, v) _mm512_storeu_ps((void *) (p), (v))
+#define LOAD_DOUBLE(p) _mm512_loadu_pd((const void *) (p))
+#define STORE_DOUBLE(p, v) _mm512_storeu_pd((void *) (p), (v))
+#define AND_INT _mm512_and_si512
+#define OR_INT _mm512_or_si512
+#define XOR_INT _mm512_xor_si512
+#elif defined(GENERATE_AVX2_CODE)
+#define PREPEND avx2
+#define ISA(name) _mm256_ ## name
+#define VEC_INT __m256i
+#define VEC_FLOAT __m256
+#define VEC_DOUBLE __m256d
+#define LOAD_INT(p) _mm256_loadu_si256((const __m256i *) (p))
+#define STORE_INT(p, v) _mm256_storeu_si256((__m256i *) (p), (v))
+#define LOAD_FLOAT(p) _mm256_loadu_ps((const float *) (p))
+#define STORE_FLOAT(p, v) _mm256_storeu_ps((float *) (p), (v))
+#define LOAD_DOUBLE(p) _mm256_loadu_pd((const double *) (p))
+#define STORE_DOUBLE(p, v) _mm256_storeu_pd((double *) (p), (v))
+#define AND_INT _mm256_and_si256
+#define OR_INT _mm256_or_si256
+#define XOR_INT _mm256_xor_si256
+#else
+#error "op_avx_functions.c must be compiled with GENERATE_AVX512_CODE or GENERATE_AVX2_CODE"
+#endif
+
+/*
+ * Scalar versions of the operations, used for the elements left over
+ * after the last full vector.  The argument order (out, in) matches
+ * the base functions, which matters for MIN/MAX in the presence of
+ * NaNs: the vector min/max instructions return their second operand
+ * when the comparison fails, exactly like the expressions below.
+ */
+#define OP_SUM(a, b)  ((a) + (b))
+#define OP_PROD(a, b) ((a) * (b))
+#define OP_MAX(a, b)  ((a) > (b) ? (a) : (b))
+#define OP_MIN(a, b)  ((a) < (b) ? (a) : (b))
+#define OP_BAND(a, b) ((a) & (b))
+#define OP_BOR(a, b)  ((a) | (b))
+#define OP_BXOR(a, b) ((a) ^ (b))
+
+/*
+ * Since all the functions in this file are essentially identical, we
+ * use a macro to substitute in names and types.  Each use of the
+ * macro generates both the 2-buffer (out = op(out, in)) and the
+ * 3-buffer (out = op(in1, in2)) versions of the function.
+ */
+#define OP_AVX_FUNC(name, type_name, type, vtype, load, store, vop, sop) \
+    static void OP_CONCAT(ompi_op_avx_2buff_##name##_##type_name, PREPEND)(void *_in, void *_out, int *count, \
+                                                                          struct ompi_datatype_t **dtype, \
+                                                                          struct ompi_op_base_module_1_0_0_t *module) \
+    {                                                                   \
+        const int types_per_step = sizeof(vtype) / sizeof(type);       \
+        int left_over = *count;                                         \
+        type *in = (type *) _in;                                        \
+        type *out = (type *) _out;                                      \
+        for (; left_over >= types_per_step; left_over -= types_per_step) { \
+            vtype vecA = load(in);                                      \
+            vtype vecB = load(out);                                     \
+            store(out, vop(vecB, vecA));                                \
+            in += types_per_step;                                       \
+            out += types_per_step;                                      \
+        }                                                               \
+        for (; left_over > 0; --left_over, ++in, ++out) {               \
+            *out = sop(*out, *in);                                      \
+        }                                                               \
+    }                                                                   \
+    static void OP_CONCAT(ompi_op_avx_3buff_##name##_##type_name, PREPEND)(void * restrict _in1, \
+                                                                          void * restrict _in2, \
+                                                                          void * restrict _out, int *count, \
+                                                                          struct ompi_datatype_t **dtype, \
+                                                                          struct ompi_op_base_module_1_0_0_t *module) \
+    {                                                                   \
+        const int types_per_step = sizeof(vtype) / sizeof(type);       \
+        int left_over = *count;                                         \
+        type *in1 = (type *) _in1;                                      \
+        type *in2 = (type *) _in2;                                      \
+        type *out = (type *) _out;                                      \
+        for (; left_over >= types_per_step; left_over -= types_per_step) { \
+            vtype vecA = load(in1);                                     \
+            vtype vecB = load(in2);                                     \
+            store(out, vop(vecA, vecB));                                \
+            in1 += types_per_step;                                      \
+            in2 += types_per_step;                                      \
+            out += types_per_step;                                      \
+        }                                                               \
+        for (; left_over > 0; --left_over, ++in1, ++in2, ++out) {       \
+            *out = sop(*in1, *in2);                                     \
+        }                                                               \
+    }
+
+#define OP_AVX_INT_FUNC(name, type, vop, sop) \
+    OP_AVX_FUNC(name, type, type, VEC_INT, LOAD_INT, STORE_INT, vop, sop)
+#define OP_AVX_FLOAT_FUNC(name, vop, sop) \
+    OP_AVX_FUNC(name, float, float, VEC_FLOAT, LOAD_FLOAT, STORE_FLOAT, vop, sop)
+#define OP_AVX_DOUBLE_FUNC(name, vop, sop) \
+    OP_AVX_FUNC(name, double, double, VEC_DOUBLE, LOAD_DOUBLE, STORE_DOUBLE, vop, sop)
+
+/*************************************************************************
+ * Max
+ *************************************************************************/
+
+OP_AVX_INT_FUNC(max, int8_t, ISA(max_epi8), OP_MAX)
+OP_AVX_INT_FUNC(max, uint8_t, ISA(max_epu8), OP_MAX)
+OP_AVX_INT_FUNC(max, int16_t, ISA(max_epi16), OP_MAX)
+OP_AVX_INT_FUNC(max, uint16_t, ISA(max_epu16), OP_MAX)
+OP_AVX_INT_FUNC(max, int32_t, ISA(max_epi32), OP_MAX)
+OP_AVX_INT_FUNC(max, uint32_t, ISA(max_epu32), OP_MAX)
+#if defined(GENERATE_AVX512_CODE)
+OP_AVX_INT_FUNC(max, int64_t, ISA(max_epi64), OP_MAX)
+OP_AVX_INT_FUNC(max, uint64_t, ISA(max_epu64), OP_MAX)
+#endif
+OP_AVX_FLOAT_FUNC(max, ISA(max_ps), OP_MAX)
+OP_AVX_DOUBLE_FUNC(max, ISA(max_pd), OP_MAX)
+
+/*************************************************************************
+ * Min
+ *************************************************************************/
+
+OP_AVX_INT_FUNC(min, int8_t, ISA(min_epi8), OP_MIN)
+OP_AVX_INT_FUNC(min, uint8_t, ISA(min_epu8), OP_MIN)
+OP_AVX_INT_FUNC(min, int16_t, ISA(min_epi16), OP_MIN)
+OP_AVX_INT_FUNC(min, uint16_t, ISA(min_epu16), OP_MIN)
+OP_AVX_INT_FUNC(min, int32_t, ISA(min_epi32), OP_MIN)
+OP_AVX_INT_FUNC(min, uint32_t, ISA(min_epu32), OP_MIN)
+#if defined(GENERATE_AVX512_CODE)
+OP_AVX_INT_FUNC(min, int64_t, ISA(min_epi64), OP_MIN)
+OP_AVX_INT_FUNC(min, uint64_t, ISA(min_epu64), OP_MIN)
+#endif
+OP_AVX_FLOAT_FUNC(min, ISA(min_ps), OP_MIN)
+OP_AVX_DOUBLE_FUNC(min, ISA(min_pd), OP_MIN)
+
+/*************************************************************************
+ * Sum
+ *************************************************************************/
+
+OP_AVX_INT_FUNC(sum, int8_t, ISA(add_epi8), OP_SUM)
+OP_AVX_INT_FUNC(sum, uint8_t, ISA(add_epi8), OP_SUM)
+OP_AVX_INT_FUNC(sum, int16_t, ISA(add_epi16), OP_SUM)
+OP_AVX_INT_FUNC(sum, uint16_t, ISA(add_epi16), OP_SUM)
+OP_AVX_INT_FUNC(sum, int32_t, ISA(add_epi32), OP_SUM)
+OP_AVX_INT_FUNC(sum, uint32_t, ISA(add_epi32), OP_SUM)
+OP_AVX_INT_FUNC(sum, int64_t, ISA(add_epi64), OP_SUM)
+OP_AVX_INT_FUNC(sum, uint64_t, ISA(add_epi64), OP_SUM)
+OP_AVX_FLOAT_FUNC(sum, ISA(add_ps), OP_SUM)
+OP_AVX_DOUBLE_FUNC(sum, ISA(add_pd), OP_SUM)
+
+/*************************************************************************
+ * Product
+ *
+ * There is no 8 bits multiplication in either instruction set, and
+ * the 64 bits one requires AVX-512DQ.
+ *************************************************************************/
+
+OP_AVX_INT_FUNC(prod, int16_t, ISA(mullo_epi16), OP_PROD)
+OP_AVX_INT_FUNC(prod, uint16_t, ISA(mullo_epi16), OP_PROD)
+OP_AVX_INT_FUNC(prod, int32_t, ISA(mullo_epi32), OP_PROD)
+OP_AVX_INT_FUNC(prod, uint32_t, ISA(mullo_epi32), OP_PROD)
+#if defined(GENERATE_AVX512_CODE)
+OP_AVX_INT_FUNC(prod, int64_t, ISA(mullo_epi64), OP_PROD)
+OP_AVX_INT_FUNC(prod, uint64_t, ISA(mullo_epi64), OP_PROD)
+#endif
+OP_AVX_FLOAT_FUNC(prod, ISA(mul_ps), OP_PROD)
+OP_AVX_DOUBLE_FUNC(prod, ISA(mul_pd), OP_PROD)
+
+/*************************************************************************
+ * Bitwise AND, OR and XOR
+ *
+ * The bitwise operations do not care about the element size, but we
+ * need one function per type to handle the left over elements.
+ *************************************************************************/
+
+#define OP_AVX_BIT_FUNCS(name, vop, sop)        \
+    OP_AVX_INT_FUNC(name, int8_t, vop, sop)     \
+    OP_AVX_INT_FUNC(name, uint8_t, vop, sop)    \
+    OP_AVX_INT_FUNC(name, int16_t, vop, sop)    \
+    OP_AVX_INT_FUNC(name, uint16_t, vop, sop)   \
+    OP_AVX_INT_FUNC(name, int32_t, vop, sop)    \
+    OP_AVX_INT_FUNC(name, uint32_t, vop, sop)   \
+    OP_AVX_INT_FUNC(name, int64_t, vop, sop)    \
+    OP_AVX_INT_FUNC(name, uint64_t, vop, sop)
+
+OP_AVX_BIT_FUNCS(band, AND_INT, OP_BAND)
+OP_AVX_BIT_FUNCS(bor, OR_INT, OP_BOR)
+OP_AVX_BIT_FUNCS(bxor, XOR_INT, OP_BXOR)
+
+/*************************************************************************
+ * Function tables
+ *************************************************************************/
+
+#define C_INTEGER_8(name, ftype)                                                          \
+    [OMPI_OP_BASE_TYPE_INT8_T] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_int8_t, PREPEND),   \
+    [OMPI_OP_BASE_TYPE_UINT8_T] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_uint8_t, PREPEND)
+#define C_INTEGER_16(name, ftype)                                                         \
+    [OMPI_OP_BASE_TYPE_INT16_T] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_int16_t, PREPEND), \
+    [OMPI_OP_BASE_TYPE_UINT16_T] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_uint16_t, PREPEND)
+#define C_INTEGER_32(name, ftype)                                                         \
+    [OMPI_OP_BASE_TYPE_INT32_T] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_int32_t, PREPEND), \
+    [OMPI_OP_BASE_TYPE_UINT32_T] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_uint32_t, PREPEND)
+#define C_INTEGER_64(name, ftype)                                                         \
+    [OMPI_OP_BASE_TYPE_INT64_T] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_int64_t, PREPEND), \
+    [OMPI_OP_BASE_TYPE_UINT64_T] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_uint64_t, PREPEND)
+#define C_INTEGER(name, ftype) \
+    C_INTEGER_8(name, ftype),  \
+    C_INTEGER_16(name, ftype), \
+    C_INTEGER_32(name, ftype), \
+    C_INTEGER_64(name, ftype)
+#define FLOATING_POINT(name, ftype)                                                       \
+    [OMPI_OP_BASE_TYPE_FLOAT] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_float, PREPEND),     \
+    [OMPI_OP_BASE_TYPE_DOUBLE] = OP_CONCAT(ompi_op_avx_##ftype##_##name##_double, PREPEND)
+
+#define OP_AVX_TABLE(ftype)                                     \
+    {                                                           \
+        [OMPI_OP_BASE_FORTRAN_MAX] = {                          \
+            C_INTEGER_8(max, ftype),                            \
+            C_INTEGER_16(max, ftype),                           \
+            C_INTEGER_32(max, ftype),                           \
+            OP_AVX_INTEGER_64_IF_AVX512(max, ftype)             \
+            FLOATING_POINT(max, ftype),                         \
+        },                                                      \
+        [OMPI_OP_BASE_FORTRAN_MIN] = {                          \
+            C_INTEGER_8(min, ftype),                            \
+            C_INTEGER_16(min, ftype),                           \
+            C_INTEGER_32(min, ftype),                           \
+            OP_AVX_INTEGER_64_IF_AVX512(min, ftype)             \
+            FLOATING_POINT(min, ftype),                         \
+        },                                                      \
+        [OMPI_OP_BASE_FORTRAN_SUM] = {                          \
+            C_INTEGER(sum, ftype),                              \
+            FLOATING_POINT(sum, ftype),                         \
+        },                                                      \
+        [OMPI_OP_BASE_FORTRAN_PROD] = {                         \
+            C_INTEGER_16(prod, ftype),                          \
+            C_INTEGER_32(prod, ftype),                          \
+            OP_AVX_INTEGER_64_IF_AVX512(prod, ftype)            \
+            FLOATING_POINT(prod, ftype),                        \
+        },                                                      \
+        [OMPI_OP_BASE_FORTRAN_BAND] = {                         \
+            C_INTEGER(band, ftype),                             \
+        },                                                      \
+        [OMPI_OP_BASE_FORTRAN_BOR] = {                          \
+            C_INTEGER(bor, ftype),                              \
+        },                                                      \
+        [OMPI_OP_BASE_FORTRAN_BXOR] = {                         \
+            C_INTEGER(bxor, ftype),                             \
+        },                                                      \
+    }
+
+/* The 64 bits MIN, MAX and PROD are only available with AVX-512 */
+#if defined(GENERATE_AVX512_CODE)
+#define OP_AVX_INTEGER_64_IF_AVX512(name, ftype) C_INTEGER_64(name, ftype),
+#else
+#define OP_AVX_INTEGER_64_IF_AVX512(name, ftype)
+#endif
+
+/* All the entries not explicitly listed are NULL, meaning that the
+   corresponding function from a lower instruction set (or from the
+   base) will be used instead. */
+ompi_op_base_handler_fn_t
+OP_CONCAT(ompi_op_avx_functions, PREPEND)[OMPI_OP_BASE_FORTRAN_OP_MAX][OMPI_OP_BASE_TYPE_MAX] =
+    OP_AVX_TABLE(2buff);
+
+ompi_op_base_3buff_handler_fn_t
+OP_CONCAT(ompi_op_avx_3buff_functions, PREPEND)[OMPI_OP_BASE_FORTRAN_OP_MAX][OMPI_OP_BASE_TYPE_MAX] =
+    OP_AVX_TABLE(3buff);
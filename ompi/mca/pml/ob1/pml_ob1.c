@@ -596,7 +596,7 @@ int mca_pml_ob1_dump(struct ompi_communicator_t* comm, int verbose)
 
     /* TODO: don't forget to dump mca_pml_ob1.non_existing_communicator_pending */
 
-    opal_output(0, "Communicator %s [%p](%d) rank %d recv_seq %d num_procs %lu last_probed %lu\n",
+    opal_output(0, "Communicator %s [%p](%d) rank %d recv_seq %u num_procs %lu last_probed %lu\n",
                 comm->c_name, (void*) comm, comm->c_contextid, comm->c_my_rank,
                 pml_comm->recv_sequence, pml_comm->num_procs, pml_comm->last_probed);
 
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2018 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -61,6 +61,9 @@ struct mca_pml_ob1_t {
     int max_rdma_per_request;
     int max_send_per_range;
     bool use_all_rdma;
+    bool partitioned_matching;
+    int match_engine;
+    int match_isa;
 
     /* lock queue access */
     opal_mutex_t lock;
@@ -397,6 +400,38 @@ mca_pml_ob1_calc_weighted_length( mca_pml_ob1_com_btl_t *btls, int num_btls, siz
     btls[0].length += length_left;
 }
 
+/* Adaptive striping: give all the size bytes to the BTL that should
+ * complete the next fragment first, given the data it already has in
+ * flight and its measured throughput. The fragments are limited by the
+ * RDMA pipeline fragment size when rdma is set, by the maximum send size
+ * otherwise. Returns the index of the selected BTL. */
+static inline int
+mca_pml_ob1_calc_adaptive_length( mca_pml_ob1_com_btl_t *btls, int num_btls, size_t size,
+                                  bool rdma )
+{
+    double best_time = 0.0;
+    int i, best = 0;
+
+    for(i = 0; i < num_btls; i++) {
+        mca_bml_base_btl_t* bml_btl = btls[i].bml_btl;
+        size_t frag_size = rdma ? bml_btl->btl->btl_rdma_pipeline_frag_size :
+            bml_btl->btl->btl_max_send_size;
+        double t;
+
+        if(0 == frag_size || frag_size > size)
+            frag_size = size;
+        t = mca_bml_base_btl_completion_time(bml_btl, frag_size);
+        if(0 == i || t < best_time) {
+            best_time = t;
+            best = i;
+        }
+        btls[i].length = 0;
+    }
+
+    btls[best].length = size;
+    return best;
+}
+
 /**
  * A thread-safe function that should be called every time we need the OB1
  * progress to be turned (or kept) on.
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2018 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -34,8 +34,10 @@ static void mca_pml_ob1_comm_proc_construct(mca_pml_ob1_comm_proc_t* proc)
     proc->send_sequence = 0;
     proc->frags_cant_match = NULL;
 #if !MCA_PML_OB1_CUSTOM_MATCH
+    OBJ_CONSTRUCT(&proc->lock, opal_mutex_t);
     OBJ_CONSTRUCT(&proc->specific_receives, opal_list_t);
     OBJ_CONSTRUCT(&proc->unexpected_frags, opal_list_t);
+    mca_pml_ob1_match_vector_init(&proc->posted_tags);
 #endif
 }
 
@@ -46,6 +48,8 @@ static void mca_pml_ob1_comm_proc_destruct(mca_pml_ob1_comm_proc_t* proc)
 #if !MCA_PML_OB1_CUSTOM_MATCH
     OBJ_DESTRUCT(&proc->specific_receives);
     OBJ_DESTRUCT(&proc->unexpected_frags);
+    OBJ_DESTRUCT(&proc->lock);
+    mca_pml_ob1_match_vector_fini(&proc->posted_tags);
 #endif
     if (proc->ompi_proc) {
         OBJ_RELEASE(proc->ompi_proc);
@@ -62,6 +66,9 @@ static void mca_pml_ob1_comm_construct(mca_pml_ob1_comm_t* comm)
 {
 #if !MCA_PML_OB1_CUSTOM_MATCH
     OBJ_CONSTRUCT(&comm->wild_receives, opal_list_t);
+    OBJ_CONSTRUCT(&comm->wild_lock, opal_mutex_t);
+    comm->match_shared = 0;
+    comm->match_exclusive = 0;
 #else
     comm->prq = custom_match_prq_init();
     comm->umq = custom_match_umq_init();
@@ -89,6 +96,7 @@ static void mca_pml_ob1_comm_destruct(mca_pml_ob1_comm_t* comm)
 
 #if !MCA_PML_OB1_CUSTOM_MATCH
     OBJ_DESTRUCT(&comm->wild_receives);
+    OBJ_DESTRUCT(&comm->wild_lock);
 #else
     custom_match_prq_destroy(comm->prq);
     custom_match_umq_destroy(comm->umq);
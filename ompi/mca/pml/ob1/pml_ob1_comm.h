@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2018 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -36,6 +36,8 @@
 typedef struct mca_pml_ob1_comm_proc_t mca_pml_ob1_comm_proc_t;
 
 #include "custommatch/pml_ob1_custom_match.h"
+#include "pml_ob1.h"
+#include "pml_ob1_match_vector.h"
 
 BEGIN_C_DECLS
 
@@ -47,23 +49,39 @@ struct mca_pml_ob1_comm_proc_t {
     opal_atomic_int32_t send_sequence; /**< send side sequence number */
     struct mca_pml_ob1_recv_frag_t* frags_cant_match;  /**< out-of-order fragment queues */
 #if !MCA_PML_OB1_CUSTOM_MATCH
+    opal_mutex_t lock;             /**< matching lock of this peer (partitioned matching) */
     opal_list_t specific_receives; /**< queues of unmatched specific receives */
     opal_list_t unexpected_frags;  /**< unexpected fragment queues */
+    mca_pml_ob1_match_vector_t posted_tags;  /**< index of specific_receives (vector matching engine) */
 #endif
 };
 
 OBJ_CLASS_DECLARATION(mca_pml_ob1_comm_proc_t);
 
+#if !MCA_PML_OB1_CUSTOM_MATCH
+/**
+ * Are the receives posted for this peer indexed by the vector matching
+ * engine ? They are not if the index could not be allocated.
+ */
+static inline bool mca_pml_ob1_comm_proc_match_vector (const mca_pml_ob1_comm_proc_t *proc)
+{
+    return (MCA_PML_OB1_MATCH_ENGINE_VECTOR == mca_pml_ob1.match_engine) && !proc->posted_tags.disabled;
+}
+#endif
+
 /**
  *  Cached on ompi_communicator_t to hold queues/state
  *  used by the PML<->PTL interface for matching logic.
  */
 struct mca_pml_comm_t {
     opal_object_t super;
-    volatile uint32_t recv_sequence;  /**< recv request sequence number - receiver side */
+    opal_atomic_uint32_t recv_sequence;  /**< recv request sequence number - receiver side */
     opal_mutex_t matching_lock;   /**< matching lock */
 #if !MCA_PML_OB1_CUSTOM_MATCH
     opal_list_t wild_receives;    /**< queue of unmatched wild (source process not specified) receives */
+    opal_mutex_t wild_lock;       /**< serialize the peers matching against wild_receives */
+    opal_atomic_int32_t match_shared;  /**< number of peers currently matching (partitioned matching) */
+    volatile int32_t match_exclusive;  /**< a wildcard operation owns all the queues */
 #endif
     opal_mutex_t proc_lock;
     mca_pml_ob1_comm_proc_t **procs;
@@ -107,6 +125,82 @@ static inline mca_pml_ob1_comm_proc_t *mca_pml_ob1_peer_lookup (struct ompi_comm
     return pml_comm->procs[rank];
 }
 
+/**
+ * Acquire the matching lock of a communicator.
+ *
+ * By default there is a single matching lock per communicator. When
+ * partitioned matching is enabled each peer has its own lock, so that
+ * fragments from (and receives posted for) different peers can be
+ * matched concurrently. Operations involving all the peers (wildcard
+ * receives and probes, and their cancellation) pass a NULL proc and
+ * take exclusive ownership of all the queues of the communicator:
+ * they wait for the peers currently matching to drain, and prevent
+ * any new one from starting until the exclusive lock is released.
+ *
+ * @param  comm   Instance of mca_pml_ob1_comm_t
+ * @param  proc   Peer being matched, or NULL for exclusive access
+ */
+static inline void mca_pml_ob1_match_lock (mca_pml_ob1_comm_t *comm, mca_pml_ob1_comm_proc_t *proc)
+{
+#if !MCA_PML_OB1_CUSTOM_MATCH
+    if (mca_pml_ob1.partitioned_matching && (opal_using_threads () || mca_pml_ob1_matching_protection)) {
+        if (NULL == proc) {
+            /* serialize the exclusive owners, then wait for the peers to drain */
+            opal_mutex_lock (&comm->matching_lock);
+            comm->match_exclusive = 1;
+            opal_atomic_mb ();
+            while (0 != comm->match_shared) {
+                opal_atomic_rmb ();
+            }
+            opal_atomic_mb ();
+            return;
+        }
+
+        do {
+            while (comm->match_exclusive) {
+                opal_atomic_rmb ();
+            }
+            opal_atomic_add_fetch_32 (&comm->match_shared, 1);
+            opal_atomic_mb ();
+            if (OPAL_LIKELY(!comm->match_exclusive)) {
+                break;
+            }
+            /* an exclusive owner got in first, back off */
+            opal_atomic_add_fetch_32 (&comm->match_shared, -1);
+        } while (1);
+        opal_mutex_lock (&proc->lock);
+        return;
+    }
+#endif
+    OB1_MATCHING_LOCK(&comm->matching_lock);
+}
+
+/**
+ * Release a matching lock acquired with mca_pml_ob1_match_lock().
+ *
+ * @param  comm   Instance of mca_pml_ob1_comm_t
+ * @param  proc   The proc given to mca_pml_ob1_match_lock()
+ */
+static inline void mca_pml_ob1_match_unlock (mca_pml_ob1_comm_t *comm, mca_pml_ob1_comm_proc_t *proc)
+{
+#if !MCA_PML_OB1_CUSTOM_MATCH
+    if (mca_pml_ob1.partitioned_matching && (opal_using_threads () || mca_pml_ob1_matching_protection)) {
+        if (NULL == proc) {
+            opal_atomic_mb ();
+            comm->match_exclusive = 0;
+            opal_mutex_unlock (&comm->matching_lock);
+            return;
+        }
+
+        opal_mutex_unlock (&proc->lock);
+        opal_atomic_wmb ();
+        opal_atomic_add_fetch_32 (&comm->match_shared, -1);
+        return;
+    }
+#endif
+    OB1_MATCHING_UNLOCK(&comm->matching_lock);
+}
+
 /**
  * Initialize an instance of mca_pml_ob1_comm_t based on the communicator size.
  *
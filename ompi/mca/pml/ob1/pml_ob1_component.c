@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -60,6 +60,22 @@ int mca_pml_ob1_output = 0;
 static int mca_pml_ob1_verbose = 0;
 bool mca_pml_ob1_matching_protection = false;
 
+#if !MCA_PML_OB1_CUSTOM_MATCH
+static mca_base_var_enum_value_t mca_pml_ob1_match_engines[] = {
+    {MCA_PML_OB1_MATCH_ENGINE_LIST, "list"},
+    {MCA_PML_OB1_MATCH_ENGINE_VECTOR, "vector"},
+    {0, NULL}
+};
+
+static mca_base_var_enum_value_t mca_pml_ob1_match_isas[] = {
+    {MCA_PML_OB1_MATCH_ISA_AUTO, "auto"},
+    {MCA_PML_OB1_MATCH_ISA_SCALAR, "scalar"},
+    {MCA_PML_OB1_MATCH_ISA_AVX2, "avx2"},
+    {MCA_PML_OB1_MATCH_ISA_AVX512, "avx512"},
+    {0, NULL}
+};
+#endif
+
 mca_pml_base_component_2_0_0_t mca_pml_ob1_component = {
     /* First, the mca_base_component_t struct containing meta
        information about the component itself */
@@ -194,6 +210,10 @@ static int mca_pml_ob1_get_posted_recvq_size (const struct mca_base_pvar_t *pvar
 
 static int mca_pml_ob1_component_register(void)
 {
+#if !MCA_PML_OB1_CUSTOM_MATCH
+    mca_base_var_enum_t *new_enum;
+#endif
+
     mca_pml_ob1_param_register_int("verbose", 0, &mca_pml_ob1_verbose);
 
     mca_pml_ob1_param_register_int("free_list_num", 4, &mca_pml_ob1.free_list_num);
@@ -220,6 +240,37 @@ static int mca_pml_ob1_component_register(void)
                                            "(default: false)", MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
                                            OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_GROUP, &mca_pml_ob1.use_all_rdma);
 
+    mca_pml_ob1.partitioned_matching = false;
+    (void) mca_base_component_var_register(&mca_pml_ob1_component.pmlm_version, "partitioned_matching",
+                                           "Use a matching lock per peer instead of per communicator, allowing "
+                                           "messages from different peers to be matched concurrently in "
+                                           "multi-threaded runs. Wildcard receives and probes serialize with "
+                                           "all peers (default: false)", MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                           OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_pml_ob1.partitioned_matching);
+
+    mca_pml_ob1.match_engine = MCA_PML_OB1_MATCH_ENGINE_LIST;
+    mca_pml_ob1.match_isa = MCA_PML_OB1_MATCH_ISA_AUTO;
+#if !MCA_PML_OB1_CUSTOM_MATCH
+    (void) mca_base_var_enum_create("pml_ob1_match_engines", mca_pml_ob1_match_engines, &new_enum);
+    (void) mca_base_component_var_register(&mca_pml_ob1_component.pmlm_version, "matching_engine",
+                                           "Engine used to match incoming messages against the receives "
+                                           "posted for a specific peer: list walks the list of posted "
+                                           "receives, vector scans an array of their tags with SIMD "
+                                           "instructions (default: list)", MCA_BASE_VAR_TYPE_INT, new_enum, 0, 0,
+                                           OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY, &mca_pml_ob1.match_engine);
+    OBJ_RELEASE(new_enum);
+
+    (void) mca_base_var_enum_create("pml_ob1_match_isas", mca_pml_ob1_match_isas, &new_enum);
+    (void) mca_base_component_var_register(&mca_pml_ob1_component.pmlm_version, "matching_vector_isa",
+                                           "Instruction set used by the vector matching engine. auto "
+                                           "selects the widest one supported by the processor, and a "
+                                           "narrower one is used if the requested one is not supported "
+                                           "(default: auto)", MCA_BASE_VAR_TYPE_INT, new_enum, 0, 0,
+                                           OPAL_INFO_LVL_6, MCA_BASE_VAR_SCOPE_READONLY, &mca_pml_ob1.match_isa);
+    OBJ_RELEASE(new_enum);
+#endif
+
     mca_pml_ob1.allocator_name = "bucket";
     (void) mca_base_component_var_register(&mca_pml_ob1_component.pmlm_version, "allocator",
                                            "Name of allocator component for unexpected messages",
@@ -291,6 +342,16 @@ mca_pml_ob1_component_init( int* priority,
         return NULL;
     }
 
+#if !MCA_PML_OB1_CUSTOM_MATCH
+    if (MCA_PML_OB1_MATCH_ENGINE_VECTOR == mca_pml_ob1.match_engine) {
+        int isa = mca_pml_ob1_match_vector_select (mca_pml_ob1.match_isa);
+        opal_output_verbose( 10, mca_pml_ob1_output,
+                             "in ob1, vector matching engine using %s (requested %s)\n",
+                             mca_pml_ob1_match_vector_isa_name (isa),
+                             mca_pml_ob1_match_vector_isa_name (mca_pml_ob1.match_isa));
+    }
+#endif
+
     if(OMPI_SUCCESS != mca_bml_base_init( enable_progress_threads,
                                           enable_mpi_threads)) {
         return NULL;
@@ -0,0 +1,195 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+
+#include <string.h>
+
+#include "pml_ob1_match_vector.h"
+
+/* The SIMD kernels are compiled for their own instruction set with the
+ * target attribute, and only used if the processor supports it, so
+ * that the rest of the component does not depend on the compiler flags. */
+#if defined(__x86_64__) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5)))
+#define PML_OB1_MATCH_VECTOR_X86 1
+#include <immintrin.h>
+#else
+#define PML_OB1_MATCH_VECTOR_X86 0
+#endif
+
+/* initial number of slots of an index, and alignment of the tags */
+#define PML_OB1_MATCH_VECTOR_MIN_SIZE  64
+#define PML_OB1_MATCH_VECTOR_ALIGN     64
+
+static size_t mca_pml_ob1_match_vector_scan_scalar (const int32_t *tags, size_t from, size_t to,
+                                                    int32_t tag, int32_t any_tag)
+{
+    for (size_t i = from ; i < to ; ++i) {
+        if (tags[i] == tag || tags[i] == any_tag) {
+            return i;
+        }
+    }
+    return to;
+}
+
+#if PML_OB1_MATCH_VECTOR_X86
+__attribute__((target("avx2")))
+static size_t mca_pml_ob1_match_vector_scan_avx2 (const int32_t *tags, size_t from, size_t to,
+                                                  int32_t tag, int32_t any_tag)
+{
+    const __m256i vtag = _mm256_set1_epi32 (tag);
+    const __m256i vany = _mm256_set1_epi32 (any_tag);
+
+    for (size_t i = from ; i < to ; i += 8) {
+        __m256i v = _mm256_load_si256 ((const __m256i *) (tags + i));
+        __m256i m = _mm256_or_si256 (_mm256_cmpeq_epi32 (v, vtag), _mm256_cmpeq_epi32 (v, vany));
+        int bits = _mm256_movemask_ps (_mm256_castsi256_ps (m));
+        if (bits) {
+            return i + __builtin_ctz (bits);
+        }
+    }
+    return to;
+}
+
+__attribute__((target("avx512f")))
+static size_t mca_pml_ob1_match_vector_scan_avx512 (const int32_t *tags, size_t from, size_t to,
+                                                    int32_t tag, int32_t any_tag)
+{
+    const __m512i vtag = _mm512_set1_epi32 (tag);
+    const __m512i vany = _mm512_set1_epi32 (any_tag);
+
+    for (size_t i = from ; i < to ; i += 16) {
+        __m512i v = _mm512_load_si512 ((const void *) (tags + i));
+        __mmask16 bits = _mm512_cmpeq_epi32_mask (v, vtag) | _mm512_cmpeq_epi32_mask (v, vany);
+        if (bits) {
+            return i + __builtin_ctz ((unsigned int) bits);
+        }
+    }
+    return to;
+}
+#endif  /* PML_OB1_MATCH_VECTOR_X86 */
+
+mca_pml_ob1_match_vector_scan_fn_t mca_pml_ob1_match_vector_scan = mca_pml_ob1_match_vector_scan_scalar;
+
+int mca_pml_ob1_match_vector_select (int isa)
+{
+    int best = MCA_PML_OB1_MATCH_ISA_SCALAR;
+
+#if PML_OB1_MATCH_VECTOR_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+        best = MCA_PML_OB1_MATCH_ISA_AVX2;
+    }
+    if (__builtin_cpu_supports ("avx512f")) {
+        best = MCA_PML_OB1_MATCH_ISA_AVX512;
+    }
+#endif
+
+    if (MCA_PML_OB1_MATCH_ISA_AUTO == isa || isa > best) {
+        isa = best;
+    }
+
+    switch (isa) {
+#if PML_OB1_MATCH_VECTOR_X86
+    case MCA_PML_OB1_MATCH_ISA_AVX512:
+        mca_pml_ob1_match_vector_scan = mca_pml_ob1_match_vector_scan_avx512;
+        break;
+    case MCA_PML_OB1_MATCH_ISA_AVX2:
+        mca_pml_ob1_match_vector_scan = mca_pml_ob1_match_vector_scan_avx2;
+        break;
+#endif
+    default:
+        isa = MCA_PML_OB1_MATCH_ISA_SCALAR;
+        mca_pml_ob1_match_vector_scan = mca_pml_ob1_match_vector_scan_scalar;
+    }
+
+    return isa;
+}
+
+const char *mca_pml_ob1_match_vector_isa_name (int isa)
+{
+    switch (isa) {
+    case MCA_PML_OB1_MATCH_ISA_AVX512:
+        return "avx512";
+    case MCA_PML_OB1_MATCH_ISA_AVX2:
+        return "avx2";
+    case MCA_PML_OB1_MATCH_ISA_SCALAR:
+        return "scalar";
+    default:
+        return "auto";
+    }
+}
+
+/* Make room at the tail of the index: slide the posted receives to the
+ * front if at least half of the slots are holes, otherwise double the
+ * size. The slots past the tail are always empty, so that the kernels
+ * can scan whole vectors. */
+int mca_pml_ob1_match_vector_grow (mca_pml_ob1_match_vector_t *vec)
+{
+    struct mca_pml_ob1_recv_request_t **reqs;
+    size_t size, i, j;
+    int32_t *tags;
+
+    if (vec->disabled) {
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+
+    if (vec->size && 2 * vec->count <= vec->size) {
+        for (i = vec->head, j = 0 ; i < vec->tail ; ++i) {
+            if (NULL != vec->reqs[i]) {
+                vec->tags[j] = vec->tags[i];
+                vec->reqs[j++] = vec->reqs[i];
+            }
+        }
+        for (i = j ; i < vec->tail ; ++i) {
+            vec->tags[i] = MCA_PML_OB1_MATCH_VECTOR_EMPTY;
+            vec->reqs[i] = NULL;
+        }
+        vec->head = 0;
+        vec->tail = j;
+        return OMPI_SUCCESS;
+    }
+
+    size = vec->size ? 2 * vec->size : PML_OB1_MATCH_VECTOR_MIN_SIZE;
+    reqs = (struct mca_pml_ob1_recv_request_t **) realloc (vec->reqs, size * sizeof (*reqs));
+    if (NULL != reqs) {
+        vec->reqs = reqs;
+    }
+    if (NULL == reqs || 0 != posix_memalign ((void **) &tags, PML_OB1_MATCH_VECTOR_ALIGN,
+                                             size * sizeof (int32_t))) {
+        /* keep going with the list of specific receives */
+        mca_pml_ob1_match_vector_fini (vec);
+        vec->disabled = true;
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+
+    if (vec->size) {
+        memcpy (tags, vec->tags, vec->size * sizeof (int32_t));
+        free (vec->tags);
+    }
+    for (i = vec->size ; i < size ; ++i) {
+        tags[i] = MCA_PML_OB1_MATCH_VECTOR_EMPTY;
+        reqs[i] = NULL;
+    }
+    vec->tags = tags;
+    vec->reqs = reqs;
+    vec->size = size;
+
+    return OMPI_SUCCESS;
+}
+
+void mca_pml_ob1_match_vector_fini (mca_pml_ob1_match_vector_t *vec)
+{
+    free (vec->tags);
+    free (vec->reqs);
+    mca_pml_ob1_match_vector_init (vec);
+}
@@ -0,0 +1,193 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/**
+ * @file
+ *
+ * Vectorized index of the receives posted for a peer.
+ *
+ * The tags of the receives posted for a given peer are kept in a
+ * contiguous, cache aligned array in posting order, next to the array
+ * of the corresponding requests. Matching an incoming fragment is then
+ * a linear scan of the tags, done 8 (AVX2) or 16 (AVX-512) at a time,
+ * instead of walking a linked list of requests. Matched or canceled
+ * receives leave a hole that is skipped by the scan, and the array is
+ * compacted when it runs out of space.
+ *
+ * The index does not replace the list of specific receives of the
+ * peer, it only shadows it when the vector matching engine is
+ * selected. All the functions must be called with the matching lock
+ * of the peer held.
+ */
+#ifndef MCA_PML_OB1_MATCH_VECTOR_H
+#define MCA_PML_OB1_MATCH_VECTOR_H
+
+#include "ompi_config.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "opal/prefetch.h"
+#include "ompi/constants.h"
+#include "ompi/mca/pml/pml_constants.h"
+
+BEGIN_C_DECLS
+
+/** Number of tags compared at once by the widest kernel */
+#define MCA_PML_OB1_MATCH_VECTOR_WIDTH 16
+
+/** Tag of an empty slot, never matches an incoming fragment */
+#define MCA_PML_OB1_MATCH_VECTOR_EMPTY INT32_MIN
+
+/** Matching engines */
+enum {
+    MCA_PML_OB1_MATCH_ENGINE_LIST = 0,
+    MCA_PML_OB1_MATCH_ENGINE_VECTOR,
+};
+
+/** Instruction sets available to the vector matching engine */
+enum {
+    MCA_PML_OB1_MATCH_ISA_AUTO = 0,
+    MCA_PML_OB1_MATCH_ISA_SCALAR,
+    MCA_PML_OB1_MATCH_ISA_AVX2,
+    MCA_PML_OB1_MATCH_ISA_AVX512,
+};
+
+struct mca_pml_ob1_recv_request_t;
+
+struct mca_pml_ob1_match_vector_t {
+    int32_t *tags;                             /**< tags of the posted receives */
+    struct mca_pml_ob1_recv_request_t **reqs;  /**< the posted receives */
+    size_t head;       /**< first used slot */
+    size_t tail;       /**< one past the last used slot */
+    size_t count;      /**< number of posted receives */
+    size_t size;       /**< number of allocated slots */
+    bool disabled;     /**< allocation failed, use the list of specific receives */
+};
+typedef struct mca_pml_ob1_match_vector_t mca_pml_ob1_match_vector_t;
+
+/**
+ * Scan the tags in [from, to) for the first one matching the incoming
+ * tag. Both bounds are multiples of MCA_PML_OB1_MATCH_VECTOR_WIDTH.
+ *
+ * @return index of the first matching slot, or to if none matches
+ */
+typedef size_t (*mca_pml_ob1_match_vector_scan_fn_t) (const int32_t *tags, size_t from,
+                                                      size_t to, int32_t tag, int32_t any_tag);
+
+/** Scan kernel selected by mca_pml_ob1_match_vector_select() */
+extern mca_pml_ob1_match_vector_scan_fn_t mca_pml_ob1_match_vector_scan;
+
+/**
+ * Select the scan kernel for the requested instruction set.
+ *
+ * @param  isa  One of the MCA_PML_OB1_MATCH_ISA_* values. AUTO picks
+ *              the widest one supported by the processor.
+ * @return      The instruction set actually used, which is lower than
+ *              the requested one if the processor does not support it.
+ */
+int mca_pml_ob1_match_vector_select (int isa);
+
+/** Name of an instruction set, for verbose output */
+const char *mca_pml_ob1_match_vector_isa_name (int isa);
+
+int mca_pml_ob1_match_vector_grow (mca_pml_ob1_match_vector_t *vec);
+
+void mca_pml_ob1_match_vector_fini (mca_pml_ob1_match_vector_t *vec);
+
+static inline void mca_pml_ob1_match_vector_init (mca_pml_ob1_match_vector_t *vec)
+{
+    vec->tags = NULL;
+    vec->reqs = NULL;
+    vec->head = vec->tail = 0;
+    vec->count = vec->size = 0;
+    vec->disabled = false;
+}
+
+/**
+ * Append a posted receive to the index. If the index cannot be grown
+ * it is emptied and disabled, and the caller must fall back to the
+ * list of specific receives for this peer.
+ */
+static inline void mca_pml_ob1_match_vector_append (mca_pml_ob1_match_vector_t *vec,
+                                                    struct mca_pml_ob1_recv_request_t *req,
+                                                    int32_t tag)
+{
+    if (OPAL_UNLIKELY(vec->tail == vec->size)) {
+        if (OMPI_SUCCESS != mca_pml_ob1_match_vector_grow (vec)) {
+            return;
+        }
+    }
+    vec->tags[vec->tail] = tag;
+    vec->reqs[vec->tail] = req;
+    vec->tail++;
+    vec->count++;
+}
+
+/**
+ * Find the first posted receive matching an incoming tag.
+ *
+ * @param  slot  (OUT) Slot of the receive, to be given to
+ *               mca_pml_ob1_match_vector_remove_slot().
+ */
+static inline struct mca_pml_ob1_recv_request_t *
+mca_pml_ob1_match_vector_find (const mca_pml_ob1_match_vector_t *vec, int32_t tag, size_t *slot)
+{
+    size_t from, to, i;
+
+    if (0 == vec->count) {
+        return NULL;
+    }
+
+    /* user tags also match receives posted with MPI_ANY_TAG */
+    from = vec->head & ~((size_t) MCA_PML_OB1_MATCH_VECTOR_WIDTH - 1);
+    to = (vec->tail + MCA_PML_OB1_MATCH_VECTOR_WIDTH - 1) & ~((size_t) MCA_PML_OB1_MATCH_VECTOR_WIDTH - 1);
+    i = mca_pml_ob1_match_vector_scan (vec->tags, from, to, tag, tag >= 0 ? OMPI_ANY_TAG : tag);
+    if (i == to) {
+        return NULL;
+    }
+
+    *slot = i;
+    return vec->reqs[i];
+}
+
+static inline void mca_pml_ob1_match_vector_remove_slot (mca_pml_ob1_match_vector_t *vec, size_t slot)
+{
+    vec->tags[slot] = MCA_PML_OB1_MATCH_VECTOR_EMPTY;
+    vec->reqs[slot] = NULL;
+
+    if (0 == --vec->count) {
+        vec->head = vec->tail = 0;
+        return;
+    }
+    while (NULL == vec->reqs[vec->head]) {
+        vec->head++;
+    }
+    while (NULL == vec->reqs[vec->tail - 1]) {
+        vec->tail--;
+    }
+}
+
+/** Remove a posted receive from the index (cancel) */
+static inline void mca_pml_ob1_match_vector_remove (mca_pml_ob1_match_vector_t *vec,
+                                                    struct mca_pml_ob1_recv_request_t *req)
+{
+    for (size_t i = vec->head ; i < vec->tail ; ++i) {
+        if (vec->reqs[i] == req) {
+            mca_pml_ob1_match_vector_remove_slot (vec, i);
+            return;
+        }
+    }
+}
+
+END_C_DECLS
+
+#endif  /* MCA_PML_OB1_MATCH_VECTOR_H */
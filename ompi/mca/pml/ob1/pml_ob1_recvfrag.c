@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2019 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2007 High Performance Computing Center Stuttgart,
@@ -396,7 +396,7 @@ void mca_pml_ob1_recv_frag_callback_match(mca_btl_base_module_t* btl,
      * end points) from being processed, and potentially "loosing"
      * the fragment.
      */
-    OB1_MATCHING_LOCK(&comm->matching_lock);
+    mca_pml_ob1_match_lock(comm, proc);
 
     if (!OMPI_COMM_CHECK_ASSERT_ALLOW_OVERTAKE(comm_ptr)) {
         /* get sequence number of next message that can be processed.
@@ -409,7 +409,7 @@ void mca_pml_ob1_recv_frag_callback_match(mca_btl_base_module_t* btl,
             MCA_PML_OB1_RECV_FRAG_INIT(frag, hdr, segments, num_segments, btl);
             append_frag_to_ordered_list(&proc->frags_cant_match, frag, proc->expected_sequence);
             SPC_RECORD(OMPI_SPC_OUT_OF_SEQUENCE, 1);
-            OB1_MATCHING_UNLOCK(&comm->matching_lock);
+            mca_pml_ob1_match_unlock(comm, proc);
             return;
         }
 
@@ -434,7 +434,7 @@ void mca_pml_ob1_recv_frag_callback_match(mca_btl_base_module_t* btl,
                            hdr->hdr_src, hdr->hdr_tag, PERUSE_RECV);
 
     /* release matching lock before processing fragment */
-    OB1_MATCHING_UNLOCK(&comm->matching_lock);
+    mca_pml_ob1_match_unlock(comm, proc);
 
     if(OPAL_LIKELY(match)) {
         bytes_received = segments->seg_len - OMPI_PML_OB1_MATCH_HDR_LEN;
@@ -503,7 +503,7 @@ void mca_pml_ob1_recv_frag_callback_match(mca_btl_base_module_t* btl,
     if(NULL != proc->frags_cant_match) {
         mca_pml_ob1_recv_frag_t* frag;
 
-        OB1_MATCHING_LOCK(&comm->matching_lock);
+        mca_pml_ob1_match_lock(comm, proc);
         if((frag = check_cantmatch_for_match(proc))) {
             /* mca_pml_ob1_recv_frag_match_proc() will release the lock. */
             mca_pml_ob1_recv_frag_match_proc(frag->btl, comm_ptr, proc,
@@ -511,7 +511,7 @@ void mca_pml_ob1_recv_frag_callback_match(mca_btl_base_module_t* btl,
                                              frag->segments, frag->num_segments,
                                              frag->hdr.hdr_match.hdr_common.hdr_type, frag);
         } else {
-            OB1_MATCHING_UNLOCK(&comm->matching_lock);
+            mca_pml_ob1_match_unlock(comm, proc);
         }
     }
 
@@ -698,7 +698,15 @@ void mca_pml_ob1_recv_frag_callback_fin(mca_btl_base_module_t* btl,
 
 
 
-#define PML_MAX_SEQ ~((mca_pml_sequence_t)0);
+#define PML_MAX_SEQ ~((mca_pml_sequence_t)0)
+
+/* The receive sequence numbers are 32 bits and wrap around. Compare them
+ * through their difference, as the fragment sequence numbers are, which
+ * is correct as long as less than 2^31 receives are posted at once. */
+static inline bool pml_ob1_recv_seq_before(mca_pml_sequence_t a, mca_pml_sequence_t b)
+{
+    return (int32_t)((uint32_t)a - (uint32_t)b) < 0;
+}
 
 static inline mca_pml_ob1_recv_request_t* get_posted_recv(opal_list_t *queue)
 {
@@ -720,6 +728,51 @@ static inline mca_pml_ob1_recv_request_t* get_next_posted_recv(
     return (mca_pml_ob1_recv_request_t*)i;
 }
 
+#if !MCA_PML_OB1_CUSTOM_MATCH
+/* Same as match_incomming() when the receives posted for the peer are
+ * indexed by the vector matching engine. The index gives the first
+ * specific receive matching the tag, which is the one to use unless a
+ * matching wild receive was posted before it. */
+static mca_pml_ob1_recv_request_t *match_incomming_vector(
+        mca_pml_ob1_match_hdr_t *hdr, mca_pml_ob1_comm_t *comm,
+        mca_pml_ob1_comm_proc_t *proc)
+{
+    mca_pml_ob1_recv_request_t *specific_recv, *wild_recv;
+    mca_pml_sequence_t specific_recv_seq;
+    int tag = hdr->hdr_tag;
+    size_t slot;
+
+    specific_recv = mca_pml_ob1_match_vector_find(&proc->posted_tags, tag, &slot);
+    specific_recv_seq = specific_recv ?
+        specific_recv->req_recv.req_base.req_sequence : PML_MAX_SEQ;
+
+    OPAL_LIST_FOREACH(wild_recv, &comm->wild_receives, mca_pml_ob1_recv_request_t) {
+        int req_tag;
+
+        if (PML_MAX_SEQ != specific_recv_seq &&
+            pml_ob1_recv_seq_before(specific_recv_seq, wild_recv->req_recv.req_base.req_sequence)) {
+            break;
+        }
+        req_tag = wild_recv->req_recv.req_base.req_tag;
+        if (req_tag == tag || (req_tag == OMPI_ANY_TAG && tag >= 0)) {
+            opal_list_remove_item(&comm->wild_receives, (opal_list_item_t*)wild_recv);
+            PERUSE_TRACE_COMM_EVENT(PERUSE_COMM_REQ_REMOVE_FROM_POSTED_Q,
+                    &(wild_recv->req_recv.req_base), PERUSE_RECV);
+            return wild_recv;
+        }
+    }
+
+    if (NULL != specific_recv) {
+        mca_pml_ob1_match_vector_remove_slot(&proc->posted_tags, slot);
+        opal_list_remove_item(&proc->specific_receives, (opal_list_item_t*)specific_recv);
+        PERUSE_TRACE_COMM_EVENT(PERUSE_COMM_REQ_REMOVE_FROM_POSTED_Q,
+                &(specific_recv->req_recv.req_base), PERUSE_RECV);
+    }
+
+    return specific_recv;
+}
+#endif
+
 static mca_pml_ob1_recv_request_t *match_incomming(
         mca_pml_ob1_match_hdr_t *hdr, mca_pml_ob1_comm_t *comm,
         mca_pml_ob1_comm_proc_t *proc)
@@ -729,6 +782,10 @@ static mca_pml_ob1_recv_request_t *match_incomming(
     mca_pml_sequence_t wild_recv_seq, specific_recv_seq;
     int tag = hdr->hdr_tag;
 
+    if (mca_pml_ob1_comm_proc_match_vector(proc)) {
+        return match_incomming_vector(hdr, comm, proc);
+    }
+
     specific_recv = get_posted_recv(&proc->specific_receives);
     wild_recv = get_posted_recv(&comm->wild_receives);
 
@@ -744,7 +801,9 @@ static mca_pml_ob1_recv_request_t *match_incomming(
         int req_tag;
         mca_pml_sequence_t *seq;
 
-        if (OPAL_UNLIKELY(wild_recv_seq < specific_recv_seq)) {
+        if (OPAL_UNLIKELY(PML_MAX_SEQ == specific_recv_seq ||
+                          (PML_MAX_SEQ != wild_recv_seq &&
+                           pml_ob1_recv_seq_before(wild_recv_seq, specific_recv_seq)))) {
             match = &wild_recv;
             queue = &comm->wild_receives;
             seq = &wild_recv_seq;
@@ -780,6 +839,19 @@ static mca_pml_ob1_recv_request_t *match_incomming_no_any_source (
     mca_pml_ob1_recv_request_t *recv_req;
     int tag = hdr->hdr_tag;
 
+    if (mca_pml_ob1_comm_proc_match_vector(proc)) {
+        size_t slot;
+
+        recv_req = mca_pml_ob1_match_vector_find(&proc->posted_tags, tag, &slot);
+        if (NULL != recv_req) {
+            mca_pml_ob1_match_vector_remove_slot(&proc->posted_tags, slot);
+            opal_list_remove_item (&proc->specific_receives, (opal_list_item_t *) recv_req);
+            PERUSE_TRACE_COMM_EVENT(PERUSE_COMM_REQ_REMOVE_FROM_POSTED_Q,
+                    &(recv_req->req_recv.req_base), PERUSE_RECV);
+        }
+        return recv_req;
+    }
+
     OPAL_LIST_FOREACH(recv_req, &proc->specific_receives, mca_pml_ob1_recv_request_t) {
         int req_tag = recv_req->req_recv.req_base.req_tag;
 
@@ -793,6 +865,28 @@ static mca_pml_ob1_recv_request_t *match_incomming_no_any_source (
 
     return NULL;
 }
+
+/* With partitioned matching several peers can be matched at once while
+ * holding only their own lock. The wild receives are shared between all
+ * the peers, so they are matched under a separate lock. New wild receives
+ * are only appended while holding the communicator exclusively, thus an
+ * empty queue cannot be filled while we are matching. */
+static mca_pml_ob1_recv_request_t *match_incomming_shared (
+        mca_pml_ob1_match_hdr_t *hdr, mca_pml_ob1_comm_t *comm,
+        mca_pml_ob1_comm_proc_t *proc)
+{
+    mca_pml_ob1_recv_request_t *match;
+
+    if (opal_list_is_empty (&comm->wild_receives)) {
+        return match_incomming_no_any_source (hdr, comm, proc);
+    }
+
+    opal_mutex_lock (&comm->wild_lock);
+    match = match_incomming (hdr, comm, proc);
+    opal_mutex_unlock (&comm->wild_lock);
+
+    return match;
+}
 #endif
 
 static mca_pml_ob1_recv_request_t*
@@ -815,7 +909,11 @@ match_one(mca_btl_base_module_t *btl,
         match = match_incomming(hdr, comm, proc);
 #else
         if (!OMPI_COMM_CHECK_ASSERT_NO_ANY_SOURCE (comm_ptr)) {
-            match = match_incomming(hdr, comm, proc);
+            if (OPAL_UNLIKELY(mca_pml_ob1.partitioned_matching)) {
+                match = match_incomming_shared (hdr, comm, proc);
+            } else {
+                match = match_incomming(hdr, comm, proc);
+            }
         } else {
             match = match_incomming_no_any_source (hdr, comm, proc);
         }
@@ -954,7 +1052,7 @@ static int mca_pml_ob1_recv_frag_match( mca_btl_base_module_t *btl,
      * end points) from being processed, and potentially "loosing"
      * the fragment.
      */
-    OB1_MATCHING_LOCK(&comm->matching_lock);
+    mca_pml_ob1_match_lock(comm, proc);
 
     frag_msg_seq = hdr->hdr_seq;
     next_msg_seq_expected = (uint16_t)proc->expected_sequence;
@@ -971,7 +1069,7 @@ static int mca_pml_ob1_recv_frag_match( mca_btl_base_module_t *btl,
             SPC_RECORD(OMPI_SPC_OOS_IN_QUEUE, 1);
             SPC_UPDATE_WATERMARK(OMPI_SPC_MAX_OOS_IN_QUEUE, OMPI_SPC_OOS_IN_QUEUE);
 
-            OB1_MATCHING_UNLOCK(&comm->matching_lock);
+            mca_pml_ob1_match_unlock(comm, proc);
             return OMPI_SUCCESS;
         }
     }
@@ -1032,7 +1130,7 @@ mca_pml_ob1_recv_frag_match_proc( mca_btl_base_module_t *btl,
                            hdr->hdr_src, hdr->hdr_tag, PERUSE_RECV);
 
     /* release matching lock before processing fragment */
-    OB1_MATCHING_UNLOCK(&comm->matching_lock);
+    mca_pml_ob1_match_unlock(comm, proc);
 
     if(OPAL_LIKELY(match)) {
         switch(type) {
@@ -1057,7 +1155,7 @@ mca_pml_ob1_recv_frag_match_proc( mca_btl_base_module_t *btl,
      * may now be used to form new matchs
      */
     if(OPAL_UNLIKELY(NULL != proc->frags_cant_match)) {
-        OB1_MATCHING_LOCK(&comm->matching_lock);
+        mca_pml_ob1_match_lock(comm, proc);
         if((frag = check_cantmatch_for_match(proc))) {
             hdr = &frag->hdr.hdr_match;
             segments = frag->segments;
@@ -1066,7 +1164,7 @@ mca_pml_ob1_recv_frag_match_proc( mca_btl_base_module_t *btl,
             type = hdr->hdr_common.hdr_type;
             goto match_this_frag;
         }
-        OB1_MATCHING_UNLOCK(&comm->matching_lock);
+        mca_pml_ob1_match_unlock(comm, proc);
     }
 
     return OMPI_SUCCESS;
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2019 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2008 High Performance Computing Center Stuttgart,
@@ -101,11 +101,18 @@ static int mca_pml_ob1_recv_request_cancel(struct ompi_request_t* ompi_request,
     mca_pml_ob1_recv_request_t* request = (mca_pml_ob1_recv_request_t*)ompi_request;
     ompi_communicator_t *comm = request->req_recv.req_base.req_comm;
     mca_pml_ob1_comm_t *ob1_comm = comm->c_pml_comm;
+    mca_pml_ob1_comm_proc_t* proc = NULL;
+
+#if !MCA_PML_OB1_CUSTOM_MATCH
+    if( request->req_recv.req_base.req_peer != OMPI_ANY_SOURCE ) {
+        proc = mca_pml_ob1_peer_lookup (comm, request->req_recv.req_base.req_peer);
+    }
+#endif
 
     /* The rest should be protected behind the match logic lock */
-    OB1_MATCHING_LOCK(&ob1_comm->matching_lock);
+    mca_pml_ob1_match_lock(ob1_comm, proc);
     if( true == request->req_match_received ) { /* way to late to cancel this one */
-        OB1_MATCHING_UNLOCK(&ob1_comm->matching_lock);
+        mca_pml_ob1_match_unlock(ob1_comm, proc);
         assert( OMPI_ANY_TAG != ompi_request->req_status.MPI_TAG ); /* not matched isn't it */
         return OMPI_SUCCESS;
     }
@@ -116,7 +123,9 @@ static int mca_pml_ob1_recv_request_cancel(struct ompi_request_t* ompi_request,
     if( request->req_recv.req_base.req_peer == OMPI_ANY_SOURCE ) {
         opal_list_remove_item( &ob1_comm->wild_receives, (opal_list_item_t*)request );
     } else {
-        mca_pml_ob1_comm_proc_t* proc = mca_pml_ob1_peer_lookup (comm, request->req_recv.req_base.req_peer);
+        if (mca_pml_ob1_comm_proc_match_vector(proc)) {
+            mca_pml_ob1_match_vector_remove(&proc->posted_tags, request);
+        }
         opal_list_remove_item(&proc->specific_receives, (opal_list_item_t*)request);
     }
 #endif
@@ -127,7 +136,7 @@ static int mca_pml_ob1_recv_request_cancel(struct ompi_request_t* ompi_request,
      * to true. Otherwise, the request will never be freed.
      */
     request->req_recv.req_base.req_pml_complete = true;
-    OB1_MATCHING_UNLOCK(&ob1_comm->matching_lock);
+    mca_pml_ob1_match_unlock(ob1_comm, proc);
 
     ompi_request->req_status._cancelled = true;
     /* This macro will set the req_complete to true so the MPI Test/Wait* functions
@@ -200,6 +209,7 @@ static void mca_pml_ob1_put_completion (mca_pml_ob1_rdma_frag_t *frag, int64_t r
     OPAL_THREAD_ADD_FETCH32(&recvreq->req_pipeline_depth, -1);
 
     assert ((uint64_t) rdma_size == frag->rdma_length);
+    mca_bml_base_btl_completed (bml_btl, frag->rdma_length, 0 >= rdma_size);
     MCA_PML_OB1_RDMA_FRAG_RETURN(frag);
 
     if (OPAL_LIKELY(0 < rdma_size)) {
@@ -453,11 +463,14 @@ static int mca_pml_ob1_recv_request_put_frag (mca_pml_ob1_rdma_frag_t *frag)
                                   &(recvreq->req_recv.req_base), frag->rdma_length,
                                   PERUSE_RECV);
 
-    /* send rdma request to peer */
+    /* send rdma request to peer. the BTL is busy with the put until the
+     * FIN comes back, see mca_pml_ob1_put_completion() */
+    mca_bml_base_btl_sent (bml_btl, frag->rdma_length);
     rc = mca_bml_base_send (bml_btl, ctl, MCA_PML_OB1_HDR_TYPE_PUT);
     /* Increment counter for bytes_put even though they probably haven't all been received yet */
     SPC_RECORD(OMPI_SPC_BYTES_PUT, (ompi_spc_value_t)frag->rdma_length);
     if (OPAL_UNLIKELY(rc < 0)) {
+        mca_bml_base_btl_completed (bml_btl, frag->rdma_length, true);
         mca_bml_base_free (bml_btl, ctl);
         return rc;
     }
@@ -1010,6 +1023,13 @@ int mca_pml_ob1_recv_request_schedule_once( mca_pml_ob1_recv_request_t* recvreq,
             prev_bytes_remaining = bytes_remaining;
         }
 
+        if(mca_bml_base_adaptive_striping && recvreq->req_rdma_cnt > 1) {
+            /* request the next put on the BTL expected to complete it first */
+            recvreq->req_rdma_idx = mca_pml_ob1_calc_adaptive_length(recvreq->req_rdma,
+                                                                     recvreq->req_rdma_cnt,
+                                                                     bytes_remaining, true);
+        }
+
         do {
             rdma_idx = recvreq->req_rdma_idx;
             bml_btl = recvreq->req_rdma[rdma_idx].bml_btl;
@@ -1229,7 +1249,7 @@ void mca_pml_ob1_recv_req_start(mca_pml_ob1_recv_request_t *req)
 {
     ompi_communicator_t *comm = req->req_recv.req_base.req_comm;
     mca_pml_ob1_comm_t *ob1_comm = comm->c_pml_comm;
-    mca_pml_ob1_comm_proc_t* proc;
+    mca_pml_ob1_comm_proc_t* proc, *lock_proc = NULL;
     mca_pml_ob1_recv_frag_t* frag;
     mca_pml_ob1_hdr_t* hdr;
 #if MCA_PML_OB1_CUSTOM_MATCH
@@ -1252,7 +1272,13 @@ void mca_pml_ob1_recv_req_start(mca_pml_ob1_recv_request_t *req)
 
     MCA_PML_BASE_RECV_START(&req->req_recv);
 
-    OB1_MATCHING_LOCK(&ob1_comm->matching_lock);
+#if !MCA_PML_OB1_CUSTOM_MATCH
+    /* specific receives only need the lock of their peer, wild ones all of them */
+    if(req->req_recv.req_base.req_peer != OMPI_ANY_SOURCE) {
+        lock_proc = mca_pml_ob1_peer_lookup (comm, req->req_recv.req_base.req_peer);
+    }
+#endif
+    mca_pml_ob1_match_lock(ob1_comm, lock_proc);
     /**
      * The laps of time between the ACTIVATE event and the SEARCH_UNEX one include
      * the cost of the request lock.
@@ -1261,7 +1287,12 @@ void mca_pml_ob1_recv_req_start(mca_pml_ob1_recv_request_t *req)
                             &(req->req_recv.req_base), PERUSE_RECV);
 
     /* assign sequence number */
-    req->req_recv.req_base.req_sequence = ob1_comm->recv_sequence++;
+    if (OPAL_UNLIKELY(mca_pml_ob1.partitioned_matching)) {
+        /* specific receives for different peers can get here concurrently */
+        req->req_recv.req_base.req_sequence = (uint32_t) opal_atomic_fetch_add_32 ((opal_atomic_int32_t *) &ob1_comm->recv_sequence, 1);
+    } else {
+        req->req_recv.req_base.req_sequence = ob1_comm->recv_sequence++;
+    }
 
     /* attempt to match posted recv */
     if(req->req_recv.req_base.req_peer == OMPI_ANY_SOURCE) {
@@ -1301,16 +1332,21 @@ void mca_pml_ob1_recv_req_start(mca_pml_ob1_recv_request_t *req)
         /* We didn't find any matches.  Record this irecv so we can match
            it when the message comes in. */
         if(OPAL_LIKELY(req->req_recv.req_base.req_type != MCA_PML_REQUEST_IPROBE &&
-                       req->req_recv.req_base.req_type != MCA_PML_REQUEST_IMPROBE))
+                       req->req_recv.req_base.req_type != MCA_PML_REQUEST_IMPROBE)) {
 #if MCA_PML_OB1_CUSTOM_MATCH
             custom_match_prq_append(ob1_comm->prq, req,
                                     req->req_recv.req_base.req_tag,
                                     req->req_recv.req_base.req_peer);
 #else
             append_recv_req_to_queue(queue, req);
+            if (NULL != lock_proc && mca_pml_ob1_comm_proc_match_vector(lock_proc)) {
+                mca_pml_ob1_match_vector_append(&lock_proc->posted_tags, req,
+                                                req->req_recv.req_base.req_tag);
+            }
 #endif
+        }
         req->req_match_received = false;
-        OB1_MATCHING_UNLOCK(&ob1_comm->matching_lock);
+        mca_pml_ob1_match_unlock(ob1_comm, lock_proc);
     } else {
         if(OPAL_LIKELY(!IS_PROB_REQ(req))) {
             PERUSE_TRACE_COMM_EVENT(PERUSE_COMM_REQ_MATCH_UNEX,
@@ -1333,7 +1369,7 @@ void mca_pml_ob1_recv_req_start(mca_pml_ob1_recv_request_t *req)
                                   (opal_list_item_t*)frag);
 #endif
             SPC_RECORD(OMPI_SPC_UNEXPECTED_IN_QUEUE, -1);
-            OB1_MATCHING_UNLOCK(&ob1_comm->matching_lock);
+            mca_pml_ob1_match_unlock(ob1_comm, lock_proc);
 
             switch(hdr->hdr_common.hdr_type) {
             case MCA_PML_OB1_HDR_TYPE_MATCH:
@@ -1369,14 +1405,14 @@ void mca_pml_ob1_recv_req_start(mca_pml_ob1_recv_request_t *req)
                                   (opal_list_item_t*)frag);
 #endif
             SPC_RECORD(OMPI_SPC_UNEXPECTED_IN_QUEUE, -1);
-            OB1_MATCHING_UNLOCK(&ob1_comm->matching_lock);
+            mca_pml_ob1_match_unlock(ob1_comm, lock_proc);
 
             req->req_recv.req_base.req_addr = frag;
             mca_pml_ob1_recv_request_matched_probe(req, frag->btl,
                                                    frag->segments, frag->num_segments);
 
         } else {
-            OB1_MATCHING_UNLOCK(&ob1_comm->matching_lock);
+            mca_pml_ob1_match_unlock(ob1_comm, lock_proc);
             mca_pml_ob1_recv_request_matched_probe(req, frag->btl,
                                                    frag->segments, frag->num_segments);
         }
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2019 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2008 High Performance Computing Center Stuttgart,
@@ -323,6 +323,7 @@ mca_pml_ob1_frag_completion( mca_btl_base_module_t* btl,
                                                                    des->des_segment_count,
                                                                    sizeof(mca_pml_ob1_frag_hdr_t));
 
+    mca_bml_base_btl_completed(bml_btl, req_bytes_delivered, false);
     OPAL_THREAD_ADD_FETCH32(&sendreq->req_pipeline_depth, -1);
     OPAL_THREAD_ADD_FETCH_SIZE_T(&sendreq->req_bytes_delivered, req_bytes_delivered);
     SPC_USER_OR_MPI(sendreq->req_send.req_base.req_ompi.req_status.MPI_TAG, (ompi_spc_value_t)req_bytes_delivered,
@@ -966,6 +967,14 @@ mca_pml_ob1_send_request_schedule_once(mca_pml_ob1_send_request_t* sendreq)
             return OMPI_ERR_OUT_OF_RESOURCE;
         }
 
+        if(mca_bml_base_adaptive_striping && range->range_btl_cnt > 1) {
+            /* hand the rest of the range to the BTL expected to complete
+             * the next fragment first */
+            range->range_btl_idx = mca_pml_ob1_calc_adaptive_length(range->range_btls,
+                                                                    range->range_btl_cnt,
+                                                                    range->range_send_length, false);
+        }
+
 cannot_pack:
         do {
             btl_idx = range->range_btl_idx;
@@ -1062,6 +1071,7 @@ cannot_pack:
             /* Unclear that this flag needs to be set but to be sure, set it */
             des->des_flags |= MCA_BTL_DES_SEND_ALWAYS_CALLBACK;
             des->des_cbfunc = mca_pml_ob1_copy_frag_completion;
+            mca_bml_base_btl_sent(bml_btl, size);
             range->range_btls[btl_idx].length -= size;
             range->range_send_length -= size;
             range->range_send_offset += size;
@@ -1075,6 +1085,7 @@ cannot_pack:
 #endif /* OPAL_CUDA_SUPPORT */
 
         /* initiate send - note that this may complete before the call returns */
+        mca_bml_base_btl_sent(bml_btl, size);
         rc = mca_bml_base_send(bml_btl, des, MCA_PML_OB1_HDR_TYPE_FRAG);
         if( OPAL_LIKELY(rc >= 0) ) {
             /* update state */
@@ -1087,6 +1098,7 @@ cannot_pack:
                 prev_bytes_remaining = 0;
             }
         } else {
+            mca_bml_base_btl_completed(bml_btl, size, true);
             mca_bml_base_free(bml_btl,des);
         }
     }
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * These symbols are in a file by themselves to provide nice linker
+ * semantics. Since linkers generally pull in symbols by object fules,
+ * keeping these symbols as the only symbols in this file prevents
+ * utility programs such as "ompi_info" from having to import entire
+ * modules just to query their version and parameters
+ */
+
+#include "ompi_config.h"
+#include "mpi.h"
+#include "ompi/group/group.h"
+#include "ompi/proc/proc.h"
+#include "ompi/mca/sharedfp/sharedfp.h"
+#include "ompi/mca/sharedfp/base/base.h"
+#include "ompi/mca/sharedfp/atomic/sharedfp_atomic.h"
+
+/*
+ * *******************************************************************
+ * ************************ actions structure ************************
+ * *******************************************************************
+ */
+ /* IMPORTANT: Update here when adding sharedfp component interface functions*/
+static mca_sharedfp_base_module_1_0_0_t atomic =  {
+    mca_sharedfp_atomic_module_init, /* initalise after being selected */
+    mca_sharedfp_atomic_module_finalize, /* close a module on a communicator */
+    mca_sharedfp_atomic_seek,
+    mca_sharedfp_atomic_get_position,
+    mca_sharedfp_atomic_read,
+    mca_sharedfp_atomic_read_ordered,
+    mca_sharedfp_atomic_read_ordered_begin,
+    mca_sharedfp_atomic_read_ordered_end,
+    mca_sharedfp_atomic_iread,
+    mca_sharedfp_atomic_write,
+    mca_sharedfp_atomic_write_ordered,
+    mca_sharedfp_atomic_write_ordered_begin,
+    mca_sharedfp_atomic_write_ordered_end,
+    mca_sharedfp_atomic_iwrite,
+    mca_sharedfp_atomic_file_open,
+    mca_sharedfp_atomic_file_close
+};
+/*
+ * *******************************************************************
+ * ************************* structure ends **************************
+ * *******************************************************************
+ */
+
+int mca_sharedfp_atomic_component_init_query(bool enable_progress_threads,
+                                             bool enable_mpi_threads)
+{
+    /* Nothing to do */
+
+   return OMPI_SUCCESS;
+}
+
+bool mca_sharedfp_atomic_all_local (struct ompi_communicator_t *comm)
+{
+    ompi_proc_t *proc;
+    int i, size = ompi_comm_size(comm);
+
+    for (i = 0; i < size; ++i) {
+        proc = ompi_group_peer_lookup(comm->c_local_group, i);
+        if (!OPAL_PROC_ON_LOCAL_NODE(proc->super.proc_flags)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct mca_sharedfp_base_module_1_0_0_t * mca_sharedfp_atomic_component_file_query(ompio_file_t *fh, int *priority)
+{
+#if OPAL_HAVE_ATOMIC_MATH_64
+    /* All processes on a single node: the shared file pointer is
+    ** kept in a shared memory segment.
+    */
+    if ( mca_sharedfp_atomic_all_local (fh->f_comm) ) {
+        *priority = mca_sharedfp_atomic_priority;
+        return &atomic;
+    }
+#endif
+
+    /* Otherwise the shared file pointer is exposed by rank 0 through an
+    ** MPI window. This costs a collective window allocation at every file
+    ** open and relies on rank 0 making progress in MPI, so by default the
+    ** module is only used if no other component can run.
+    */
+    opal_output(ompi_sharedfp_base_framework.framework_output,
+                "mca_sharedfp_atomic_component_file_query: (%d/%s) "
+                "not all processes are on the same node, using priority %d.",
+                fh->f_comm->c_contextid, fh->f_comm->c_name,
+                mca_sharedfp_atomic_multinode_priority);
+    *priority = mca_sharedfp_atomic_multinode_priority;
+    return &atomic;
+}
+
+int mca_sharedfp_atomic_component_file_unquery (ompio_file_t *file)
+{
+   /* This function might be needed for some purposes later. for now it
+    * does not have anything to do since there are no steps which need
+    * to be undone if this module is not selected */
+
+   return OMPI_SUCCESS;
+}
+
+int mca_sharedfp_atomic_module_init (ompio_file_t *file)
+{
+    return OMPI_SUCCESS;
+}
+
+
+int mca_sharedfp_atomic_module_finalize (ompio_file_t *file)
+{
+    return OMPI_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef MCA_SHAREDFP_atomic_H
+#define MCA_SHAREDFP_atomic_H
+
+#include "ompi_config.h"
+#include "ompi/mca/mca.h"
+#include "ompi/mca/sharedfp/sharedfp.h"
+#include "ompi/mca/common/ompio/common_ompio.h"
+#include "ompi/win/win.h"
+#include "opal/mca/shmem/shmem.h"
+#include "opal/sys/atomic.h"
+
+BEGIN_C_DECLS
+
+int mca_sharedfp_atomic_component_init_query(bool enable_progress_threads,
+                                             bool enable_mpi_threads);
+struct mca_sharedfp_base_module_1_0_0_t *
+        mca_sharedfp_atomic_component_file_query (ompio_file_t *file, int *priority);
+int mca_sharedfp_atomic_component_file_unquery (ompio_file_t *file);
+bool mca_sharedfp_atomic_all_local (struct ompi_communicator_t *comm);
+
+int mca_sharedfp_atomic_module_init (ompio_file_t *file);
+int mca_sharedfp_atomic_module_finalize (ompio_file_t *file);
+
+extern int mca_sharedfp_atomic_priority;
+extern int mca_sharedfp_atomic_multinode_priority;
+extern bool mca_sharedfp_atomic_window;
+extern int mca_sharedfp_atomic_verbose;
+
+OMPI_MODULE_DECLSPEC extern mca_sharedfp_base_component_2_0_0_t mca_sharedfp_atomic_component;
+/*
+ * ******************************************************************
+ * ********* functions which are implemented in this module *********
+ * ******************************************************************
+ */
+/*IMPORANT: Update here when implementing functions from sharedfp API*/
+int mca_sharedfp_atomic_seek (ompio_file_t *fh,
+                              OMPI_MPI_OFFSET_TYPE offset, int whence);
+int mca_sharedfp_atomic_get_position (ompio_file_t *fh,
+                                      OMPI_MPI_OFFSET_TYPE * offset);
+int mca_sharedfp_atomic_file_open (struct ompi_communicator_t *comm,
+                                   const char* filename,
+                                   int amode,
+                                   struct opal_info_t *info,
+                                   ompio_file_t *fh);
+int mca_sharedfp_atomic_file_close (ompio_file_t *fh);
+int mca_sharedfp_atomic_read (ompio_file_t *fh,
+                              void *buf, int count, MPI_Datatype datatype, MPI_Status *status);
+int mca_sharedfp_atomic_read_ordered (ompio_file_t *fh,
+                                      void *buf, int count, struct ompi_datatype_t *datatype,
+                                      ompi_status_public_t *status
+                                      );
+int mca_sharedfp_atomic_read_ordered_begin (ompio_file_t *fh,
+                                            void *buf,
+                                            int count,
+                                            struct ompi_datatype_t *datatype);
+int mca_sharedfp_atomic_read_ordered_end (ompio_file_t *fh,
+                                          void *buf,
+                                          ompi_status_public_t *status);
+int mca_sharedfp_atomic_iread (ompio_file_t *fh,
+                               void *buf,
+                               int count,
+                               struct ompi_datatype_t *datatype,
+                               ompi_request_t **request);
+int mca_sharedfp_atomic_write (ompio_file_t *fh,
+                               const void *buf,
+                               int count,
+                               struct ompi_datatype_t *datatype,
+                               ompi_status_public_t *status);
+int mca_sharedfp_atomic_write_ordered (ompio_file_t *fh,
+                                       const void *buf,
+                                       int count,
+                                       struct ompi_datatype_t *datatype,
+                                       ompi_status_public_t *status);
+int mca_sharedfp_atomic_write_ordered_begin (ompio_file_t *fh,
+                                             const void *buf,
+                                             int count,
+                                             struct ompi_datatype_t *datatype);
+int mca_sharedfp_atomic_write_ordered_end (ompio_file_t *fh,
+                                           const void *buf,
+                                           ompi_status_public_t *status);
+int mca_sharedfp_atomic_iwrite (ompio_file_t *fh,
+                                const void *buf,
+                                int count,
+                                struct ompi_datatype_t *datatype,
+                                ompi_request_t **request);
+/*--------------------------------------------------------------*
+ *Structures and definitions only for this component
+ *--------------------------------------------------------------*/
+
+/*This structure will hang off of the mca_sharedfp_base_data_t's
+ *selected_module_data attribute.
+ *
+ *If all processes share a node, the shared file pointer lives in a
+ *shared memory segment and is updated with atomic fetch-and-add.
+ *Otherwise it is exposed by rank 0 through an MPI window and updated
+ *with one-sided fetch-and-op operations. In neither case does any
+ *process ever hold a lock on the shared file pointer. If the window
+ *cannot be created, both pointers stay NULL and the shared file
+ *pointer operations fail.
+ */
+struct mca_sharedfp_atomic_data
+{
+    opal_atomic_int64_t *offset_ptr;   /* shared memory case */
+    opal_shmem_ds_t      seg_ds;
+    struct ompi_win_t   *win;          /* multi-node case */
+    OMPI_MPI_OFFSET_TYPE *win_base;
+};
+
+typedef struct mca_sharedfp_atomic_data atomic_data;
+
+
+int mca_sharedfp_atomic_request_position (ompio_file_t *fh,
+                                          OMPI_MPI_OFFSET_TYPE bytes_requested,
+                                          OMPI_MPI_OFFSET_TYPE * offset);
+int mca_sharedfp_atomic_set_position (ompio_file_t *fh,
+                                      OMPI_MPI_OFFSET_TYPE offset);
+/*
+ * ******************************************************************
+ * ************ functions implemented in this module end ************
+ * ******************************************************************
+ */
+
+END_C_DECLS
+
+#endif /* MCA_SHAREDFP_atomic_H */
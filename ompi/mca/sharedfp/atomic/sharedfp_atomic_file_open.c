@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+
+#include "ompi_config.h"
+#include "sharedfp_atomic.h"
+
+#include "mpi.h"
+#include "ompi/constants.h"
+#include "ompi/proc/proc.h"
+#include "ompi/info/info.h"
+#include "ompi/mca/osc/osc.h"
+#include "ompi/mca/rte/rte.h"
+#include "ompi/mca/sharedfp/sharedfp.h"
+#include "ompi/mca/sharedfp/base/base.h"
+#include "opal/mca/shmem/base/base.h"
+#include "opal/util/printf.h"
+
+#if OPAL_HAVE_ATOMIC_MATH_64
+static int sharedfp_atomic_segment_open (struct ompi_communicator_t *comm,
+                                         ompio_file_t *fh,
+                                         struct mca_sharedfp_atomic_data *atomic_data)
+{
+    int ret = OMPI_SUCCESS, all_ret, coll_ret;
+    char *seg_file = NULL;
+    void *seg_base;
+
+    /* the segment is created and initialized by rank 0 */
+    if ( 0 == fh->f_rank ) {
+        if ( 0 > opal_asprintf (&seg_file, "%s" OPAL_PATH_SEP "sharedfp_atomic_cid-%d-%d.sm",
+                                ompi_process_info.job_session_dir, ompi_comm_get_cid(comm),
+                                (int) OMPI_PROC_MY_NAME->vpid) ) {
+            ret = OMPI_ERR_OUT_OF_RESOURCE;
+        }
+        else {
+            ret = opal_shmem_segment_create (&atomic_data->seg_ds, seg_file, sizeof(opal_atomic_int64_t));
+            free (seg_file);
+        }
+        if ( OMPI_SUCCESS == ret ) {
+            seg_base = opal_shmem_segment_attach (&atomic_data->seg_ds);
+            if ( NULL == seg_base ) {
+                opal_shmem_unlink (&atomic_data->seg_ds);
+                ret = OMPI_ERROR;
+            }
+            else {
+                atomic_data->offset_ptr = (opal_atomic_int64_t *) seg_base;
+                *atomic_data->offset_ptr = 0;
+                opal_atomic_wmb ();
+            }
+        }
+    }
+
+    coll_ret = comm->c_coll->coll_bcast (&ret, 1, MPI_INT, 0, comm, comm->c_coll->coll_bcast_module);
+    if ( OMPI_SUCCESS != coll_ret || OMPI_SUCCESS != ret ) {
+        return ( OMPI_SUCCESS != ret ) ? ret : coll_ret;
+    }
+
+    ret = comm->c_coll->coll_bcast (&atomic_data->seg_ds, sizeof(atomic_data->seg_ds), MPI_BYTE, 0,
+                                    comm, comm->c_coll->coll_bcast_module);
+    if ( OMPI_SUCCESS != ret ) {
+        return ret;
+    }
+
+    if ( 0 != fh->f_rank ) {
+        seg_base = opal_shmem_segment_attach (&atomic_data->seg_ds);
+        atomic_data->offset_ptr = (opal_atomic_int64_t *) seg_base;
+        ret = ( NULL == seg_base ) ? OMPI_ERROR : OMPI_SUCCESS;
+    }
+
+    /* wait for all processes to attach before the backing file disappears */
+    coll_ret = comm->c_coll->coll_allreduce (&ret, &all_ret, 1, MPI_INT, MPI_MIN, comm,
+                                             comm->c_coll->coll_allreduce_module);
+    if ( 0 == fh->f_rank ) {
+        opal_shmem_unlink (&atomic_data->seg_ds);
+    }
+    if ( OMPI_SUCCESS != coll_ret || OMPI_SUCCESS != all_ret ) {
+        if ( NULL != atomic_data->offset_ptr ) {
+            opal_shmem_segment_detach (&atomic_data->seg_ds);
+            atomic_data->offset_ptr = NULL;
+        }
+        return OMPI_ERROR;
+    }
+
+    return OMPI_SUCCESS;
+}
+#endif
+
+static int sharedfp_atomic_window_open (struct ompi_communicator_t *comm,
+                                        ompio_file_t *fh,
+                                        struct mca_sharedfp_atomic_data *atomic_data)
+{
+    int ret, all_ret, coll_ret;
+
+    /* only rank 0 exposes memory, holding the shared file pointer */
+    ret = ompi_win_allocate ( (0 == fh->f_rank) ? sizeof(OMPI_MPI_OFFSET_TYPE) : 0,
+                              sizeof(OMPI_MPI_OFFSET_TYPE), &(MPI_INFO_NULL->super),
+                              comm, &atomic_data->win_base, &atomic_data->win );
+    if ( OMPI_SUCCESS != ret ) {
+        atomic_data->win = NULL;
+        return ret;
+    }
+    if ( 0 == fh->f_rank ) {
+        *atomic_data->win_base = 0;
+    }
+
+    /* the passive target epoch stays open until the file is closed */
+    ret = atomic_data->win->w_osc_module->osc_lock_all (MPI_MODE_NOCHECK, atomic_data->win);
+
+    /* all processes have to agree on whether the window is usable */
+    coll_ret = comm->c_coll->coll_allreduce (&ret, &all_ret, 1, MPI_INT, MPI_MIN, comm,
+                                             comm->c_coll->coll_allreduce_module);
+    if ( OMPI_SUCCESS != coll_ret || OMPI_SUCCESS != all_ret ) {
+        if ( OMPI_SUCCESS == ret ) {
+            atomic_data->win->w_osc_module->osc_unlock_all (atomic_data->win);
+        }
+        ompi_win_free (atomic_data->win);
+        atomic_data->win = NULL;
+        return OMPI_ERROR;
+    }
+
+    return OMPI_SUCCESS;
+}
+
+int mca_sharedfp_atomic_file_open (struct ompi_communicator_t *comm,
+                                   const char* filename,
+                                   int amode,
+                                   struct opal_info_t *info,
+                                   ompio_file_t *fh)
+{
+    int err = OMPI_SUCCESS;
+    struct mca_sharedfp_base_data_t* sh;
+    struct mca_sharedfp_atomic_data * atomic_data = NULL;
+
+    /*Memory is allocated here for the sh structure*/
+    if ( mca_sharedfp_atomic_verbose ) {
+        opal_output(ompi_sharedfp_base_framework.framework_output,
+                    "mca_sharedfp_atomic_file_open: malloc f_sharedfp_ptr struct\n");
+    }
+
+    sh = (struct mca_sharedfp_base_data_t*)malloc(sizeof(struct mca_sharedfp_base_data_t));
+    if ( NULL == sh ) {
+        opal_output(0, "mca_sharedfp_atomic_file_open: Error, unable to malloc f_sharedfp  struct\n");
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+
+    /*Populate the sh file structure based on the implementation*/
+    sh->global_offset = 0;                        /* Global Offset*/
+    sh->selected_module_data = NULL;
+
+    atomic_data = (struct mca_sharedfp_atomic_data*) calloc (1, sizeof(struct mca_sharedfp_atomic_data));
+    if ( NULL == atomic_data ){
+        opal_output(0, "mca_sharedfp_atomic_file_open: Error, unable to malloc atomic_data struct\n");
+        free(sh);
+        return OMPI_ERR_OUT_OF_RESOURCE;
+    }
+
+#if OPAL_HAVE_ATOMIC_MATH_64
+    if ( !mca_sharedfp_atomic_window && mca_sharedfp_atomic_all_local (comm) ) {
+        if ( mca_sharedfp_atomic_verbose ) {
+            opal_output(ompi_sharedfp_base_framework.framework_output,
+                        "mca_sharedfp_atomic_file_open: using a shared memory segment\n");
+        }
+        err = sharedfp_atomic_segment_open (comm, fh, atomic_data);
+    }
+    else
+#endif
+    {
+        if ( mca_sharedfp_atomic_verbose ) {
+            opal_output(ompi_sharedfp_base_framework.framework_output,
+                        "mca_sharedfp_atomic_file_open: using an MPI window\n");
+        }
+        err = sharedfp_atomic_window_open (comm, fh, atomic_data);
+        if ( OMPI_SUCCESS != err ) {
+            /* No one-sided support for this communicator. Do not fail
+            ** the file open because of it: only the shared file pointer
+            ** operations will report an error if they are ever used.
+            */
+            opal_output(ompi_sharedfp_base_framework.framework_output,
+                        "mca_sharedfp_atomic_file_open: unable to create an MPI window, "
+                        "shared file pointer operations are not available\n");
+            err = OMPI_SUCCESS;
+        }
+    }
+
+    if ( OMPI_SUCCESS != err ) {
+        opal_output(0, "mca_sharedfp_atomic_file_open: Error, unable to set up the shared file pointer\n");
+        free(atomic_data);
+        free(sh);
+        return err;
+    }
+
+    /* Assign the atomic_data to sh->selected_module_data*/
+    sh->selected_module_data = atomic_data;
+    /*remember the shared file handle*/
+    fh->f_sharedfp_data = sh;
+
+    return OMPI_SUCCESS;
+}
+
+int mca_sharedfp_atomic_file_close (ompio_file_t *fh)
+{
+    int err = OMPI_SUCCESS;
+    /*sharedfp data structure*/
+    struct mca_sharedfp_base_data_t *sh=NULL;
+    /*sharedfp atomic module data structure*/
+    struct mca_sharedfp_atomic_data * file_data=NULL;
+
+    if( NULL == fh->f_sharedfp_data ){
+        return OMPI_SUCCESS;
+    }
+    sh = fh->f_sharedfp_data;
+
+    /* Use an MPI Barrier in order to make sure that
+     * all processes are ready to release the
+     * shared file pointer resources
+     */
+    fh->f_comm->c_coll->coll_barrier (fh->f_comm, fh->f_comm->c_coll->coll_barrier_module );
+
+    file_data = (atomic_data*)(sh->selected_module_data);
+    if (file_data)  {
+        if ( NULL != file_data->win ) {
+            file_data->win->w_osc_module->osc_unlock_all (file_data->win);
+            err = ompi_win_free (file_data->win);
+        }
+        else if ( NULL != file_data->offset_ptr ) {
+            opal_shmem_segment_detach (&file_data->seg_ds);
+        }
+        free(file_data);
+    }
+
+    /*free shared file pointer data struct*/
+    free(sh);
+    fh->f_sharedfp_data = NULL;
+
+    return err;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+
+#include "ompi_config.h"
+#include "sharedfp_atomic.h"
+
+#include "mpi.h"
+#include "ompi/constants.h"
+#include "ompi/op/op.h"
+#include "ompi/mca/osc/osc.h"
+#include "ompi/mca/sharedfp/sharedfp.h"
+#include "ompi/mca/sharedfp/base/base.h"
+
+/* Atomically advance the shared file pointer by bytes_requested
+** and return its previous value in offset.
+*/
+int mca_sharedfp_atomic_request_position(ompio_file_t *fh,
+                                         OMPI_MPI_OFFSET_TYPE bytes_requested,
+                                         OMPI_MPI_OFFSET_TYPE *offset)
+{
+    int ret = OMPI_SUCCESS;
+    OMPI_MPI_OFFSET_TYPE old_offset = 0;
+    struct mca_sharedfp_atomic_data * atomic_data = NULL;
+    struct mca_sharedfp_base_data_t *sh = NULL;
+
+    sh = fh->f_sharedfp_data;
+    atomic_data = sh->selected_module_data;
+
+    *offset = 0;
+    if ( NULL == atomic_data->win && NULL == atomic_data->offset_ptr ) {
+        opal_output(0, "mca_sharedfp_atomic_request_position: no shared file pointer available\n");
+        return OMPI_ERR_NOT_AVAILABLE;
+    }
+    if ( NULL != atomic_data->win ) {
+        ret = atomic_data->win->w_osc_module->osc_fetch_and_op (&bytes_requested, &old_offset,
+                                                                OMPI_OFFSET_DATATYPE, 0, 0,
+                                                                MPI_SUM, atomic_data->win);
+        if ( OMPI_SUCCESS == ret ) {
+            ret = atomic_data->win->w_osc_module->osc_flush (0, atomic_data->win);
+        }
+        if ( OMPI_SUCCESS != ret ) {
+            return ret;
+        }
+    }
+    else {
+#if OPAL_HAVE_ATOMIC_MATH_64
+        old_offset = opal_atomic_fetch_add_64 (atomic_data->offset_ptr, (int64_t) bytes_requested);
+#endif
+    }
+
+    if ( mca_sharedfp_atomic_verbose ) {
+        opal_output(ompi_sharedfp_base_framework.framework_output,
+                    "old_offset=%lld, bytes_requested=%lld, new offset=%lld, rank=%d\n",
+                    old_offset, bytes_requested, old_offset + bytes_requested, fh->f_rank);
+    }
+
+    *offset = old_offset;
+
+    return ret;
+}
+
+/* Overwrite the shared file pointer. Only used by rank 0 in seek,
+** which synchronizes with all other processes afterwards.
+*/
+int mca_sharedfp_atomic_set_position(ompio_file_t *fh,
+                                     OMPI_MPI_OFFSET_TYPE offset)
+{
+    int ret = OMPI_SUCCESS;
+    OMPI_MPI_OFFSET_TYPE old_offset;
+    struct mca_sharedfp_atomic_data * atomic_data = NULL;
+    struct mca_sharedfp_base_data_t *sh = NULL;
+
+    sh = fh->f_sharedfp_data;
+    atomic_data = sh->selected_module_data;
+
+    if ( NULL == atomic_data->win && NULL == atomic_data->offset_ptr ) {
+        return OMPI_ERR_NOT_AVAILABLE;
+    }
+    if ( NULL != atomic_data->win ) {
+        ret = atomic_data->win->w_osc_module->osc_fetch_and_op (&offset, &old_offset,
+                                                                OMPI_OFFSET_DATATYPE, 0, 0,
+                                                                MPI_REPLACE, atomic_data->win);
+        if ( OMPI_SUCCESS == ret ) {
+            ret = atomic_data->win->w_osc_module->osc_flush (0, atomic_data->win);
+        }
+    }
+    else {
+#if OPAL_HAVE_ATOMIC_MATH_64
+        (void) opal_atomic_swap_64 (atomic_data->offset_ptr, (int64_t) offset);
+#endif
+    }
+
+    return ret;
+}
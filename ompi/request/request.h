@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -395,7 +395,9 @@ static inline int ompi_request_free(ompi_request_t** request)
 
 static inline void ompi_request_wait_completion(ompi_request_t *req)
 {
-    if (opal_using_threads () && !REQUEST_COMPLETE(req)) {
+    /* blocking waits go through a sync object, whose count the
+     * progress engine can wait on */
+    if ((opal_using_threads () || opal_progress_wait_block) && !REQUEST_COMPLETE(req)) {
         void *_tmp_ptr = REQUEST_PENDING;
         ompi_wait_sync_t sync;
 
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2010 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2014 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -46,6 +46,7 @@
 #include "opal/mca/base/base.h"
 #include "opal/mca/hwloc/base/base.h"
 #include "opal/runtime/opal_progress.h"
+#include "opal/runtime/opal_progress_threads.h"
 #include "opal/threads/threads.h"
 #include "opal/util/arch.h"
 #include "opal/util/argv.h"
@@ -383,6 +384,7 @@ int ompi_mpi_init(int argc, char **argv, int requested, int *provided,
     opal_value_t *kv;
     volatile bool active;
     bool background_fence = false;
+    bool enable_mpi_threads;
 
     OMPI_TIMING_INIT(64);
 
@@ -440,6 +442,15 @@ int ompi_mpi_init(int argc, char **argv, int requested, int *provided,
         opal_set_using_threads(true);
     }
 
+    /* An asynchronous progress thread enters the stack concurrently
+     * with the application, whatever the thread level it asked for:
+     * the provided level is left untouched, but the internals must be
+     * protected, and the components selected accordingly. */
+    if (opal_progress_async) {
+        opal_set_using_threads(true);
+    }
+    enable_mpi_threads = ompi_mpi_thread_multiple || opal_progress_async;
+
     /* Convince OPAL to use our naming scheme */
     opal_process_name_print = _process_name_print_for_opal;
     opal_compare_proc = _process_name_compare;
@@ -586,7 +597,7 @@ int ompi_mpi_init(int argc, char **argv, int requested, int *provided,
     }
     if (OMPI_SUCCESS !=
         (ret = ompi_op_base_find_available(OPAL_ENABLE_PROGRESS_THREADS,
-                                           ompi_mpi_thread_multiple))) {
+                                           enable_mpi_threads))) {
         error = "ompi_op_base_find_available() failed";
         goto error;
     }
@@ -613,7 +624,7 @@ int ompi_mpi_init(int argc, char **argv, int requested, int *provided,
         error = "mca_bml_base_open() failed";
         goto error;
     }
-    if (OMPI_SUCCESS != (ret = mca_bml_base_init (1, ompi_mpi_thread_multiple))) {
+    if (OMPI_SUCCESS != (ret = mca_bml_base_init (1, enable_mpi_threads))) {
         error = "mca_bml_base_init() failed";
         goto error;
     }
@@ -648,7 +659,7 @@ int ompi_mpi_init(int argc, char **argv, int requested, int *provided,
 
     if (OMPI_SUCCESS !=
         (ret = mca_pml_base_select(OPAL_ENABLE_PROGRESS_THREADS,
-                                   ompi_mpi_thread_multiple))) {
+                                   enable_mpi_threads))) {
         error = "mca_pml_base_select() failed";
         goto error;
     }
@@ -728,21 +739,21 @@ int ompi_mpi_init(int argc, char **argv, int requested, int *provided,
 
     /* select buffered send allocator component to be used */
     if( OMPI_SUCCESS !=
-        (ret = mca_pml_base_bsend_init(ompi_mpi_thread_multiple))) {
+        (ret = mca_pml_base_bsend_init(enable_mpi_threads))) {
         error = "mca_pml_base_bsend_init() failed";
         goto error;
     }
 
     if (OMPI_SUCCESS !=
         (ret = mca_coll_base_find_available(OPAL_ENABLE_PROGRESS_THREADS,
-                                            ompi_mpi_thread_multiple))) {
+                                            enable_mpi_threads))) {
         error = "mca_coll_base_find_available() failed";
         goto error;
     }
 
     if (OMPI_SUCCESS !=
         (ret = ompi_osc_base_find_available(OPAL_ENABLE_PROGRESS_THREADS,
-                                            ompi_mpi_thread_multiple))) {
+                                            enable_mpi_threads))) {
         error = "ompi_osc_base_find_available() failed";
         goto error;
     }
@@ -1012,6 +1023,12 @@ int ompi_mpi_init(int argc, char **argv, int requested, int *provided,
         goto error;
     }
 
+    /* Everything is in place, let the progress engine run on its own */
+    if (OMPI_SUCCESS != (ret = opal_progress_async_start())) {
+        error = "opal_progress_async_start";
+        goto error;
+    }
+
     /* Fall through */
  error:
     if (ret != OMPI_SUCCESS) {
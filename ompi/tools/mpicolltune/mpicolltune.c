@@ -0,0 +1,760 @@
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * mpicolltune: measure every algorithm exported by the coll/tuned
+ * component over a range of communicator and message sizes and write
+ * the fastest choices as a coll/tuned dynamic rules file (the format
+ * read by ompi_coll_tuned_read_rules_config_file).
+ *
+ * The algorithm under test is forced through the MPI_T control
+ * variables coll_tuned_<coll>_algorithm and
+ * coll_tuned_<coll>_algorithm_segmentsize.  coll/tuned only looks at
+ * these when a module is enabled on a communicator, so each
+ * (algorithm, segment size) pair is measured on a freshly duplicated
+ * communicator.
+ */
+
+#include "opal_config.h"
+
+#include <stdio.h>
+#include <mpi.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#define MAX_SEGSIZES   16
+#define MAX_COMM_SIZES 64
+#define MAX_MSG_SIZES  64
+
+/* how coll_tuned_decision_dynamic.c uses the message size of a rule */
+typedef enum {
+    MSG_RULES,     /* one rule per message size range */
+    MSG_FIRST,     /* only the first rule is ever used (alltoallv) */
+    MSG_NONE       /* no payload (barrier) */
+} tune_msg_kind_t;
+
+typedef int (*tune_run_fn_t)(MPI_Comm comm, int size, size_t msg,
+                             void *sbuf, void *rbuf, int *counts, int *disps);
+
+typedef struct {
+    const char *name;           /* as in coll_tuned_<name>_algorithm */
+    int id;                     /* COLLTYPE, see coll_base_functions.h */
+    tune_msg_kind_t kind;
+    /* algorithms honoring the segment size (bit n set for algorithm n);
+     * keep in sync with the ompi_coll_tuned_<name>_intra_do_this */
+    uint32_t segmented;
+    /* the fanout given to the forced algorithms, as in
+     * coll_tuned_<name>_algorithm_<fanout>; keep in sync with
+     * coll_tuned_decision_dynamic.c */
+    const char *fanout;
+    tune_run_fn_t run;
+} tune_coll_t;
+
+typedef struct {
+    size_t msg;
+    int alg;
+    int faninout;
+    int segsize;
+} tune_choice_t;
+
+static int run_allgather(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_allgatherv(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_allreduce(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_alltoall(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_alltoallv(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_barrier(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_bcast(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_exscan(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_gather(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_reduce(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_reduce_scatter(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_reduce_scatter_block(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_scan(MPI_Comm, int, size_t, void *, void *, int *, int *);
+static int run_scatter(MPI_Comm, int, size_t, void *, void *, int *, int *);
+
+#define ALG(n) (1u << (n))
+
+static const tune_coll_t tune_colls[] = {
+    { "allgather",             0, MSG_RULES, 0, "tree_fanout", run_allgather },
+    { "allgatherv",            1, MSG_RULES, 0, "tree_fanout", run_allgatherv },
+    { "allreduce",             2, MSG_RULES, ALG(5) | ALG(8), "tree_fanout", run_allreduce },
+    { "alltoall",              3, MSG_RULES, 0, "tree_fanout", run_alltoall },
+    { "alltoallv",             4, MSG_FIRST, 0, NULL, run_alltoallv },
+    { "barrier",               6, MSG_NONE,  0, NULL, run_barrier },
+    { "bcast",                 7, MSG_RULES,
+      ALG(2) | ALG(3) | ALG(4) | ALG(5) | ALG(6) | ALG(7) | ALG(8) | ALG(9), "chain_fanout",
+      run_bcast },
+    { "exscan",                8, MSG_RULES, 0, NULL, run_exscan },
+    { "gather",                9, MSG_RULES, ALG(3), "tree_fanout", run_gather },
+    { "reduce",               11, MSG_RULES,
+      ALG(2) | ALG(3) | ALG(4) | ALG(5) | ALG(6), "chain_fanout", run_reduce },
+    { "reduce_scatter",       12, MSG_RULES, 0, "chain_fanout", run_reduce_scatter },
+    { "reduce_scatter_block", 13, MSG_RULES, 0, "chain_fanout", run_reduce_scatter_block },
+    { "scan",                 14, MSG_RULES, 0, NULL, run_scan },
+    { "scatter",              15, MSG_RULES, 0, "chain_fanout", run_scatter },
+};
+#define NUM_TUNE_COLLS ((int)(sizeof(tune_colls) / sizeof(tune_colls[0])))
+
+static char *filename = NULL;
+static char *coll_list = NULL;
+static size_t min_msg = 1;
+static size_t max_msg = 1 << 22;
+static int iterations = 20;
+static int warmup = 2;
+static int verbose = 0;
+static int comm_sizes[MAX_COMM_SIZES];
+static int num_comm_sizes = 0;
+static int segsizes[MAX_SEGSIZES];
+static int num_segsizes = 0;
+
+static void print_help(char *progname)
+{
+    printf("Usage: %s -o <rules file> [options]\n"
+           "  -o, --output <file>        dynamic rules file to write\n"
+           "  -c, --colls <list>         comma separated collectives to tune (default: all)\n"
+           "  -p, --comm-sizes <list>    communicator sizes (default: powers of two and the job size)\n"
+           "  -m, --min-msg <bytes>      smallest message size (default: %lu)\n"
+           "  -M, --max-msg <bytes>      largest message size (default: %lu)\n"
+           "  -s, --segsizes <list>      search these segment sizes for segmented algorithms\n"
+           "  -i, --iterations <n>       timed iterations per measurement (default: %d)\n"
+           "  -w, --warmup <n>           untimed iterations per measurement (default: %d)\n"
+           "  -v, --verbose              print every measurement\n"
+           "  -h, --help                 print this help\n",
+           progname, (unsigned long)min_msg, (unsigned long)max_msg, iterations, warmup);
+}
+
+static int parse_int_list(const char *str, int *list, int max)
+{
+    char *copy = strdup(str), *tok, *save = NULL;
+    int n = 0;
+
+    if (NULL == copy) {
+        return -1;
+    }
+    for (tok = strtok_r(copy, ",", &save); NULL != tok; tok = strtok_r(NULL, ",", &save)) {
+        if (n == max) {
+            free(copy);
+            return -1;
+        }
+        list[n] = atoi(tok);
+        if (list[n] < 0) {
+            free(copy);
+            return -1;
+        }
+        n++;
+    }
+    free(copy);
+    return n;
+}
+
+static int parse_opts(int rank, int argc, char **argv)
+{
+    while (1) {
+        int option_index = 0;
+        static struct option long_options[] = {
+            {"output",     required_argument, 0, 'o' },
+            {"colls",      required_argument, 0, 'c' },
+            {"comm-sizes", required_argument, 0, 'p' },
+            {"min-msg",    required_argument, 0, 'm' },
+            {"max-msg",    required_argument, 0, 'M' },
+            {"segsizes",   required_argument, 0, 's' },
+            {"iterations", required_argument, 0, 'i' },
+            {"warmup",     required_argument, 0, 'w' },
+            {"verbose",    no_argument,       0, 'v' },
+            {"help",       no_argument,       0, 'h' },
+            { 0,           0,                 0, 0   } };
+
+        int c = getopt_long(argc, argv, "o:c:p:m:M:s:i:w:vh",
+                            long_options, &option_index);
+        if (c == -1)
+            break;
+        switch (c) {
+        case 'h':
+            if (rank == 0)
+                print_help(argv[0]);
+            return 1;
+        case 'o':
+            filename = optarg;
+            break;
+        case 'c':
+            coll_list = optarg;
+            break;
+        case 'p':
+            num_comm_sizes = parse_int_list(optarg, comm_sizes, MAX_COMM_SIZES);
+            if (num_comm_sizes <= 0) {
+                return -1;
+            }
+            break;
+        case 'm':
+            min_msg = strtoul(optarg, NULL, 0);
+            break;
+        case 'M':
+            max_msg = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            num_segsizes = parse_int_list(optarg, segsizes, MAX_SEGSIZES);
+            if (num_segsizes <= 0) {
+                return -1;
+            }
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            return -1;
+        }
+    }
+    if (NULL == filename || iterations < 1 || warmup < 0 ||
+        0 == min_msg || max_msg < min_msg) {
+        if (rank == 0)
+            print_help(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+static int coll_selected(const char *name)
+{
+    char *copy, *tok, *save = NULL;
+    int found = 0;
+
+    if (NULL == coll_list) {
+        return 1;
+    }
+    copy = strdup(coll_list);
+    if (NULL == copy) {
+        return 0;
+    }
+    for (tok = strtok_r(copy, ",", &save); NULL != tok; tok = strtok_r(NULL, ",", &save)) {
+        if (0 == strcmp(tok, name)) {
+            found = 1;
+            break;
+        }
+    }
+    free(copy);
+    return found;
+}
+
+/*
+ * Each runner receives the rule message size and derives the counts
+ * coll/tuned will see.  They return 0 when the size cannot be expressed
+ * for this communicator (e.g. a per-rank block of zero bytes).
+ */
+
+#define BLOCK_COUNT(msg, size) ((int)((msg) / (size_t)(size)))
+#define DOUBLE_COUNT(msg) ((int)((msg) / sizeof(double)))
+
+static int run_allgather(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                         int *counts, int *disps)
+{
+    int count = BLOCK_COUNT(msg, size);
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Allgather(sbuf, count, MPI_BYTE, rbuf, count, MPI_BYTE, comm) ? 1 : -1;
+}
+
+static int run_allgatherv(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                          int *counts, int *disps)
+{
+    int i, count = BLOCK_COUNT(msg, size);
+    if (0 == count) return 0;
+    for (i = 0; i < size; ++i) {
+        counts[i] = count;
+        disps[i] = i * count;
+    }
+    return MPI_SUCCESS == MPI_Allgatherv(sbuf, count, MPI_BYTE, rbuf, counts, disps,
+                                         MPI_BYTE, comm) ? 1 : -1;
+}
+
+static int run_allreduce(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                         int *counts, int *disps)
+{
+    int count = DOUBLE_COUNT(msg);
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Allreduce(sbuf, rbuf, count, MPI_DOUBLE, MPI_SUM, comm) ? 1 : -1;
+}
+
+static int run_alltoall(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                        int *counts, int *disps)
+{
+    int count = BLOCK_COUNT(msg, size);
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Alltoall(sbuf, count, MPI_BYTE, rbuf, count, MPI_BYTE, comm) ? 1 : -1;
+}
+
+static int run_alltoallv(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                         int *counts, int *disps)
+{
+    int i, count = BLOCK_COUNT(msg, size);
+    if (0 == count) return 0;
+    for (i = 0; i < size; ++i) {
+        counts[i] = count;
+        disps[i] = i * count;
+    }
+    return MPI_SUCCESS == MPI_Alltoallv(sbuf, counts, disps, MPI_BYTE,
+                                        rbuf, counts, disps, MPI_BYTE, comm) ? 1 : -1;
+}
+
+static int run_barrier(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                       int *counts, int *disps)
+{
+    return MPI_SUCCESS == MPI_Barrier(comm) ? 1 : -1;
+}
+
+static int run_bcast(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                     int *counts, int *disps)
+{
+    return MPI_SUCCESS == MPI_Bcast(sbuf, (int)msg, MPI_BYTE, 0, comm) ? 1 : -1;
+}
+
+static int run_exscan(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                      int *counts, int *disps)
+{
+    int count = DOUBLE_COUNT(msg);
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Exscan(sbuf, rbuf, count, MPI_DOUBLE, MPI_SUM, comm) ? 1 : -1;
+}
+
+static int run_gather(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                      int *counts, int *disps)
+{
+    int count = BLOCK_COUNT(msg, size);
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Gather(sbuf, count, MPI_BYTE, rbuf, count, MPI_BYTE, 0, comm) ? 1 : -1;
+}
+
+static int run_reduce(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                      int *counts, int *disps)
+{
+    int count = DOUBLE_COUNT(msg);
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Reduce(sbuf, rbuf, count, MPI_DOUBLE, MPI_SUM, 0, comm) ? 1 : -1;
+}
+
+static int run_reduce_scatter(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                              int *counts, int *disps)
+{
+    int i, count = DOUBLE_COUNT(msg) / size;
+    if (0 == count) return 0;
+    for (i = 0; i < size; ++i) {
+        counts[i] = count;
+    }
+    return MPI_SUCCESS == MPI_Reduce_scatter(sbuf, rbuf, counts, MPI_DOUBLE, MPI_SUM, comm) ? 1 : -1;
+}
+
+static int run_reduce_scatter_block(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                                    int *counts, int *disps)
+{
+    int count = DOUBLE_COUNT(msg) / size;
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Reduce_scatter_block(sbuf, rbuf, count, MPI_DOUBLE,
+                                                   MPI_SUM, comm) ? 1 : -1;
+}
+
+static int run_scan(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                    int *counts, int *disps)
+{
+    int count = DOUBLE_COUNT(msg);
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Scan(sbuf, rbuf, count, MPI_DOUBLE, MPI_SUM, comm) ? 1 : -1;
+}
+
+static int run_scatter(MPI_Comm comm, int size, size_t msg, void *sbuf, void *rbuf,
+                       int *counts, int *disps)
+{
+    int count = BLOCK_COUNT(msg, size);
+    if (0 == count) return 0;
+    return MPI_SUCCESS == MPI_Scatter(sbuf, count, MPI_BYTE, rbuf, count, MPI_BYTE, 0, comm) ? 1 : -1;
+}
+
+static int cvar_handle(const char *name, MPI_T_cvar_handle *handle)
+{
+    int index, count;
+
+    if (MPI_SUCCESS != MPI_T_cvar_get_index(name, &index)) {
+        return -1;
+    }
+    if (MPI_SUCCESS != MPI_T_cvar_handle_alloc(index, NULL, handle, &count) || 1 != count) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Set a control variable on every rank of comm.  The ranks agree on the
+ * outcome, so that they either all run with the new value or all skip.
+ */
+static int cvar_write_all(MPI_Comm comm, MPI_T_cvar_handle handle, const char *coll,
+                          const char *what, int value)
+{
+    int rc, ok;
+
+    rc = MPI_T_cvar_write(handle, &value);
+    if (MPI_SUCCESS != rc) {
+        fprintf(stderr, "Fail to set the %s %s to %d (MPI_T error %d)\n", coll, what, value, rc);
+    }
+    ok = (MPI_SUCCESS == rc) ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+    return ok ? 0 : -1;
+}
+
+/*
+ * Time one (algorithm, segment size) pair for every message size on a
+ * fresh duplicate of comm.  times[i] is the slowest rank's average, or
+ * a negative value when the size is not applicable or the algorithm
+ * refused to run.  Returns -1 if the algorithm could not be forced or
+ * reset, in which case the results of the collective are meaningless.
+ */
+static int measure(const tune_coll_t *coll, MPI_Comm comm, int nmsgs, const size_t *msgs,
+                    MPI_T_cvar_handle alg_handle, MPI_T_cvar_handle seg_handle,
+                    int alg, int segsize, void *sbuf, void *rbuf, int *counts, int *disps,
+                    double *times)
+{
+    MPI_Comm tcomm;
+    int i, it, size, rc, ok;
+    double t;
+
+    for (i = 0; i < nmsgs; ++i) {
+        times[i] = -1.0;
+    }
+    if (0 != cvar_write_all(comm, alg_handle, coll->name, "algorithm", alg) ||
+        (NULL != seg_handle &&
+         0 != cvar_write_all(comm, seg_handle, coll->name, "segment size", segsize))) {
+        return -1;
+    }
+    /* coll/tuned latches the forced values when enabled on a communicator */
+    MPI_Comm_dup(comm, &tcomm);
+    MPI_Comm_set_errhandler(tcomm, MPI_ERRORS_RETURN);
+    MPI_Comm_size(tcomm, &size);
+
+    for (i = 0; i < nmsgs; ++i) {
+        rc = 1;
+        for (it = 0; it < warmup && rc > 0; ++it) {
+            rc = coll->run(tcomm, size, msgs[i], sbuf, rbuf, counts, disps);
+        }
+        MPI_Barrier(tcomm);
+        t = MPI_Wtime();
+        for (it = 0; it < iterations && rc > 0; ++it) {
+            rc = coll->run(tcomm, size, msgs[i], sbuf, rbuf, counts, disps);
+        }
+        t = (MPI_Wtime() - t) / iterations;
+        ok = rc;
+        MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, tcomm);
+        if (ok <= 0) {
+            times[i] = -1.0;
+            if (ok < 0) {
+                /* unsupported for this communicator; skip the remaining sizes */
+                for (; i < nmsgs; ++i) times[i] = -1.0;
+            }
+            continue;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, tcomm);
+        times[i] = t;
+    }
+    MPI_Comm_free(&tcomm);
+
+    return cvar_write_all(comm, alg_handle, coll->name, "algorithm", 0);
+}
+
+/*
+ * Tune one collective on comm.  Fills choices[] with the merged rules
+ * (first entry starting at message size 0) and returns their number,
+ * -1 if coll/tuned does not export the collective, or -2 if forcing its
+ * algorithms through MPI_T failed.
+ */
+static int tune_coll(const tune_coll_t *coll, MPI_Comm comm, int rank, int nmsgs,
+                     const size_t *msgs, void *sbuf, void *rbuf, int *counts, int *disps,
+                     tune_choice_t *choices)
+{
+    MPI_T_cvar_handle alg_handle, seg_handle = NULL, count_handle, fanout_handle;
+    char name[256];
+    int nalgs = 0, alg, s, i, n, nchoices = 0, size, ncands = 0, best_cand, faninout = 0;
+    double *times, best_score = 0.0;
+    tune_choice_t *cands;
+
+    snprintf(name, sizeof(name), "coll_tuned_%s_algorithm_count", coll->name);
+    if (0 != cvar_handle(name, &count_handle)) {
+        return -1;
+    }
+    if (MPI_SUCCESS != MPI_T_cvar_read(count_handle, &nalgs)) {
+        MPI_T_cvar_handle_free(&count_handle);
+        return -1;
+    }
+    MPI_T_cvar_handle_free(&count_handle);
+    snprintf(name, sizeof(name), "coll_tuned_%s_algorithm", coll->name);
+    if (0 != cvar_handle(name, &alg_handle)) {
+        return -1;
+    }
+    snprintf(name, sizeof(name), "coll_tuned_%s_algorithm_segmentsize", coll->name);
+    if (0 != cvar_handle(name, &seg_handle)) {
+        seg_handle = NULL;
+    }
+    /* the fanout is not searched, the rules carry the one in effect
+     * during the measurement: a 0 in a rule does not mean the default,
+     * coll/tuned then builds a chain of 1 or a radix 2 instead */
+    if (NULL != coll->fanout) {
+        snprintf(name, sizeof(name), "coll_tuned_%s_algorithm_%s", coll->name, coll->fanout);
+        if (0 == cvar_handle(name, &fanout_handle)) {
+            if (MPI_SUCCESS != MPI_T_cvar_read(fanout_handle, &faninout)) {
+                faninout = 0;
+            }
+            MPI_T_cvar_handle_free(&fanout_handle);
+        }
+    }
+    MPI_Comm_size(comm, &size);
+    if (MSG_NONE == coll->kind) {
+        nmsgs = 1;
+    }
+
+    /* candidates: every algorithm (0 is the fixed decision, not a
+     * candidate), and every segment size for the segmented ones */
+    cands = malloc((size_t)nalgs * (num_segsizes + 1) * sizeof(tune_choice_t));
+    times = malloc((size_t)nalgs * (num_segsizes + 1) * nmsgs * sizeof(double));
+    if (NULL == cands || NULL == times) {
+        fprintf(stderr, "Fail to allocate memory. Abort\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (alg = 1; alg < nalgs; ++alg) {
+        int nseg = (NULL != seg_handle && (coll->segmented & ALG(alg))) ? num_segsizes : 0;
+        for (s = -1; s < nseg; ++s) {
+            int segsize = (s < 0) ? 0 : segsizes[s];
+            double *t = times + (size_t)ncands * nmsgs;
+            if (s >= 0 && 0 == segsize) continue;  /* already measured as s == -1 */
+            if (0 != measure(coll, comm, nmsgs, msgs, alg_handle, seg_handle, alg, segsize,
+                             sbuf, rbuf, counts, disps, t)) {
+                nchoices = -2;
+                goto out;
+            }
+            if (0 == rank && verbose) {
+                for (i = 0; i < nmsgs; ++i) {
+                    if (t[i] < 0.0) continue;
+                    printf("%-20s comm %4d msg %10lu alg %2d seg %7d: %12.2f us\n",
+                           coll->name, size, (unsigned long)msgs[i], alg, segsize,
+                           t[i] * 1e6);
+                }
+            }
+            cands[ncands].alg = alg;
+            cands[ncands].faninout = faninout;
+            cands[ncands].segsize = segsize;
+            ncands++;
+        }
+    }
+
+    if (MSG_RULES == coll->kind) {
+        /* fastest candidate per size, merging consecutive sizes with the
+         * same choice into one rule */
+        for (i = 0; i < nmsgs; ++i) {
+            best_cand = -1;
+            for (n = 0; n < ncands; ++n) {
+                double t = times[(size_t)n * nmsgs + i];
+                if (t >= 0.0 && (best_cand < 0 || t < times[(size_t)best_cand * nmsgs + i])) {
+                    best_cand = n;
+                }
+            }
+            if (best_cand < 0) continue;
+            if (nchoices > 0 && choices[nchoices - 1].alg == cands[best_cand].alg &&
+                choices[nchoices - 1].segsize == cands[best_cand].segsize) {
+                continue;
+            }
+            choices[nchoices] = cands[best_cand];
+            choices[nchoices].msg = (0 == nchoices) ? 0 : msgs[i];
+            nchoices++;
+        }
+    } else {
+        /* a single rule: pick the candidate with the smallest sum of
+         * slowdowns relative to the fastest one at each size */
+        best_cand = -1;
+        for (n = 0; n < ncands; ++n) {
+            double score = 0.0;
+            for (i = 0; i < nmsgs; ++i) {
+                double t = times[(size_t)n * nmsgs + i], fastest = -1.0;
+                int m;
+                for (m = 0; m < ncands; ++m) {
+                    double tm = times[(size_t)m * nmsgs + i];
+                    if (tm >= 0.0 && (fastest < 0.0 || tm < fastest)) fastest = tm;
+                }
+                if (fastest < 0.0) continue;
+                if (t < 0.0) break;
+                score += (fastest > 0.0) ? t / fastest : 1.0;
+            }
+            if (i < nmsgs) continue;  /* unusable at some size */
+            if (best_cand < 0 || score < best_score) {
+                best_cand = n;
+                best_score = score;
+            }
+        }
+        if (best_cand >= 0) {
+            choices[0] = cands[best_cand];
+            choices[0].msg = 0;
+            nchoices = 1;
+        }
+    }
+
+out:
+    free(times);
+    free(cands);
+    MPI_T_cvar_handle_free(&alg_handle);
+    if (NULL != seg_handle) {
+        MPI_T_cvar_handle_free(&seg_handle);
+    }
+    return nchoices;
+}
+
+int main(int argc, char **argv)
+{
+    int rank, commsize, provided, i, c, ncolls = 0, nmsgs = 0;
+    size_t msgs[MAX_MSG_SIZES], msg, bufsize;
+    const tune_coll_t *colls[NUM_TUNE_COLLS];
+    tune_choice_t *choices;
+    int *nchoices, *counts, *disps;
+    void *sbuf, *rbuf;
+    FILE *fp = NULL;
+
+    /* forced algorithms are only honored with dynamic rules enabled, and
+     * a rules file would take precedence over them */
+    setenv("OMPI_MCA_coll_tuned_use_dynamic_rules", "1", 1);
+    unsetenv("OMPI_MCA_coll_tuned_dynamic_rules_filename");
+
+    MPI_Init(&argc, &argv);
+    MPI_T_init_thread(MPI_THREAD_SINGLE, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &commsize);
+
+    int ret = parse_opts(rank, argc, argv);
+    if (ret != 0) {
+        MPI_T_finalize();
+        MPI_Finalize();
+        exit(ret < 0 ? 1 : 0);
+    }
+
+    for (i = 0; i < NUM_TUNE_COLLS; ++i) {
+        if (coll_selected(tune_colls[i].name)) {
+            colls[ncolls++] = &tune_colls[i];
+        }
+    }
+    if (0 == ncolls) {
+        if (rank == 0)
+            fprintf(stderr, "No known collective in \"%s\"\n", coll_list);
+        MPI_Finalize();
+        exit(1);
+    }
+
+    if (0 == num_comm_sizes) {
+        for (c = 2; c < commsize && num_comm_sizes < MAX_COMM_SIZES - 1; c *= 2) {
+            comm_sizes[num_comm_sizes++] = c;
+        }
+        comm_sizes[num_comm_sizes++] = commsize;
+    }
+    for (i = 0; i < num_comm_sizes; ++i) {
+        if (comm_sizes[i] < 1 || comm_sizes[i] > commsize ||
+            (i > 0 && comm_sizes[i] <= comm_sizes[i - 1])) {
+            if (rank == 0)
+                fprintf(stderr, "Communicator sizes must be increasing and at most %d\n", commsize);
+            MPI_Finalize();
+            exit(1);
+        }
+    }
+    for (msg = min_msg; msg <= max_msg && nmsgs < MAX_MSG_SIZES; msg *= 2) {
+        msgs[nmsgs++] = msg;
+    }
+
+    /* the largest buffer any runner touches is max_msg (or one block of it
+     * per rank for the rooted and all-to-all collectives) */
+    bufsize = msgs[nmsgs - 1] + sizeof(double);
+    sbuf = calloc(1, bufsize);
+    rbuf = calloc(1, bufsize);
+    counts = malloc(commsize * sizeof(int));
+    disps = malloc(commsize * sizeof(int));
+    choices = malloc((size_t)ncolls * num_comm_sizes * nmsgs * sizeof(tune_choice_t));
+    nchoices = calloc((size_t)ncolls * num_comm_sizes, sizeof(int));
+    if (NULL == sbuf || NULL == rbuf || NULL == counts || NULL == disps ||
+        NULL == choices || NULL == nchoices) {
+        fprintf(stderr, "Fail to allocate memory. Abort\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (c = 0; c < num_comm_sizes; ++c) {
+        MPI_Comm comm;
+        MPI_Comm_split(MPI_COMM_WORLD, rank < comm_sizes[c] ? 0 : MPI_UNDEFINED, rank, &comm);
+        if (MPI_COMM_NULL != comm) {
+            for (i = 0; i < ncolls; ++i) {
+                int idx = i * num_comm_sizes + c;
+                nchoices[idx] = tune_coll(colls[i], comm, rank, nmsgs, msgs, sbuf, rbuf,
+                                          counts, disps, choices + (size_t)idx * nmsgs);
+                if (0 == rank && -1 == nchoices[idx]) {
+                    fprintf(stderr, "coll/tuned does not export %s; is the component available?\n",
+                            colls[i]->name);
+                } else if (0 == rank && -2 == nchoices[idx]) {
+                    fprintf(stderr, "Fail to force the %s algorithms; no rules written for it\n",
+                            colls[i]->name);
+                }
+            }
+            MPI_Comm_free(&comm);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    if (rank == 0) {
+        int nrules = 0;
+        fp = fopen(filename, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "Fail to open the file %s. Abort\n", filename);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (i = 0; i < ncolls; ++i) {
+            for (c = 0; c < num_comm_sizes && nchoices[i * num_comm_sizes + c] <= 0; ++c);
+            if (c < num_comm_sizes) nrules++;
+        }
+        fprintf(fp, "# coll/tuned dynamic rules generated by mpicolltune on %d processes\n", commsize);
+        fprintf(fp, "# use with --mca coll_tuned_use_dynamic_rules 1 --mca coll_tuned_dynamic_rules_filename <file>\n");
+        fprintf(fp, "%d # number of collectives\n", nrules);
+        for (i = 0; i < ncolls; ++i) {
+            int ncs = 0;
+            for (c = 0; c < num_comm_sizes; ++c) {
+                if (nchoices[i * num_comm_sizes + c] > 0) ncs++;
+            }
+            if (0 == ncs) continue;
+            fprintf(fp, "%d # collective ID (%s)\n", colls[i]->id, colls[i]->name);
+            fprintf(fp, "%d # number of comm sizes\n", ncs);
+            for (c = 0; c < num_comm_sizes; ++c) {
+                int idx = i * num_comm_sizes + c, m;
+                tune_choice_t *ch = choices + (size_t)idx * nmsgs;
+                if (nchoices[idx] <= 0) continue;
+                fprintf(fp, "%d # comm size\n", comm_sizes[c]);
+                fprintf(fp, "%d # number of msg sizes\n", nchoices[idx]);
+                for (m = 0; m < nchoices[idx]; ++m) {
+                    fprintf(fp, "%lu %d %d %d # message size, algorithm, fanin/out, segment size\n",
+                            (unsigned long)ch[m].msg, ch[m].alg, ch[m].faninout, ch[m].segsize);
+                }
+            }
+        }
+        fclose(fp);
+    }
+
+    free(nchoices);
+    free(choices);
+    free(disps);
+    free(counts);
+    free(rbuf);
+    free(sbuf);
+    MPI_T_finalize();
+    MPI_Finalize();
+    return 0;
+}
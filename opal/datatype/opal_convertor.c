@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2019 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
@@ -598,7 +598,17 @@ int32_t opal_convertor_prepare_for_recv( opal_convertor_t* convertor,
             if( convertor->pDesc->flags & OPAL_DATATYPE_FLAG_CONTIGUOUS ) {
                 convertor->fAdvance = opal_unpack_homogeneous_contig;
             } else {
-                convertor->fAdvance = opal_generic_simple_unpack;
+                if( (NULL != convertor->pDesc->program) && !(convertor->flags & CONVERTOR_CUDA) ) {
+                    convertor->fAdvance = opal_unpack_compiled;
+                    convertor->flags |= CONVERTOR_COMPILED;
+                } else {
+                    convertor->fAdvance = opal_generic_simple_unpack;
+                }
+                /* large enough to be split between the helper threads */
+                if( (0 < opal_convertor_parallel_threads) && !(convertor->flags & CONVERTOR_CUDA) &&
+                    (convertor->local_size >= opal_convertor_parallel_min_size) ) {
+                    convertor->fAdvance = opal_unpack_parallel;
+                }
             }
         }
     return OPAL_SUCCESS;
@@ -646,7 +656,17 @@ int32_t opal_convertor_prepare_for_send( opal_convertor_t* convertor,
                 else
                     convertor->fAdvance = opal_pack_homogeneous_contig_with_gaps;
             } else {
-                convertor->fAdvance = opal_generic_simple_pack;
+                if( (NULL != datatype->program) && !(convertor->flags & CONVERTOR_CUDA) ) {
+                    convertor->fAdvance = opal_pack_compiled;
+                    convertor->flags |= CONVERTOR_COMPILED;
+                } else {
+                    convertor->fAdvance = opal_generic_simple_pack;
+                }
+                /* large enough to be split between the helper threads */
+                if( (0 < opal_convertor_parallel_threads) && !(convertor->flags & CONVERTOR_CUDA) &&
+                    (convertor->local_size >= opal_convertor_parallel_min_size) ) {
+                    convertor->fAdvance = opal_pack_parallel;
+                }
             }
         }
     return OPAL_SUCCESS;
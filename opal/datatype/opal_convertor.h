@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2017 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
@@ -57,6 +57,7 @@ BEGIN_C_DECLS
 #define CONVERTOR_CUDA_UNIFIED     0x10000000
 #define CONVERTOR_HAS_REMOTE_SIZE  0x20000000
 #define CONVERTOR_SKIP_CUDA_INIT   0x40000000
+#define CONVERTOR_COMPILED         0x80000000
 
 union dt_elem_desc;
 typedef struct opal_convertor_t opal_convertor_t;
@@ -342,6 +343,12 @@ opal_convertor_set_position( opal_convertor_t* convertor,
         return OPAL_SUCCESS;
     }
 
+    if( convertor->flags & CONVERTOR_COMPILED ) {
+        /* the compiled pack/unpack only depend on bConverted */
+        convertor->bConverted = *position;
+        return OPAL_SUCCESS;
+    }
+
     return opal_convertor_set_position_nocheck( convertor, position );
 }
 
@@ -1,6 +1,6 @@
 /* -*- Mode: C; c-basic-offset:4 ; -*- */
 /*
- * Copyright (c) 2004-2014 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2009      Oak Ridge National Labs.  All rights reserved.
@@ -49,6 +49,19 @@ opal_convertor_master_t* opal_convertor_find_or_create_master( uint32_t remote_a
  */
 void opal_convertor_destroy_masters( void );
 
+/*
+ * Number of helper threads used to pack and unpack large non-contiguous data
+ * (0 disables the parallel mode), and the size of the smallest iovec split
+ * between them.
+ */
+extern int opal_convertor_parallel_threads;
+extern size_t opal_convertor_parallel_min_size;
+
+/*
+ * Stop the helper threads. Called when the data-type engine is shutdown.
+ */
+void opal_convertor_parallel_finalize( void );
+
 
 END_C_DECLS
 
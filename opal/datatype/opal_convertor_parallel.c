@@ -0,0 +1,345 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * Pack and unpack of large non-contiguous data on a small pool of helper
+ * threads. Each iovec large enough is split into position ranges of the
+ * packed stream, one per thread (the calling thread included). Compiled
+ * convertors can start anywhere in the packed stream without any state;
+ * the other homogeneous convertors get one clone per range, positioned with
+ * opal_convertor_set_position.
+ */
+
+#include "opal_config.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "opal/threads/threads.h"
+#include "opal/datatype/opal_convertor_internal.h"
+#include "opal/datatype/opal_datatype_internal.h"
+#include "opal/datatype/opal_datatype_program.h"
+#include "opal/datatype/opal_datatype_prototypes.h"
+
+/* Parts are cache line aligned in the packed buffer to avoid false sharing */
+#define OPAL_CONVERTOR_PARALLEL_ALIGN 64
+
+int opal_convertor_parallel_threads = 0;
+size_t opal_convertor_parallel_min_size = 1024 * 1024;
+
+typedef struct opal_convertor_parallel_part_t {
+    opal_convertor_t* convertor;   /**< clone for the generic functions, NULL when compiled */
+    unsigned char*    packed;
+    size_t            position;
+    size_t            length;
+} opal_convertor_parallel_part_t;
+
+/*
+ * The helper threads block on condition variables attached to the pthread
+ * mutex of pool.lock. opal_condition_t cannot be used here: its wait polls
+ * opal_progress, which the helper threads must not call, and does not
+ * release the mutex when opal_using_threads() is false.
+ */
+typedef struct opal_convertor_parallel_pool_t {
+    opal_mutex_t      submit;      /**< one pack/unpack at a time uses the pool */
+    opal_mutex_t      lock;
+    pthread_cond_t    work;
+    pthread_cond_t    done;
+    opal_thread_t**   threads;
+    int               nthreads;
+    bool              stop;
+    uint64_t          generation;  /**< incremented for each new job */
+    int               pending;     /**< helper threads still working on the job */
+    /* the job */
+    opal_convertor_t* convertor;
+    int               pack;
+    opal_convertor_parallel_part_t* parts;
+    int               nparts;
+} opal_convertor_parallel_pool_t;
+
+static opal_convertor_parallel_pool_t opal_convertor_parallel_pool = {
+    .submit = OPAL_MUTEX_STATIC_INIT,
+    .lock = OPAL_MUTEX_STATIC_INIT,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+static void
+opal_convertor_parallel_do_part( opal_convertor_t* pConv, opal_convertor_parallel_part_t* part, int pack )
+{
+    const opal_datatype_t* pData = pConv->pDesc;
+    struct iovec iov;
+    uint32_t iov_count;
+    size_t max_data, done = 0;
+
+    if( NULL == part->convertor ) {
+        (void)opal_datatype_program_copy( pData->program, pData->ub - pData->lb, pConv->pBaseBuf,
+                                          pConv->count, part->position, part->packed,
+                                          part->length, pack );
+        return;
+    }
+    while( done < part->length ) {
+        iov.iov_base = (IOVBASE_TYPE*)(part->packed + done);
+        iov.iov_len  = part->length - done;
+        iov_count    = 1;
+        max_data     = iov.iov_len;
+        if( pack ) (void)opal_generic_simple_pack( part->convertor, &iov, &iov_count, &max_data );
+        else (void)opal_generic_simple_unpack( part->convertor, &iov, &iov_count, &max_data );
+        if( 0 == max_data ) break;
+        done += max_data;
+    }
+    /* the generic functions do not split predefined elements, the last range
+     * might stop short of the end of the iovec */
+    part->length = done;
+}
+
+static void* opal_convertor_parallel_main( opal_object_t* obj )
+{
+    opal_convertor_parallel_pool_t* pool = &opal_convertor_parallel_pool;
+    int index = (int)(intptr_t)((opal_thread_t*)obj)->t_arg;
+    uint64_t generation = 0;
+
+    opal_mutex_lock( &pool->lock );
+    while( 1 ) {
+        while( !pool->stop && (generation == pool->generation) ) {
+            pthread_cond_wait( &pool->work, &pool->lock.m_lock_pthread );
+        }
+        if( pool->stop ) break;
+        generation = pool->generation;
+        opal_mutex_unlock( &pool->lock );
+
+        /* the calling thread handles the first part */
+        if( (index + 1) < pool->nparts ) {
+            opal_convertor_parallel_do_part( pool->convertor, &pool->parts[index + 1], pool->pack );
+        }
+
+        opal_mutex_lock( &pool->lock );
+        if( 0 == --pool->pending ) {
+            pthread_cond_signal( &pool->done );
+        }
+    }
+    opal_mutex_unlock( &pool->lock );
+    return NULL;
+}
+
+/* Called with the submit lock held */
+static int opal_convertor_parallel_start( opal_convertor_parallel_pool_t* pool )
+{
+    int nthreads = opal_convertor_parallel_threads;
+
+    pool->threads = (opal_thread_t**)calloc( nthreads, sizeof(opal_thread_t*) );
+    if( NULL == pool->threads ) return OPAL_ERR_OUT_OF_RESOURCE;
+    pool->stop = false;
+    for( int i = 0; i < nthreads; i++ ) {
+        opal_thread_t* thread = OBJ_NEW(opal_thread_t);
+        thread->t_run = opal_convertor_parallel_main;
+        thread->t_arg = (void*)(intptr_t)i;
+        if( OPAL_SUCCESS != opal_thread_start( thread ) ) {
+            OBJ_RELEASE(thread);
+            break;
+        }
+        pool->threads[pool->nthreads++] = thread;
+    }
+    if( 0 == pool->nthreads ) {
+        free( pool->threads );
+        pool->threads = NULL;
+        return OPAL_ERROR;
+    }
+    return OPAL_SUCCESS;
+}
+
+void opal_convertor_parallel_finalize( void )
+{
+    opal_convertor_parallel_pool_t* pool = &opal_convertor_parallel_pool;
+
+    if( NULL == pool->threads ) return;
+
+    opal_mutex_lock( &pool->lock );
+    pool->stop = true;
+    pthread_cond_broadcast( &pool->work );
+    opal_mutex_unlock( &pool->lock );
+    for( int i = 0; i < pool->nthreads; i++ ) {
+        opal_thread_join( pool->threads[i], NULL );
+        OBJ_RELEASE(pool->threads[i]);
+    }
+    free( pool->threads );
+    pool->threads = NULL;
+    pool->nthreads = 0;
+}
+
+/**
+ * Split length bytes of the packed stream starting at the current position
+ * of the convertor into nparts ranges. For the generic functions each range
+ * gets a clone of the convertor moved to its start, and the range boundaries
+ * are the positions opal_convertor_set_position was able to reach. The clones
+ * are positioned from the beginning of the data, the position functions skip
+ * whole datatypes at once so this only walks the description of the last one.
+ */
+static int
+opal_convertor_parallel_split( opal_convertor_t* pConv, unsigned char* packed, size_t length,
+                               opal_convertor_parallel_part_t* parts, opal_convertor_t* clones,
+                               int nparts )
+{
+    size_t part_length = (length / nparts) & ~((size_t)OPAL_CONVERTOR_PARALLEL_ALIGN - 1);
+    size_t end = pConv->bConverted + length, position;
+    int i;
+
+    parts[0].convertor = (pConv->flags & CONVERTOR_COMPILED) ? NULL : pConv;
+    parts[0].position  = pConv->bConverted;
+    parts[0].packed    = packed;
+    for( i = 1; i < nparts; i++ ) {
+        position = pConv->bConverted + i * part_length;
+        parts[i].convertor = NULL;
+        if( !(pConv->flags & CONVERTOR_COMPILED) ) {
+            OBJ_CONSTRUCT( &clones[i], opal_convertor_t );
+            opal_convertor_clone_with_position( pConv, &clones[i], 0, &position );
+            if( (position >= end) || (position <= parts[i - 1].position) ) {
+                OBJ_DESTRUCT( &clones[i] );
+                break;
+            }
+            parts[i].convertor = &clones[i];
+        }
+        parts[i].position = position;
+        parts[i].packed   = packed + (position - pConv->bConverted);
+        parts[i - 1].length = position - parts[i - 1].position;
+    }
+    parts[i - 1].length = end - parts[i - 1].position;
+    return i;
+}
+
+static int32_t
+opal_convertor_parallel_advance( opal_convertor_t* pConv, struct iovec* iov,
+                                 uint32_t* out_size, size_t* max_data, int pack )
+{
+    opal_convertor_parallel_pool_t* pool = &opal_convertor_parallel_pool;
+    opal_convertor_parallel_part_t parts[pool->nthreads + 1];
+    opal_convertor_t clones[pool->nthreads + 1];
+    size_t length, total = 0;
+    uint32_t idx;
+    int nparts;
+
+    for( idx = 0; idx < (*out_size); idx++ ) {
+        length = pConv->local_size - pConv->bConverted;
+        if( 0 == length ) break;
+        if( length > iov[idx].iov_len ) length = iov[idx].iov_len;
+
+        nparts = pool->nthreads + 1;
+        if( length < opal_convertor_parallel_min_size ) {
+            nparts = 1;
+        } else {
+            nparts = opal_convertor_parallel_split( pConv, (unsigned char*)iov[idx].iov_base, length,
+                                                    parts, clones, nparts );
+        }
+        if( 1 == nparts ) {
+            struct iovec local_iov = { .iov_base = iov[idx].iov_base, .iov_len = length };
+            uint32_t local_count = 1;
+            size_t local_max = length;
+
+            if( pConv->flags & CONVERTOR_COMPILED ) {
+                if( pack ) (void)opal_pack_compiled( pConv, &local_iov, &local_count, &local_max );
+                else (void)opal_unpack_compiled( pConv, &local_iov, &local_count, &local_max );
+            } else {
+                if( pack ) (void)opal_generic_simple_pack( pConv, &local_iov, &local_count, &local_max );
+                else (void)opal_generic_simple_unpack( pConv, &local_iov, &local_count, &local_max );
+            }
+            pConv->flags &= ~CONVERTOR_COMPLETED;
+            length = local_max;
+            if( 0 == length ) break;
+        } else {
+            opal_mutex_lock( &pool->lock );
+            pool->convertor = pConv;
+            pool->pack      = pack;
+            pool->parts     = parts;
+            pool->nparts    = nparts;
+            pool->pending   = pool->nthreads;
+            pool->generation++;
+            pthread_cond_broadcast( &pool->work );
+            opal_mutex_unlock( &pool->lock );
+
+            opal_convertor_parallel_do_part( pConv, &parts[0], pack );
+
+            opal_mutex_lock( &pool->lock );
+            while( 0 != pool->pending ) {
+                pthread_cond_wait( &pool->done, &pool->lock.m_lock_pthread );
+            }
+            opal_mutex_unlock( &pool->lock );
+
+            length = parts[nparts - 1].position + parts[nparts - 1].length - parts[0].position;
+            if( !(pConv->flags & CONVERTOR_COMPILED) ) {
+                /* continue from where the last range stopped */
+                opal_convertor_t* last = parts[nparts - 1].convertor;
+                memcpy( pConv->pStack, last->pStack, sizeof(dt_stack_t) * (last->stack_pos + 1) );
+                pConv->stack_pos      = last->stack_pos;
+                pConv->partial_length = last->partial_length;
+                for( int i = 1; i < nparts; i++ ) {
+                    OBJ_DESTRUCT( &clones[i] );
+                }
+            }
+            pConv->bConverted = parts[0].position + length;
+        }
+        iov[idx].iov_len = length;
+        total += length;
+    }
+    *max_data = total;
+    *out_size = idx;
+    if( pConv->bConverted == pConv->local_size ) {
+        pConv->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Pack or unpack on the helper threads when the pool is available, on the
+ * calling thread otherwise (the pool is busy with another convertor or the
+ * helper threads cannot be started).
+ */
+static int32_t
+opal_convertor_parallel( opal_convertor_t* pConv, struct iovec* iov,
+                         uint32_t* out_size, size_t* max_data, int pack )
+{
+    opal_convertor_parallel_pool_t* pool = &opal_convertor_parallel_pool;
+    int32_t rc;
+
+    if( 0 == opal_mutex_trylock( &pool->submit ) ) {
+        if( (NULL != pool->threads) || (OPAL_SUCCESS == opal_convertor_parallel_start( pool )) ) {
+            rc = opal_convertor_parallel_advance( pConv, iov, out_size, max_data, pack );
+            opal_mutex_unlock( &pool->submit );
+            return rc;
+        }
+        opal_mutex_unlock( &pool->submit );
+    }
+    if( pConv->flags & CONVERTOR_COMPILED ) {
+        return pack ? opal_pack_compiled( pConv, iov, out_size, max_data )
+                    : opal_unpack_compiled( pConv, iov, out_size, max_data );
+    }
+    return pack ? opal_generic_simple_pack( pConv, iov, out_size, max_data )
+                : opal_generic_simple_unpack( pConv, iov, out_size, max_data );
+}
+
+int32_t
+opal_pack_parallel( opal_convertor_t* pConv,
+                    struct iovec* iov, uint32_t* out_size,
+                    size_t* max_data )
+{
+    return opal_convertor_parallel( pConv, iov, out_size, max_data, 1 );
+}
+
+int32_t
+opal_unpack_parallel( opal_convertor_t* pConv,
+                      struct iovec* iov, uint32_t* out_size,
+                      size_t* max_data )
+{
+    return opal_convertor_parallel( pConv, iov, out_size, max_data, 0 );
+}
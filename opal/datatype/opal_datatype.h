@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2017 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
@@ -132,6 +132,8 @@ struct opal_datatype_t {
                                       all language interfaces (because Fortran is not known at the OPAL
                                       layer). This field should never be initialized in homogeneous
                                       environments */
+    struct opal_datatype_program_t *program;  /**< flat copy program generated at commit for the
+                                                   homogeneous pack/unpack, NULL if not available */
     /* --- cacheline 5 boundary (320 bytes) was 32-36 bytes ago --- */
 
     /* size: 352, cachelines: 6, members: 15 */
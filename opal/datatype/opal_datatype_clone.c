@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2017 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
@@ -25,6 +25,7 @@
 #include "opal/constants.h"
 #include "opal/datatype/opal_datatype.h"
 #include "opal/datatype/opal_datatype_internal.h"
+#include "opal/datatype/opal_datatype_program.h"
 
 /*
  * As the new type has the same commit state as the old one, I have to copy the fake
@@ -44,6 +45,7 @@ int32_t opal_datatype_clone( const opal_datatype_t * src_type, opal_datatype_t *
 
     dest_type->flags &= (~OPAL_DATATYPE_FLAG_PREDEFINED);
     dest_type->ptypes = NULL;
+    dest_type->program = NULL;
     dest_type->desc.desc = temp;
 
     /**
@@ -71,5 +73,8 @@ int32_t opal_datatype_clone( const opal_datatype_t * src_type, opal_datatype_t *
     }
     dest_type->id  = src_type->id;  /* preserve the default id. This allow us to
                                      * copy predefined types. */
+    if( NULL != src_type->program ) {
+        (void)opal_datatype_compile( dest_type );
+    }
     return OPAL_SUCCESS;
 }
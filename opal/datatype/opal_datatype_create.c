@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2017 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
@@ -27,6 +27,7 @@
 #include "opal/constants.h"
 #include "opal/datatype/opal_datatype.h"
 #include "opal/datatype/opal_datatype_internal.h"
+#include "opal/datatype/opal_datatype_program.h"
 #include "limits.h"
 #include "opal/prefetch.h"
 
@@ -55,10 +56,13 @@ static void opal_datatype_construct( opal_datatype_t* pData )
 
     pData->ptypes             = NULL;
     pData->loops              = 0;
+    pData->program            = NULL;
 }
 
 static void opal_datatype_destruct( opal_datatype_t* datatype )
 {
+    opal_datatype_program_free( datatype );
+
     /**
      * As the default description and the optimized description might point to the
      * same data description we should start by cleaning the optimized description.
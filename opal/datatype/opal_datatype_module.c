@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2018 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2006 High Performance Computing Center Stuttgart,
@@ -37,6 +37,7 @@
 #include "opal/datatype/opal_datatype_internal.h"
 #include "opal/datatype/opal_datatype.h"
 #include "opal/datatype/opal_convertor_internal.h"
+#include "opal/datatype/opal_datatype_program.h"
 #include "opal/mca/base/mca_base_var.h"
 
 /* by default the debuging is turned off */
@@ -158,9 +159,38 @@ OPAL_DECLSPEC const opal_datatype_t* opal_datatype_basicDatatypes[OPAL_DATATYPE_
 
 int opal_datatype_register_params(void)
 {
-#if OPAL_ENABLE_DEBUG
     int ret;
 
+    ret = mca_base_var_register ("opal", "mpi", NULL, "ddt_compile_max_ops",
+                                 "Maximum number of strided copy operations in the program generated "
+                                 "when a non-contiguous datatype is committed. Datatypes that need more "
+                                 "operations use the generic pack/unpack functions (0 = never compile)",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE, OPAL_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &opal_datatype_program_max_ops);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = mca_base_var_register ("opal", "mpi", NULL, "ddt_pack_threads",
+                                 "Number of helper threads used to pack and unpack large non-contiguous "
+                                 "data, in addition to the calling thread (0 = pack on the calling thread only)",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE, OPAL_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &opal_convertor_parallel_threads);
+    if (0 > ret) {
+        return ret;
+    }
+
+    ret = mca_base_var_register ("opal", "mpi", NULL, "ddt_pack_threads_min_size",
+                                 "Minimum number of bytes packed or unpacked in a single call for the work "
+                                 "to be split between the helper threads",
+                                 MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE, OPAL_INFO_LVL_5,
+                                 MCA_BASE_VAR_SCOPE_LOCAL, &opal_convertor_parallel_min_size);
+    if (0 > ret) {
+        return ret;
+    }
+
+#if OPAL_ENABLE_DEBUG
+
     ret = mca_base_var_register ("opal", "mpi", NULL, "ddt_unpack_debug",
                                  "Whether to output debugging information in the ddt unpack functions (nonzero = enabled)",
                                  MCA_BASE_VAR_TYPE_BOOL, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE, OPAL_INFO_LVL_3,
@@ -235,6 +265,9 @@ static void opal_datatype_finalize (void)
     /* As they are statically allocated they cannot be released. But we
      * can call OBJ_DESTRUCT, just to free all internally allocated ressources.
      */
+    /* stop the pack/unpack helper threads */
+    opal_convertor_parallel_finalize();
+
     /* clear all master convertors */
     opal_convertor_destroy_masters();
 
@@ -0,0 +1,278 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "opal_config.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "opal/datatype/opal_convertor_internal.h"
+#include "opal/datatype/opal_datatype_internal.h"
+#include "opal/datatype/opal_datatype_program.h"
+#include "opal/datatype/opal_datatype_prototypes.h"
+
+int opal_datatype_program_max_ops = 256;
+
+static void opal_datatype_program_release( opal_datatype_program_t* program )
+{
+    free( program->ops );
+    free( program );
+}
+
+static opal_datatype_program_t* opal_datatype_program_alloc( void )
+{
+    return (opal_datatype_program_t*)calloc( 1, sizeof(opal_datatype_program_t) );
+}
+
+/**
+ * Append an operation to the program, merging it with the previous one when
+ * both are single blocks and the new one starts where the previous ends.
+ */
+static int32_t
+opal_datatype_program_append( opal_datatype_program_t* program, ptrdiff_t disp, size_t blocklen,
+                              size_t count, ptrdiff_t stride, size_t outer_count, ptrdiff_t outer_stride )
+{
+    opal_datatype_program_op_t* op;
+
+    if( 0 == blocklen || 0 == count || 0 == outer_count ) return OPAL_SUCCESS;
+
+    /* normalize: contiguous blocks are a single larger block */
+    if( (1 < count) && (stride == (ptrdiff_t)blocklen) ) {
+        blocklen *= count;
+        count = 1;
+    }
+    if( 1 == count ) {
+        count = outer_count;
+        stride = outer_stride;
+        outer_count = 1;
+        if( (1 < count) && (stride == (ptrdiff_t)blocklen) ) {
+            blocklen *= count;
+            count = 1;
+        }
+    }
+    if( 1 == count ) stride = (ptrdiff_t)blocklen;
+    if( 1 == outer_count ) outer_stride = 0;
+
+    if( 0 != program->used ) {
+        op = &program->ops[program->used - 1];
+        if( (1 == op->count) && (1 == op->outer_count) && (1 == count) && (1 == outer_count) &&
+            ((op->disp + (ptrdiff_t)op->blocklen) == disp) ) {
+            op->blocklen += blocklen;
+            op->stride = (ptrdiff_t)op->blocklen;
+            op->size = op->blocklen;
+            return OPAL_SUCCESS;
+        }
+    }
+
+    if( program->used >= (uint32_t)opal_datatype_program_max_ops ) {
+        return OPAL_ERR_OUT_OF_RESOURCE;
+    }
+    if( program->used == program->length ) {
+        uint32_t length = (0 == program->length) ? 8 : 2 * program->length;
+        op = (opal_datatype_program_op_t*)realloc( program->ops, length * sizeof(opal_datatype_program_op_t) );
+        if( NULL == op ) return OPAL_ERR_OUT_OF_RESOURCE;
+        program->ops = op;
+        program->length = length;
+    }
+    op = &program->ops[program->used++];
+    op->disp = disp;
+    op->blocklen = blocklen;
+    op->count = count;
+    op->stride = stride;
+    op->outer_count = outer_count;
+    op->outer_stride = outer_stride;
+    op->size = blocklen * count * outer_count;
+    op->packed_disp = 0;
+    return OPAL_SUCCESS;
+}
+
+/**
+ * Fold a loop of loops iterations and extent extent around the operations of
+ * its body. A body made of a single one or two level operation becomes a two
+ * level operation, anything else is unrolled.
+ */
+static int32_t
+opal_datatype_program_loop( opal_datatype_program_t* program, const opal_datatype_program_t* body,
+                            size_t loops, ptrdiff_t extent )
+{
+    const opal_datatype_program_op_t* op;
+    int32_t rc;
+
+    if( 1 == body->used ) {
+        op = &body->ops[0];
+        if( 1 == op->outer_count ) {
+            if( (1 < op->count) && ((ptrdiff_t)op->count * op->stride == extent) ) {
+                /* the loop continues the same stride */
+                return opal_datatype_program_append( program, op->disp, op->blocklen, op->count * loops,
+                                                     op->stride, 1, 0 );
+            }
+            return opal_datatype_program_append( program, op->disp, op->blocklen, op->count,
+                                                 op->stride, loops, extent );
+        }
+        if( 1 == loops ) {
+            return opal_datatype_program_append( program, op->disp, op->blocklen, op->count,
+                                                 op->stride, op->outer_count, op->outer_stride );
+        }
+    }
+
+    if( (program->used + loops * body->used) > (size_t)opal_datatype_program_max_ops ) {
+        return OPAL_ERR_OUT_OF_RESOURCE;
+    }
+    for( size_t i = 0; i < loops; i++ ) {
+        for( uint32_t j = 0; j < body->used; j++ ) {
+            op = &body->ops[j];
+            rc = opal_datatype_program_append( program, op->disp + (ptrdiff_t)i * extent, op->blocklen,
+                                               op->count, op->stride, op->outer_count, op->outer_stride );
+            if( OPAL_SUCCESS != rc ) return rc;
+        }
+    }
+    return OPAL_SUCCESS;
+}
+
+static int32_t
+opal_datatype_program_build( opal_datatype_program_t* program, const dt_elem_desc_t* desc,
+                             uint32_t start, uint32_t end )
+{
+    opal_datatype_program_t* body;
+    uint32_t pos = start;
+    int32_t rc;
+
+    while( pos < end ) {
+        const dt_elem_desc_t* pElem = &desc[pos];
+
+        if( OPAL_DATATYPE_LOOP == pElem->elem.common.type ) {
+            body = opal_datatype_program_alloc();
+            if( NULL == body ) return OPAL_ERR_OUT_OF_RESOURCE;
+            rc = opal_datatype_program_build( body, desc, pos + 1, pos + pElem->loop.items );
+            if( OPAL_SUCCESS == rc ) {
+                rc = opal_datatype_program_loop( program, body, pElem->loop.loops, pElem->loop.extent );
+            }
+            opal_datatype_program_release( body );
+            if( OPAL_SUCCESS != rc ) return rc;
+            pos += pElem->loop.items + 1;  /* skip the matching END_LOOP */
+            continue;
+        }
+        if( !(pElem->elem.common.flags & OPAL_DATATYPE_FLAG_DATA) ) {
+            return OPAL_ERR_NOT_SUPPORTED;
+        }
+        rc = opal_datatype_program_append( program, pElem->elem.disp,
+                                           pElem->elem.blocklen * opal_datatype_basicDatatypes[pElem->elem.common.type]->size,
+                                           pElem->elem.count, pElem->elem.extent, 1, 0 );
+        if( OPAL_SUCCESS != rc ) return rc;
+        pos++;
+    }
+    return OPAL_SUCCESS;
+}
+
+/**
+ * Generate the program for a committed datatype. Contiguous datatypes are
+ * handled by the contiguous pack/unpack functions and do not need one. A
+ * datatype that cannot be expressed with at most opal_datatype_program_max_ops
+ * operations keeps using the generic description interpreter.
+ */
+int32_t opal_datatype_compile( opal_datatype_t* pData )
+{
+    opal_datatype_program_t* program;
+    size_t size = 0;
+    int32_t rc;
+
+    assert( NULL == pData->program );
+    if( (0 >= opal_datatype_program_max_ops) || (0 == pData->size) || (0 == pData->opt_desc.used) ||
+        (pData->flags & OPAL_DATATYPE_FLAG_CONTIGUOUS) ) {
+        return OPAL_SUCCESS;
+    }
+
+    program = opal_datatype_program_alloc();
+    if( NULL == program ) return OPAL_ERR_OUT_OF_RESOURCE;
+
+    rc = opal_datatype_program_build( program, pData->opt_desc.desc, 0, pData->opt_desc.used );
+    if( OPAL_SUCCESS == rc ) {
+        for( uint32_t i = 0; i < program->used; i++ ) {
+            program->ops[i].packed_disp = size;
+            size += program->ops[i].size;
+        }
+    }
+    if( (OPAL_SUCCESS != rc) || (size != pData->size) ) {
+        opal_datatype_program_release( program );
+        return OPAL_SUCCESS;  /* not an error, the datatype is just not compiled */
+    }
+
+    program->size = size;
+    pData->program = program;
+    return OPAL_SUCCESS;
+}
+
+void opal_datatype_program_free( opal_datatype_t* pData )
+{
+    if( NULL != pData->program ) {
+        opal_datatype_program_release( pData->program );
+        pData->program = NULL;
+    }
+}
+
+int32_t
+opal_pack_compiled( opal_convertor_t* pConv,
+                    struct iovec* iov, uint32_t* out_size,
+                    size_t* max_data )
+{
+    const opal_datatype_t* pData = pConv->pDesc;
+    size_t length, total_packed = 0;
+    uint32_t idx;
+
+    for( idx = 0; idx < (*out_size); idx++ ) {
+        length = pConv->local_size - pConv->bConverted;
+        if( 0 == length ) break;
+        if( length > iov[idx].iov_len ) length = iov[idx].iov_len;
+        (void)opal_datatype_program_copy( pData->program, pData->ub - pData->lb, pConv->pBaseBuf,
+                                          pConv->count, pConv->bConverted,
+                                          (unsigned char*)iov[idx].iov_base, length, 1 );
+        iov[idx].iov_len = length;
+        pConv->bConverted += length;
+        total_packed += length;
+    }
+    *max_data = total_packed;
+    *out_size = idx;
+    if( pConv->bConverted == pConv->local_size ) {
+        pConv->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    return 0;
+}
+
+int32_t
+opal_unpack_compiled( opal_convertor_t* pConv,
+                      struct iovec* iov, uint32_t* out_size,
+                      size_t* max_data )
+{
+    const opal_datatype_t* pData = pConv->pDesc;
+    size_t length, total_unpacked = 0;
+    uint32_t idx;
+
+    for( idx = 0; idx < (*out_size); idx++ ) {
+        length = pConv->local_size - pConv->bConverted;
+        if( 0 == length ) break;
+        if( length > iov[idx].iov_len ) length = iov[idx].iov_len;
+        (void)opal_datatype_program_copy( pData->program, pData->ub - pData->lb, pConv->pBaseBuf,
+                                          pConv->count, pConv->bConverted,
+                                          (unsigned char*)iov[idx].iov_base, length, 0 );
+        iov[idx].iov_len = length;
+        pConv->bConverted += length;
+        total_unpacked += length;
+    }
+    *max_data = total_unpacked;
+    *out_size = idx;
+    if( pConv->bConverted == pConv->local_size ) {
+        pConv->flags |= CONVERTOR_COMPLETED;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef OPAL_DATATYPE_PROGRAM_H_HAS_BEEN_INCLUDED
+#define OPAL_DATATYPE_PROGRAM_H_HAS_BEEN_INCLUDED
+
+#include "opal_config.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "opal/datatype/opal_datatype.h"
+
+BEGIN_C_DECLS
+
+/**
+ * One operation of a compiled datatype: outer_count repetitions of count
+ * contiguous blocks of blocklen bytes. Consecutive blocks are stride bytes
+ * apart, consecutive repetitions outer_stride bytes apart. This covers the
+ * vector, indexed-block and 2D/3D subarray shapes with a single operation.
+ */
+struct opal_datatype_program_op_t {
+    ptrdiff_t disp;          /**< displacement of the first block */
+    size_t    blocklen;      /**< length in bytes of each contiguous block */
+    size_t    count;         /**< number of blocks in the inner loop */
+    ptrdiff_t stride;        /**< distance between two blocks of the inner loop */
+    size_t    outer_count;   /**< number of repetitions of the inner loop */
+    ptrdiff_t outer_stride;  /**< distance between two repetitions of the inner loop */
+    size_t    size;          /**< packed size of the whole operation */
+    size_t    packed_disp;   /**< offset of the operation in the packed representation */
+};
+typedef struct opal_datatype_program_op_t opal_datatype_program_op_t;
+
+/**
+ * The flat program generated from the optimized description of a committed
+ * datatype. The program describes a single instance of the datatype, the
+ * count is handled by the pack/unpack loops, so one program serves every
+ * (datatype, count) pair.
+ */
+struct opal_datatype_program_t {
+    uint32_t                    used;    /**< number of operations */
+    uint32_t                    length;  /**< number of allocated operations */
+    size_t                      size;    /**< packed size of one instance (datatype size) */
+    opal_datatype_program_op_t* ops;
+};
+typedef struct opal_datatype_program_t opal_datatype_program_t;
+
+/* Maximum number of operations in a compiled program (0 disables the compilation) */
+extern int opal_datatype_program_max_ops;
+
+int32_t opal_datatype_compile( opal_datatype_t* pData );
+void opal_datatype_program_free( opal_datatype_t* pData );
+
+/**
+ * Copy nblocks blocks of blocklen bytes between the user memory (stride apart)
+ * and a contiguous packed buffer. The common element sizes are spelled out so
+ * the compiler can turn each copy into a single load/store pair.
+ */
+#define OPAL_DATATYPE_PROGRAM_BLOCKS( BLEN, USER, STRIDE, PACKED, NBLOCKS, PACK ) \
+    do {                                                                \
+        for( size_t _i = 0; _i < (NBLOCKS); _i++ ) {                    \
+            if( PACK ) memcpy( (PACKED), (USER), (BLEN) );              \
+            else memcpy( (USER), (PACKED), (BLEN) );                    \
+            (USER) += (STRIDE);                                         \
+            (PACKED) += (BLEN);                                         \
+        }                                                               \
+    } while (0)
+
+static inline void
+opal_datatype_program_copy_blocks( unsigned char* user, ptrdiff_t stride, size_t blocklen,
+                                   unsigned char* packed, size_t nblocks, int pack )
+{
+    if( (ptrdiff_t)blocklen == stride ) {
+        if( pack ) memcpy( packed, user, nblocks * blocklen );
+        else memcpy( user, packed, nblocks * blocklen );
+        return;
+    }
+    switch( blocklen ) {
+    case 1:  OPAL_DATATYPE_PROGRAM_BLOCKS( 1, user, stride, packed, nblocks, pack ); break;
+    case 2:  OPAL_DATATYPE_PROGRAM_BLOCKS( 2, user, stride, packed, nblocks, pack ); break;
+    case 4:  OPAL_DATATYPE_PROGRAM_BLOCKS( 4, user, stride, packed, nblocks, pack ); break;
+    case 8:  OPAL_DATATYPE_PROGRAM_BLOCKS( 8, user, stride, packed, nblocks, pack ); break;
+    case 16: OPAL_DATATYPE_PROGRAM_BLOCKS( 16, user, stride, packed, nblocks, pack ); break;
+    case 32: OPAL_DATATYPE_PROGRAM_BLOCKS( 32, user, stride, packed, nblocks, pack ); break;
+    default: OPAL_DATATYPE_PROGRAM_BLOCKS( blocklen, user, stride, packed, nblocks, pack ); break;
+    }
+}
+
+/**
+ * Copy up to length bytes of one operation, starting skip bytes into its
+ * packed representation. Return the number of bytes copied.
+ */
+static inline size_t
+opal_datatype_program_op_copy( const opal_datatype_program_op_t* op, unsigned char* base,
+                               size_t skip, unsigned char* packed, size_t length, int pack )
+{
+    size_t block = skip / op->blocklen, offset = skip % op->blocklen;
+    size_t outer = block / op->count, inner = block % op->count;
+    size_t done = 0, nblocks, n;
+    unsigned char* user;
+
+    if( length > (op->size - skip) ) length = op->size - skip;
+
+    while( done < length ) {
+        user = base + op->disp + outer * op->outer_stride + inner * op->stride;
+        if( 0 != offset ) {  /* finish the block started by a previous call */
+            n = op->blocklen - offset;
+            if( n > (length - done) ) n = length - done;
+            if( pack ) memcpy( packed + done, user + offset, n );
+            else memcpy( user + offset, packed + done, n );
+            done += n;
+            if( (offset + n) < op->blocklen ) break;
+            offset = 0;
+            user += op->stride;
+            if( ++inner == op->count ) {
+                inner = 0; outer++;
+                continue;
+            }
+        }
+        nblocks = (length - done) / op->blocklen;
+        if( nblocks > (op->count - inner) ) nblocks = op->count - inner;
+        opal_datatype_program_copy_blocks( user, op->stride, op->blocklen, packed + done, nblocks, pack );
+        done += nblocks * op->blocklen;
+        inner += nblocks;
+        if( inner == op->count ) {
+            inner = 0; outer++;
+            continue;
+        }
+        /* not enough space for a whole block: copy the beginning of the next one */
+        n = length - done;
+        user += nblocks * op->stride;
+        if( pack ) memcpy( packed + done, user, n );
+        else memcpy( user, packed + done, n );
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * Copy length bytes between the packed stream of count instances of the
+ * datatype starting at position, and the user buffer. The program keeps no
+ * state between calls, any position in the packed stream can be reached
+ * directly. The extent is not part of the program as resizing a committed
+ * datatype does not recompile it.
+ */
+static inline size_t
+opal_datatype_program_copy( const opal_datatype_program_t* program, ptrdiff_t extent,
+                            unsigned char* base, size_t count, size_t position,
+                            unsigned char* packed, size_t length, int pack )
+{
+    size_t instance = position / program->size, skip = position % program->size, done = 0;
+    uint32_t idx = 0;
+
+    base += (ptrdiff_t)instance * extent;
+    while( skip >= (program->ops[idx].packed_disp + program->ops[idx].size) ) idx++;
+    skip -= program->ops[idx].packed_disp;
+
+    while( (done < length) && (instance < count) ) {
+        done += opal_datatype_program_op_copy( &program->ops[idx], base, skip,
+                                               packed + done, length - done, pack );
+        skip = 0;
+        if( ++idx == program->used ) {
+            idx = 0;
+            instance++;
+            base += extent;
+        }
+    }
+    return done;
+}
+
+END_C_DECLS
+
+#endif  /* OPAL_DATATYPE_PROGRAM_H_HAS_BEEN_INCLUDED */
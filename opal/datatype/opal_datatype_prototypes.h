@@ -1,6 +1,6 @@
 /* -*- Mode: C; c-basic-offset:4 ; -*- */
 /*
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2009      Oak Ridge National Labs.  All rights reserved.
@@ -83,6 +83,22 @@ int32_t
 opal_generic_simple_unpack_checksum( opal_convertor_t* pConvertor,
                                      struct iovec* iov, uint32_t* out_size,
                                      size_t* max_data );
+int32_t
+opal_pack_compiled( opal_convertor_t* pConv,
+                    struct iovec* iov, uint32_t* out_size,
+                    size_t* max_data );
+int32_t
+opal_unpack_compiled( opal_convertor_t* pConv,
+                      struct iovec* iov, uint32_t* out_size,
+                      size_t* max_data );
+int32_t
+opal_pack_parallel( opal_convertor_t* pConv,
+                    struct iovec* iov, uint32_t* out_size,
+                    size_t* max_data );
+int32_t
+opal_unpack_parallel( opal_convertor_t* pConv,
+                      struct iovec* iov, uint32_t* out_size,
+                      size_t* max_data );
 
 END_C_DECLS
 
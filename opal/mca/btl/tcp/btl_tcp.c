@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2014 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -100,7 +100,8 @@ int mca_btl_tcp_add_procs( struct mca_btl_base_module_t* btl,
 
         for (uint32_t j = 0 ; j < (uint32_t)tcp_proc->proc_endpoint_count ; ++j) {
             tcp_endpoint = tcp_proc->proc_endpoints[j];
-            if (tcp_endpoint->endpoint_btl == tcp_btl) {
+            if ((tcp_endpoint->endpoint_btl == tcp_btl) &&
+                (tcp_endpoint->endpoint_lead == tcp_endpoint)) {
                 existing_found = true;
                 break;
             }
@@ -124,6 +125,12 @@ int mca_btl_tcp_add_procs( struct mca_btl_base_module_t* btl,
                 OBJ_RELEASE(tcp_endpoint);
                 continue;
             }
+            rc = mca_btl_tcp_endpoint_create_socks(tcp_endpoint, mca_btl_tcp_component.tcp_sockets);
+            if(rc != OPAL_SUCCESS) {
+                OPAL_THREAD_UNLOCK(&tcp_proc->proc_lock);
+                OBJ_RELEASE(tcp_endpoint);
+                return rc;
+            }
 
             OPAL_THREAD_LOCK(&tcp_btl->tcp_endpoints_mutex);
             opal_list_append(&tcp_btl->tcp_endpoints, (opal_list_item_t*)tcp_endpoint);
@@ -296,6 +303,37 @@ mca_btl_base_descriptor_t* mca_btl_tcp_prepare_src(
     return &frag->base;
 }
 
+/*
+ * Number the fragment in the stream of the endpoint, and pick the
+ * socket it goes on. The size class of the fragment decides over how
+ * many of the sockets of the endpoint the fragments of its size are
+ * spread; within them, consecutive fragments go round-robin.
+ */
+static inline mca_btl_base_endpoint_t*
+mca_btl_tcp_sock_select(mca_btl_base_endpoint_t* endpoint, mca_btl_tcp_frag_t* frag)
+{
+    mca_btl_tcp_socket_class_t* class = mca_btl_tcp_component.tcp_socket_class;
+    uint32_t count = endpoint->endpoint_sock_count;
+    int i;
+
+    if( NULL == endpoint->endpoint_socks ) {
+        /* unused by the receiver, but the fragments are recycled: do
+         * not put a stale value on the wire */
+        frag->hdr.seq = 0;
+        return endpoint;
+    }
+    frag->hdr.seq = (uint32_t)opal_atomic_fetch_add_32(&endpoint->endpoint_send_seq, 1);
+    for( i = 1; i < mca_btl_tcp_component.tcp_socket_class_count; i++ ) {
+        if( class[i].size > frag->hdr.size ) {
+            break;
+        }
+    }
+    if( (0 != class[i-1].sockets) && (class[i-1].sockets < count) ) {
+        count = class[i-1].sockets;
+    }
+    return endpoint->endpoint_socks[frag->hdr.seq % count];
+}
+
 /**
  * Initiate an asynchronous send.
  *
@@ -332,8 +370,9 @@ int mca_btl_tcp_send( struct mca_btl_base_module_t* btl,
     frag->hdr.base.tag = tag;
     frag->hdr.type = MCA_BTL_TCP_HDR_TYPE_SEND;
     frag->hdr.count = 0;
+    frag->endpoint = mca_btl_tcp_sock_select(endpoint, frag);
     if (endpoint->endpoint_nbo) MCA_BTL_TCP_HDR_HTON(frag->hdr);
-    return mca_btl_tcp_endpoint_send(endpoint,frag);
+    return mca_btl_tcp_endpoint_send(frag->endpoint,frag);
 }
 
 static void fake_rdma_complete (mca_btl_base_module_t *btl, mca_btl_base_endpoint_t *endpoint,
@@ -406,8 +445,9 @@ int mca_btl_tcp_put (mca_btl_base_module_t *btl, struct mca_btl_base_endpoint_t
     frag->hdr.base.tag = MCA_BTL_TAG_BTL;
     frag->hdr.type = MCA_BTL_TCP_HDR_TYPE_PUT;
     frag->hdr.count = 1;
+    frag->endpoint = mca_btl_tcp_sock_select(endpoint, frag);
     if (endpoint->endpoint_nbo) MCA_BTL_TCP_HDR_HTON(frag->hdr);
-    return ((i = mca_btl_tcp_endpoint_send(endpoint,frag)) >= 0 ? OPAL_SUCCESS : i);
+    return ((i = mca_btl_tcp_endpoint_send(frag->endpoint,frag)) >= 0 ? OPAL_SUCCESS : i);
 }
 
 
@@ -467,8 +507,9 @@ int mca_btl_tcp_get (mca_btl_base_module_t *btl, struct mca_btl_base_endpoint_t
     frag->hdr.base.tag = MCA_BTL_TAG_BTL;
     frag->hdr.type = MCA_BTL_TCP_HDR_TYPE_GET;
     frag->hdr.count = 1;
+    frag->endpoint = mca_btl_tcp_sock_select(endpoint, frag);
     if (endpoint->endpoint_nbo) MCA_BTL_TCP_HDR_HTON(frag->hdr);
-    return ((rc = mca_btl_tcp_endpoint_send(endpoint,frag)) >= 0 ? OPAL_SUCCESS : rc);
+    return ((rc = mca_btl_tcp_endpoint_send(frag->endpoint,frag)) >= 0 ? OPAL_SUCCESS : rc);
 }
 
 
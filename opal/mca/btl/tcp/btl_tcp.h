@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -59,7 +59,7 @@ extern opal_event_base_t* mca_btl_tcp_event_base;
     do {                                                                \
         int btl_ownership = (frag->base.des_flags & MCA_BTL_DES_FLAGS_BTL_OWNERSHIP); \
         if( frag->base.des_flags & MCA_BTL_DES_SEND_ALWAYS_CALLBACK ) { \
-            frag->base.des_cbfunc(&frag->endpoint->endpoint_btl->super, frag->endpoint, \
+            frag->base.des_cbfunc(&frag->endpoint->endpoint_btl->super, frag->endpoint->endpoint_lead, \
                                   &frag->base, frag->rc);               \
         }                                                               \
         if( btl_ownership ) {                                           \
@@ -97,6 +97,16 @@ extern int mca_btl_tcp_progress_thread_trigger;
         }                                                               \
     } while (0)
 
+/**
+ * Number of sockets of an endpoint a fragment can be spread on,
+ * depending on its size.
+ */
+struct mca_btl_tcp_socket_class_t {
+    size_t size;                            /**< smallest fragment of the class */
+    unsigned int sockets;                   /**< number of sockets (0 for all of them) */
+};
+typedef struct mca_btl_tcp_socket_class_t mca_btl_tcp_socket_class_t;
+
 /**
  * TCP BTL component.
  */
@@ -106,6 +116,10 @@ struct mca_btl_tcp_component_t {
     uint32_t tcp_addr_count;                /**< total number of addresses */
     uint32_t tcp_num_btls;                  /**< number of interfaces available to the TCP component */
     unsigned int tcp_num_links;             /**< number of logical links per physical device */
+    unsigned int tcp_sockets;               /**< number of sockets per endpoint */
+    char* tcp_socket_classes;               /**< size classes of the fragments, as given by the user */
+    mca_btl_tcp_socket_class_t* tcp_socket_class; /**< size classes, in increasing size */
+    int tcp_socket_class_count;             /**< number of size classes */
     struct mca_btl_tcp_module_t **tcp_btls; /**< array of available BTL modules */
     int tcp_free_list_num;                  /**< initial size of free lists */
     int tcp_free_list_max;                  /**< maximum size of free lists */
@@ -153,6 +167,16 @@ struct mca_btl_tcp_component_t {
      * that are not found?
      */
     bool report_all_unfound_interfaces;
+
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    int tcp_uring;                          /**< drive the connected sockets with io_uring */
+    unsigned int tcp_uring_entries;         /**< size of the io_uring submission queue */
+    int tcp_uring_sqpoll;                   /**< let a kernel thread poll the submission queue */
+    unsigned int tcp_uring_buffers;         /**< number of fragments registered with the ring */
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    unsigned int tcp_zerocopy_threshold;    /**< smallest write sent with MSG_ZEROCOPY (0 disables) */
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
 };
 typedef struct mca_btl_tcp_component_t mca_btl_tcp_component_t;
 
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -87,6 +87,7 @@
 #include "btl_tcp_proc.h"
 #include "btl_tcp_frag.h"
 #include "btl_tcp_endpoint.h"
+#include "btl_tcp_uring.h"
 #if OPAL_CUDA_SUPPORT
 #include "opal/mca/common/cuda/common_cuda.h"
 #endif /* OPAL_CUDA_SUPPORT */
@@ -247,6 +248,18 @@ static int mca_btl_tcp_component_register(void)
 
     /* register TCP component parameters */
     mca_btl_tcp_param_register_uint("links", NULL, 1, OPAL_INFO_LVL_4, &mca_btl_tcp_component.tcp_num_links);
+    mca_btl_tcp_param_register_uint("sockets",
+                                    "Number of sockets opened to each peer address. The fragments are "
+                                    "spread over them according to btl_tcp_socket_classes, and numbered so "
+                                    "that the peer delivers them in order. Must be the same on all the "
+                                    "processes, and cannot be combined with btl_tcp_links",
+                                    1, OPAL_INFO_LVL_4, &mca_btl_tcp_component.tcp_sockets);
+    mca_btl_tcp_param_register_string("socket_classes",
+                                      "Comma-delimited list of size:count pairs, in increasing size. The "
+                                      "fragments of at least size bytes are spread over the first count "
+                                      "sockets of the endpoint (0 for all of them), until the next size "
+                                      "(e.g., \"0:1,65536:2,1048576:0\")",
+                                      "0:1,65536:0", OPAL_INFO_LVL_5, &mca_btl_tcp_component.tcp_socket_classes);
     mca_btl_tcp_param_register_string("if_include", "Comma-delimited list of devices and/or CIDR notation of networks to use for MPI communication (e.g., \"eth0,192.168.0.0/16\").  Mutually exclusive with btl_tcp_if_exclude.", "", OPAL_INFO_LVL_1, &mca_btl_tcp_component.tcp_if_include);
     mca_btl_tcp_param_register_string("if_exclude", "Comma-delimited list of devices and/or CIDR notation of networks to NOT use for MPI communication -- all devices not matching these specifications will be used (e.g., \"eth0,192.168.0.0/16\").  If set to a non-default value, it is mutually exclusive with btl_tcp_if_include.",
                                       "127.0.0.1/8,sppp",
@@ -307,6 +320,34 @@ static int mca_btl_tcp_component_register(void)
     /* Check if we should support async progress */
     mca_btl_tcp_param_register_int ("progress_thread", NULL, 0, OPAL_INFO_LVL_1,
                                      &mca_btl_tcp_component.tcp_enable_progress_thread);
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    mca_btl_tcp_param_register_int ("uring",
+                                    "Drive the connected sockets with io_uring instead of the event library. "
+                                    "The sends and receives of all the connections are batched in a single "
+                                    "system call per progress, and completed without any. "
+                                    "Not compatible with the progress thread.",
+                                    0, OPAL_INFO_LVL_4, &mca_btl_tcp_component.tcp_uring);
+    mca_btl_tcp_param_register_uint("uring_entries", "Size of the io_uring submission queue",
+                                    1024, OPAL_INFO_LVL_5, &mca_btl_tcp_component.tcp_uring_entries);
+    mca_btl_tcp_param_register_int ("uring_sqpoll",
+                                    "Let a kernel thread poll the io_uring submission queue, so that "
+                                    "submitting does not need any system call either. The thread spins "
+                                    "for a while when it is idle, so it needs a core of its own",
+                                    0, OPAL_INFO_LVL_5, &mca_btl_tcp_component.tcp_uring_sqpoll);
+    mca_btl_tcp_param_register_uint("uring_buffers",
+                                    "Maximum number of eager and max fragments registered with io_uring "
+                                    "(0 disables the registered buffers)",
+                                    1024, OPAL_INFO_LVL_5, &mca_btl_tcp_component.tcp_uring_buffers);
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    mca_btl_tcp_param_register_uint("zerocopy_threshold",
+                                    "Send the writes of at least this many bytes with MSG_ZEROCOPY, so that "
+                                    "the kernel transmits the data straight from the user buffer instead of "
+                                    "copying it. The fragment completes once the kernel reports that it does "
+                                    "not need the buffer anymore. Only pays off for large writes, typically "
+                                    "above 64KB (0 disables, not used with io_uring)",
+                                    0, OPAL_INFO_LVL_4, &mca_btl_tcp_component.tcp_zerocopy_threshold);
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
     mca_btl_tcp_component.report_all_unfound_interfaces = false;
     (void) mca_base_component_var_register(&mca_btl_tcp_component.super.btl_version,
                                            "warn_all_unfound_interfaces",
@@ -448,6 +489,8 @@ static int mca_btl_tcp_component_close(void)
     if (NULL != mca_btl_tcp_component.tcp_btls) {
         free(mca_btl_tcp_component.tcp_btls);
     }
+    free(mca_btl_tcp_component.tcp_socket_class);
+    mca_btl_tcp_component.tcp_socket_class = NULL;
 
     if (mca_btl_tcp_component.tcp_listen_sd >= 0) {
         opal_event_del(&mca_btl_tcp_component.tcp_recv_event);
@@ -473,6 +516,11 @@ static int mca_btl_tcp_component_close(void)
 
     /* release resources */
     OBJ_DESTRUCT(&mca_btl_tcp_component.tcp_procs);
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    if( mca_btl_tcp_component.tcp_uring ) {
+        mca_btl_tcp_uring_fini();
+    }
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
     OBJ_DESTRUCT(&mca_btl_tcp_component.tcp_frag_eager);
     OBJ_DESTRUCT(&mca_btl_tcp_component.tcp_frag_max);
     OBJ_DESTRUCT(&mca_btl_tcp_component.tcp_frag_user);
@@ -1222,6 +1270,54 @@ static int mca_btl_tcp_component_exchange(void)
      return rc;
 }
 
+/*
+ * Parse btl_tcp_socket_classes. The first class always starts at 0.
+ */
+static int mca_btl_tcp_component_parse_socket_classes(void)
+{
+    char **classes = opal_argv_split(mca_btl_tcp_component.tcp_socket_classes, ',');
+    int count = opal_argv_count(classes);
+    mca_btl_tcp_socket_class_t* class;
+    char* end;
+    int i;
+
+    mca_btl_tcp_component.tcp_socket_class = class = (mca_btl_tcp_socket_class_t*)
+        calloc(count + 1, sizeof(mca_btl_tcp_socket_class_t));
+    if( NULL == class ) {
+        opal_argv_free(classes);
+        return OPAL_ERR_OUT_OF_RESOURCE;
+    }
+    /* fragments below the first size use a single socket */
+    class->sockets = 1;
+    mca_btl_tcp_component.tcp_socket_class_count = 1;
+
+    for( i = 0; i < count; i++ ) {
+        size_t size = strtoul(classes[i], &end, 10);
+        if( ':' != *end || (i > 0 && size <= class->size) ) {
+            goto error;
+        }
+        if( i > 0 || 0 != size ) {
+            class++;
+            mca_btl_tcp_component.tcp_socket_class_count++;
+        }
+        class->size = size;
+        class->sockets = strtoul(end + 1, &end, 10);
+        if( '\0' != *end ) {
+            goto error;
+        }
+    }
+    opal_argv_free(classes);
+    return OPAL_SUCCESS;
+
+ error:
+    BTL_ERROR(("invalid socket class \"%s\" in \"%s\", spreading all the fragments",
+               classes[i], mca_btl_tcp_component.tcp_socket_classes));
+    mca_btl_tcp_component.tcp_socket_class_count = 1;
+    mca_btl_tcp_component.tcp_socket_class->sockets = 0;
+    opal_argv_free(classes);
+    return OPAL_SUCCESS;
+}
+
 /*
  *  TCP module initialization:
  *  (1) read interface list from kernel and compare against module parameters
@@ -1236,8 +1332,37 @@ mca_btl_base_module_t** mca_btl_tcp_component_init(int *num_btl_modules,
     int ret = OPAL_SUCCESS;
     unsigned int i;
     mca_btl_base_module_t **btls;
+    opal_free_list_item_init_fn_t frag_init = NULL;
     *num_btl_modules = 0;
 
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    if( mca_btl_tcp_component.tcp_uring ) {
+        if( mca_btl_tcp_component.tcp_enable_progress_thread ) {
+            opal_output_verbose(10, opal_btl_base_framework.framework_output,
+                                "btl: tcp: io_uring disabled by the progress thread");
+            mca_btl_tcp_component.tcp_uring = 0;
+        } else if( OPAL_SUCCESS != mca_btl_tcp_uring_init() ) {
+            mca_btl_tcp_component.tcp_uring = 0;
+        } else {
+            mca_btl_tcp_component.super.btl_progress = mca_btl_tcp_uring_progress;
+            frag_init = mca_btl_tcp_uring_frag_init;
+        }
+    }
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+
+    if( 0 == mca_btl_tcp_component.tcp_sockets ) {
+        mca_btl_tcp_component.tcp_sockets = 1;
+    }
+    if( mca_btl_tcp_component.tcp_sockets > 1 && mca_btl_tcp_component.tcp_num_links > 1 ) {
+        /* the incoming connections of the links cannot be told apart */
+        opal_output_verbose(10, opal_btl_base_framework.framework_output,
+                            "btl: tcp: btl_tcp_sockets is ignored with btl_tcp_links");
+        mca_btl_tcp_component.tcp_sockets = 1;
+    }
+    if( OPAL_SUCCESS != mca_btl_tcp_component_parse_socket_classes() ) {
+        return NULL;
+    }
+
     /* initialize free lists */
     opal_free_list_init( &mca_btl_tcp_component.tcp_frag_eager,
                          sizeof (mca_btl_tcp_frag_eager_t) +
@@ -1248,7 +1373,7 @@ mca_btl_base_module_t** mca_btl_tcp_component_init(int *num_btl_modules,
                          mca_btl_tcp_component.tcp_free_list_num,
                          mca_btl_tcp_component.tcp_free_list_max,
                          mca_btl_tcp_component.tcp_free_list_inc,
-                         NULL, 0, NULL, NULL, NULL );
+                         NULL, 0, NULL, frag_init, NULL );
 
     opal_free_list_init( &mca_btl_tcp_component.tcp_frag_max,
                          sizeof (mca_btl_tcp_frag_max_t) +
@@ -1259,7 +1384,7 @@ mca_btl_base_module_t** mca_btl_tcp_component_init(int *num_btl_modules,
                          mca_btl_tcp_component.tcp_free_list_num,
                          mca_btl_tcp_component.tcp_free_list_max,
                          mca_btl_tcp_component.tcp_free_list_inc,
-                         NULL, 0, NULL, NULL, NULL );
+                         NULL, 0, NULL, frag_init, NULL );
 
     opal_free_list_init( &mca_btl_tcp_component.tcp_frag_user,
                          sizeof (mca_btl_tcp_frag_user_t),
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -50,6 +50,9 @@
 #include <sys/time.h>
 #endif  /* HAVE_SYS_TIME_H */
 #include <time.h>
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+#include <linux/errqueue.h>
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
 
 #include "opal/mca/event/event.h"
 #include "opal/util/net.h"
@@ -64,6 +67,7 @@
 #include "btl_tcp_proc.h"
 #include "btl_tcp_frag.h"
 #include "btl_tcp_addr.h"
+#include "btl_tcp_uring.h"
 
 /*
  * Magic ID string send during connect/accept handshake
@@ -87,6 +91,27 @@ static void mca_btl_tcp_endpoint_construct(mca_btl_tcp_endpoint_t* endpoint)
     endpoint->endpoint_state = MCA_BTL_TCP_CLOSED;
     endpoint->endpoint_retries = 0;
     endpoint->endpoint_nbo = false;
+    endpoint->endpoint_lead = endpoint;
+    endpoint->endpoint_socks = NULL;
+    endpoint->endpoint_sock_count = 1;
+    endpoint->endpoint_send_seq = 0;
+    endpoint->endpoint_recv_seq = 0;
+    OBJ_CONSTRUCT(&endpoint->endpoint_recv_held, opal_list_t);
+    OBJ_CONSTRUCT(&endpoint->endpoint_seq_lock, opal_mutex_t);
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    endpoint->endpoint_uring = false;
+    endpoint->endpoint_uring_recv_done = false;
+    endpoint->endpoint_uring_recv_res = 0;
+    endpoint->endpoint_uring_writes = 0;
+    endpoint->endpoint_uring_posted = 0;
+    OBJ_CONSTRUCT(&endpoint->endpoint_uring_frags, opal_list_t);
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    endpoint->endpoint_zerocopy = false;
+    endpoint->endpoint_zerocopy_next = 0;
+    endpoint->endpoint_zerocopy_done = 0;
+    OBJ_CONSTRUCT(&endpoint->endpoint_zerocopy_frags, opal_list_t);
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
 #if MCA_BTL_TCP_ENDPOINT_CACHE
     endpoint->endpoint_cache        = NULL;
     endpoint->endpoint_cache_pos    = NULL;
@@ -103,13 +128,70 @@ static void mca_btl_tcp_endpoint_construct(mca_btl_tcp_endpoint_t* endpoint)
  */
 static void mca_btl_tcp_endpoint_destruct(mca_btl_tcp_endpoint_t* endpoint)
 {
+    mca_btl_tcp_frag_t* frag;
+
+    if( NULL != endpoint->endpoint_socks ) {
+        for( unsigned int i = 1; i < endpoint->endpoint_sock_count; i++ ) {
+            OBJ_RELEASE(endpoint->endpoint_socks[i]);
+        }
+        free(endpoint->endpoint_socks);
+    }
     mca_btl_tcp_endpoint_close(endpoint);
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    /* the socket is shut down, wait for the ring to let go of the endpoint */
+    while( endpoint->endpoint_uring_posted > 0 ) {
+        mca_btl_tcp_uring_progress();
+    }
+    OBJ_DESTRUCT(&endpoint->endpoint_uring_frags);
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    OBJ_DESTRUCT(&endpoint->endpoint_zerocopy_frags);
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
     mca_btl_tcp_proc_remove(endpoint->endpoint_proc, endpoint);
     OBJ_DESTRUCT(&endpoint->endpoint_frags);
+    while( NULL != (frag = (mca_btl_tcp_frag_t*)opal_list_remove_first(&endpoint->endpoint_recv_held)) ) {
+        MCA_BTL_TCP_FRAG_RETURN(frag);
+    }
+    OBJ_DESTRUCT(&endpoint->endpoint_recv_held);
+    OBJ_DESTRUCT(&endpoint->endpoint_seq_lock);
     OBJ_DESTRUCT(&endpoint->endpoint_send_lock);
     OBJ_DESTRUCT(&endpoint->endpoint_recv_lock);
 }
 
+/*
+ * Create the endpoints of the additional sockets to the peer address of
+ * a newly inserted endpoint. They are not known by the upper layer,
+ * but they are in the proc so that they can accept connections.
+ * Called with the proc lock held.
+ */
+int mca_btl_tcp_endpoint_create_socks(mca_btl_base_endpoint_t* btl_endpoint, unsigned int count)
+{
+    mca_btl_tcp_proc_t* btl_proc = btl_endpoint->endpoint_proc;
+
+    if( count <= 1 ) {
+        return OPAL_SUCCESS;
+    }
+    btl_endpoint->endpoint_socks = (mca_btl_base_endpoint_t**)calloc(count, sizeof(mca_btl_base_endpoint_t*));
+    if( NULL == btl_endpoint->endpoint_socks ) {
+        return OPAL_ERR_OUT_OF_RESOURCE;
+    }
+    btl_endpoint->endpoint_socks[0] = btl_endpoint;
+    for( unsigned int i = 1; i < count; i++ ) {
+        mca_btl_base_endpoint_t* sock = OBJ_NEW(mca_btl_tcp_endpoint_t);
+        if( NULL == sock ) {
+            break;
+        }
+        sock->endpoint_btl = btl_endpoint->endpoint_btl;
+        sock->endpoint_proc = btl_proc;
+        sock->endpoint_addr = btl_endpoint->endpoint_addr;
+        sock->endpoint_nbo = btl_endpoint->endpoint_nbo;
+        sock->endpoint_lead = btl_endpoint;
+        btl_proc->proc_endpoints[btl_proc->proc_endpoint_count++] = sock;
+        btl_endpoint->endpoint_socks[btl_endpoint->endpoint_sock_count++] = sock;
+    }
+    return OPAL_SUCCESS;
+}
+
 OBJ_CLASS_INSTANCE(
     mca_btl_tcp_endpoint_t,
     opal_list_item_t,
@@ -323,6 +405,314 @@ static inline void mca_btl_tcp_endpoint_event_init(mca_btl_base_endpoint_t* btl_
 }
 
 
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+/*
+ * Enable the zero-copy writes on a newly connected socket. The kernel
+ * numbers them from 0 on each socket.
+ */
+static void mca_btl_tcp_endpoint_zerocopy_connected(mca_btl_base_endpoint_t* btl_endpoint)
+{
+    int flag = 1;
+
+    btl_endpoint->endpoint_zerocopy = false;
+    btl_endpoint->endpoint_zerocopy_next = 0;
+    btl_endpoint->endpoint_zerocopy_done = 0;
+    if( 0 == mca_btl_tcp_component.tcp_zerocopy_threshold ) {
+        return;
+    }
+    if( setsockopt(btl_endpoint->endpoint_sd, SOL_SOCKET, SO_ZEROCOPY, &flag, sizeof(flag)) < 0 ) {
+        opal_output_verbose(20, opal_btl_base_framework.framework_output,
+                            "btl: tcp: cannot enable SO_ZEROCOPY: %s (%d)",
+                            strerror(opal_socket_errno), opal_socket_errno);
+        return;
+    }
+    btl_endpoint->endpoint_zerocopy = true;
+}
+
+/*
+ * A fragment is completely sent, but the kernel may still be reading
+ * from its buffers. If so keep it until it reports it is done with
+ * them. Called with the send lock held.
+ */
+static bool mca_btl_tcp_endpoint_zerocopy_defer(mca_btl_base_endpoint_t* btl_endpoint,
+                                                mca_btl_tcp_frag_t* frag)
+{
+    if( !frag->zerocopy ) {
+        return false;
+    }
+    if( (int32_t)(frag->zerocopy_id - btl_endpoint->endpoint_zerocopy_done) < 0 ) {
+        frag->zerocopy = false;
+        return false;
+    }
+    frag->base.des_flags |= MCA_BTL_DES_SEND_ALWAYS_CALLBACK;
+    opal_list_append(&btl_endpoint->endpoint_zerocopy_frags, (opal_list_item_t*)frag);
+    return true;
+}
+
+/*
+ * Read the notifications of the zero-copy writes from the error queue
+ * of the socket, and complete the fragments whose buffers were
+ * released.
+ */
+static void mca_btl_tcp_endpoint_zerocopy_progress(mca_btl_base_endpoint_t* btl_endpoint)
+{
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_storage))];
+    struct sock_extended_err* serr;
+    struct cmsghdr* cmsg;
+    mca_btl_tcp_frag_t* frag;
+    opal_list_t done;
+
+    OBJ_CONSTRUCT(&done, opal_list_t);
+    OPAL_THREAD_LOCK(&btl_endpoint->endpoint_send_lock);
+    while( btl_endpoint->endpoint_zerocopy_done != btl_endpoint->endpoint_zerocopy_next ) {
+        struct msghdr msg = { .msg_control = control, .msg_controllen = sizeof(control) };
+
+        if( recvmsg(btl_endpoint->endpoint_sd, &msg, MSG_ERRQUEUE) < 0 ) {
+            break;  /* nothing more for now */
+        }
+        for( cmsg = CMSG_FIRSTHDR(&msg); NULL != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg) ) {
+            if( !(SOL_IP == cmsg->cmsg_level && IP_RECVERR == cmsg->cmsg_type) &&
+                !(SOL_IPV6 == cmsg->cmsg_level && IPV6_RECVERR == cmsg->cmsg_type) ) {
+                continue;
+            }
+            serr = (struct sock_extended_err*)CMSG_DATA(cmsg);
+            if( SO_EE_ORIGIN_ZEROCOPY != serr->ee_origin ) {
+                continue;
+            }
+            /* the writes [ee_info, ee_data] are released, in order */
+            btl_endpoint->endpoint_zerocopy_done = serr->ee_data + 1;
+            if( (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && btl_endpoint->endpoint_zerocopy ) {
+                /* the kernel had to copy the data anyway (loopback, or
+                 * a device without scatter-gather), stop paying for
+                 * the notifications */
+                opal_output_verbose(20, opal_btl_base_framework.framework_output,
+                                    "btl: tcp: zero-copy writes fall back to copies, disabling them");
+                btl_endpoint->endpoint_zerocopy = false;
+            }
+        }
+    }
+    while( !opal_list_is_empty(&btl_endpoint->endpoint_zerocopy_frags) ) {
+        frag = (mca_btl_tcp_frag_t*)opal_list_get_first(&btl_endpoint->endpoint_zerocopy_frags);
+        if( (int32_t)(frag->zerocopy_id - btl_endpoint->endpoint_zerocopy_done) >= 0 ) {
+            break;
+        }
+        opal_list_remove_first(&btl_endpoint->endpoint_zerocopy_frags);
+        frag->zerocopy = false;
+        opal_list_append(&done, (opal_list_item_t*)frag);
+    }
+    OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_send_lock);
+
+    while( NULL != (frag = (mca_btl_tcp_frag_t*)opal_list_remove_first(&done)) ) {
+        int btl_ownership = (frag->base.des_flags & MCA_BTL_DES_FLAGS_BTL_OWNERSHIP);
+
+        frag->base.des_cbfunc(&frag->btl->super, frag->endpoint->endpoint_lead, &frag->base, frag->rc);
+        if( btl_ownership ) {
+            MCA_BTL_TCP_FRAG_RETURN(frag);
+        }
+    }
+    OBJ_DESTRUCT(&done);
+}
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
+
+#if OPAL_BTL_TCP_HAVE_IO_URING
+/*
+ * Number of fragments written by a single chain of linked requests.
+ */
+#define MCA_BTL_TCP_URING_CHAIN 16
+
+/*
+ * Submit the pending fragments as a chain of linked writes. There is
+ * at most one chain in the ring per endpoint, the next one starts with
+ * the fragments left behind by a short write. Called with the send lock
+ * held.
+ */
+static void mca_btl_tcp_endpoint_uring_start_send(mca_btl_base_endpoint_t* btl_endpoint)
+{
+    mca_btl_tcp_frag_t* frags[MCA_BTL_TCP_URING_CHAIN];
+    mca_btl_tcp_frag_t* frag;
+    int count = 0;
+
+    if( btl_endpoint->endpoint_uring_writes > 0 )
+        return;
+
+    while( opal_list_get_size(&btl_endpoint->endpoint_uring_frags) < MCA_BTL_TCP_URING_CHAIN &&
+           NULL != (frag = (mca_btl_tcp_frag_t*)opal_list_remove_first(&btl_endpoint->endpoint_frags)) ) {
+        opal_list_append(&btl_endpoint->endpoint_uring_frags, (opal_list_item_t*)frag);
+    }
+    OPAL_LIST_FOREACH(frag, &btl_endpoint->endpoint_uring_frags, mca_btl_tcp_frag_t) {
+        frags[count++] = frag;
+    }
+    if( 0 < count ) {
+        btl_endpoint->endpoint_uring_writes = mca_btl_tcp_uring_write_chain(frags, count);
+    }
+}
+
+/*
+ * Post a read for the next fragment. Called with the recv lock held.
+ */
+static void mca_btl_tcp_endpoint_uring_post_recv(mca_btl_base_endpoint_t* btl_endpoint)
+{
+    mca_btl_tcp_frag_t* frag = btl_endpoint->endpoint_recv_frag;
+
+    if( NULL == frag ) {
+        MCA_BTL_TCP_FRAG_ALLOC_RECV(frag);
+        if( NULL == frag ) {
+            BTL_ERROR(("cannot allocate a fragment to receive from %s",
+                       OPAL_NAME_PRINT(btl_endpoint->endpoint_proc->proc_opal->proc_name)));
+            return;
+        }
+    }
+    MCA_BTL_TCP_FRAG_INIT_DST(frag, btl_endpoint);
+    btl_endpoint->endpoint_recv_frag = frag;
+    /* nothing is cached yet, so this only posts the read */
+    (void)mca_btl_tcp_frag_recv(frag, btl_endpoint->endpoint_sd);
+}
+
+/*
+ * Hand a newly connected socket over to the ring. Called with both the
+ * send and the recv locks held.
+ *
+ * The socket goes back to blocking mode: on a non-blocking socket the
+ * reads and writes complete right away with -EAGAIN and we would spin
+ * reposting them, while on a blocking one the ring waits internally for
+ * the socket to become ready. Nothing but the ring touches the socket
+ * until it is closed.
+ */
+static void mca_btl_tcp_endpoint_uring_connected(mca_btl_base_endpoint_t* btl_endpoint)
+{
+    int flags;
+
+    if((flags = fcntl(btl_endpoint->endpoint_sd, F_GETFL, 0)) < 0) {
+        BTL_ERROR(("fcntl(F_GETFL) failed: %s (%d)",
+                   strerror(opal_socket_errno), opal_socket_errno));
+    } else if(fcntl(btl_endpoint->endpoint_sd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+        BTL_ERROR(("fcntl(F_SETFL) failed: %s (%d)",
+                   strerror(opal_socket_errno), opal_socket_errno));
+    }
+
+    MCA_BTL_TCP_ENDPOINT_DUMP(10, btl_endpoint, false, "event_del(recv) [endpoint_uring_connected]");
+    opal_event_del(&btl_endpoint->endpoint_recv_event);
+    if( mca_btl_tcp_event_base == opal_sync_event_base ) {
+        opal_progress_event_users_decrement();
+    }
+    btl_endpoint->endpoint_uring = true;
+    btl_endpoint->endpoint_uring_recv_done = false;
+    mca_btl_tcp_endpoint_uring_post_recv(btl_endpoint);
+    mca_btl_tcp_endpoint_uring_start_send(btl_endpoint);
+}
+
+/*
+ * Detach the requests still in the ring from the endpoint being closed.
+ * They complete once the socket is shut down, as orphans.
+ */
+static void mca_btl_tcp_endpoint_uring_close(mca_btl_base_endpoint_t* btl_endpoint)
+{
+    mca_btl_tcp_frag_t *frag, *prev;
+
+    btl_endpoint->endpoint_uring = false;
+    btl_endpoint->endpoint_uring_recv_done = false;
+
+    frag = btl_endpoint->endpoint_recv_frag;
+    if( NULL != frag && frag->uring_posted ) {
+        /* the read still writes in the cache, which is released along
+         * with the fragment */
+        frag->uring_orphan = true;
+        btl_endpoint->endpoint_recv_frag = NULL;
+#if MCA_BTL_TCP_ENDPOINT_CACHE
+        btl_endpoint->endpoint_cache = NULL;
+#endif  /* MCA_BTL_TCP_ENDPOINT_CACHE */
+    }
+
+    /* the fragments not in the ring go back to the pending ones, in order */
+    btl_endpoint->endpoint_uring_writes = 0;
+    OPAL_LIST_FOREACH_SAFE_REV(frag, prev, &btl_endpoint->endpoint_uring_frags, mca_btl_tcp_frag_t) {
+        opal_list_remove_item(&btl_endpoint->endpoint_uring_frags, (opal_list_item_t*)frag);
+        if( frag->uring_posted ) {
+            frag->uring_orphan = true;
+        } else {
+            opal_list_prepend(&btl_endpoint->endpoint_frags, (opal_list_item_t*)frag);
+        }
+    }
+}
+
+/*
+ * Completion of a read posted by mca_btl_tcp_frag_recv().
+ */
+void mca_btl_tcp_endpoint_uring_recv_complete(mca_btl_tcp_frag_t* frag, int res)
+{
+    mca_btl_base_endpoint_t* btl_endpoint = frag->endpoint;
+
+    OPAL_THREAD_LOCK(&btl_endpoint->endpoint_recv_lock);
+    frag->uring_posted = false;
+    (void)opal_atomic_add_fetch_32(&btl_endpoint->endpoint_uring_posted, -1);
+    if( frag->uring_orphan ) {
+        frag->uring_orphan = false;
+        OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_recv_lock);
+#if MCA_BTL_TCP_ENDPOINT_CACHE
+        free(frag->iov_ptr[frag->iov_cnt].iov_base);
+#endif  /* MCA_BTL_TCP_ENDPOINT_CACHE */
+        MCA_BTL_TCP_FRAG_RETURN(frag);
+        return;
+    }
+    btl_endpoint->endpoint_uring_recv_done = true;
+    btl_endpoint->endpoint_uring_recv_res = res;
+    OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_recv_lock);
+
+    mca_btl_tcp_endpoint_recv_handler(btl_endpoint->endpoint_sd, OPAL_EV_READ, btl_endpoint);
+}
+
+/*
+ * Completion of a write of a chain.
+ */
+void mca_btl_tcp_endpoint_uring_send_complete(mca_btl_tcp_frag_t* frag, int res)
+{
+    mca_btl_base_endpoint_t* btl_endpoint = frag->endpoint;
+    bool complete = false;
+
+    OPAL_THREAD_LOCK(&btl_endpoint->endpoint_send_lock);
+    frag->uring_posted = false;
+    (void)opal_atomic_add_fetch_32(&btl_endpoint->endpoint_uring_posted, -1);
+    if( frag->uring_orphan ) {
+        /* the endpoint was closed in the meantime */
+        frag->uring_orphan = false;
+        if( res < 0 || !mca_btl_tcp_frag_update_send(frag, (size_t)res) ) {
+            frag->rc = OPAL_ERR_UNREACH;
+        }
+        complete = true;
+    } else {
+        btl_endpoint->endpoint_uring_writes--;
+        if( res >= 0 ) {
+            complete = mca_btl_tcp_frag_update_send(frag, (size_t)res);
+            if( complete ) {
+                opal_list_remove_item(&btl_endpoint->endpoint_uring_frags, (opal_list_item_t*)frag);
+            }
+        } else if( -ECANCELED != res && -EAGAIN != res && -EINTR != res ) {
+            /* the fragment is not in the ring anymore, it fails with the endpoint */
+            BTL_ERROR(("mca_btl_tcp_frag_send: writev failed: %s (%d)",
+                       strerror(-res), -res));
+            btl_endpoint->endpoint_state = MCA_BTL_TCP_FAILED;
+            mca_btl_tcp_endpoint_close(btl_endpoint);
+        }
+        /* the requests after a short write, or those of a thread that
+         * exited, were canceled: start over from there */
+        if( btl_endpoint->endpoint_uring && 0 == btl_endpoint->endpoint_uring_writes ) {
+            mca_btl_tcp_endpoint_uring_start_send(btl_endpoint);
+        }
+    }
+    OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_send_lock);
+
+    if( complete ) {
+        int btl_ownership = (frag->base.des_flags & MCA_BTL_DES_FLAGS_BTL_OWNERSHIP);
+
+        assert( frag->base.des_flags & MCA_BTL_DES_SEND_ALWAYS_CALLBACK );
+        frag->base.des_cbfunc(&frag->btl->super, frag->endpoint->endpoint_lead, &frag->base, frag->rc);
+        if( btl_ownership ) {
+            MCA_BTL_TCP_FRAG_RETURN(frag);
+        }
+    }
+}
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+
 /*
  * Attempt to send a fragment using a given endpoint. If the endpoint is not connected,
  * queue the fragment and start the connection as required.
@@ -346,14 +736,28 @@ int mca_btl_tcp_endpoint_send(mca_btl_base_endpoint_t* btl_endpoint, mca_btl_tcp
         rc = OPAL_ERR_UNREACH;
         break;
     case MCA_BTL_TCP_CONNECTED:
+#if OPAL_BTL_TCP_HAVE_IO_URING
+        if (btl_endpoint->endpoint_uring) {
+            frag->base.des_flags |= MCA_BTL_DES_SEND_ALWAYS_CALLBACK;
+            opal_list_append(&btl_endpoint->endpoint_frags, (opal_list_item_t*)frag);
+            mca_btl_tcp_endpoint_uring_start_send(btl_endpoint);
+            break;
+        }
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
         if (NULL == btl_endpoint->endpoint_send_frag) {
             if(frag->base.des_flags & MCA_BTL_DES_FLAGS_PRIORITY &&
                mca_btl_tcp_frag_send(frag, btl_endpoint->endpoint_sd)) {
                 int btl_ownership = (frag->base.des_flags & MCA_BTL_DES_FLAGS_BTL_OWNERSHIP);
 
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+                if( mca_btl_tcp_endpoint_zerocopy_defer(btl_endpoint, frag) ) {
+                    OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_send_lock);
+                    return OPAL_SUCCESS;
+                }
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
                 OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_send_lock);
                 if( frag->base.des_flags & MCA_BTL_DES_SEND_ALWAYS_CALLBACK ) {
-                    frag->base.des_cbfunc(&frag->btl->super, frag->endpoint, &frag->base, frag->rc);
+                    frag->base.des_cbfunc(&frag->btl->super, frag->endpoint->endpoint_lead, &frag->base, frag->rc);
                 }
                 if( btl_ownership ) {
                     MCA_BTL_TCP_FRAG_RETURN(frag);
@@ -520,9 +924,16 @@ void mca_btl_tcp_endpoint_close(mca_btl_base_endpoint_t* btl_endpoint)
     btl_endpoint->endpoint_retries++;
     MCA_BTL_TCP_ENDPOINT_DUMP(1, btl_endpoint, false, "event_del(recv) [close]");
     opal_event_del(&btl_endpoint->endpoint_recv_event);
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    if( btl_endpoint->endpoint_uring ) {
+        /* the recv event was already removed from the progress engine */
+        mca_btl_tcp_endpoint_uring_close(btl_endpoint);
+    } else
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
     if( mca_btl_tcp_event_base == opal_sync_event_base ) {
         /* If no progress thread then lower the awarness of the default progress engine */
         opal_progress_event_users_decrement();
+        (void)opal_progress_wait_unregister(btl_endpoint->endpoint_sd);
     }
     MCA_BTL_TCP_ENDPOINT_DUMP(1, btl_endpoint, false, "event_del(send) [close]");
     opal_event_del(&btl_endpoint->endpoint_send_event);
@@ -546,11 +957,28 @@ void mca_btl_tcp_endpoint_close(mca_btl_base_endpoint_t* btl_endpoint)
         if( NULL == frag )
             frag = (mca_btl_tcp_frag_t*)opal_list_remove_first(&btl_endpoint->endpoint_frags);
         while(NULL != frag) {
-            frag->base.des_cbfunc(&frag->btl->super, frag->endpoint, &frag->base, OPAL_ERR_UNREACH);
+            frag->base.des_cbfunc(&frag->btl->super, frag->endpoint->endpoint_lead, &frag->base, OPAL_ERR_UNREACH);
 
             frag = (mca_btl_tcp_frag_t*)opal_list_remove_first(&btl_endpoint->endpoint_frags);
         }
     }
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    /* nothing will be reported anymore for the writes of the socket */
+    {
+        mca_btl_tcp_frag_t* frag;
+        while( NULL != (frag = (mca_btl_tcp_frag_t*)opal_list_remove_first(&btl_endpoint->endpoint_zerocopy_frags)) ) {
+            int btl_ownership = (frag->base.des_flags & MCA_BTL_DES_FLAGS_BTL_OWNERSHIP);
+
+            frag->zerocopy = false;
+            frag->base.des_cbfunc(&frag->btl->super, frag->endpoint->endpoint_lead, &frag->base, frag->rc);
+            if( btl_ownership ) {
+                MCA_BTL_TCP_FRAG_RETURN(frag);
+            }
+        }
+        btl_endpoint->endpoint_zerocopy = false;
+        btl_endpoint->endpoint_zerocopy_next = btl_endpoint->endpoint_zerocopy_done = 0;
+    }
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
     btl_endpoint->endpoint_state = MCA_BTL_TCP_CLOSED;
 }
 
@@ -568,6 +996,20 @@ static void mca_btl_tcp_endpoint_connected(mca_btl_base_endpoint_t* btl_endpoint
     btl_endpoint->endpoint_retries = 0;
     MCA_BTL_TCP_ENDPOINT_DUMP(1, btl_endpoint, true, "READY [endpoint_connected]");
 
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    if(mca_btl_tcp_component.tcp_uring) {
+        mca_btl_tcp_endpoint_uring_connected(btl_endpoint);
+        return;
+    }
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    mca_btl_tcp_endpoint_zerocopy_connected(btl_endpoint);
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
+    if( mca_btl_tcp_event_base == opal_sync_event_base ) {
+        /* wake up the threads blocked in the progress engine when data arrives */
+        (void)opal_progress_wait_register(btl_endpoint->endpoint_sd, NULL);
+    }
+
     if(opal_list_get_size(&btl_endpoint->endpoint_frags) > 0) {
         if(NULL == btl_endpoint->endpoint_send_frag)
             btl_endpoint->endpoint_send_frag = (mca_btl_tcp_frag_t*)
@@ -876,6 +1318,56 @@ static int mca_btl_tcp_endpoint_complete_connect(mca_btl_base_endpoint_t* btl_en
 }
 
 
+/*
+ * Hand a received fragment to the upper layer, in the order in which
+ * the fragments were sent over all the sockets to the peer address.
+ * A fragment that arrives ahead of its turn is held back until the
+ * ones before it are delivered, so that, e.g., a control message does
+ * not overtake the data of a put sent on another socket. Called with
+ * the recv lock of the socket held.
+ *
+ * @return true if the fragment was held back, and now belongs to the
+ *         endpoint.
+ */
+static bool mca_btl_tcp_endpoint_recv_deliver(mca_btl_base_endpoint_t* btl_endpoint,
+                                              mca_btl_tcp_frag_t* frag)
+{
+    mca_btl_base_endpoint_t* lead = btl_endpoint->endpoint_lead;
+    mca_btl_tcp_frag_t* item;
+
+    if( NULL == lead->endpoint_socks ) {
+        MCA_BTL_TCP_RECV_TRIGGER_CB(frag);
+        return false;
+    }
+
+    OPAL_THREAD_LOCK(&lead->endpoint_seq_lock);
+    if( frag->hdr.seq != lead->endpoint_recv_seq ) {
+        OPAL_LIST_FOREACH_REV(item, &lead->endpoint_recv_held, mca_btl_tcp_frag_t) {
+            if( (int32_t)(frag->hdr.seq - item->hdr.seq) > 0 ) {
+                break;
+            }
+        }
+        opal_list_insert_pos(&lead->endpoint_recv_held, opal_list_get_next((opal_list_item_t*)item),
+                             (opal_list_item_t*)frag);
+        OPAL_THREAD_UNLOCK(&lead->endpoint_seq_lock);
+        return true;
+    }
+    MCA_BTL_TCP_RECV_TRIGGER_CB(frag);
+    lead->endpoint_recv_seq++;
+    while( !opal_list_is_empty(&lead->endpoint_recv_held) ) {
+        item = (mca_btl_tcp_frag_t*)opal_list_get_first(&lead->endpoint_recv_held);
+        if( item->hdr.seq != lead->endpoint_recv_seq ) {
+            break;
+        }
+        opal_list_remove_first(&lead->endpoint_recv_held);
+        MCA_BTL_TCP_RECV_TRIGGER_CB(item);
+        lead->endpoint_recv_seq++;
+        MCA_BTL_TCP_FRAG_RETURN(item);
+    }
+    OPAL_THREAD_UNLOCK(&lead->endpoint_seq_lock);
+    return false;
+}
+
 /*
  * A file descriptor is available/ready for recv. Check the state
  * of the socket and take the appropriate action.
@@ -891,6 +1383,13 @@ static void mca_btl_tcp_endpoint_recv_handler(int sd, short flags, void* user)
     if( sd != btl_endpoint->endpoint_sd )
         return;
 
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    /* the notifications of the zero-copy writes wake up the socket as errors */
+    if( btl_endpoint->endpoint_zerocopy_done != btl_endpoint->endpoint_zerocopy_next ) {
+        mca_btl_tcp_endpoint_zerocopy_progress(btl_endpoint);
+    }
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
+
     /**
      * There is an extremely rare race condition here, that can only be
      * triggered during the initialization. If the two processes start their
@@ -907,6 +1406,12 @@ static void mca_btl_tcp_endpoint_recv_handler(int sd, short flags, void* user)
      * If we can't lock this mutex, it is OK to cancel the receive operation, it
      * will be eventually triggered again shorthly.
      */
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    /* a completed read is delivered only once, it cannot be dropped */
+    if( btl_endpoint->endpoint_uring ) {
+        OPAL_THREAD_LOCK(&btl_endpoint->endpoint_recv_lock);
+    } else
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
     if( OPAL_THREAD_TRYLOCK(&btl_endpoint->endpoint_recv_lock) )
         return;
 
@@ -950,13 +1455,7 @@ static void mca_btl_tcp_endpoint_recv_handler(int sd, short flags, void* user)
 
             frag = btl_endpoint->endpoint_recv_frag;
             if(NULL == frag) {
-                if(mca_btl_tcp_module.super.btl_max_send_size >
-                   mca_btl_tcp_module.super.btl_eager_limit) {
-                    MCA_BTL_TCP_FRAG_ALLOC_MAX(frag);
-                } else {
-                    MCA_BTL_TCP_FRAG_ALLOC_EAGER(frag);
-                }
-
+                MCA_BTL_TCP_FRAG_ALLOC_RECV(frag);
                 if(NULL == frag) {
                     OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_recv_lock);
                     return;
@@ -972,26 +1471,40 @@ static void mca_btl_tcp_endpoint_recv_handler(int sd, short flags, void* user)
             if(mca_btl_tcp_frag_recv(frag, btl_endpoint->endpoint_sd) == false) {
                 btl_endpoint->endpoint_recv_frag = frag;
             } else {
+                bool held;
+
                 btl_endpoint->endpoint_recv_frag = NULL;
-                if( MCA_BTL_TCP_HDR_TYPE_SEND == frag->hdr.type ) {
-                    mca_btl_active_message_callback_t* reg;
-                    reg = mca_btl_base_active_message_trigger + frag->hdr.base.tag;
-                    reg->cbfunc(&frag->btl->super, frag->hdr.base.tag, &frag->base, reg->cbdata);
-                }
+                held = mca_btl_tcp_endpoint_recv_deliver(btl_endpoint, frag);
 #if MCA_BTL_TCP_ENDPOINT_CACHE
                 if( 0 != btl_endpoint->endpoint_cache_length ) {
                     /* If the cache still contain some data we can reuse the same fragment
                      * until we flush it completly.
                      */
+                    if( held ) {
+                        MCA_BTL_TCP_FRAG_ALLOC_RECV(frag);
+                        if( NULL == frag ) {
+                            OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_recv_lock);
+                            return;
+                        }
+                    }
                     MCA_BTL_TCP_FRAG_INIT_DST(frag, btl_endpoint);
                     goto data_still_pending_on_endpoint;
                 }
 #endif  /* MCA_BTL_TCP_ENDPOINT_CACHE */
-                MCA_BTL_TCP_FRAG_RETURN(frag);
+                if( !held ) {
+                    MCA_BTL_TCP_FRAG_RETURN(frag);
+                }
             }
 #if MCA_BTL_TCP_ENDPOINT_CACHE
             assert( 0 == btl_endpoint->endpoint_cache_length );
 #endif  /* MCA_BTL_TCP_ENDPOINT_CACHE */
+#if OPAL_BTL_TCP_HAVE_IO_URING
+            /* keep a read posted on the socket */
+            if( btl_endpoint->endpoint_uring && NULL == btl_endpoint->endpoint_recv_frag &&
+                MCA_BTL_TCP_CONNECTED == btl_endpoint->endpoint_state ) {
+                mca_btl_tcp_endpoint_uring_post_recv(btl_endpoint);
+            }
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
             OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_recv_lock);
             break;
         }
@@ -1043,11 +1556,16 @@ static void mca_btl_tcp_endpoint_send_handler(int sd, short flags, void* user)
             /* progress any pending sends */
             btl_endpoint->endpoint_send_frag = (mca_btl_tcp_frag_t*)
                 opal_list_remove_first(&btl_endpoint->endpoint_frags);
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+            if( mca_btl_tcp_endpoint_zerocopy_defer(btl_endpoint, frag) ) {
+                continue;
+            }
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
 
             /* if required - update request status and release fragment */
             OPAL_THREAD_UNLOCK(&btl_endpoint->endpoint_send_lock);
             assert( frag->base.des_flags & MCA_BTL_DES_SEND_ALWAYS_CALLBACK );
-            frag->base.des_cbfunc(&frag->btl->super, frag->endpoint, &frag->base, frag->rc);
+            frag->base.des_cbfunc(&frag->btl->super, frag->endpoint->endpoint_lead, &frag->base, frag->rc);
             if( btl_ownership ) {
                 MCA_BTL_TCP_FRAG_RETURN(frag);
             }
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -69,6 +69,27 @@ struct mca_btl_base_endpoint_t {
     opal_event_t                    endpoint_send_event;   /**< event for async processing of send frags */
     opal_event_t                    endpoint_recv_event;   /**< event for async processing of recv frags */
     bool                            endpoint_nbo;          /**< convert headers to network byte order? */
+    struct mca_btl_base_endpoint_t* endpoint_lead;         /**< endpoint known by the upper layer for this socket (possibly itself) */
+    struct mca_btl_base_endpoint_t** endpoint_socks;       /**< endpoints of all the sockets to the peer address (lead only) */
+    unsigned int                    endpoint_sock_count;   /**< number of sockets to the peer address (lead only) */
+    opal_atomic_int32_t             endpoint_send_seq;     /**< sequence number of the next fragment sent (lead only) */
+    uint32_t                        endpoint_recv_seq;     /**< sequence number of the next fragment delivered (lead only) */
+    opal_list_t                     endpoint_recv_held;    /**< fragments received ahead of their turn, in order (lead only) */
+    opal_mutex_t                    endpoint_seq_lock;     /**< serializes the delivery of the fragments (lead only) */
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    bool                            endpoint_uring;        /**< the connected socket is driven by io_uring */
+    bool                            endpoint_uring_recv_done; /**< a read completed, its result is pending */
+    int                             endpoint_uring_recv_res;  /**< result of the completed read */
+    int                             endpoint_uring_writes; /**< writes of the current chain still in the ring */
+    opal_list_t                     endpoint_uring_frags;  /**< frags of the current chain, in order */
+    opal_atomic_int32_t             endpoint_uring_posted; /**< requests of the endpoint in the ring */
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    bool                            endpoint_zerocopy;     /**< SO_ZEROCOPY is enabled on the socket */
+    uint32_t                        endpoint_zerocopy_next; /**< id of the next zero-copy write */
+    uint32_t                        endpoint_zerocopy_done; /**< id of the first zero-copy write not released yet */
+    opal_list_t                     endpoint_zerocopy_frags; /**< sent frags waiting for their buffers, in order */
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
 };
 
 typedef struct mca_btl_base_endpoint_t mca_btl_base_endpoint_t;
@@ -88,6 +109,11 @@ void mca_btl_tcp_endpoint_close(mca_btl_base_endpoint_t*);
 int  mca_btl_tcp_endpoint_send(mca_btl_base_endpoint_t*, struct mca_btl_tcp_frag_t*);
 void mca_btl_tcp_endpoint_accept(mca_btl_base_endpoint_t*, struct sockaddr*, int);
 void mca_btl_tcp_endpoint_shutdown(mca_btl_base_endpoint_t*);
+int  mca_btl_tcp_endpoint_create_socks(mca_btl_base_endpoint_t*, unsigned int);
+#if OPAL_BTL_TCP_HAVE_IO_URING
+void mca_btl_tcp_endpoint_uring_recv_complete(struct mca_btl_tcp_frag_t*, int res);
+void mca_btl_tcp_endpoint_uring_send_complete(struct mca_btl_tcp_frag_t*, int res);
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
 
 /*
  * Diagnostics: change this to "1" to enable the function
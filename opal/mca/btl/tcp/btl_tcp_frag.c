@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -49,24 +49,41 @@
 #include "btl_tcp_frag.h"
 #include "btl_tcp_endpoint.h"
 #include "btl_tcp_proc.h"
+#include "btl_tcp_uring.h"
 
 
+static void mca_btl_tcp_frag_common_constructor(mca_btl_tcp_frag_t* frag)
+{
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    frag->uring_buf = -1;
+    frag->uring_posted = false;
+    frag->uring_orphan = false;
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    frag->zerocopy = false;
+    frag->zerocopy_id = 0;
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
+}
+
 static void mca_btl_tcp_frag_eager_constructor(mca_btl_tcp_frag_t* frag)
 {
     frag->size = mca_btl_tcp_module.super.btl_eager_limit;
     frag->my_list = &mca_btl_tcp_component.tcp_frag_eager;
+    mca_btl_tcp_frag_common_constructor(frag);
 }
 
 static void mca_btl_tcp_frag_max_constructor(mca_btl_tcp_frag_t* frag)
 {
     frag->size = mca_btl_tcp_module.super.btl_max_send_size;
     frag->my_list = &mca_btl_tcp_component.tcp_frag_max;
+    mca_btl_tcp_frag_common_constructor(frag);
 }
 
 static void mca_btl_tcp_frag_user_constructor(mca_btl_tcp_frag_t* frag)
 {
     frag->size = 0;
     frag->my_list = &mca_btl_tcp_component.tcp_frag_user;
+    mca_btl_tcp_frag_common_constructor(frag);
 }
 
 
@@ -113,10 +130,38 @@ size_t mca_btl_tcp_frag_dump(mca_btl_tcp_frag_t* frag, char* msg, char* buf, siz
 bool mca_btl_tcp_frag_send(mca_btl_tcp_frag_t* frag, int sd)
 {
     ssize_t cnt;
-    size_t i, num_vecs;
+
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    mca_btl_base_endpoint_t* btl_endpoint = frag->endpoint;
+    bool zerocopy = false;
+
+    if( btl_endpoint->endpoint_zerocopy ) {
+        size_t length = 0;
+        for( uint32_t i = 0; i < frag->iov_cnt; i++ ) {
+            length += frag->iov_ptr[i].iov_len;
+        }
+        zerocopy = (length >= mca_btl_tcp_component.tcp_zerocopy_threshold);
+    }
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
 
     /* non-blocking write, but continue if interrupted */
     do {
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+        if( zerocopy ) {
+            struct msghdr msg = { .msg_iov = frag->iov_ptr, .msg_iovlen = frag->iov_cnt };
+
+            cnt = sendmsg(sd, &msg, MSG_ZEROCOPY);
+            if( cnt >= 0 ) {
+                /* the kernel numbers the zero-copy writes of the socket */
+                frag->zerocopy = true;
+                frag->zerocopy_id = btl_endpoint->endpoint_zerocopy_next++;
+            } else if( ENOBUFS == opal_socket_errno ) {
+                /* out of pinned memory, copy this one */
+                zerocopy = false;
+                continue;
+            }
+        } else
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
         cnt = writev(sd, frag->iov_ptr, frag->iov_cnt);
         if(cnt < 0) {
             switch(opal_socket_errno) {
@@ -142,10 +187,27 @@ bool mca_btl_tcp_frag_send(mca_btl_tcp_frag_t* frag, int sd)
         }
     } while(cnt < 0);
 
+    if(mca_btl_tcp_frag_update_send(frag, (size_t)cnt)) {
+        return true;
+    }
+    OPAL_OUTPUT_VERBOSE((100, opal_btl_base_framework.framework_output,
+                         "%s:%d write %ld bytes on socket %d\n",
+                         __FILE__, __LINE__, cnt, sd));
+    return false;
+}
+
+/*
+ * Account for cnt bytes written from the fragment, and return true if
+ * the fragment is now completely sent.
+ */
+bool mca_btl_tcp_frag_update_send(mca_btl_tcp_frag_t* frag, size_t cnt)
+{
+    size_t i, num_vecs;
+
     /* if the write didn't complete - update the iovec state */
     num_vecs = frag->iov_cnt;
     for( i = 0; i < num_vecs; i++) {
-        if(cnt >= (ssize_t)frag->iov_ptr->iov_len) {
+        if(cnt >= frag->iov_ptr->iov_len) {
             cnt -= frag->iov_ptr->iov_len;
             frag->iov_ptr++;
             frag->iov_idx++;
@@ -154,9 +216,6 @@ bool mca_btl_tcp_frag_send(mca_btl_tcp_frag_t* frag, int sd)
             frag->iov_ptr->iov_base = (opal_iov_base_ptr_t)
                 (((unsigned char*)frag->iov_ptr->iov_base) + cnt);
             frag->iov_ptr->iov_len -= cnt;
-            OPAL_OUTPUT_VERBOSE((100, opal_btl_base_framework.framework_output,
-                                 "%s:%d write %ld bytes on socket %d\n",
-                                 __FILE__, __LINE__, cnt, sd));
             break;
         }
     }
@@ -209,6 +268,29 @@ bool mca_btl_tcp_frag_recv(mca_btl_tcp_frag_t* frag, int sd)
 
     /* non-blocking read, but continue if interrupted */
     do {
+#if OPAL_BTL_TCP_HAVE_IO_URING
+        if( btl_endpoint->endpoint_uring ) {
+            /* the read is done by the ring, and we get back here with its result */
+            if( !btl_endpoint->endpoint_uring_recv_done ) {
+                if( !frag->uring_posted &&
+                    OPAL_SUCCESS != mca_btl_tcp_uring_readv(frag, num_vecs) ) {
+                    BTL_ERROR(("mca_btl_tcp_frag_recv: io_uring submission queue full"));
+                }
+                return false;
+            }
+            btl_endpoint->endpoint_uring_recv_done = false;
+            cnt = btl_endpoint->endpoint_uring_recv_res;
+            if( cnt < 0 ) {
+                errno = (int)-cnt;
+                cnt = -1;
+                /* the kernel cancels the requests of a thread when it
+                 * exits, post the read again */
+                if( EINTR == errno || EAGAIN == errno || ECANCELED == errno ) {
+                    continue;
+                }
+            }
+        } else
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
         cnt = readv(sd, frag->iov_ptr, num_vecs);
         if( 0 < cnt ) goto advance_iov_position;
         if( cnt == 0 ) {
@@ -304,6 +386,12 @@ bool mca_btl_tcp_frag_recv(mca_btl_tcp_frag_t* frag, int sd)
         }
         return true;
     }
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    if( btl_endpoint->endpoint_uring ) {
+        /* post the read of the remainder */
+        goto repeat;
+    }
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
     return false;
 }
 
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2016 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -50,7 +50,6 @@ struct mca_btl_tcp_frag_t {
     mca_btl_base_segment_t segments[2];
     struct mca_btl_base_endpoint_t *endpoint;
     struct mca_btl_tcp_module_t* btl;
-    mca_btl_tcp_hdr_t hdr;
     struct iovec iov[MCA_BTL_TCP_FRAG_IOVEC_NUMBER + 1];
     struct iovec *iov_ptr;
     uint32_t iov_cnt;
@@ -65,6 +64,18 @@ struct mca_btl_tcp_frag_t {
         void *data;
         void *context;
     } cb;
+#if OPAL_BTL_TCP_HAVE_IO_URING
+    int uring_buf;          /**< index of the buffer registered with the ring, or -1 */
+    bool uring_posted;      /**< a request on the fragment is in the ring */
+    bool uring_orphan;      /**< the endpoint was closed while the request was in the ring */
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+#if OPAL_BTL_TCP_HAVE_ZEROCOPY
+    bool zerocopy;          /**< part of the fragment was sent with MSG_ZEROCOPY */
+    uint32_t zerocopy_id;   /**< id of the last zero-copy write of the fragment */
+#endif  /* OPAL_BTL_TCP_HAVE_ZEROCOPY */
+    /* keep the header last, right in front of the payload of the eager
+     * and max fragments, so that both can be sent in one write */
+    mca_btl_tcp_hdr_t hdr;
 };
 typedef struct mca_btl_tcp_frag_t mca_btl_tcp_frag_t;
 OBJ_CLASS_DECLARATION(mca_btl_tcp_frag_t);
@@ -105,6 +116,17 @@ OBJ_CLASS_DECLARATION(mca_btl_tcp_frag_user_t);
         opal_free_list_get (&mca_btl_tcp_component.tcp_frag_user);      \
 }
 
+/* a receive fragment must be able to hold the largest fragment sent */
+#define MCA_BTL_TCP_FRAG_ALLOC_RECV(frag)                                  \
+do {                                                                       \
+    if(mca_btl_tcp_module.super.btl_max_send_size >                        \
+       mca_btl_tcp_module.super.btl_eager_limit) {                         \
+        MCA_BTL_TCP_FRAG_ALLOC_MAX(frag);                                  \
+    } else {                                                               \
+        MCA_BTL_TCP_FRAG_ALLOC_EAGER(frag);                                \
+    }                                                                      \
+} while(0)
+
 #define MCA_BTL_TCP_FRAG_RETURN(frag)                                      \
 {                                                                          \
     opal_free_list_return (frag->my_list, (opal_free_list_item_t*)(frag)); \
@@ -126,6 +148,7 @@ do {                                                                       \
 
 
 bool mca_btl_tcp_frag_send(mca_btl_tcp_frag_t*, int sd);
+bool mca_btl_tcp_frag_update_send(mca_btl_tcp_frag_t*, size_t cnt);
 bool mca_btl_tcp_frag_recv(mca_btl_tcp_frag_t*, int sd);
 size_t mca_btl_tcp_frag_dump(mca_btl_tcp_frag_t* frag, char* msg, char* buf, size_t length);
 END_C_DECLS
@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -39,6 +39,7 @@ struct mca_btl_tcp_hdr_t {
     uint8_t  type;
     uint16_t count;
     uint32_t size;
+    uint32_t seq;    /**< position in the stream of the sockets of the endpoint */
 };
 typedef struct mca_btl_tcp_hdr_t mca_btl_tcp_hdr_t;
 
@@ -46,12 +47,14 @@ typedef struct mca_btl_tcp_hdr_t mca_btl_tcp_hdr_t;
     do {                              \
         hdr.count = htons(hdr.count); \
         hdr.size = htonl(hdr.size);   \
+        hdr.seq = htonl(hdr.seq);     \
     } while (0)
 
 #define MCA_BTL_TCP_HDR_NTOH(hdr)     \
     do {                              \
         hdr.count = ntohs(hdr.count); \
         hdr.size = ntohl(hdr.size);   \
+        hdr.seq = ntohl(hdr.seq);     \
     } while (0)
 
 END_C_DECLS
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2006 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2017 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -198,9 +198,10 @@ mca_btl_tcp_proc_t* mca_btl_tcp_proc_create(opal_proc_t* proc)
         }
     }
 
-    /* allocate space for endpoint array - one for each exported address */
+    /* allocate space for endpoint array - one for each socket to each
+     * exported address */
     btl_proc->proc_endpoints = (mca_btl_base_endpoint_t**)
-        malloc((1 + btl_proc->proc_addr_count) *
+        malloc((1 + btl_proc->proc_addr_count) * mca_btl_tcp_component.tcp_sockets *
                sizeof(mca_btl_base_endpoint_t*));
     if (NULL == btl_proc->proc_endpoints) {
         rc = OPAL_ERR_OUT_OF_RESOURCE;
@@ -0,0 +1,316 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "opal_config.h"
+
+#include "btl_tcp_uring.h"
+
+#if OPAL_BTL_TCP_HAVE_IO_URING
+
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "opal/sys/atomic.h"
+#include "opal/runtime/opal_progress.h"
+#include "opal/mca/btl/base/btl_base_error.h"
+#include "opal/util/output.h"
+#include "opal/util/uring.h"
+
+#include "btl_tcp_frag.h"
+#include "btl_tcp_endpoint.h"
+
+/* completions dispatched per call to the progress function */
+#define MCA_BTL_TCP_URING_BATCH  64
+
+/* the low bit of the user data tells the reads from the writes */
+#define MCA_BTL_TCP_URING_READ   ((uint64_t) 1)
+
+struct mca_btl_tcp_uring_t {
+    opal_uring_t ring;
+
+    /* registered buffers */
+    unsigned buf_count;
+    unsigned buf_max;
+
+    opal_atomic_int32_t inflight;
+    opal_mutex_t lock;
+};
+typedef struct mca_btl_tcp_uring_t mca_btl_tcp_uring_t;
+
+static mca_btl_tcp_uring_t mca_btl_tcp_uring = {.ring = OPAL_URING_STATIC_INIT};
+
+int mca_btl_tcp_uring_init(void)
+{
+    mca_btl_tcp_uring_t *uring = &mca_btl_tcp_uring;
+
+    if (OPAL_SUCCESS != opal_uring_init(&uring->ring, mca_btl_tcp_component.tcp_uring_entries,
+                                        mca_btl_tcp_component.tcp_uring_sqpoll)) {
+        opal_output_verbose(10, opal_btl_base_framework.framework_output,
+                            "btl: tcp: cannot set up io_uring: %s", strerror(errno));
+        return OPAL_ERR_NOT_AVAILABLE;
+    }
+    uring->inflight = 0;
+
+    /* sparse table, filled as the fragments are created */
+    uring->buf_count = uring->buf_max = 0;
+    if (mca_btl_tcp_component.tcp_uring_buffers > 0) {
+        struct io_uring_rsrc_register reg;
+
+        memset(&reg, 0, sizeof(reg));
+        reg.nr = mca_btl_tcp_component.tcp_uring_buffers;
+        reg.flags = IORING_RSRC_REGISTER_SPARSE;
+        if (0 == opal_uring_register(&uring->ring, IORING_REGISTER_BUFFERS2, &reg, sizeof(reg))) {
+            uring->buf_max = reg.nr;
+        } else {
+            opal_output_verbose(10, opal_btl_base_framework.framework_output,
+                                "btl: tcp: cannot register buffers with io_uring: %s",
+                                strerror(errno));
+        }
+    }
+
+    OBJ_CONSTRUCT(&uring->lock, opal_mutex_t);
+
+    /* the ring is readable when completions are pending */
+    (void) opal_progress_wait_register(uring->ring.fd, NULL);
+
+    opal_output_verbose(10, opal_btl_base_framework.framework_output,
+                        "btl: tcp: using io_uring with %u entries%s", uring->ring.sq_entries,
+                        uring->ring.sqpoll ? " and a submission thread" : "");
+    return OPAL_SUCCESS;
+}
+
+void mca_btl_tcp_uring_fini(void)
+{
+    mca_btl_tcp_uring_t *uring = &mca_btl_tcp_uring;
+    struct io_uring_cqe cqes[MCA_BTL_TCP_URING_BATCH];
+    struct io_uring_sqe *sqe;
+
+    if (uring->ring.fd < 0) {
+        return;
+    }
+
+    /* The endpoints wait for their requests when they are destructed,
+     * so nothing should be left. Otherwise cancel whatever remains and
+     * wait for the kernel to let go of the fragments, without calling
+     * back into the endpoints. */
+    OPAL_THREAD_LOCK(&uring->lock);
+    if (uring->inflight > 0 && NULL != (sqe = opal_uring_get_sqe(&uring->ring))) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        sqe->user_data = 0;
+        opal_uring_publish(&uring->ring);
+    }
+    for (int i = 0 ; i < 1000 && uring->inflight > 0 ; ++i) {
+        unsigned count;
+
+        (void) opal_uring_flush(&uring->ring);
+        count = opal_uring_reap(&uring->ring, cqes, MCA_BTL_TCP_URING_BATCH);
+        if (0 == count) {
+            usleep(1000);
+            continue;
+        }
+        for (unsigned j = 0 ; j < count ; ++j) {
+            if (0 != cqes[j].user_data) {
+                uring->inflight--;
+            }
+        }
+    }
+    OPAL_THREAD_UNLOCK(&uring->lock);
+
+    (void) opal_progress_wait_unregister(uring->ring.fd);
+    opal_uring_fini(&uring->ring);
+    OBJ_DESTRUCT(&uring->lock);
+}
+
+int mca_btl_tcp_uring_frag_init(opal_free_list_item_t *item, void *ctx)
+{
+    mca_btl_tcp_uring_t *uring = &mca_btl_tcp_uring;
+    mca_btl_tcp_frag_t *frag = (mca_btl_tcp_frag_t *) item;
+    struct io_uring_rsrc_update2 update;
+    struct iovec iov;
+
+    (void) ctx;
+    frag->uring_buf = -1;
+    if (uring->buf_count >= uring->buf_max) {
+        return OPAL_SUCCESS;
+    }
+
+    /* from the header to the end of the payload */
+    iov.iov_base = (IOVBASE_TYPE *) &frag->hdr;
+    iov.iov_len = (size_t) ((char *) (frag + 1) + frag->size - (char *) &frag->hdr);
+
+    OPAL_THREAD_LOCK(&uring->lock);
+    if (uring->buf_count < uring->buf_max) {
+        memset(&update, 0, sizeof(update));
+        update.offset = uring->buf_count;
+        update.data = (uint64_t) (uintptr_t) &iov;
+        update.nr = 1;
+        if (1 == opal_uring_register(&uring->ring, IORING_REGISTER_BUFFERS_UPDATE,
+                                     &update, sizeof(update))) {
+            frag->uring_buf = (int) uring->buf_count++;
+        } else {
+            /* most likely out of locked memory, stop trying */
+            opal_output_verbose(10, opal_btl_base_framework.framework_output,
+                                "btl: tcp: registered %u buffers with io_uring: %s",
+                                uring->buf_count, strerror(errno));
+            uring->buf_max = uring->buf_count;
+        }
+    }
+    OPAL_THREAD_UNLOCK(&uring->lock);
+
+    return OPAL_SUCCESS;
+}
+
+int mca_btl_tcp_uring_readv(mca_btl_tcp_frag_t *frag, uint32_t iov_cnt)
+{
+    mca_btl_tcp_uring_t *uring = &mca_btl_tcp_uring;
+    struct io_uring_sqe *sqe;
+
+    OPAL_THREAD_LOCK(&uring->lock);
+    sqe = opal_uring_get_sqe(&uring->ring);
+    if (OPAL_UNLIKELY(NULL == sqe)) {
+        OPAL_THREAD_UNLOCK(&uring->lock);
+        return OPAL_ERR_TEMP_OUT_OF_RESOURCE;
+    }
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = frag->endpoint->endpoint_sd;
+    sqe->addr = (uint64_t) (uintptr_t) frag->iov_ptr;
+    sqe->len = iov_cnt;
+    sqe->user_data = (uint64_t) (uintptr_t) frag | MCA_BTL_TCP_URING_READ;
+    frag->uring_posted = true;
+    (void) opal_atomic_add_fetch_32(&frag->endpoint->endpoint_uring_posted, 1);
+    (void) opal_atomic_add_fetch_32(&uring->inflight, 1);
+    opal_uring_publish(&uring->ring);
+    OPAL_THREAD_UNLOCK(&uring->lock);
+
+    return OPAL_SUCCESS;
+}
+
+/* Check if what is left to send of the fragment lies in its registered
+ * buffer, which is the case for the eager and max fragments as their
+ * header is right in front of their payload. */
+static inline bool mca_btl_tcp_uring_frag_fixed(mca_btl_tcp_frag_t *frag, uint64_t *addr, uint32_t *len)
+{
+    char *base, *end;
+
+    if (frag->uring_buf < 0 || frag->iov_cnt > 2) {
+        return false;
+    }
+    base = (char *) frag->iov_ptr[0].iov_base;
+    end = base + frag->iov_ptr[0].iov_len;
+    if (2 == frag->iov_cnt) {
+        if ((char *) frag->iov_ptr[1].iov_base != end) {
+            return false;
+        }
+        end += frag->iov_ptr[1].iov_len;
+    }
+    if (base < (char *) &frag->hdr || end > (char *) (frag + 1) + frag->size) {
+        return false;
+    }
+
+    *addr = (uint64_t) (uintptr_t) base;
+    *len = (uint32_t) (end - base);
+    return true;
+}
+
+int mca_btl_tcp_uring_write_chain(mca_btl_tcp_frag_t **frags, int count)
+{
+    mca_btl_tcp_uring_t *uring = &mca_btl_tcp_uring;
+    struct io_uring_sqe *sqe;
+    unsigned space;
+    int i;
+
+    OPAL_THREAD_LOCK(&uring->lock);
+    /* a chain cannot span two submissions, so reserve the entries of
+     * the whole chain first */
+    space = opal_uring_sq_space(&uring->ring);
+    if (space < (unsigned) count) {
+        (void) opal_uring_flush(&uring->ring);
+        space = opal_uring_sq_space(&uring->ring);
+        if (space < (unsigned) count) {
+            count = (int) space;
+        }
+    }
+
+    for (i = 0 ; i < count ; ++i) {
+        mca_btl_tcp_frag_t *frag = frags[i];
+        uint64_t addr;
+        uint32_t len;
+
+        sqe = opal_uring_get_sqe(&uring->ring);
+        sqe->fd = frag->endpoint->endpoint_sd;
+        if (mca_btl_tcp_uring_frag_fixed(frag, &addr, &len)) {
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->addr = addr;
+            sqe->len = len;
+            sqe->buf_index = (uint16_t) frag->uring_buf;
+        } else {
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->addr = (uint64_t) (uintptr_t) frag->iov_ptr;
+            sqe->len = frag->iov_cnt;
+        }
+        if (i + 1 < count) {
+            /* a short write fails the rest of the chain, keeping the
+             * stream in order */
+            sqe->flags = IOSQE_IO_LINK;
+        }
+        sqe->user_data = (uint64_t) (uintptr_t) frag;
+        frag->uring_posted = true;
+    }
+    if (i > 0) {
+        (void) opal_atomic_add_fetch_32(&frags[0]->endpoint->endpoint_uring_posted, i);
+        (void) opal_atomic_add_fetch_32(&uring->inflight, i);
+        opal_uring_publish(&uring->ring);
+    }
+    OPAL_THREAD_UNLOCK(&uring->lock);
+
+    return i;
+}
+
+int mca_btl_tcp_uring_progress(void)
+{
+    mca_btl_tcp_uring_t *uring = &mca_btl_tcp_uring;
+    struct io_uring_cqe cqes[MCA_BTL_TCP_URING_BATCH];
+    unsigned count;
+
+    if (!opal_uring_pending(&uring->ring)) {
+        return 0;
+    }
+
+    OPAL_THREAD_LOCK(&uring->lock);
+    (void) opal_uring_flush(&uring->ring);
+    count = opal_uring_reap(&uring->ring, cqes, MCA_BTL_TCP_URING_BATCH);
+    OPAL_THREAD_UNLOCK(&uring->lock);
+
+    /* the callbacks may queue more requests */
+    for (unsigned i = 0 ; i < count ; ++i) {
+        mca_btl_tcp_frag_t *frag = (mca_btl_tcp_frag_t *) (uintptr_t) (cqes[i].user_data & ~MCA_BTL_TCP_URING_READ);
+
+        if (NULL == frag) {
+            continue;  /* cancellation */
+        }
+        (void) opal_atomic_add_fetch_32(&uring->inflight, -1);
+        if (cqes[i].user_data & MCA_BTL_TCP_URING_READ) {
+            mca_btl_tcp_endpoint_uring_recv_complete(frag, cqes[i].res);
+        } else {
+            mca_btl_tcp_endpoint_uring_send_complete(frag, cqes[i].res);
+        }
+    }
+
+    return (int) count;
+}
+
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
@@ -0,0 +1,88 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/**
+ * @file
+ *
+ * io_uring engine of the TCP BTL.
+ *
+ * The connection establishment is left to libevent, but once an
+ * endpoint is connected its socket is driven by a single ring shared
+ * by all the endpoints of the process. Each connected endpoint keeps
+ * one read posted, and its pending fragments are submitted as a chain
+ * of linked writes, so that they reach the socket in order. The
+ * submissions of all the endpoints are batched in one io_uring_enter
+ * per call to the progress function, and the completions are reaped
+ * from the shared completion queue without any system call.
+ *
+ * The eager and max fragments are registered with the ring when they
+ * are created, and a fragment whose header is contiguous with its
+ * payload is sent with a single write from the registered buffer.
+ */
+#ifndef MCA_BTL_TCP_URING_H
+#define MCA_BTL_TCP_URING_H
+
+#include "opal_config.h"
+
+#include "opal/class/opal_free_list.h"
+
+#include "btl_tcp.h"
+
+BEGIN_C_DECLS
+
+#if OPAL_BTL_TCP_HAVE_IO_URING
+
+struct mca_btl_tcp_frag_t;
+
+/**
+ * Create the ring. On failure the TCP BTL keeps using libevent.
+ */
+int mca_btl_tcp_uring_init(void);
+
+/**
+ * Cancel the outstanding requests and release the ring. Must be called
+ * before the fragment free lists are destructed.
+ */
+void mca_btl_tcp_uring_fini(void);
+
+/**
+ * Free list item initializer registering the buffer of a fragment with
+ * the ring. Fragments created once the buffer table is full are sent
+ * with a regular vectored write.
+ */
+int mca_btl_tcp_uring_frag_init(opal_free_list_item_t *item, void *ctx);
+
+/**
+ * Queue a vectored read of the first iov_cnt entries of the iovec of
+ * a receive fragment. Must be called with the endpoint receive lock
+ * held.
+ */
+int mca_btl_tcp_uring_readv(struct mca_btl_tcp_frag_t *frag, uint32_t iov_cnt);
+
+/**
+ * Queue a linked chain of writes, one per fragment, in order. Must be
+ * called with the endpoint send lock held.
+ *
+ * @return  number of fragments queued, which can be less than count
+ *          if the submission queue is full.
+ */
+int mca_btl_tcp_uring_write_chain(struct mca_btl_tcp_frag_t **frags, int count);
+
+/**
+ * Submit the queued requests and dispatch the completions.
+ */
+int mca_btl_tcp_uring_progress(void);
+
+#endif  /* OPAL_BTL_TCP_HAVE_IO_URING */
+
+END_C_DECLS
+
+#endif  /* MCA_BTL_TCP_URING_H */
@@ -3,7 +3,7 @@
 # Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
 #                         University Research and Technology
 #                         Corporation.  All rights reserved.
-# Copyright (c) 2004-2005 The University of Tennessee and The University
+# Copyright (c) 2004-2020 The University of Tennessee and The University
 #                         of Tennessee Research Foundation.  All rights
 #                         reserved.
 # Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -37,4 +37,41 @@ AC_DEFUN([MCA_opal_btl_tcp_CONFIG],[
 #endif
 		   ])
     OPAL_SUMMARY_ADD([[Transports]],[[TCP]],[[btl_tcp]],[$opal_btl_tcp_happy])
+
+    OPAL_VAR_SCOPE_PUSH([btl_tcp_zerocopy_happy btl_tcp_uring_happy])
+    # zero-copy sends complete through the socket error queue (4.14)
+    AC_CACHE_CHECK([for MSG_ZEROCOPY support],
+                   [opal_cv_btl_tcp_zerocopy],
+                   [AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>]],
+                                                       [[struct sock_extended_err serr = { .ee_origin = SO_EE_ORIGIN_ZEROCOPY,
+                                 .ee_code = SO_EE_CODE_ZEROCOPY_COPIED };
+int opts[] = { SO_ZEROCOPY, MSG_ZEROCOPY, MSG_ERRQUEUE, IP_RECVERR };
+(void) serr; (void) opts;]])],
+                                      [opal_cv_btl_tcp_zerocopy=yes],
+                                      [opal_cv_btl_tcp_zerocopy=no])])
+    AS_IF([test "$opal_cv_btl_tcp_zerocopy" = "yes"],
+          [btl_tcp_zerocopy_happy=1], [btl_tcp_zerocopy_happy=0])
+    AC_DEFINE_UNQUOTED([OPAL_BTL_TCP_HAVE_ZEROCOPY], [$btl_tcp_zerocopy_happy],
+        [If zero-copy sends can be enabled within the TCP BTL])
+
+    # the io_uring path registers its buffers in a sparse table and
+    # cancels the requests of a socket at once (5.19)
+    btl_tcp_uring_happy=0
+    AS_IF([test "$opal_cv_have_io_uring" = "yes"],
+          [AC_CACHE_CHECK([for io_uring registered buffers support],
+                          [opal_cv_btl_tcp_uring],
+                          [AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[#include <linux/io_uring.h>]],
+                                                              [[struct io_uring_rsrc_register reg = { .flags = IORING_RSRC_REGISTER_SPARSE };
+struct io_uring_rsrc_update2 update = { .offset = 0 };
+int ops[] = { IORING_OP_WRITE_FIXED, IORING_OP_ASYNC_CANCEL, IORING_ASYNC_CANCEL_ANY,
+              IORING_REGISTER_BUFFERS2, IORING_REGISTER_BUFFERS_UPDATE };
+(void) reg; (void) update; (void) ops;]])],
+                                             [opal_cv_btl_tcp_uring=yes],
+                                             [opal_cv_btl_tcp_uring=no])])
+           AS_IF([test "$opal_cv_btl_tcp_uring" = "yes"], [btl_tcp_uring_happy=1])])
+    AC_DEFINE_UNQUOTED([OPAL_BTL_TCP_HAVE_IO_URING], [$btl_tcp_uring_happy],
+        [If the io_uring send and receive path can be enabled within the TCP BTL])
+    OPAL_VAR_SCOPE_POP
 ])dnl
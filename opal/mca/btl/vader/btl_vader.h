@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2009 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -141,10 +141,18 @@ struct mca_btl_vader_component_t {
 
     char *backing_directory;                /**< directory to place shared memory backing files */
 
+    int wake_fd;                            /**< read end of the pipe the peers wake this process with */
+    char *wake_path;                        /**< path of the pipe */
+
     /* knem stuff */
 #if OPAL_BTL_VADER_HAVE_KNEM
     unsigned int knem_dma_min;              /**< minimum size to enable DMA for knem transfers (0 disables) */
 #endif
+
+#if OPAL_BTL_VADER_HAVE_CMA
+    size_t cma_chunk_size;                  /**< maximum size of a single process_vm_readv/writev call (0 = unlimited) */
+    bool cma_calibrated;                    /**< eager limit was selected by the CMA calibration */
+#endif
     mca_mpool_base_module_t *mpool;
 };
 typedef struct mca_btl_vader_component_t mca_btl_vader_component_t;
@@ -293,6 +301,19 @@ int mca_btl_vader_emu_acswap (struct mca_btl_base_module_t *btl, struct mca_btl_
 
 void mca_btl_vader_sc_emu_init (void);
 
+/**
+ * Check whether a btl_vader MCA variable still has its default value.
+ *
+ * @param name (IN)     Variable name without the btl_vader_ prefix.
+ */
+bool mca_btl_vader_var_is_default (const char *name);
+
+/**
+ * Match the rendezvous eager limit to the selected single-copy mechanism
+ * and to the current eager limit.
+ */
+void mca_btl_vader_update_rndv_eager_limit (void);
+
 /**
  * Allocate a segment.
  *
@@ -311,6 +332,12 @@ mca_btl_base_descriptor_t* mca_btl_vader_alloc (struct mca_btl_base_module_t* bt
  */
 int mca_btl_vader_free (struct mca_btl_base_module_t *btl, mca_btl_base_descriptor_t *des);
 
+/**
+ * Path of the pipe used to wake up a local process blocked in the
+ * progress engine.
+ */
+char *mca_btl_vader_wake_path (int local_rank);
+
 
 END_C_DECLS
 
@@ -0,0 +1,179 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "btl_vader.h"
+#include "btl_vader_cma.h"
+
+#if OPAL_BTL_VADER_HAVE_CMA
+
+#include <unistd.h>
+
+#include "opal/mca/timer/base/base.h"
+
+#define MCA_BTL_VADER_CMA_CALIBRATE_MIN   4096
+#define MCA_BTL_VADER_CMA_CALIBRATE_ITERS 16
+#define MCA_BTL_VADER_CMA_EAGER_LIMIT_KEY "btl.vader.cma_eager_limit"
+
+/* time a copy-in/copy-out of size bytes: the sender copies into a
+ * shared memory fragment and the receiver copies out of it */
+static opal_timer_t mca_btl_vader_cma_time_copy (char *src, char *frag, char *dst, size_t size)
+{
+    opal_timer_t start = opal_timer_base_get_cycles ();
+
+    for (int i = 0 ; i < MCA_BTL_VADER_CMA_CALIBRATE_ITERS ; ++i) {
+        memcpy (frag, src, size);
+        memcpy (dst, frag, size);
+    }
+
+    return opal_timer_base_get_cycles () - start;
+}
+
+static opal_timer_t mca_btl_vader_cma_time_single (pid_t pid, char *src, char *dst, size_t size)
+{
+    opal_timer_t start = opal_timer_base_get_cycles ();
+
+    for (int i = 0 ; i < MCA_BTL_VADER_CMA_CALIBRATE_ITERS ; ++i) {
+        (void) mca_btl_vader_cma_copy (pid, dst, src, size, false);
+    }
+
+    return opal_timer_base_get_cycles () - start;
+}
+
+/**
+ * Select the eager limit by comparing the double copy of the FIFO path
+ * against a process_vm_readv() of the same size. Messages above the eager
+ * limit use the rendezvous protocol and are moved with a single copy.
+ *
+ * Returns 0 when the single copy never wins below the maximum send size,
+ * in which case the registered eager limit is kept.
+ */
+static size_t mca_btl_vader_cma_calibrate (pid_t pid)
+{
+    size_t max_size = mca_btl_vader.super.btl_max_send_size;
+    size_t eager_limit = 0;
+    char *buffer;
+
+    if (max_size < 2 * MCA_BTL_VADER_CMA_CALIBRATE_MIN) {
+        return 0;
+    }
+
+    buffer = malloc (3 * max_size);
+    if (NULL == buffer) {
+        return 0;
+    }
+
+    memset (buffer, 0, 3 * max_size);
+
+    for (size_t size = 2 * MCA_BTL_VADER_CMA_CALIBRATE_MIN ; size <= max_size ; size <<= 1) {
+        opal_timer_t copy_time = (opal_timer_t) -1, cma_time = (opal_timer_t) -1, tmp;
+
+        /* keep the best of a few trials to filter out preemption */
+        for (int trial = 0 ; trial < 3 ; ++trial) {
+            tmp = mca_btl_vader_cma_time_copy (buffer, buffer + max_size, buffer + 2 * max_size, size);
+            copy_time = tmp < copy_time ? tmp : copy_time;
+            tmp = mca_btl_vader_cma_time_single (pid, buffer, buffer + 2 * max_size, size);
+            cma_time = tmp < cma_time ? tmp : cma_time;
+        }
+
+        BTL_VERBOSE(("cma calibration: size %lu copy-in/copy-out %lu single copy %lu", (unsigned long) size,
+                     (unsigned long) copy_time, (unsigned long) cma_time));
+
+        if (cma_time < copy_time) {
+            eager_limit = size >> 1;
+            break;
+        }
+    }
+
+    free (buffer);
+
+    if (0 != eager_limit) {
+        BTL_VERBOSE(("cma calibration selected an eager limit of %lu bytes", (unsigned long) eager_limit));
+    } else {
+        BTL_VERBOSE(("single copy is never faster, keeping the eager limit"));
+    }
+
+    return eager_limit;
+}
+
+static void mca_btl_vader_cma_set_eager_limit (size_t eager_limit)
+{
+    mca_btl_vader.super.btl_eager_limit = eager_limit;
+    mca_btl_vader_component.cma_calibrated = true;
+
+    if (mca_btl_vader_var_is_default ("rdma_pipeline_send_length")) {
+        mca_btl_vader.super.btl_rdma_pipeline_send_length = eager_limit;
+    }
+
+    if (mca_btl_vader_var_is_default ("rdma_pipeline_frag_size")) {
+        mca_btl_vader.super.btl_rdma_pipeline_frag_size = eager_limit;
+    }
+
+    mca_btl_vader_update_rndv_eager_limit ();
+}
+
+int mca_btl_vader_cma_init (void)
+{
+    pid_t pid = getpid ();
+    uint64_t probe_src = 0xdeadbeef, probe_dst = 0;
+    struct iovec src_iov = {.iov_base = &probe_src, .iov_len = sizeof (probe_src)};
+    struct iovec dst_iov = {.iov_base = &probe_dst, .iov_len = sizeof (probe_dst)};
+    ssize_t ret;
+
+    /* a permissive ptrace scope is not enough: seccomp filters (the default in
+     * most container runtimes) reject process_vm_readv() outright. find out now
+     * instead of failing the first large transfer. */
+    ret = process_vm_readv (pid, &dst_iov, 1, &src_iov, 1, 0);
+    if ((ssize_t) sizeof (probe_src) != ret || probe_src != probe_dst) {
+        BTL_VERBOSE(("process_vm_readv self test failed. errno = %d", errno));
+        return OPAL_ERR_NOT_AVAILABLE;
+    }
+
+    /* the eager limit must be the same on all the processes of the node.
+     * the first local rank calibrates and publishes its choice, the others
+     * pick it up in mca_btl_vader_cma_agree_eager_limit(). */
+    if (0 == MCA_BTL_VADER_LOCAL_RANK && mca_btl_vader_var_is_default ("eager_limit")) {
+        size_t eager_limit = mca_btl_vader_cma_calibrate (pid);
+        int rc;
+
+        if (0 != eager_limit) {
+            OPAL_MODEX_SEND_VALUE(rc, OPAL_PMIX_LOCAL, MCA_BTL_VADER_CMA_EAGER_LIMIT_KEY,
+                                  &eager_limit, OPAL_SIZE);
+            if (OPAL_SUCCESS == rc) {
+                mca_btl_vader_cma_set_eager_limit (eager_limit);
+            }
+        }
+    }
+
+    return OPAL_SUCCESS;
+}
+
+void mca_btl_vader_cma_agree_eager_limit (struct opal_proc_t *leader)
+{
+    size_t eager_limit = 0, *eager_limit_ptr = &eager_limit;
+    int rc;
+
+    if (0 == MCA_BTL_VADER_LOCAL_RANK || MCA_BTL_VADER_CMA != mca_btl_vader_component.single_copy_mechanism ||
+        !mca_btl_vader_var_is_default ("eager_limit")) {
+        return;
+    }
+
+    /* nothing is published when the calibration kept the registered limit */
+    OPAL_MODEX_RECV_VALUE_OPTIONAL(rc, MCA_BTL_VADER_CMA_EAGER_LIMIT_KEY, &leader->proc_name,
+                                   &eager_limit_ptr, OPAL_SIZE);
+    if (OPAL_SUCCESS == rc && 0 != eager_limit) {
+        BTL_VERBOSE(("using the eager limit of %lu bytes calibrated by local rank 0",
+                     (unsigned long) eager_limit));
+        mca_btl_vader_cma_set_eager_limit (eager_limit);
+    }
+}
+
+#endif /* OPAL_BTL_VADER_HAVE_CMA */
@@ -0,0 +1,93 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#if !defined(BTL_VADER_CMA_H)
+#define BTL_VADER_CMA_H
+
+#if OPAL_BTL_VADER_HAVE_CMA
+
+#include <sys/uio.h>
+#include <errno.h>
+
+#if OPAL_CMA_NEED_SYSCALL_DEFS
+#include "opal/sys/cma.h"
+#endif /* OPAL_CMA_NEED_SYSCALL_DEFS */
+
+int mca_btl_vader_cma_init (void);
+
+/**
+ * Adopt the eager limit calibrated by the first local rank
+ *
+ * @param[in] leader      the process with local rank 0
+ *
+ * Must be called before the fragment free lists are sized.
+ */
+void mca_btl_vader_cma_agree_eager_limit (struct opal_proc_t *leader);
+
+/**
+ * Copy between a local buffer and the address space of another process
+ *
+ * @param[in] pid         process id of the peer
+ * @param[in] local       local buffer
+ * @param[in] remote      address of the buffer in the peer
+ * @param[in] size        number of bytes to transfer
+ * @param[in] write       true to write to the peer, false to read from it
+ *
+ * The transfer is split into chunks of at most btl_vader_cma_chunk_size
+ * bytes (0 means no limit) so the kernel never has to pin the whole range
+ * at once. Partial transfers are resumed where they stopped: the kernel
+ * caps a single call at 0x7ffff000 bytes regardless of what the man page
+ * says.
+ */
+static inline int mca_btl_vader_cma_copy (pid_t pid, void *local, void *remote, size_t size, bool write)
+{
+    size_t chunk_size = mca_btl_vader_component.cma_chunk_size;
+    struct iovec local_iov, remote_iov;
+    ssize_t ret;
+
+    if (0 == chunk_size) {
+        chunk_size = size;
+    }
+
+    local_iov.iov_base = local;
+    remote_iov.iov_base = remote;
+
+    while (size > 0) {
+        local_iov.iov_len = remote_iov.iov_len = (size < chunk_size) ? size : chunk_size;
+
+        if (write) {
+            ret = process_vm_writev (pid, &local_iov, 1, &remote_iov, 1, 0);
+        } else {
+            ret = process_vm_readv (pid, &local_iov, 1, &remote_iov, 1, 0);
+        }
+
+        if (OPAL_UNLIKELY(0 >= ret)) {
+            if (0 > ret && EINTR == errno) {
+                continue;
+            }
+
+            opal_output(0, "%s %ld, expected %lu, errno = %d\n", write ? "Wrote" : "Read", (long) ret,
+                        (unsigned long) local_iov.iov_len, errno);
+            return OPAL_ERROR;
+        }
+
+        local_iov.iov_base = (void *)((char *) local_iov.iov_base + ret);
+        remote_iov.iov_base = (void *)((char *) remote_iov.iov_base + ret);
+        size -= ret;
+    }
+
+    return OPAL_SUCCESS;
+}
+
+#endif /* OPAL_BTL_VADER_HAVE_CMA */
+
+#endif /* defined(BTL_VADER_CMA_H) */
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2011 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2009 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -40,8 +40,10 @@
 #include "btl_vader_fifo.h"
 #include "btl_vader_fbox.h"
 #include "btl_vader_xpmem.h"
+#include "btl_vader_cma.h"
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 
 #ifdef HAVE_SYS_PRCTL_H
@@ -232,6 +234,18 @@ static int mca_btl_vader_component_register (void)
                                            &mca_btl_vader_component.knem_dma_min);
 #endif
 
+#if OPAL_BTL_VADER_HAVE_CMA
+    mca_btl_vader_component.cma_chunk_size = 0;
+    mca_btl_vader_component.cma_calibrated = false;
+    (void) mca_base_component_var_register(&mca_btl_vader_component.super.btl_version, "cma_chunk_size",
+                                           "Maximum number of bytes moved by a single CMA system call. "
+                                           "Larger transfers are split into chunks of this size so the kernel "
+                                           "does not pin the entire buffer at once (0 = no limit, default: 0)",
+                                           MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                           OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_LOCAL,
+                                           &mca_btl_vader_component.cma_chunk_size);
+#endif
+
     mca_btl_vader.super.btl_exclusivity               = MCA_BTL_EXCLUSIVITY_HIGH;
 
     if (MCA_BTL_VADER_XPMEM == mca_btl_vader_component.single_copy_mechanism) {
@@ -321,6 +335,76 @@ static int mca_btl_vader_component_open(void)
  * component cleanup - sanity checking of queue lengths
  */
 
+char *mca_btl_vader_wake_path (int local_rank)
+{
+    char *path = NULL;
+
+    (void) opal_asprintf (&path, "%s" OPAL_PATH_SEP "vader_wake.%s.%x.%d", mca_btl_vader_component.backing_directory,
+                          opal_process_info.nodename, OPAL_PROC_MY_NAME.jobid, local_rank);
+    return path;
+}
+
+/* tell the peers whether to signal us when they write to our fifo or fast boxes */
+static void mca_btl_vader_wake_cb (bool blocking)
+{
+    char buffer[64];
+
+    if (blocking) {
+        opal_atomic_add_fetch_32 (&mca_btl_vader_component.my_fifo->sleeping, 1);
+        return;
+    }
+
+    opal_atomic_add_fetch_32 (&mca_btl_vader_component.my_fifo->sleeping, -1);
+    while (0 < read (mca_btl_vader_component.wake_fd, buffer, sizeof (buffer))) {
+        continue;
+    }
+}
+
+/* create the pipe the peers wake this process with when it blocks in the progress engine */
+static void mca_btl_vader_wake_init (void)
+{
+    mca_btl_vader_component_t *component = &mca_btl_vader_component;
+
+    component->wake_path = mca_btl_vader_wake_path (MCA_BTL_VADER_LOCAL_RANK);
+    if (NULL == component->wake_path) {
+        return;
+    }
+
+    /* open for reading and writing so the pipe never reports end-of-file */
+    if (0 != mkfifo (component->wake_path, 0600) ||
+        0 > (component->wake_fd = open (component->wake_path, O_RDWR | O_NONBLOCK))) {
+        BTL_VERBOSE(("could not create wakeup pipe %s. relying on opal_progress_wait_timeout",
+                     component->wake_path));
+        free (component->wake_path);
+        component->wake_path = NULL;
+        return;
+    }
+    if (NULL != opal_pmix.register_cleanup) {
+        opal_pmix.register_cleanup (component->wake_path, false, false, false);
+    }
+
+    if (OPAL_SUCCESS != opal_progress_wait_register (component->wake_fd, mca_btl_vader_wake_cb)) {
+        close (component->wake_fd);
+        component->wake_fd = -1;
+    }
+}
+
+static void mca_btl_vader_wake_fini (void)
+{
+    mca_btl_vader_component_t *component = &mca_btl_vader_component;
+
+    if (0 <= component->wake_fd) {
+        (void) opal_progress_wait_unregister (component->wake_fd);
+        close (component->wake_fd);
+        component->wake_fd = -1;
+    }
+    if (NULL != component->wake_path) {
+        unlink (component->wake_path);
+        free (component->wake_path);
+        component->wake_path = NULL;
+    }
+}
+
 static int mca_btl_vader_component_close(void)
 {
     OBJ_DESTRUCT(&mca_btl_vader_component.vader_frags_eager);
@@ -338,6 +422,8 @@ static int mca_btl_vader_component_close(void)
 
     mca_btl_vader_component.my_segment = NULL;
 
+    mca_btl_vader_wake_fini ();
+
 #if OPAL_BTL_VADER_HAVE_KNEM
     mca_btl_vader_knem_fini ();
 #endif
@@ -388,6 +474,52 @@ static void mca_btl_vader_select_next_single_copy_mechanism (void)
 }
 #endif
 
+bool mca_btl_vader_var_is_default (const char *name)
+{
+    mca_base_var_source_t source = MCA_BASE_VAR_SOURCE_DEFAULT;
+    int var_index;
+
+    var_index = mca_base_var_find ("opal", "btl", "vader", name);
+    if (0 > var_index) {
+        return true;
+    }
+
+    (void) mca_base_var_get_value (var_index, NULL, &source, NULL);
+
+    return MCA_BASE_VAR_SOURCE_DEFAULT == source;
+}
+
+/* The limits set in mca_btl_vader_component_register() are those of the
+ * requested single-copy mechanism. Match the rendezvous eager limit to the
+ * mechanism actually selected and to the eager limit it ended up with. */
+void mca_btl_vader_update_rndv_eager_limit (void)
+{
+    mca_btl_base_module_t *btl = &mca_btl_vader.super;
+
+    if (!mca_btl_vader_var_is_default ("rndv_eager_limit")) {
+        return;
+    }
+
+    switch (mca_btl_vader_component.single_copy_mechanism) {
+    case MCA_BTL_VADER_XPMEM:
+        btl->btl_rndv_eager_limit = btl->btl_eager_limit;
+        break;
+#if OPAL_BTL_VADER_HAVE_CMA
+    case MCA_BTL_VADER_CMA:
+        /* beyond a calibrated eager limit the single copy is the faster path */
+        btl->btl_rndv_eager_limit = mca_btl_vader_component.cma_calibrated ?
+            btl->btl_eager_limit : btl->btl_max_send_size;
+        break;
+#endif
+    default:
+        btl->btl_rndv_eager_limit = btl->btl_max_send_size;
+    }
+
+    if (btl->btl_rndv_eager_limit < btl->btl_eager_limit) {
+        btl->btl_rndv_eager_limit = btl->btl_eager_limit;
+    }
+}
+
 static void mca_btl_vader_check_single_copy (void)
 {
 #if OPAL_BTL_VADER_HAVE_XPMEM || OPAL_BTL_VADER_HAVE_CMA || OPAL_BTL_VADER_HAVE_KNEM
@@ -449,6 +581,17 @@ static void mca_btl_vader_check_single_copy (void)
                 opal_show_help("help-btl-vader.txt", "cma-permission-denied",
                                true, opal_process_info.nodename);
             }
+        } else if (OPAL_SUCCESS != mca_btl_vader_cma_init ()) {
+            /* the system call itself is blocked (seccomp) */
+            int save_errno = errno;
+
+            mca_btl_vader_select_next_single_copy_mechanism ();
+
+            if (MCA_BTL_VADER_CMA == initial_mechanism) {
+                opal_show_help("help-btl-vader.txt", "cma-syscall-failed",
+                               true, opal_process_info.nodename, save_errno,
+                               strerror(save_errno));
+            }
         } else {
             /* ptrace_scope will allow CMA */
             mca_btl_vader.super.btl_get = mca_btl_vader_get_cma;
@@ -534,6 +677,7 @@ static mca_btl_base_module_t **mca_btl_vader_component_init (int *num_btls,
     component->num_fbox_in_endpoints = 0;
 
     mca_btl_vader_check_single_copy ();
+    mca_btl_vader_update_rndv_eager_limit ();
 
     if (MCA_BTL_VADER_XPMEM != mca_btl_vader_component.single_copy_mechanism) {
         char *sm_file;
@@ -575,6 +719,11 @@ static mca_btl_base_module_t **mca_btl_vader_component_init (int *num_btls,
     /* initialize my fifo */
     vader_fifo_init ((struct vader_fifo_t *) component->my_segment);
 
+    component->wake_fd = -1;
+    if (opal_progress_wait_block) {
+        mca_btl_vader_wake_init ();
+    }
+
     rc = mca_btl_base_vader_modex_send ();
     if (OPAL_SUCCESS != rc) {
         BTL_VERBOSE(("Error sending modex"));
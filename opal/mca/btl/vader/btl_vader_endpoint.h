@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -89,6 +89,7 @@ typedef struct mca_btl_base_endpoint_t {
     opal_mutex_t pending_frags_lock; /**< protect pending_frags */
     opal_list_t pending_frags; /**< fragments pending fast box space */
     bool waiting;           /**< endpoint is on the component wait list */
+    int wake_fd;            /**< write end of the peer's wakeup pipe (-1 if none) */
 } mca_btl_base_endpoint_t;
 
 typedef mca_btl_base_endpoint_t mca_btl_vader_endpoint_t;
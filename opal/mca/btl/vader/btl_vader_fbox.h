@@ -175,6 +175,8 @@ static inline bool mca_btl_vader_fbox_sendi (mca_btl_base_endpoint_t *ep, unsign
     opal_atomic_wmb ();
     OPAL_THREAD_UNLOCK(&ep->lock);
 
+    vader_fifo_wake (ep);
+
     return true;
 }
 
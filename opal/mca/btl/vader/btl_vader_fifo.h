@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2007 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2009 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -26,6 +26,8 @@
 #ifndef MCA_BTL_VADER_FIFO_H
 #define MCA_BTL_VADER_FIFO_H
 
+#include "opal/runtime/opal_progress.h"
+
 #include "btl_vader.h"
 #include "btl_vader_endpoint.h"
 #include "btl_vader_frag.h"
@@ -70,6 +72,7 @@ typedef struct vader_fifo_t {
     atomic_fifo_value_t fifo_head;
     atomic_fifo_value_t fifo_tail;
     opal_atomic_int32_t fbox_available;
+    opal_atomic_int32_t sleeping;   /**< number of threads of the owner blocked in the progress engine */
 } vader_fifo_t;
 
 /* large enough to ensure the fifo is on its own cache line */
@@ -100,6 +103,27 @@ static inline void *relative2virtual (fifo_value_t offset)
     return (void *)(intptr_t)((offset & MCA_BTL_VADER_OFFSET_MASK) + mca_btl_vader_component.endpoints[offset >> MCA_BTL_VADER_OFFSET_BITS].segment_base);
 }
 
+/**
+ * vader_fifo_wake:
+ *
+ * @brief wake up the peer if it is blocked in the progress engine
+ *
+ * @param[in]  ep  - endpoint just written to
+ *
+ * Must follow the write of the data the peer is to find: the peer announces it
+ * is going to block before it polls one last time.
+ */
+static inline void vader_fifo_wake (struct mca_btl_base_endpoint_t *ep)
+{
+    if (OPAL_UNLIKELY(opal_progress_wait_block)) {
+        opal_atomic_mb ();
+        if (ep->fifo->sleeping && 0 <= ep->wake_fd) {
+            char c = 0;
+            (void) write (ep->wake_fd, &c, 1);
+        }
+    }
+}
+
 #include "btl_vader_fbox.h"
 
 /**
@@ -160,6 +184,7 @@ static inline void vader_fifo_init (vader_fifo_t *fifo)
     fifo->fifo_head = VADER_FIFO_FREE;
     fifo->fifo_tail = VADER_FIFO_FREE;
     fifo->fbox_available = mca_btl_vader_component.fbox_max;
+    fifo->sleeping = 0;
     mca_btl_vader_component.my_fifo = fifo;
 }
 
@@ -206,6 +231,7 @@ static inline bool vader_fifo_write_ep (mca_btl_vader_hdr_t *hdr, struct mca_btl
     mca_btl_vader_try_fbox_setup (ep, hdr);
     hdr->next = VADER_FIFO_FREE;
     vader_fifo_write (ep->fifo, rhdr);
+    vader_fifo_wake (ep);
 
     return true;
 }
@@ -225,6 +251,7 @@ static inline void vader_fifo_write_back (mca_btl_vader_hdr_t *hdr, struct mca_b
 {
     hdr->next = VADER_FIFO_FREE;
     vader_fifo_write(ep->fifo, virtual2relativepeer (ep, (char *) hdr));
+    vader_fifo_wake (ep);
 }
 
 #endif /* MCA_BTL_VADER_FIFO_H */
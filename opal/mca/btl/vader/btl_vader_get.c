@@ -4,6 +4,9 @@
  *                         reserved.
  * Copyright (c) 2018      Research Organization for Information Science
  *                         and Technology (RIST).  All rights reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -17,16 +20,7 @@
 #include "btl_vader_frag.h"
 #include "btl_vader_endpoint.h"
 #include "btl_vader_xpmem.h"
-
-#if OPAL_BTL_VADER_HAVE_CMA
-#include <sys/uio.h>
-
-#if OPAL_CMA_NEED_SYSCALL_DEFS
-#include "opal/sys/cma.h"
-#endif /* OPAL_CMA_NEED_SYSCALL_DEFS */
-
-
-#endif
+#include "btl_vader_cma.h"
 
 /**
  * Initiate an synchronous get.
@@ -70,38 +64,13 @@ int mca_btl_vader_get_cma (mca_btl_base_module_t *btl, mca_btl_base_endpoint_t *
                            mca_btl_base_registration_handle_t *remote_handle, size_t size, int flags,
                            int order, mca_btl_base_rdma_completion_fn_t cbfunc, void *cbcontext, void *cbdata)
 {
-    struct iovec src_iov = {.iov_base = (void *)(intptr_t) remote_address, .iov_len = size};
-    struct iovec dst_iov = {.iov_base = local_address, .iov_len = size};
-    ssize_t ret;
-
-    /*
-     * According to the man page :
-     * "On success, process_vm_readv() returns the number of bytes read and
-     * process_vm_writev() returns the number of bytes written.  This return
-     * value may be less than the total number of requested bytes, if a
-     * partial read/write occurred.  (Partial transfers apply at the
-     * granularity of iovec elements.  These system calls won't perform a
-     * partial transfer that splits a single iovec element.)".
-     * So since we use a single iovec element, the returned size should either
-     * be 0 or size, and the do loop should not be needed here.
-     * We tried on various Linux kernels with size > 2 GB, and surprisingly,
-     * the returned value is always 0x7ffff000 (fwiw, it happens to be the size
-     * of the larger number of pages that fits a signed 32 bits integer).
-     * We do not know whether this is a bug from the kernel, the libc or even
-     * the man page, but for the time being, we do as is process_vm_readv() could
-     * return any value.
-     */
-    do {
-        ret = process_vm_readv (endpoint->segment_data.other.seg_ds->seg_cpid, &dst_iov, 1, &src_iov, 1, 0);
-        if (0 > ret) {
-            opal_output(0, "Read %ld, expected %lu, errno = %d\n", (long)ret, (unsigned long)size, errno);
-            return OPAL_ERROR;
-        }
-        src_iov.iov_base = (void *)((char *)src_iov.iov_base + ret);
-        src_iov.iov_len -= ret;
-        dst_iov.iov_base = (void *)((char *)dst_iov.iov_base + ret);
-        dst_iov.iov_len -= ret;
-    } while (0 < src_iov.iov_len);
+    int rc;
+
+    rc = mca_btl_vader_cma_copy (endpoint->segment_data.other.seg_ds->seg_cpid, local_address,
+                                 (void *)(intptr_t) remote_address, size, false);
+    if (OPAL_UNLIKELY(OPAL_SUCCESS != rc)) {
+        return rc;
+    }
 
     /* always call the callback function */
     cbfunc (btl, endpoint, local_address, local_handle, cbcontext, cbdata, OPAL_SUCCESS);
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2011 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2009 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2007 High Performance Computing Center Stuttgart,
@@ -33,8 +33,10 @@
 #include "btl_vader_fifo.h"
 #include "btl_vader_fbox.h"
 #include "btl_vader_xpmem.h"
+#include "btl_vader_cma.h"
 
 #include <string.h>
+#include <fcntl.h>
 
 static int vader_del_procs (struct mca_btl_base_module_t *btl,
                             size_t nprocs, struct opal_proc_t **procs,
@@ -221,6 +223,15 @@ static int init_vader_endpoint (struct mca_btl_base_endpoint_t *ep, struct opal_
 
     ep->fifo = (struct vader_fifo_t *) ep->segment_base;
 
+    if (opal_progress_wait_block && remote_rank != MCA_BTL_VADER_LOCAL_RANK) {
+        /* the peer created its wakeup pipe before publishing its modex */
+        char *wake_path = mca_btl_vader_wake_path (remote_rank);
+        if (NULL != wake_path) {
+            ep->wake_fd = open (wake_path, O_WRONLY | O_NONBLOCK);
+            free (wake_path);
+        }
+    }
+
     return OPAL_SUCCESS;
 }
 
@@ -276,6 +287,17 @@ static int vader_add_procs (struct mca_btl_base_module_t* btl,
     }
 
     if (!vader_btl->btl_inited) {
+#if OPAL_BTL_VADER_HAVE_CMA
+        /* the endpoints are numbered in the order of procs, the first local one is local rank 0 */
+        for (size_t proc = 0 ; proc < nprocs ; ++proc) {
+            if (procs[proc]->proc_name.jobid == my_proc->proc_name.jobid &&
+                OPAL_PROC_ON_LOCAL_NODE(procs[proc]->proc_flags)) {
+                mca_btl_vader_cma_agree_eager_limit (procs[proc]);
+                break;
+            }
+        }
+#endif
+
         rc = vader_btl_first_time_init (vader_btl, 1 + MCA_BTL_VADER_NUM_LOCAL_PEERS);
         if (rc != OPAL_SUCCESS) {
             return rc;
@@ -550,6 +572,7 @@ static void mca_btl_vader_endpoint_constructor (mca_btl_vader_endpoint_t *ep)
     OBJ_CONSTRUCT(&ep->pending_frags_lock, opal_mutex_t);
     ep->fifo = NULL;
     ep->fbox_out.fbox = NULL;
+    ep->wake_fd = -1;
 }
 
 #if OPAL_BTL_VADER_HAVE_XPMEM
@@ -560,6 +583,11 @@ static void mca_btl_vader_endpoint_destructor (mca_btl_vader_endpoint_t *ep)
     OBJ_DESTRUCT(&ep->pending_frags);
     OBJ_DESTRUCT(&ep->pending_frags_lock);
 
+    if (0 <= ep->wake_fd) {
+        close (ep->wake_fd);
+        ep->wake_fd = -1;
+    }
+
 #if OPAL_BTL_VADER_HAVE_XPMEM
     if (MCA_BTL_VADER_XPMEM == mca_btl_vader_component.single_copy_mechanism) {
         mca_btl_vader_xpmem_cleanup_endpoint (ep);
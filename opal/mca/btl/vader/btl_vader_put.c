@@ -4,6 +4,9 @@
  *                         reserved.
  * Copyright (c) 2014-2018 Research Organization for Information Science
  *                         and Technology (RIST).  All rights reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -17,15 +20,7 @@
 #include "btl_vader_frag.h"
 #include "btl_vader_endpoint.h"
 #include "btl_vader_xpmem.h"
-
-#if OPAL_BTL_VADER_HAVE_CMA
-#include <sys/uio.h>
-
-#if OPAL_CMA_NEED_SYSCALL_DEFS
-#include "opal/sys/cma.h"
-#endif /* OPAL_CMA_NEED_SYSCALL_DEFS */
-
-#endif
+#include "btl_vader_cma.h"
 
 /**
  * Initiate an synchronous put.
@@ -65,22 +60,13 @@ int mca_btl_vader_put_cma (mca_btl_base_module_t *btl, mca_btl_base_endpoint_t *
                            mca_btl_base_registration_handle_t *remote_handle, size_t size, int flags,
                            int order, mca_btl_base_rdma_completion_fn_t cbfunc, void *cbcontext, void *cbdata)
 {
-    struct iovec src_iov = {.iov_base = local_address, .iov_len = size};
-    struct iovec dst_iov = {.iov_base = (void *)(intptr_t) remote_address, .iov_len = size};
-    ssize_t ret;
-
-    /* This should not be needed, see the rationale in mca_btl_vader_get_cma() */
-    do {
-        ret = process_vm_writev (endpoint->segment_data.other.seg_ds->seg_cpid, &src_iov, 1, &dst_iov, 1, 0);
-        if (0 > ret) {
-            opal_output(0, "Wrote %ld, expected %lu, errno = %d\n", (long)ret, (unsigned long)size, errno);
-            return OPAL_ERROR;
-        }
-        src_iov.iov_base = (void *)((char *)src_iov.iov_base + ret);
-        src_iov.iov_len -= ret;
-        dst_iov.iov_base = (void *)((char *)dst_iov.iov_base + ret);
-        dst_iov.iov_len -= ret;
-    } while (0 < src_iov.iov_len);
+    int rc;
+
+    rc = mca_btl_vader_cma_copy (endpoint->segment_data.other.seg_ds->seg_cpid, local_address,
+                                 (void *)(intptr_t) remote_address, size, true);
+    if (OPAL_UNLIKELY(OPAL_SUCCESS != rc)) {
+        return rc;
+    }
 
     /* always call the callback function */
     cbfunc (btl, endpoint, local_address, local_handle, cbcontext, cbdata, OPAL_SUCCESS);
@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2014 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -44,6 +44,7 @@
 #include "opal/mca/shmem/base/base.h"
 #include "opal/mca/base/mca_base_var.h"
 #include "opal/runtime/opal_params.h"
+#include "opal/runtime/opal_progress_threads.h"
 #include "opal/dss/dss.h"
 #include "opal/util/opal_environ.h"
 #include "opal/util/show_help.h"
@@ -172,6 +173,89 @@ int opal_register_params(void)
                                  &opal_progress_yield_when_idle);
 #endif
 
+    opal_progress_wait_block = false;
+    ret = mca_base_var_register ("opal", "opal", "progress", "wait_block",
+                                 "Block the threads waiting for the completion of requests once "
+                                 "they have spun for opal_progress_wait_spin calls to the progress "
+                                 "engine, until a BTL or another thread signals an event (requires "
+                                 "epoll and eventfd)",
+                                 MCA_BASE_VAR_TYPE_BOOL, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                 OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_LOCAL,
+                                 &opal_progress_wait_block);
+    if (0 > ret) {
+        return ret;
+    }
+
+    opal_progress_wait_spin = 10000;
+    ret = mca_base_var_register ("opal", "opal", "progress", "wait_spin",
+                                 "Longest number of calls to the progress engine a waiting thread "
+                                 "spins for before it blocks. The actual number adapts between "
+                                 "opal_progress_wait_spin_min and this value: it grows when waits "
+                                 "complete late in the window, and shrinks when they have to block",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                 OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_LOCAL,
+                                 &opal_progress_wait_spin);
+    if (0 > ret) {
+        return ret;
+    }
+
+    opal_progress_wait_spin_min = 100;
+    ret = mca_base_var_register ("opal", "opal", "progress", "wait_spin_min",
+                                 "Shortest number of calls to the progress engine a waiting "
+                                 "thread spins for before it blocks",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                 OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_LOCAL,
+                                 &opal_progress_wait_spin_min);
+    if (0 > ret) {
+        return ret;
+    }
+
+    opal_progress_wait_timeout = 10;
+    ret = mca_base_var_register ("opal", "opal", "progress", "wait_timeout",
+                                 "Longest time (in milliseconds) a waiting thread blocks before "
+                                 "it polls again, for the transports that cannot signal it",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                 OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_LOCAL,
+                                 &opal_progress_wait_timeout);
+    if (0 > ret) {
+        return ret;
+    }
+
+    opal_progress_async = false;
+    ret = mca_base_var_register ("opal", "opal", "progress", "async",
+                                 "Drive the progress engine from a dedicated thread, so that "
+                                 "communications advance while the application computes. "
+                                 "Implies that every layer is thread safe, whatever the thread "
+                                 "level requested by the application",
+                                 MCA_BASE_VAR_TYPE_BOOL, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                 OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_LOCAL,
+                                 &opal_progress_async);
+    if (0 > ret) {
+        return ret;
+    }
+
+    opal_progress_async_core = -1;
+    ret = mca_base_var_register ("opal", "opal", "progress", "async_core",
+                                 "Core, among the ones the process is bound to, on which the "
+                                 "asynchronous progress thread runs (-1: not bound)",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                 OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_LOCAL,
+                                 &opal_progress_async_core);
+    if (0 > ret) {
+        return ret;
+    }
+
+    opal_progress_async_idle = 0;
+    ret = mca_base_var_register ("opal", "opal", "progress", "async_idle",
+                                 "Time (in microseconds) the asynchronous progress thread sleeps "
+                                 "after a pass that completed nothing (0: never sleep)",
+                                 MCA_BASE_VAR_TYPE_INT, NULL, 0, MCA_BASE_VAR_FLAG_SETTABLE,
+                                 OPAL_INFO_LVL_5, MCA_BASE_VAR_SCOPE_LOCAL,
+                                 &opal_progress_async_idle);
+    if (0 > ret) {
+        return ret;
+    }
+
 #if OPAL_ENABLE_DEBUG
     opal_progress_debug = false;
     ret = mca_base_var_register ("opal", "opal", "progress", "debug",
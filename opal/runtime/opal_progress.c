@@ -3,7 +3,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2005 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -28,6 +28,15 @@
 #ifdef HAVE_SCHED_H
 #include <sched.h>
 #endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
 
 #include "opal/runtime/opal_progress.h"
 #include "opal/mca/event/event.h"
@@ -44,6 +53,12 @@
 bool opal_progress_debug = false;
 #endif
 
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+#define OPAL_PROGRESS_HAVE_WAIT_SET 1
+#else
+#define OPAL_PROGRESS_HAVE_WAIT_SET 0
+#endif
+
 /*
  * default parameters
  */
@@ -85,6 +100,97 @@ static opal_atomic_int32_t num_event_users = 0;
 static int debug_output = -1;
 #endif
 
+/* spin-then-block waiting */
+bool opal_progress_wait_block = false;
+int opal_progress_wait_spin = 10000;
+int opal_progress_wait_spin_min = 100;
+int opal_progress_wait_timeout = 10;
+opal_atomic_int32_t opal_progress_wait_sleepers = 0;
+
+/* current spin window, adapted after each wait */
+static int32_t wait_window = 0;
+
+#if OPAL_PROGRESS_HAVE_WAIT_SET
+typedef struct {
+    int fd;
+    opal_progress_wait_callback_t cb;
+} wait_source_t;
+
+static opal_mutex_t wait_lock = OPAL_MUTEX_STATIC_INIT;
+static wait_source_t *wait_sources = NULL;
+static int wait_sources_len = 0;
+static int wait_sources_size = 0;
+static int wait_epoll_fd = -1;
+static int wait_event_fd = -1;
+
+static void opal_progress_wait_set_fini (void)
+{
+    if (0 <= wait_event_fd) {
+        close (wait_event_fd);
+        wait_event_fd = -1;
+    }
+    if (0 <= wait_epoll_fd) {
+        close (wait_epoll_fd);
+        wait_epoll_fd = -1;
+    }
+    free (wait_sources);
+    wait_sources = NULL;
+    wait_sources_len = wait_sources_size = 0;
+}
+
+static int opal_progress_wait_set_init (void)
+{
+    struct epoll_event event = {.events = EPOLLIN};
+
+    wait_epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+    wait_event_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (0 > wait_epoll_fd || 0 > wait_event_fd) {
+        opal_progress_wait_set_fini ();
+        return OPAL_ERR_NOT_AVAILABLE;
+    }
+
+    event.data.fd = wait_event_fd;
+    if (0 != epoll_ctl (wait_epoll_fd, EPOLL_CTL_ADD, wait_event_fd, &event)) {
+        opal_progress_wait_set_fini ();
+        return OPAL_ERR_NOT_AVAILABLE;
+    }
+
+    return OPAL_SUCCESS;
+}
+
+static void opal_progress_wait_sources_notify (bool blocking)
+{
+    OPAL_THREAD_LOCK(&wait_lock);
+    for (int i = 0 ; i < wait_sources_len ; ++i) {
+        if (NULL != wait_sources[i].cb) {
+            wait_sources[i].cb (blocking);
+        }
+    }
+    OPAL_THREAD_UNLOCK(&wait_lock);
+}
+
+/* block until a descriptor of the wait set is readable, or the timeout */
+static void opal_progress_wait_set_block (opal_atomic_int32_t *count)
+{
+    struct epoll_event events[8];
+    uint64_t value;
+
+    opal_atomic_add_fetch_32 (&opal_progress_wait_sleepers, 1);
+    opal_progress_wait_sources_notify (true);
+
+    /* progress once more to catch the events that raced with the
+     * announcement, so that every later one signals us */
+    opal_progress ();
+    if (*count > 0) {
+        (void) epoll_wait (wait_epoll_fd, events, 8, opal_progress_wait_timeout);
+        (void) read (wait_event_fd, &value, sizeof (value));
+    }
+
+    opal_progress_wait_sources_notify (false);
+    opal_atomic_add_fetch_32 (&opal_progress_wait_sleepers, -1);
+}
+#endif  /* OPAL_PROGRESS_HAVE_WAIT_SET */
+
 /**
  * Fake callback used for threading purpose when one thread
  * progesses callbacks while another unregister somes. The root
@@ -113,6 +219,10 @@ static void opal_progress_finalize (void)
     free ((void *) callbacks_lp);
     callbacks_lp = NULL;
 
+#if OPAL_PROGRESS_HAVE_WAIT_SET
+    opal_progress_wait_set_fini ();
+#endif
+
     opal_atomic_unlock(&progress_lock);
 }
 
@@ -154,6 +264,18 @@ opal_progress_init(void)
         callbacks_lp[i] = fake_cb;
     }
 
+    if (opal_progress_wait_spin_min > opal_progress_wait_spin) {
+        opal_progress_wait_spin_min = opal_progress_wait_spin;
+    }
+    wait_window = opal_progress_wait_spin;
+#if OPAL_PROGRESS_HAVE_WAIT_SET
+    if (opal_progress_wait_block && OPAL_SUCCESS != opal_progress_wait_set_init ()) {
+        opal_progress_wait_block = false;
+    }
+#else
+    opal_progress_wait_block = false;
+#endif
+
     OPAL_OUTPUT((debug_output, "progress: initialized event flag to: %x",
                  opal_progress_event_flag));
     OPAL_OUTPUT((debug_output, "progress: initialized yield_when_idle to: %s",
@@ -162,6 +284,8 @@ opal_progress_init(void)
                  num_event_users));
     OPAL_OUTPUT((debug_output, "progress: initialized poll rate to: %ld",
                  (long) event_progress_delta));
+    OPAL_OUTPUT((debug_output, "progress: initialized wait_block to: %s",
+                 opal_progress_wait_block ? "true" : "false"));
 
     opal_finalize_register_cleanup (opal_progress_finalize);
 
@@ -218,8 +342,8 @@ static int opal_progress_events(void)
  * care, as the cost of that happening is far outweighed by the cost
  * of the if checks (they were resulting in bad pipe stalling behavior)
  */
-void
-opal_progress(void)
+static inline int
+_opal_progress(void)
 {
     static uint32_t num_calls = 0;
     size_t i;
@@ -246,6 +370,20 @@ opal_progress(void)
         opal_progress_events();
     }
 
+    return events;
+}
+
+int
+opal_progress_count(void)
+{
+    return _opal_progress();
+}
+
+void
+opal_progress(void)
+{
+    int events = _opal_progress();
+
 #if OPAL_HAVE_SCHED_YIELD
     if (opal_progress_yield_when_idle && events <= 0) {
         /* If there is nothing to do - yield the processor - otherwise
@@ -259,6 +397,118 @@ opal_progress(void)
 }
 
 
+/*
+ * Spin for the current window, then block until signalled. The
+ * window grows when waits complete late in it, and shrinks when they
+ * have to block, so that threads waiting on short operations keep
+ * spinning while the ones waiting on long operations give the core
+ * away early.
+ */
+void
+opal_progress_wait(opal_atomic_int32_t *count)
+{
+    int32_t window = wait_window, spins = 0;
+    bool blocked = false;
+
+    while (*count > 0) {
+        if (spins < window || !opal_progress_wait_block) {
+            opal_progress();
+            ++spins;
+            continue;
+        }
+#if OPAL_PROGRESS_HAVE_WAIT_SET
+        window = wait_window = (window / 2 > opal_progress_wait_spin_min) ?
+            window / 2 : opal_progress_wait_spin_min;
+        opal_progress_wait_set_block(count);
+        blocked = true;
+        spins = 0;
+#endif
+    }
+
+    if (!blocked && 2 * spins > window) {
+        wait_window = (2 * spins < opal_progress_wait_spin) ? 2 * spins : opal_progress_wait_spin;
+    }
+}
+
+
+void
+opal_progress_wakeup(void)
+{
+#if OPAL_PROGRESS_HAVE_WAIT_SET
+    uint64_t value = 1;
+
+    if (0 <= wait_event_fd) {
+        (void) write(wait_event_fd, &value, sizeof(value));
+    }
+#endif
+}
+
+
+int
+opal_progress_wait_register(int fd, opal_progress_wait_callback_t cb)
+{
+#if OPAL_PROGRESS_HAVE_WAIT_SET
+    struct epoll_event event = {.events = EPOLLIN, .data.fd = fd};
+    int ret = OPAL_SUCCESS;
+
+    if (0 > wait_epoll_fd) {
+        return OPAL_ERR_NOT_AVAILABLE;
+    }
+
+    OPAL_THREAD_LOCK(&wait_lock);
+    if (wait_sources_len == wait_sources_size) {
+        wait_source_t *tmp = realloc(wait_sources, (wait_sources_size + 8) * sizeof(wait_source_t));
+        if (NULL == tmp) {
+            OPAL_THREAD_UNLOCK(&wait_lock);
+            return OPAL_ERR_OUT_OF_RESOURCE;
+        }
+        wait_sources = tmp;
+        wait_sources_size += 8;
+    }
+    if (0 != epoll_ctl(wait_epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+        ret = OPAL_ERROR;
+    } else {
+        wait_sources[wait_sources_len].fd = fd;
+        wait_sources[wait_sources_len].cb = cb;
+        ++wait_sources_len;
+    }
+    OPAL_THREAD_UNLOCK(&wait_lock);
+
+    return ret;
+#else
+    return OPAL_ERR_NOT_AVAILABLE;
+#endif
+}
+
+
+int
+opal_progress_wait_unregister(int fd)
+{
+#if OPAL_PROGRESS_HAVE_WAIT_SET
+    int ret = OPAL_ERR_NOT_FOUND;
+
+    if (0 > wait_epoll_fd) {
+        return OPAL_ERR_NOT_AVAILABLE;
+    }
+
+    OPAL_THREAD_LOCK(&wait_lock);
+    for (int i = 0 ; i < wait_sources_len ; ++i) {
+        if (wait_sources[i].fd == fd) {
+            (void) epoll_ctl(wait_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            wait_sources[i] = wait_sources[--wait_sources_len];
+            ret = OPAL_SUCCESS;
+            break;
+        }
+    }
+    OPAL_THREAD_UNLOCK(&wait_lock);
+
+    return ret;
+#else
+    return OPAL_ERR_NOT_AVAILABLE;
+#endif
+}
+
+
 int
 opal_progress_set_event_flag(int flag)
 {
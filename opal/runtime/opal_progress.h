@@ -2,7 +2,7 @@
  * Copyright (c) 2004-2005 The Trustees of Indiana University and Indiana
  *                         University Research and Technology
  *                         Corporation.  All rights reserved.
- * Copyright (c) 2004-2006 The University of Tennessee and The University
+ * Copyright (c) 2004-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2004-2005 High Performance Computing Center Stuttgart,
@@ -59,6 +59,15 @@ OPAL_DECLSPEC int opal_progress_init(void);
  */
 OPAL_DECLSPEC void opal_progress(void);
 
+/**
+ * Progress all pending events once
+ *
+ * Same as opal_progress(), without yielding the processor when idle.
+ *
+ * @return         Number of events progressed by the callbacks
+ */
+OPAL_DECLSPEC int opal_progress_count(void);
+
 
 /**
  * Control how the event library is called
@@ -190,6 +199,69 @@ static inline bool opal_progress_spin(volatile bool* complete)
 }
 
 
+/* block the waiting threads once the spin window expires */
+OPAL_DECLSPEC extern bool opal_progress_wait_block;
+
+/* bounds of the spin window, in calls to opal_progress() */
+OPAL_DECLSPEC extern int opal_progress_wait_spin;
+OPAL_DECLSPEC extern int opal_progress_wait_spin_min;
+
+/* longest time a waiting thread blocks, in milliseconds */
+OPAL_DECLSPEC extern int opal_progress_wait_timeout;
+
+/* number of threads blocked in opal_progress_wait() */
+OPAL_DECLSPEC extern opal_atomic_int32_t opal_progress_wait_sleepers;
+
+/**
+ * Wait source callback
+ *
+ * Called with true right before a thread blocks on the wait set, at
+ * which point the source must make sure the descriptor it registered
+ * becomes readable when it has something to progress, and with false
+ * once the thread wakes up, to drain the descriptor.
+ */
+typedef void (*opal_progress_wait_callback_t)(bool blocking);
+
+/**
+ * Add a descriptor to the wait set
+ *
+ * A thread blocked in opal_progress_wait() wakes up when the
+ * descriptor becomes readable. Does nothing, and returns
+ * OPAL_ERR_NOT_AVAILABLE, unless opal_progress_wait_block is set.
+ */
+OPAL_DECLSPEC int opal_progress_wait_register(int fd, opal_progress_wait_callback_t cb);
+
+/**
+ * Remove a descriptor from the wait set
+ */
+OPAL_DECLSPEC int opal_progress_wait_unregister(int fd);
+
+/**
+ * Progress until *count drops to zero
+ *
+ * Spins in opal_progress() for an adaptive number of iterations, and
+ * then, if opal_progress_wait_block is set, blocks on the wait set
+ * until one of its descriptors becomes readable or another thread
+ * calls opal_progress_signal().
+ */
+OPAL_DECLSPEC void opal_progress_wait(opal_atomic_int32_t *count);
+
+OPAL_DECLSPEC void opal_progress_wakeup(void);
+
+/**
+ * Wake up the threads blocked in opal_progress_wait(), if any. To
+ * be called after completing an event some other thread may be
+ * waiting for.
+ */
+static inline void opal_progress_signal(void)
+{
+    opal_atomic_mb();
+    if (OPAL_UNLIKELY(0 < opal_progress_wait_sleepers)) {
+        opal_progress_wakeup();
+    }
+}
+
+
 END_C_DECLS
 
 #endif
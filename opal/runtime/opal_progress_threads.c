@@ -1,6 +1,9 @@
 /*
  * Copyright (c) 2014-2015 Intel, Inc.  All rights reserved.
  * Copyright (c) 2015 Cisco Systems, Inc.  All rights reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -17,10 +20,13 @@
 
 #include "opal/class/opal_list.h"
 #include "opal/mca/event/event.h"
+#include "opal/mca/hwloc/base/base.h"
 #include "opal/threads/threads.h"
 #include "opal/util/error.h"
 #include "opal/util/fd.h"
+#include "opal/util/output.h"
 
+#include "opal/runtime/opal_progress.h"
 #include "opal/runtime/opal_progress_threads.h"
 
 
@@ -293,3 +299,99 @@ int opal_progress_thread_resume(const char *name)
 
     return OPAL_ERR_NOT_FOUND;
 }
+
+
+bool opal_progress_async = false;
+int opal_progress_async_core = -1;
+int opal_progress_async_idle = 0;
+
+static opal_thread_t async_engine;
+static volatile bool async_active = false;
+
+/* bind the calling thread to the given core of the process binding */
+static void async_progress_bind(void)
+{
+    hwloc_cpuset_t allowed;
+    hwloc_obj_t core;
+    int ncores;
+
+    if (0 > opal_progress_async_core ||
+        OPAL_SUCCESS != opal_hwloc_base_get_topology()) {
+        return;
+    }
+
+    allowed = hwloc_bitmap_alloc();
+    if (NULL == allowed) {
+        return;
+    }
+    if (0 == hwloc_get_cpubind(opal_hwloc_topology, allowed, HWLOC_CPUBIND_PROCESS) &&
+        0 < (ncores = hwloc_get_nbobjs_inside_cpuset_by_type(opal_hwloc_topology, allowed,
+                                                             HWLOC_OBJ_CORE))) {
+        core = hwloc_get_obj_inside_cpuset_by_type(opal_hwloc_topology, allowed, HWLOC_OBJ_CORE,
+                                                   opal_progress_async_core % ncores);
+        if (NULL != core && 0 != hwloc_set_cpubind(opal_hwloc_topology, core->cpuset,
+                                                   HWLOC_CPUBIND_THREAD)) {
+            opal_output_verbose(10, 0, "progress: cannot bind the async progress thread to core %d",
+                                opal_progress_async_core % ncores);
+        }
+    }
+    hwloc_bitmap_free(allowed);
+}
+
+/*
+ * Main for the asynchronous progress thread
+ */
+static void* async_progress_engine(opal_object_t *obj)
+{
+    async_progress_bind();
+
+    while (async_active) {
+        if (0 < opal_progress_count() || 0 == opal_progress_async_idle) {
+            continue;
+        }
+        /* nothing happened, leave the core to the application */
+        usleep(opal_progress_async_idle);
+    }
+
+    return OPAL_THREAD_CANCELLED;
+}
+
+int opal_progress_async_start(void)
+{
+    int rc;
+
+    if (!opal_progress_async || async_active) {
+        return OPAL_SUCCESS;
+    }
+
+    /* every layer is driven from two threads */
+    if (!opal_using_threads()) {
+        return OPAL_ERR_NOT_SUPPORTED;
+    }
+
+    OBJ_CONSTRUCT(&async_engine, opal_thread_t);
+    async_engine.t_run = async_progress_engine;
+    async_engine.t_arg = NULL;
+    async_active = true;
+
+    rc = opal_thread_start(&async_engine);
+    if (OPAL_SUCCESS != rc) {
+        OPAL_ERROR_LOG(rc);
+        async_active = false;
+        OBJ_DESTRUCT(&async_engine);
+    }
+
+    return rc;
+}
+
+void opal_progress_async_stop(void)
+{
+    if (!async_active) {
+        return;
+    }
+
+    async_active = false;
+    opal_atomic_mb();
+    opal_thread_join(&async_engine, NULL);
+    OBJ_DESTRUCT(&async_engine);
+}
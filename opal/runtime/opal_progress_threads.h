@@ -1,6 +1,9 @@
 /*
  * Copyright (c) 2014      Intel, Inc.  All rights reserved.
  * Copyright (c) 2015 Cisco Systems, Inc.  All rights reserved.
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -67,4 +70,31 @@ OPAL_DECLSPEC int opal_progress_thread_pause(const char *name);
  */
 OPAL_DECLSPEC int opal_progress_thread_resume(const char *name);
 
+/* drive opal_progress() from a dedicated thread */
+OPAL_DECLSPEC extern bool opal_progress_async;
+
+/* core the asynchronous progress thread is bound to (-1 for none) */
+OPAL_DECLSPEC extern int opal_progress_async_core;
+
+/* time the asynchronous progress thread sleeps when idle, in microseconds */
+OPAL_DECLSPEC extern int opal_progress_async_idle;
+
+/**
+ * Start the asynchronous progress thread, which calls
+ * opal_progress() in a loop so that the registered progress
+ * callbacks (PML, BTLs, nonblocking collectives, ...) advance while
+ * the application computes.
+ *
+ * Does nothing unless opal_progress_async is set. Every layer must
+ * be thread safe, so opal_set_using_threads(true) must have been
+ * called before the components were initialized, whatever the thread
+ * level of the application.
+ */
+OPAL_DECLSPEC int opal_progress_async_start(void);
+
+/**
+ * Stop the asynchronous progress thread, and wait for it to exit.
+ */
+OPAL_DECLSPEC void opal_progress_async_stop(void);
+
 #endif
@@ -1,6 +1,6 @@
 /* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
 /*
- * Copyright (c) 2014-2016 The University of Tennessee and The University
+ * Copyright (c) 2014-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2016      Los Alamos National Security, LLC. All rights
@@ -84,8 +84,12 @@ int ompi_sync_wait_mt(ompi_wait_sync_t *sync)
     pthread_mutex_unlock(&sync->lock);
 
     OPAL_THREAD_ADD_FETCH32(&num_thread_in_progress, 1);
-    while(sync->count > 0) {  /* progress till completion */
-        opal_progress();  /* don't progress with the sync lock locked or you'll deadlock */
+    if( opal_progress_wait_block ) {
+        opal_progress_wait(&sync->count);
+    } else {
+        while(sync->count > 0) {  /* progress till completion */
+            opal_progress();  /* don't progress with the sync lock locked or you'll deadlock */
+        }
     }
     OPAL_THREAD_ADD_FETCH32(&num_thread_in_progress, -1);
 
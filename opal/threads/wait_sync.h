@@ -1,6 +1,6 @@
 /* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
 /*
- * Copyright (c) 2014-2016 The University of Tennessee and The University
+ * Copyright (c) 2014-2020 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
  * Copyright (c) 2016      Los Alamos National Security, LLC. All rights
@@ -72,6 +72,7 @@ typedef struct ompi_wait_sync_t {
         pthread_cond_signal(&sync->condition);        \
         pthread_mutex_unlock(&(sync->lock));          \
         sync->signaling = false;                      \
+        opal_progress_signal();                       \
     }
 
 #define WAIT_SYNC_SIGNALLED(sync){                    \
@@ -81,8 +82,12 @@ typedef struct ompi_wait_sync_t {
 OPAL_DECLSPEC int ompi_sync_wait_mt(ompi_wait_sync_t *sync);
 static inline int sync_wait_st (ompi_wait_sync_t *sync)
 {
-    while (sync->count > 0) {
-        opal_progress();
+    if (opal_progress_wait_block) {
+        opal_progress_wait(&sync->count);
+    } else {
+        while (sync->count > 0) {
+            opal_progress();
+        }
     }
 
     return sync->status;
@@ -0,0 +1,212 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "opal_config.h"
+
+#include "opal/util/uring.h"
+
+#if OPAL_HAVE_IO_URING
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "opal/constants.h"
+
+static inline int opal_uring_enter(opal_uring_t *ring, unsigned to_submit,
+                                   unsigned min_complete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete,
+                         flags, NULL, 0);
+}
+
+int opal_uring_init(opal_uring_t *ring, unsigned entries, bool sqpoll)
+{
+    struct io_uring_params params;
+    unsigned *sq_array;
+    int err;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    if (sqpoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = 1000;
+    }
+
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return OPAL_ERR_NOT_AVAILABLE;
+    }
+    ring->sqpoll = !!(params.flags & IORING_SETUP_SQPOLL);
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ring->sq_ring) {
+        ring->sq_ring = NULL;
+        goto error;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == ring->cq_ring) {
+            ring->cq_ring = NULL;
+            goto error;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *) mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (MAP_FAILED == ring->sqes) {
+        ring->sqes = NULL;
+        goto error;
+    }
+
+    ring->sq_head = (unsigned *) ((char *) ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned *) ((char *) ring->sq_ring + params.sq_off.tail);
+    ring->sq_flags = (unsigned *) ((char *) ring->sq_ring + params.sq_off.flags);
+    ring->sq_mask = *(unsigned *) ((char *) ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (unsigned *) ((char *) ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned *) ((char *) ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *) ((char *) ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_ring + params.cq_off.cqes);
+
+    /* the entries are always used in order */
+    sq_array = (unsigned *) ((char *) ring->sq_ring + params.sq_off.array);
+    for (unsigned i = 0 ; i < params.sq_entries ; ++i) {
+        sq_array[i] = i;
+    }
+    ring->sqe_tail = ring->sqe_published = *ring->sq_tail;
+    ring->to_submit = 0;
+
+    return OPAL_SUCCESS;
+
+ error:
+    err = errno;
+    if (NULL != ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (NULL != ring->sq_ring) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    close(ring->fd);
+    ring->fd = -1;
+    errno = err;
+    return OPAL_ERR_NOT_AVAILABLE;
+}
+
+void opal_uring_fini(opal_uring_t *ring)
+{
+    if (ring->fd < 0) {
+        return;
+    }
+
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+int opal_uring_register(opal_uring_t *ring, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return (int) syscall(__NR_io_uring_register, ring->fd, opcode, arg, nr_args);
+}
+
+int opal_uring_flush(opal_uring_t *ring)
+{
+    unsigned flags;
+    int ret;
+
+    if (ring->sqpoll) {
+        /* the kernel thread picks them up by itself, unless it went to sleep */
+        ring->to_submit = 0;
+        opal_atomic_mb();
+        flags = *(volatile unsigned *) ring->sq_flags;
+        if (flags & (IORING_SQ_NEED_WAKEUP | IORING_SQ_CQ_OVERFLOW)) {
+            (void) opal_uring_enter(ring, 0, 0, ((flags & IORING_SQ_NEED_WAKEUP) ? IORING_ENTER_SQ_WAKEUP : 0) |
+                                    ((flags & IORING_SQ_CQ_OVERFLOW) ? IORING_ENTER_GETEVENTS : 0));
+        }
+        return OPAL_SUCCESS;
+    }
+
+    while (ring->to_submit) {
+        ret = opal_uring_enter(ring, ring->to_submit, 0, 0);
+        if (ret < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            if (EAGAIN == errno || EBUSY == errno) {
+                /* try again once the completions are reaped */
+                break;
+            }
+            return OPAL_ERROR;
+        }
+        if (0 == ret) {
+            break;
+        }
+        ring->to_submit -= ret;
+    }
+
+    if (*(volatile unsigned *) ring->sq_flags & IORING_SQ_CQ_OVERFLOW) {
+        /* flush the completions the kernel kept aside */
+        (void) opal_uring_enter(ring, 0, 0, IORING_ENTER_GETEVENTS);
+    }
+    return OPAL_SUCCESS;
+}
+
+unsigned opal_uring_reap(opal_uring_t *ring, struct io_uring_cqe *cqes, unsigned max)
+{
+    unsigned head, tail, count = 0;
+
+    head = *ring->cq_head;
+    tail = opal_uring_load(ring->cq_tail);
+    while (head != tail && count < max) {
+        cqes[count++] = ring->cqes[head++ & ring->cq_mask];
+    }
+    opal_uring_store(ring->cq_head, head);
+
+    return count;
+}
+
+int opal_uring_wait(opal_uring_t *ring)
+{
+    if (OPAL_SUCCESS != opal_uring_flush(ring)) {
+        return OPAL_ERROR;
+    }
+    while (*ring->cq_head == opal_uring_load(ring->cq_tail)) {
+        if (opal_uring_enter(ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && EINTR != errno) {
+            return OPAL_ERROR;
+        }
+    }
+    return OPAL_SUCCESS;
+}
+
+#endif  /* OPAL_HAVE_IO_URING */
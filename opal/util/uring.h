@@ -0,0 +1,192 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/**
+ * @file
+ *
+ * Minimal io_uring ring, driven through the raw system calls so that
+ * only the kernel headers are needed.
+ *
+ * The submission queue entries are always used in order. They are
+ * prepared with opal_uring_get_sqe(), made visible to the kernel with
+ * opal_uring_publish(), and handed to it with opal_uring_flush(), so
+ * that the requests prepared by several callers go in with a single
+ * system call. The completions are copied out of the ring by
+ * opal_uring_reap() without any system call.
+ *
+ * None of these functions is thread safe, the callers serialize the
+ * accesses to a ring with their own lock.
+ */
+
+#ifndef OPAL_UTIL_URING_H
+#define OPAL_UTIL_URING_H
+
+#include "opal_config.h"
+
+#if OPAL_HAVE_IO_URING
+
+#include <string.h>
+#include <linux/io_uring.h>
+
+#include "opal/sys/atomic.h"
+
+BEGIN_C_DECLS
+
+struct opal_uring_t {
+    int fd;
+    bool sqpoll;
+
+    /* submission queue */
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_flags;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned sqe_tail;          /**< next entry to prepare */
+    unsigned sqe_published;     /**< entries made visible to the kernel */
+    unsigned to_submit;         /**< published but not yet submitted */
+
+    /* completion queue */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+typedef struct opal_uring_t opal_uring_t;
+
+#define OPAL_URING_STATIC_INIT {.fd = -1}
+
+/**
+ * Create a ring and map its queues.
+ *
+ * @param ring     The ring
+ * @param entries  Requested number of submission queue entries
+ * @param sqpoll   Have a kernel thread poll the submission queue
+ *
+ * @retval OPAL_SUCCESS            The ring is ready
+ * @retval OPAL_ERR_NOT_AVAILABLE  io_uring cannot be used, errno is set
+ */
+OPAL_DECLSPEC int opal_uring_init(opal_uring_t *ring, unsigned entries, bool sqpoll);
+
+/**
+ * Unmap the queues and close the ring. The kernel must be done with
+ * all the requests.
+ */
+OPAL_DECLSPEC void opal_uring_fini(opal_uring_t *ring);
+
+/**
+ * io_uring_register() on the ring.
+ *
+ * @returns the return value of the system call, errno is set on error.
+ */
+OPAL_DECLSPEC int opal_uring_register(opal_uring_t *ring, unsigned opcode, void *arg, unsigned nr_args);
+
+/**
+ * Hand the published entries to the kernel.
+ *
+ * @retval OPAL_SUCCESS  All entries were submitted, or the kernel is
+ *                       temporarily out of resources and the remaining
+ *                       ones go in with the next call
+ * @retval OPAL_ERROR    io_uring_enter failed, errno is set
+ */
+OPAL_DECLSPEC int opal_uring_flush(opal_uring_t *ring);
+
+/**
+ * Copy at most max completions out of the ring.
+ *
+ * @returns the number of completions copied in cqes.
+ */
+OPAL_DECLSPEC unsigned opal_uring_reap(opal_uring_t *ring, struct io_uring_cqe *cqes, unsigned max);
+
+/**
+ * Flush the ring and block until at least one completion is available.
+ *
+ * @retval OPAL_SUCCESS  A completion can be reaped
+ * @retval OPAL_ERROR    io_uring_enter failed, errno is set
+ */
+OPAL_DECLSPEC int opal_uring_wait(opal_uring_t *ring);
+
+static inline unsigned opal_uring_load(const unsigned *ptr)
+{
+    unsigned value = *(volatile const unsigned *) ptr;
+    opal_atomic_rmb();
+    return value;
+}
+
+static inline void opal_uring_store(unsigned *ptr, unsigned value)
+{
+    opal_atomic_mb();
+    *(volatile unsigned *) ptr = value;
+}
+
+/**
+ * Number of entries that can be prepared without flushing the ring.
+ */
+static inline unsigned opal_uring_sq_space(opal_uring_t *ring)
+{
+    return ring->sq_entries - (ring->sqe_tail - opal_uring_load(ring->sq_head));
+}
+
+/**
+ * Get a cleared submission entry, flushing the ring if it is full.
+ *
+ * @returns NULL if the kernel did not make room.
+ */
+static inline struct io_uring_sqe *opal_uring_get_sqe(opal_uring_t *ring)
+{
+    struct io_uring_sqe *sqe;
+
+    if (0 == opal_uring_sq_space(ring)) {
+        (void) opal_uring_flush(ring);
+        if (0 == opal_uring_sq_space(ring)) {
+            return NULL;
+        }
+    }
+
+    sqe = ring->sqes + (ring->sqe_tail++ & ring->sq_mask);
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+/**
+ * Make the prepared entries visible to the kernel.
+ */
+static inline void opal_uring_publish(opal_uring_t *ring)
+{
+    ring->to_submit += ring->sqe_tail - ring->sqe_published;
+    ring->sqe_published = ring->sqe_tail;
+    opal_uring_store(ring->sq_tail, ring->sqe_tail);
+}
+
+/**
+ * Check without any lock nor system call whether opal_uring_flush()
+ * or opal_uring_reap() has anything to do.
+ */
+static inline bool opal_uring_pending(opal_uring_t *ring)
+{
+    return 0 != ring->to_submit ||
+        *(volatile unsigned *) ring->cq_head != *(volatile unsigned *) ring->cq_tail ||
+        (*(volatile unsigned *) ring->sq_flags & IORING_SQ_CQ_OVERFLOW);
+}
+
+END_C_DECLS
+
+#endif  /* OPAL_HAVE_IO_URING */
+
+#endif  /* OPAL_UTIL_URING_H */
@@ -0,0 +1,344 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opal/datatype/opal_convertor.h"
+#include "ompi/datatype/ompi_datatype.h"
+#include "opal/mca/base/mca_base_var.h"
+#include "opal/runtime/opal.h"
+
+/**
+ * The purpose of this test is to check the flat copy programs generated
+ * when a datatype is committed against the generic description interpreter.
+ * Each datatype is packed and unpacked by both, using fragments of several
+ * sizes split over two iovecs, and starting from positions spread over the
+ * whole packed stream (in the middle of blocks as well as in the middle of
+ * loops). The results have to match byte for byte.
+ *
+ * The same conversions are then done on the helper threads
+ * (mpi_ddt_pack_threads), with a minimum size small enough for every
+ * call to be split, and compared with the serial results.
+ */
+
+static size_t fragment_sizes[] = { 1, 3, 8, 13, 113, 4096 };
+#define NB_FRAGMENT_SIZES (sizeof(fragment_sizes) / sizeof(fragment_sizes[0]))
+#define POSITION_STEP 7
+
+static size_t parallel_fragment_sizes[] = { 200, 1000, (size_t)-1 };
+#define NB_PARALLEL_FRAGMENT_SIZES (sizeof(parallel_fragment_sizes) / sizeof(parallel_fragment_sizes[0]))
+
+static int
+set_pack_threads( int threads, size_t min_size )
+{
+    int idx;
+
+    idx = mca_base_var_find( "opal", "mpi", NULL, "ddt_pack_threads" );
+    if( (0 > idx) ||
+        (OPAL_SUCCESS != mca_base_var_set_value( idx, &threads, sizeof(threads),
+                                                 MCA_BASE_VAR_SOURCE_SET, NULL )) ) {
+        return -1;
+    }
+    idx = mca_base_var_find( "opal", "mpi", NULL, "ddt_pack_threads_min_size" );
+    if( (0 > idx) ||
+        (OPAL_SUCCESS != mca_base_var_set_value( idx, &min_size, sizeof(min_size),
+                                                 MCA_BASE_VAR_SOURCE_SET, NULL )) ) {
+        return -1;
+    }
+    return 0;
+}
+
+static opal_convertor_t*
+create_convertor( ompi_datatype_t* datatype, int count, void* buffer,
+                  int send, int compiled )
+{
+    struct opal_datatype_program_t* program = datatype->super.program;
+    opal_convertor_t* convertor = opal_convertor_create( opal_local_arch, 0 );
+
+    /* without a program the convertor falls back on the generic functions */
+    if( !compiled ) datatype->super.program = NULL;
+    if( send ) {
+        opal_convertor_prepare_for_send( convertor, &(datatype->super), count, buffer );
+    } else {
+        opal_convertor_prepare_for_recv( convertor, &(datatype->super), count, buffer );
+    }
+    datatype->super.program = program;
+
+    if( compiled != !!(convertor->flags & CONVERTOR_COMPILED) ) {
+        printf( "convertor is %scompiled while it should%s be\n",
+                compiled ? "not " : "", compiled ? "" : " not" );
+        OBJ_RELEASE(convertor);
+        return NULL;
+    }
+    return convertor;
+}
+
+/**
+ * Pack or unpack length bytes of the packed stream starting at position,
+ * fragment bytes per iovec and two iovecs per call. Return the number of
+ * bytes converted.
+ */
+static size_t
+convert_range( opal_convertor_t* convertor, size_t position, unsigned char* packed,
+               size_t length, size_t fragment, int send )
+{
+    size_t max_data, done = 0, requested = position;
+    struct iovec iov[2];
+    uint32_t iov_count;
+
+    opal_convertor_set_position( convertor, &position );
+    if( position != requested ) {
+        printf( "Setting position failed (%lu != %lu)\n",
+                (unsigned long)requested, (unsigned long)position );
+        return 0;
+    }
+
+    while( done < length ) {
+        iov[0].iov_base = packed + done;
+        iov[0].iov_len  = (fragment < (length - done)) ? fragment : (length - done);
+        iov[1].iov_base = packed + done + iov[0].iov_len;
+        iov[1].iov_len  = (fragment < (length - done - iov[0].iov_len)) ?
+                           fragment : (length - done - iov[0].iov_len);
+        iov_count = (0 == iov[1].iov_len) ? 1 : 2;
+        max_data = iov[0].iov_len + iov[1].iov_len;
+        if( send ) {
+            opal_convertor_pack( convertor, iov, &iov_count, &max_data );
+        } else {
+            opal_convertor_unpack( convertor, iov, &iov_count, &max_data );
+        }
+        if( 0 == max_data ) break;
+        done += max_data;
+    }
+    return done;
+}
+
+static int
+check_datatype( const char* name, ompi_datatype_t* datatype, int count )
+{
+    unsigned char *user, *packed_ref, *packed, *unpacked_ref, *unpacked;
+    ptrdiff_t lb, extent, true_lb, true_extent;
+    opal_convertor_t *conv_compiled = NULL, *conv_generic = NULL, *convertor;
+    size_t size, span, position, length, f, i;
+    int compiled, errors = 0;
+
+    if( NULL == datatype->super.program ) {
+        printf( "%s: the datatype has not been compiled\n", name );
+        return 1;
+    }
+
+    ompi_datatype_type_size( datatype, &size );
+    size *= count;
+    ompi_datatype_get_extent( datatype, &lb, &extent );
+    ompi_datatype_get_true_extent( datatype, &true_lb, &true_extent );
+    span = true_extent + (count - 1) * extent;
+
+    user         = (unsigned char*)malloc( span );
+    unpacked_ref = (unsigned char*)malloc( span );
+    unpacked     = (unsigned char*)malloc( span );
+    packed_ref   = (unsigned char*)malloc( size );
+    packed       = (unsigned char*)malloc( size );
+    for( i = 0; i < span; i++ ) {
+        user[i] = (unsigned char)(i * 7 + 1);
+    }
+
+    /* the reference is what the generic functions produce in a single call */
+    conv_generic = create_convertor( datatype, count, user - true_lb, 1, 0 );
+    if( (NULL == conv_generic) ||
+        (size != convert_range( conv_generic, 0, packed_ref, size, size, 1 )) ) {
+        printf( "%s: generic pack failed\n", name );
+        errors++;
+        goto cleanup;
+    }
+    OBJ_RELEASE(conv_generic);
+
+    memset( unpacked_ref, 0, span );
+    conv_generic = create_convertor( datatype, count, unpacked_ref - true_lb, 0, 0 );
+    if( (NULL == conv_generic) ||
+        (size != convert_range( conv_generic, 0, packed_ref, size, size, 0 )) ) {
+        printf( "%s: generic unpack failed\n", name );
+        errors++;
+        goto cleanup;
+    }
+    OBJ_RELEASE(conv_generic);
+
+    /* the whole stream, with partial iovecs */
+    for( f = 0; f < NB_FRAGMENT_SIZES; f++ ) {
+        memset( packed, 0, size );
+        conv_compiled = create_convertor( datatype, count, user - true_lb, 1, 1 );
+        if( (NULL == conv_compiled) ||
+            (size != convert_range( conv_compiled, 0, packed, size, fragment_sizes[f], 1 )) ||
+            (0 != memcmp( packed, packed_ref, size )) ) {
+            printf( "%s: pack mismatch with fragments of %lu bytes\n",
+                    name, (unsigned long)fragment_sizes[f] );
+            errors++;
+        }
+        if( NULL != conv_compiled ) OBJ_RELEASE(conv_compiled);
+
+        memset( unpacked, 0, span );
+        conv_compiled = create_convertor( datatype, count, unpacked - true_lb, 0, 1 );
+        if( (NULL == conv_compiled) ||
+            (size != convert_range( conv_compiled, 0, packed_ref, size, fragment_sizes[f], 0 )) ||
+            (0 != memcmp( unpacked, unpacked_ref, span )) ) {
+            printf( "%s: unpack mismatch with fragments of %lu bytes\n",
+                    name, (unsigned long)fragment_sizes[f] );
+            errors++;
+        }
+        if( NULL != conv_compiled ) OBJ_RELEASE(conv_compiled);
+    }
+
+    /* the convertors prepared from here to the reset are split between 4 threads */
+    if( 0 != set_pack_threads( 3, 64 ) ) {
+        printf( "%s: unable to set mpi_ddt_pack_threads\n", name );
+        errors++;
+        goto cleanup;
+    }
+    for( compiled = 0; compiled < 2; compiled++ ) {
+        for( f = 0; f < NB_PARALLEL_FRAGMENT_SIZES; f++ ) {
+            memset( packed, 0, size );
+            convertor = create_convertor( datatype, count, user - true_lb, 1, compiled );
+            if( (NULL == convertor) ||
+                (size != convert_range( convertor, 0, packed, size, parallel_fragment_sizes[f], 1 )) ||
+                (0 != memcmp( packed, packed_ref, size )) ) {
+                printf( "%s: %s parallel pack mismatch with fragments of %lu bytes\n",
+                        name, compiled ? "compiled" : "generic", (unsigned long)parallel_fragment_sizes[f] );
+                errors++;
+            }
+            if( NULL != convertor ) OBJ_RELEASE(convertor);
+
+            memset( unpacked, 0, span );
+            convertor = create_convertor( datatype, count, unpacked - true_lb, 0, compiled );
+            if( (NULL == convertor) ||
+                (size != convert_range( convertor, 0, packed_ref, size, parallel_fragment_sizes[f], 0 )) ||
+                (0 != memcmp( unpacked, unpacked_ref, span )) ) {
+                printf( "%s: %s parallel unpack mismatch with fragments of %lu bytes\n",
+                        name, compiled ? "compiled" : "generic", (unsigned long)parallel_fragment_sizes[f] );
+                errors++;
+            }
+            if( NULL != convertor ) OBJ_RELEASE(convertor);
+        }
+    }
+    if( 0 != set_pack_threads( 0, 0 ) ) {
+        printf( "%s: unable to reset mpi_ddt_pack_threads\n", name );
+        errors++;
+        goto cleanup;
+    }
+
+    /* restart from positions inside blocks and loops */
+    for( position = 1; position < size; position += POSITION_STEP ) {
+        length = size - position;
+
+        conv_compiled = create_convertor( datatype, count, user - true_lb, 1, 1 );
+        conv_generic  = create_convertor( datatype, count, user - true_lb, 1, 0 );
+        if( (NULL == conv_compiled) || (NULL == conv_generic) ) {
+            errors++;
+            goto cleanup;
+        }
+        memset( packed, 0, size );
+        if( (length != convert_range( conv_compiled, position, packed, length, 13, 1 )) ||
+            (0 != memcmp( packed, packed_ref + position, length )) ) {
+            printf( "%s: compiled pack mismatch from position %lu\n", name, (unsigned long)position );
+            errors++;
+        }
+        memset( packed, 0, size );
+        if( (length != convert_range( conv_generic, position, packed, length, 13, 1 )) ||
+            (0 != memcmp( packed, packed_ref + position, length )) ) {
+            printf( "%s: generic pack mismatch from position %lu\n", name, (unsigned long)position );
+            errors++;
+        }
+        OBJ_RELEASE(conv_compiled);
+        OBJ_RELEASE(conv_generic);
+
+        /* both have to write exactly the same bytes of the user buffer */
+        length = (length < 113) ? length : 113;
+        memset( unpacked_ref, 0, span );
+        memset( unpacked, 0, span );
+        conv_compiled = create_convertor( datatype, count, unpacked - true_lb, 0, 1 );
+        conv_generic  = create_convertor( datatype, count, unpacked_ref - true_lb, 0, 0 );
+        if( (NULL == conv_compiled) || (NULL == conv_generic) ) {
+            errors++;
+            goto cleanup;
+        }
+        if( (length != convert_range( conv_compiled, position, packed_ref + position, length, 13, 0 )) ||
+            (length != convert_range( conv_generic, position, packed_ref + position, length, 13, 0 )) ||
+            (0 != memcmp( unpacked, unpacked_ref, span )) ) {
+            printf( "%s: unpack mismatch from position %lu\n", name, (unsigned long)position );
+            errors++;
+        }
+        OBJ_RELEASE(conv_compiled);
+        OBJ_RELEASE(conv_generic);
+    }
+
+ cleanup:
+    (void)set_pack_threads( 0, 0 );
+    if( NULL != conv_compiled ) OBJ_RELEASE(conv_compiled);
+    if( NULL != conv_generic ) OBJ_RELEASE(conv_generic);
+    free( user ); free( unpacked_ref ); free( unpacked );
+    free( packed_ref ); free( packed );
+
+    printf( "%s (count %d, %lu bytes): %d errors\n", name, count, (unsigned long)size, errors );
+    return errors;
+}
+
+int main( int argc, char* argv[] )
+{
+    ompi_datatype_t *vector, *vector_dbl, *indexed, *structure, *subarray, *hvector, *column;
+    int blens[4] = { 1, 3, 2, 5 }, disps[4] = { 0, 4, 12, 20 };
+    int cblens[3] = { 1, 2, 1 }, cdisps[3] = { 0, 3, 7 };
+    int sizes[3] = { 6, 7, 8 }, subsizes[3] = { 3, 4, 5 }, starts[3] = { 1, 2, 2 };
+    int sblens[3] = { 2, 1, 3 };
+    ptrdiff_t sdisps[3] = { 0, 16, 24 };
+    ompi_datatype_t* stypes[3] = { &ompi_mpi_int.dt, &ompi_mpi_double.dt, &ompi_mpi_char.dt };
+    int errors = 0;
+
+    opal_init_util (NULL, NULL);
+    ompi_datatype_init();
+
+    ompi_datatype_create_vector( 7, 3, 5, &ompi_mpi_int.dt, &vector );
+    ompi_datatype_commit( &vector );
+    ompi_datatype_create_vector( 33, 1, 3, &ompi_mpi_double.dt, &vector_dbl );
+    ompi_datatype_commit( &vector_dbl );
+    ompi_datatype_create_indexed( 4, blens, disps, &ompi_mpi_double.dt, &indexed );
+    ompi_datatype_commit( &indexed );
+    ompi_datatype_create_struct( 3, sblens, sdisps, stypes, &structure );
+    ompi_datatype_commit( &structure );
+    ompi_datatype_create_subarray( 3, sizes, subsizes, starts, MPI_ORDER_C,
+                                   &ompi_mpi_float.dt, &subarray );
+    ompi_datatype_commit( &subarray );
+    /* a loop whose body is not a single strided operation gets unrolled */
+    ompi_datatype_create_indexed( 3, cblens, cdisps, &ompi_mpi_short.dt, &column );
+    ompi_datatype_create_hvector( 4, 1, 64, column, &hvector );
+    ompi_datatype_commit( &hvector );
+
+    /* large enough for the parallel conversions to be split between all the threads */
+    errors += check_datatype( "vector", vector, 100 );
+    errors += check_datatype( "vector of doubles", vector_dbl, 50 );
+    errors += check_datatype( "indexed", indexed, 200 );
+    errors += check_datatype( "struct", structure, 500 );
+    errors += check_datatype( "subarray", subarray, 40 );
+    errors += check_datatype( "hvector of indexed", hvector, 300 );
+
+    ompi_datatype_destroy( &vector );
+    ompi_datatype_destroy( &vector_dbl );
+    ompi_datatype_destroy( &indexed );
+    ompi_datatype_destroy( &structure );
+    ompi_datatype_destroy( &subarray );
+    ompi_datatype_destroy( &column );
+    ompi_datatype_destroy( &hvector );
+
+    ompi_datatype_finalize();
+    opal_finalize_util ();
+
+    return (0 == errors ? 0 : -1);
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2020 The University of Tennessee and The University
+ *                    of Tennessee Research Foundation.  All rights
+ *                    reserved.
+ *
+ * Check the independent reads and writes of ompio through its page
+ * cache (io_ompio_cache_size > 0).
+ *
+ * 1. Read after write: every process writes its own part of the file
+ *    in small unaligned pieces, reads them back before any sync,
+ *    overwrites some of them, with small and with page sized writes,
+ *    and reads again. After sync, barrier, sync, the next process
+ *    checks the part.
+ * 2. Strided writes: the processes own every size-th piece of a few
+ *    bytes of the same pages, and write them with a strided view, then
+ *    one piece at a time. After sync, barrier, sync, every process
+ *    checks all the pieces, i.e. that no cache wrote the bytes of the
+ *    other processes back.
+ * 3. Reads past the end of the file return the bytes up to the end.
+ * 4. MPI_File_set_size truncates the file in the middle of pages that
+ *    are cached, and the truncated bytes do not come back, even after a
+ *    write beyond the new end.
+ *
+ * The cache parameters are chosen on the command line, see
+ * cache_check.sh, e.g.:
+ *   mpirun -np 4 --mca io ompio --mca io_ompio_cache_size 262144 ./cache_check
+ */
+
+#include "mpi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_FILENAME   "cache_check.out"
+#define PART_SIZE          (3 * 65536 + 123)   /* part of each process in step 1 */
+#define PIECE              100
+#define STRIDED_PIECE      24
+#define STRIDED_PIECES     1000
+
+static char value_of(MPI_Offset offset, int version)
+{
+    return (char)((offset * 7 + version * 13 + 3) % 251);
+}
+
+static void fill(char *buf, MPI_Offset offset, size_t len, int version)
+{
+    size_t i;
+
+    for(i = 0; i < len; i++) {
+        buf[i] = value_of(offset + i, version);
+    }
+}
+
+/* check buf, read at offset, against the versions of the bytes */
+static int check(const char *what, const char *buf, MPI_Offset offset, size_t len,
+                 const int *versions, int rank)
+{
+    size_t i;
+
+    for(i = 0; i < len; i++) {
+        if(value_of(offset + i, versions[i]) != buf[i]) {
+            fprintf(stderr, "[%d] %s: wrong value at offset %lld\n",
+                    rank, what, (long long)(offset + i));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_read(MPI_File fh, const char *what, MPI_Offset offset, size_t len,
+                      const int *versions, int rank)
+{
+    char *buf = (char*)malloc(len);
+    int errors;
+
+    if(MPI_SUCCESS != MPI_File_read_at(fh, offset, buf, (int)len, MPI_BYTE, MPI_STATUS_IGNORE)) {
+        fprintf(stderr, "[%d] %s: MPI_File_read_at failed\n", rank, what);
+        free(buf);
+        return 1;
+    }
+    errors = check(what, buf, offset, len, versions, rank);
+    free(buf);
+    return errors;
+}
+
+static int sync_all(MPI_File fh)
+{
+    int rc = MPI_File_sync(fh);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if(MPI_SUCCESS == rc) {
+        rc = MPI_File_sync(fh);
+    }
+    return (MPI_SUCCESS != rc);
+}
+
+static int check_read_after_write(MPI_File fh, int rank, int size)
+{
+    MPI_Offset part = (MPI_Offset)rank * PART_SIZE, offset;
+    int *versions = (int*)calloc(PART_SIZE, sizeof(int));
+    char *buf = (char*)malloc(PART_SIZE);
+    int i, errors = 0, next = (rank + 1) % size;
+    size_t len;
+
+    /* small writes, each one read back at once */
+    for(offset = 0; offset < PART_SIZE && 0 == errors; offset += PIECE) {
+        len = (PART_SIZE - offset < PIECE) ? PART_SIZE - offset : PIECE;
+        fill(buf, part + offset, len, 0);
+        MPI_File_write_at(fh, part + offset, buf, (int)len, MPI_BYTE, MPI_STATUS_IGNORE);
+        errors += check_read(fh, "read after write", part + offset, len, versions + offset, rank);
+    }
+    errors += check_read(fh, "read after write, all pieces", part, PART_SIZE, versions, rank);
+
+    /* overwrite small pieces across page boundaries, then a page sized one */
+    for(offset = 4000; offset + 137 < PART_SIZE; offset += 8192) {
+        fill(buf, part + offset, 137, 1);
+        MPI_File_write_at(fh, part + offset, buf, 137, MPI_BYTE, MPI_STATUS_IGNORE);
+        for(i = 0; i < 137; i++) {
+            versions[offset + i] = 1;
+        }
+    }
+    offset = 65536 + 1000;
+    len = 65536 + 3000;
+    fill(buf, part + offset, len, 2);
+    MPI_File_write_at(fh, part + offset, buf, (int)len, MPI_BYTE, MPI_STATUS_IGNORE);
+    for(i = 0; i < (int)len; i++) {
+        versions[offset + i] = 2;
+    }
+    for(offset = 0; offset < PART_SIZE; offset += 5000) {
+        len = (PART_SIZE - offset < 5000) ? PART_SIZE - offset : 5000;
+        errors += check_read(fh, "read after overwrite", part + offset, len, versions + offset, rank);
+    }
+
+    /* the next process sees the same content */
+    errors += sync_all(fh);
+    errors += check_read(fh, "read by another process", (MPI_Offset)next * PART_SIZE, PART_SIZE,
+                         versions, rank);
+
+    free(versions);
+    free(buf);
+    return errors;
+}
+
+static int check_strided_writes(MPI_File fh, MPI_Offset start, int rank, int size)
+{
+    int *versions = (int*)malloc(STRIDED_PIECES * STRIDED_PIECE * sizeof(int));
+    int count = 0, i, errors = 0;
+    MPI_Datatype filetype;
+    char *buf;
+
+    buf = (char*)malloc(STRIDED_PIECES * STRIDED_PIECE);
+    for(i = rank; i < STRIDED_PIECES; i += size) {
+        fill(buf + count * STRIDED_PIECE, start + (MPI_Offset)i * STRIDED_PIECE, STRIDED_PIECE, 0);
+        count++;
+    }
+
+    /* all pieces of the process at once, through a strided view */
+    MPI_Type_vector(count, STRIDED_PIECE, STRIDED_PIECE * size, MPI_BYTE, &filetype);
+    MPI_Type_commit(&filetype);
+    MPI_File_set_view(fh, start + (MPI_Offset)rank * STRIDED_PIECE, MPI_BYTE, filetype,
+                      "native", MPI_INFO_NULL);
+    MPI_File_write_at(fh, 0, buf, count * STRIDED_PIECE, MPI_BYTE, MPI_STATUS_IGNORE);
+    MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+    MPI_Type_free(&filetype);
+    for(i = 0; i < STRIDED_PIECES * STRIDED_PIECE; i++) {
+        versions[i] = 0;
+    }
+    errors += sync_all(fh);
+    errors += check_read(fh, "strided view writes", start, STRIDED_PIECES * STRIDED_PIECE,
+                         versions, rank);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    /* and again, one piece at a time, in reverse order */
+    for(i = STRIDED_PIECES - 1 - (STRIDED_PIECES - 1 - rank) % size; i >= 0; i -= size) {
+        MPI_Offset offset = start + (MPI_Offset)i * STRIDED_PIECE;
+
+        fill(buf, offset, STRIDED_PIECE, 3);
+        MPI_File_write_at(fh, offset, buf, STRIDED_PIECE, MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+    for(i = 0; i < STRIDED_PIECES * STRIDED_PIECE; i++) {
+        versions[i] = 3;
+    }
+    errors += sync_all(fh);
+    errors += check_read(fh, "strided piece writes", start, STRIDED_PIECES * STRIDED_PIECE,
+                         versions, rank);
+
+    free(versions);
+    free(buf);
+    return errors;
+}
+
+/* read count bytes at offset, expect the bytes up to end */
+static int check_eof(MPI_File fh, const char *what, MPI_Offset offset, int count,
+                     MPI_Offset end, const int *versions, int rank)
+{
+    char *buf = (char*)malloc(count);
+    int received, expected, errors = 0;
+    MPI_Status status;
+
+    expected = (offset >= end) ? 0 : (int)((end - offset < count) ? end - offset : count);
+    if(MPI_SUCCESS != MPI_File_read_at(fh, offset, buf, count, MPI_BYTE, &status)) {
+        fprintf(stderr, "[%d] %s: MPI_File_read_at failed\n", rank, what);
+        errors = 1;
+    } else {
+        MPI_Get_count(&status, MPI_BYTE, &received);
+        if(expected != received) {
+            fprintf(stderr, "[%d] %s: %d bytes read at %lld, %d expected\n",
+                    rank, what, received, (long long)offset, expected);
+            errors = 1;
+        } else {
+            errors = check(what, buf, offset, expected, versions, rank);
+        }
+    }
+    free(buf);
+    return errors;
+}
+
+static int check_end_of_file(MPI_File fh, MPI_Offset end, int version, int rank)
+{
+    int versions[1000], i, errors = 0;
+
+    for(i = 0; i < 1000; i++) {
+        versions[i] = version;
+    }
+    /* the first read caches the last page of the file */
+    errors += check_eof(fh, "read before the end", end - 200, 100, end, versions, rank);
+    errors += check_eof(fh, "read across the end", end - 10, 100, end, versions, rank);
+    errors += check_eof(fh, "read at the end", end, 100, end, versions, rank);
+    errors += check_eof(fh, "read past the end", end + 1000, 100, end, versions, rank);
+    return errors;
+}
+
+static int check_truncation(MPI_File fh, MPI_Offset end, int rank)
+{
+    MPI_Offset new_end = end - 5000 - 77, size;
+    int versions[1000], i, errors = 0;
+    char buf[100];
+
+    for(i = 0; i < 1000; i++) {
+        versions[i] = 3;
+    }
+    /* cache the pages on both sides of the new end */
+    errors += check_eof(fh, "read before truncation", new_end - 50, 100, end, versions, rank);
+    errors += check_eof(fh, "read before truncation", end - 100, 100, end, versions, rank);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    MPI_File_set_size(fh, new_end);
+    MPI_File_get_size(fh, &size);
+    if(new_end != size) {
+        fprintf(stderr, "[%d] size %lld after truncation to %lld\n",
+                rank, (long long)size, (long long)new_end);
+        errors++;
+    }
+    errors += check_end_of_file(fh, new_end, 3, rank);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    /* extend the file again: the bytes in between read as zeros */
+    if(0 == rank) {
+        fill(buf, new_end + 50, 50, 4);
+        MPI_File_write_at(fh, new_end + 50, buf, 50, MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+    errors += sync_all(fh);
+    if(MPI_SUCCESS != MPI_File_read_at(fh, new_end, buf, 100, MPI_BYTE, MPI_STATUS_IGNORE)) {
+        errors++;
+    }
+    for(i = 0; i < 50; i++) {
+        if(0 != buf[i]) {
+            fprintf(stderr, "[%d] truncated byte at offset %lld came back\n",
+                    rank, (long long)(new_end + i));
+            errors++;
+            break;
+        }
+    }
+    for(i = 0; i < 50; i++) {
+        versions[i] = 4;
+    }
+    errors += check("write after truncation", buf + 50, new_end + 50, 50, versions, rank);
+
+    return errors;
+}
+
+int main(int argc, char* argv[])
+{
+    const char *filename = DEFAULT_FILENAME;
+    int rank, size, opt, errors = 0, total;
+    MPI_Offset strided, end;
+    MPI_File fh;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    while(-1 != (opt = getopt(argc, argv, "f:"))) {
+        switch(opt) {
+        case 'f': filename = optarg; break;
+        default:
+            if(0 == rank)
+                fprintf(stderr, "Usage: %s [-f file]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    if(0 == rank) {
+        MPI_File_delete((char*)filename, MPI_INFO_NULL);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if(MPI_SUCCESS != MPI_File_open(MPI_COMM_WORLD, (char*)filename,
+                                    MPI_MODE_CREATE | MPI_MODE_RDWR, MPI_INFO_NULL, &fh)) {
+        if(0 == rank) {
+            fprintf(stderr, "MPI_File_open failed\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    errors += check_read_after_write(fh, rank, size);
+
+    /* the strided pieces end the file, not on a page boundary */
+    strided = (MPI_Offset)size * PART_SIZE + 17;
+    errors += check_strided_writes(fh, strided, rank, size);
+    end = strided + STRIDED_PIECES * STRIDED_PIECE;
+
+    errors += check_end_of_file(fh, end, 3, rank);
+    MPI_Barrier(MPI_COMM_WORLD);
+    errors += check_truncation(fh, end, rank);
+
+    MPI_File_close(&fh);
+
+    MPI_Allreduce(&errors, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if(0 == rank) {
+        MPI_File_delete((char*)filename, MPI_INFO_NULL);
+        printf("%s\n", (0 == total) ? "OK" : "FAILED");
+    }
+
+    MPI_Finalize();
+    return (0 == total) ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+
+#
+# Copyright (c) 2020 The University of Tennessee and The University
+#                    of Tennessee Research Foundation.  All rights
+#                    reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+#
+# Run cache_check with the page cache of ompio, with small pages and
+# many of them, and with a few large pages, without and with read-ahead.
+# Extra arguments are passed to mpiexec, e.g. a machine file.
+#
+
+np=${NP:-4}
+exe=./cache_check
+
+for page in 4096 65536; do
+    for readahead in 0 4; do
+        echo "io_ompio_cache_size=262144 io_ompio_cache_page_size=$page io_ompio_cache_readahead=$readahead"
+        mpiexec -n $np "$@" --mca io ompio \
+                --mca io_ompio_cache_size 262144 \
+                --mca io_ompio_cache_page_size $page \
+                --mca io_ompio_cache_readahead $readahead $exe || exit 1
+    done
+done
@@ -0,0 +1,34 @@
+#!/bin/sh
+
+#
+# Copyright (c) 2020 The University of Tennessee and The University
+#                    of Tennessee Research Foundation.  All rights
+#                    reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+#
+# Run write_all_check with the io_uring backend of fbtl/posix, through
+# the asynchronous writes of the vulcan collective write with one and
+# several writes outstanding per aggregator, with and without O_DIRECT.
+# The 4 KB blocks keep most of the writes aligned for O_DIRECT. Extra
+# arguments are passed to mpiexec, e.g. a machine file.
+#
+
+np=${NP:-4}
+exe=./write_all_check
+
+for direct in 0 1; do
+    for depth in 1 3; do
+        echo "fbtl_posix_backend=io_uring fbtl_posix_uring_direct=$direct fcoll_vulcan_pipeline_depth=$depth"
+        mpiexec -n $np "$@" --mca io ompio --mca fbtl posix --mca fcoll vulcan \
+                --mca fbtl_posix_backend io_uring \
+                --mca fbtl_posix_uring_direct $direct \
+                --mca fcoll_vulcan_pipeline_depth $depth \
+                --mca fcoll_vulcan_async_io 1 $exe -l 1024 || exit 1
+    done
+done
@@ -0,0 +1,43 @@
+#!/bin/sh
+
+#
+# Copyright (c) 2020 The University of Tennessee and The University
+#                    of Tennessee Research Foundation.  All rights
+#                    reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+#
+# Run write_all_check through the vulcan collective write without
+# (the default) and with the node-local pre-aggregation of the data,
+# for block sizes that do and do not line up with the cycles, with
+# blocks and with single integers interleaved between the processes.
+# Then again with a shared memory segment too small for the data of
+# the node, which falls back to the regular path. Run it with several
+# processes per node. Extra arguments are passed to mpiexec, e.g. a
+# machine file.
+#
+
+np=${NP:-4}
+exe=./write_all_check
+
+for aggr in 0 1; do
+    for view in "" "-i"; do
+        for blocklen in 1000 333; do
+            echo "io_ompio_node_aggregation=$aggr blocklen=$blocklen $view"
+            mpiexec -n $np "$@" --mca io ompio --mca fcoll vulcan \
+                    --mca io_ompio_node_aggregation $aggr $exe -l $blocklen $view || exit 1
+        done
+    done
+done
+
+for view in "" "-i"; do
+    echo "io_ompio_node_aggregation=1 io_ompio_node_aggregation_max_segment=65536 $view"
+    mpiexec -n $np "$@" --mca io ompio --mca fcoll vulcan \
+            --mca io_ompio_node_aggregation 1 \
+            --mca io_ompio_node_aggregation_max_segment 65536 $exe $view || exit 1
+done
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2020 The University of Tennessee and The University
+ *                    of Tennessee Research Foundation.  All rights
+ *                    reserved.
+ *
+ * Check the offsets given by the shared file pointer.
+ *
+ * Every process appends 'count' records with MPI_File_write_shared, of
+ * a size that depends on the process. A record starts with the rank,
+ * the record number and the payload length, so rank 0 can walk the file
+ * once it is complete: every record has to be present once, without
+ * overlaps nor holes, and the records of a process in order. Then each
+ * process writes one more record with MPI_File_write_ordered, and these
+ * have to follow in rank order, and be read back in the same order by
+ * MPI_File_read_ordered.
+ *
+ * The sharedfp component and its parameters are chosen on the command
+ * line, see sharedfp_check.sh, e.g.:
+ *   mpirun -np 4 --mca io ompio --mca sharedfp atomic ./sharedfp_check
+ */
+
+#include "mpi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_FILENAME   "sharedfp_check.out"
+#define DEFAULT_COUNT      100
+#define HEADER             3
+
+static int payload_of(int rank)
+{
+    return 8 * (rank + 1) + 3;
+}
+
+static size_t record_size(int rank)
+{
+    return HEADER * sizeof(int) + payload_of(rank);
+}
+
+static void make_record(char *rec, int rank, int number)
+{
+    int header[HEADER] = { rank, number, payload_of(rank) }, j;
+
+    memcpy(rec, header, sizeof(header));
+    for(j = 0; j < payload_of(rank); j++) {
+        rec[sizeof(header) + j] = (char)(rank * 31 + number + j);
+    }
+}
+
+/* check the record at pos, return its size or 0 if it is not valid */
+static size_t check_record(const char *pos, size_t left, int size)
+{
+    int header[HEADER], j;
+
+    if(left < sizeof(header)) {
+        return 0;
+    }
+    memcpy(header, pos, sizeof(header));
+    if(header[0] < 0 || header[0] >= size || payload_of(header[0]) != header[2] ||
+       left < record_size(header[0])) {
+        return 0;
+    }
+    for(j = 0; j < header[2]; j++) {
+        if((char)(header[0] * 31 + header[1] + j) != pos[sizeof(header) + j]) {
+            return 0;
+        }
+    }
+    return record_size(header[0]);
+}
+
+/* rank 0 walks the records of the whole file */
+static int check_file(MPI_File fh, int count, int size)
+{
+    MPI_Offset file_size, shared_end = 0, offset;
+    int *next = (int*)calloc(size, sizeof(int));
+    int header[HEADER], r, ordered = 0, errors = 0;
+    size_t rec;
+    char *buf;
+
+    for(r = 0; r < size; r++) {
+        shared_end += (MPI_Offset)count * record_size(r);
+    }
+    MPI_File_get_size(fh, &file_size);
+    buf = (char*)malloc(file_size);
+    MPI_File_read_at(fh, 0, buf, (int)file_size, MPI_BYTE, MPI_STATUS_IGNORE);
+
+    for(offset = 0; offset < file_size && 0 == errors; offset += rec) {
+        rec = check_record(buf + offset, file_size - offset, size);
+        if(0 == rec) {
+            fprintf(stderr, "no valid record at offset %lld\n", (long long)offset);
+            errors = 1;
+            break;
+        }
+        memcpy(header, buf + offset, sizeof(header));
+        if(offset < shared_end) {
+            /* MPI_File_write_shared: the records of a process in order */
+            if(header[1] != next[header[0]]) {
+                fprintf(stderr, "record %d of rank %d at offset %lld, record %d expected\n",
+                        header[1], header[0], (long long)offset, next[header[0]]);
+                errors = 1;
+            }
+            next[header[0]]++;
+        } else {
+            /* MPI_File_write_ordered: one record per process in rank order */
+            if(header[0] != ordered || count != header[1]) {
+                fprintf(stderr, "ordered record of rank %d at offset %lld, rank %d expected\n",
+                        header[0], (long long)offset, ordered);
+                errors = 1;
+            }
+            ordered++;
+        }
+    }
+    if(0 == errors && (offset != file_size || ordered != size)) {
+        fprintf(stderr, "%lld bytes of records, %d ordered records, in a file of %lld bytes\n",
+                (long long)offset, ordered, (long long)file_size);
+        errors = 1;
+    }
+    for(r = 0; r < size && 0 == errors; r++) {
+        if(count != next[r]) {
+            fprintf(stderr, "%d records of rank %d, %d expected\n", next[r], r, count);
+            errors = 1;
+        }
+    }
+
+    free(next);
+    free(buf);
+    return errors;
+}
+
+int main(int argc, char* argv[])
+{
+    const char *filename = DEFAULT_FILENAME;
+    int rank, size, opt, count = DEFAULT_COUNT, i, errors = 0, total;
+    MPI_Offset shared_end = 0, position;
+    MPI_File fh;
+    char *rec, *back;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    while(-1 != (opt = getopt(argc, argv, "f:n:"))) {
+        switch(opt) {
+        case 'f': filename = optarg; break;
+        case 'n': count = atoi(optarg); break;
+        default:
+            if(0 == rank)
+                fprintf(stderr, "Usage: %s [-f file] [-n records]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    if(0 == rank) {
+        MPI_File_delete((char*)filename, MPI_INFO_NULL);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if(MPI_SUCCESS != MPI_File_open(MPI_COMM_WORLD, (char*)filename,
+                                    MPI_MODE_CREATE | MPI_MODE_RDWR, MPI_INFO_NULL, &fh)) {
+        if(0 == rank) {
+            fprintf(stderr, "MPI_File_open failed\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    rec = (char*)malloc(record_size(rank));
+    back = (char*)malloc(record_size(rank));
+    for(i = 0; i < size; i++) {
+        shared_end += (MPI_Offset)count * record_size(i);
+    }
+
+    /* all processes append concurrently */
+    for(i = 0; i < count && 0 == errors; i++) {
+        make_record(rec, rank, i);
+        if(MPI_SUCCESS != MPI_File_write_shared(fh, rec, (int)record_size(rank), MPI_BYTE,
+                                                MPI_STATUS_IGNORE)) {
+            fprintf(stderr, "[%d] MPI_File_write_shared failed\n", rank);
+            errors = 1;
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_File_get_position_shared(fh, &position);
+    if(shared_end != position) {
+        fprintf(stderr, "[%d] shared file pointer at %lld after MPI_File_write_shared, %lld expected\n",
+                rank, (long long)position, (long long)shared_end);
+        errors = 1;
+    }
+
+    /* then one record each, in rank order */
+    make_record(rec, rank, count);
+    if(MPI_SUCCESS != MPI_File_write_ordered(fh, rec, (int)record_size(rank), MPI_BYTE,
+                                             MPI_STATUS_IGNORE)) {
+        fprintf(stderr, "[%d] MPI_File_write_ordered failed\n", rank);
+        errors = 1;
+    }
+    MPI_File_sync(fh);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_File_sync(fh);
+
+    if(0 == rank) {
+        errors += check_file(fh, count, size);
+    }
+
+    /* every process reads its own ordered record back */
+    MPI_File_seek_shared(fh, shared_end, MPI_SEEK_SET);
+    if(MPI_SUCCESS != MPI_File_read_ordered(fh, back, (int)record_size(rank), MPI_BYTE,
+                                            MPI_STATUS_IGNORE) ||
+       0 != memcmp(rec, back, record_size(rank))) {
+        fprintf(stderr, "[%d] MPI_File_read_ordered did not return the ordered record\n", rank);
+        errors = 1;
+    }
+
+    MPI_File_close(&fh);
+    free(rec);
+    free(back);
+
+    MPI_Allreduce(&errors, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if(0 == rank) {
+        MPI_File_delete((char*)filename, MPI_INFO_NULL);
+        printf("%s\n", (0 == total) ? "OK" : "FAILED");
+    }
+
+    MPI_Finalize();
+    return (0 == total) ? 0 : 1;
+}
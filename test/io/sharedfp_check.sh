@@ -0,0 +1,35 @@
+#!/bin/sh
+
+#
+# Copyright (c) 2020 The University of Tennessee and The University
+#                    of Tennessee Research Foundation.  All rights
+#                    reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+#
+# Run sharedfp_check with the atomic sharedfp component, with the shared
+# file pointer in a shared memory segment (the default on a single node)
+# and in an MPI window of rank 0 (the path of multi-node groups), then
+# with the lockedfile component for reference. On several nodes, the
+# atomic component has to be given a priority with
+# sharedfp_atomic_multinode_priority. Extra arguments are passed to
+# mpiexec, e.g. a machine file.
+#
+
+np=${NP:-4}
+exe=./sharedfp_check
+
+for window in 0 1; do
+    echo "sharedfp atomic, sharedfp_atomic_window=$window"
+    mpiexec -n $np "$@" --mca io ompio --mca sharedfp atomic \
+            --mca sharedfp_atomic_multinode_priority 50 \
+            --mca sharedfp_atomic_window $window $exe || exit 1
+done
+
+echo "sharedfp lockedfile"
+mpiexec -n $np "$@" --mca io ompio --mca sharedfp lockedfile $exe || exit 1
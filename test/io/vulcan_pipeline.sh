@@ -0,0 +1,32 @@
+#!/bin/sh
+
+#
+# Copyright (c) 2020 The University of Tennessee and The University
+#                    of Tennessee Research Foundation.  All rights
+#                    reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+#
+# Run write_all_check through the vulcan collective write with a
+# pipeline depth of 1 (exchange and write serialised), 2 (the default)
+# and 3 (several non-blocking writes outstanding per aggregator), with
+# asynchronous and then synchronous writes. Extra arguments are passed
+# to mpiexec, e.g. a machine file.
+#
+
+np=${NP:-4}
+exe=./write_all_check
+
+for async in 1 2; do
+    for depth in 1 2 3; do
+        echo "fcoll_vulcan_pipeline_depth=$depth fcoll_vulcan_async_io=$async"
+        mpiexec -n $np "$@" --mca io ompio --mca fcoll vulcan \
+                --mca fcoll_vulcan_pipeline_depth $depth \
+                --mca fcoll_vulcan_async_io $async $exe || exit 1
+    done
+done
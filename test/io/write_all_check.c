@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020 The University of Tennessee and The University
+ *                    of Tennessee Research Foundation.  All rights
+ *                    reserved.
+ *
+ * Check the file contents produced by MPI_File_write_all with an
+ * interleaved view.
+ *
+ * Each process owns every size-th block of 'blocklen' integers of the
+ * file, and writes them all at once through a vector file type. With
+ * -i the processes own every size-th integer instead, so that the view
+ * of each process is fully non-contiguous and interleaved with the
+ * others. The value of each integer is its index in the file. A small collective
+ * buffer (cb_buffer_size) makes the collective I/O component go
+ * through many cycles. Once the file is closed, every process reads
+ * back a contiguous part of it with independent reads and checks it.
+ *
+ * The fcoll and fbtl components and their parameters are chosen on the
+ * command line, see vulcan_pipeline.sh, node_aggregation.sh and
+ * fbtl_uring.sh, e.g.:
+ *   mpirun -np 4 --mca fcoll vulcan --mca fcoll_vulcan_pipeline_depth 3 ./write_all_check
+ */
+
+#include "mpi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define DEFAULT_FILENAME   "write_all_check.out"
+#define DEFAULT_BLOCKLEN   1000
+#define DEFAULT_BLOCKS     64
+#define DEFAULT_CB_SIZE    "65536"
+
+static int write_file(const char *filename, int blocklen, int blocks, int interleaved,
+                      const char *cb_size, int rank, int size)
+{
+    MPI_Offset disp;
+    MPI_Datatype filetype;
+    MPI_File fh;
+    MPI_Info info;
+    int *buf, i, j, rc;
+
+    buf = (int*)malloc((size_t)blocklen * blocks * sizeof(int));
+    for(i = 0; i < blocks; i++) {
+        for(j = 0; j < blocklen; j++) {
+            buf[i * blocklen + j] = interleaved ? (i * blocklen + j) * size + rank
+                                                : (i * size + rank) * blocklen + j;
+        }
+    }
+
+    if(interleaved) {
+        MPI_Type_vector(blocks * blocklen, 1, size, MPI_INT, &filetype);
+        disp = (MPI_Offset)rank * sizeof(int);
+    } else {
+        MPI_Type_vector(blocks, blocklen, blocklen * size, MPI_INT, &filetype);
+        disp = (MPI_Offset)rank * blocklen * sizeof(int);
+    }
+    MPI_Type_commit(&filetype);
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "cb_buffer_size", (char*)cb_size);
+
+    rc = MPI_File_open(MPI_COMM_WORLD, (char*)filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                       info, &fh);
+    if(MPI_SUCCESS == rc) {
+        rc = MPI_File_set_view(fh, disp, MPI_INT, filetype, "native", info);
+        if(MPI_SUCCESS == rc) {
+            rc = MPI_File_write_all(fh, buf, blocklen * blocks, MPI_INT, MPI_STATUS_IGNORE);
+        }
+        MPI_File_close(&fh);
+    }
+
+    MPI_Info_free(&info);
+    MPI_Type_free(&filetype);
+    free(buf);
+    return rc;
+}
+
+static int check_file(const char *filename, int count, int rank, int size)
+{
+    MPI_Offset start, len;
+    MPI_File fh;
+    int *buf, i, errors = 0;
+
+    /* a contiguous share of the file, not the one the process wrote */
+    len = count / size;
+    start = ((rank + 1) % size) * len;
+    if(size - 1 == (rank + 1) % size) {
+        len = count - start;
+    }
+
+    buf = (int*)malloc((len + 1) * sizeof(int));
+    if(MPI_SUCCESS != MPI_File_open(MPI_COMM_WORLD, (char*)filename, MPI_MODE_RDONLY,
+                                    MPI_INFO_NULL, &fh)) {
+        free(buf);
+        return 1;
+    }
+    if(MPI_SUCCESS != MPI_File_read_at(fh, start * sizeof(int), buf, (int)len, MPI_INT,
+                                       MPI_STATUS_IGNORE)) {
+        errors = 1;
+    }
+    for(i = 0; 0 == errors && i < len; i++) {
+        if(buf[i] != start + i) {
+            fprintf(stderr, "[%d] wrong value at index %lld: %d\n",
+                    rank, (long long)(start + i), buf[i]);
+            errors = 1;
+        }
+    }
+    MPI_File_close(&fh);
+    free(buf);
+    return errors;
+}
+
+int main(int argc, char* argv[])
+{
+    const char *filename = DEFAULT_FILENAME, *cb_size = DEFAULT_CB_SIZE;
+    int rank, size, opt, blocklen = DEFAULT_BLOCKLEN, blocks = DEFAULT_BLOCKS;
+    int interleaved = 0, rc, errors, total;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    while(-1 != (opt = getopt(argc, argv, "f:l:n:c:i"))) {
+        switch(opt) {
+        case 'f': filename = optarg; break;
+        case 'l': blocklen = atoi(optarg); break;
+        case 'n': blocks = atoi(optarg); break;
+        case 'c': cb_size = optarg; break;
+        case 'i': interleaved = 1; break;
+        default:
+            if(0 == rank)
+                fprintf(stderr, "Usage: %s [-f file] [-l blocklen] [-n blocks] [-c cb_buffer_size] [-i]\n",
+                        argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    if(0 == rank) {
+        MPI_File_delete((char*)filename, MPI_INFO_NULL);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    rc = write_file(filename, blocklen, blocks, interleaved, cb_size, rank, size);
+    errors = (MPI_SUCCESS != rc);
+    MPI_Allreduce(&errors, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if(0 == total) {
+        errors = check_file(filename, blocklen * blocks * size, rank, size);
+        MPI_Allreduce(&errors, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    } else if(0 == rank) {
+        fprintf(stderr, "MPI_File_write_all failed\n");
+    }
+
+    if(0 == rank) {
+        MPI_File_delete((char*)filename, MPI_INFO_NULL);
+        printf("%s\n", (0 == total) ? "OK" : "FAILED");
+    }
+
+    MPI_Finalize();
+    return (0 == total) ? 0 : 1;
+}
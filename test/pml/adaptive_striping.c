@@ -0,0 +1,155 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2020      The University of Tennessee and The University
+ *                         of Tennessee Research Foundation.  All rights
+ *                         reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include "ompi_config.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "ompi/mca/bml/bml.h"
+#include "opal/runtime/opal.h"
+
+/**
+ * Check that the adaptive striping of ob1 follows the rails that are
+ * actually faster, not the ones advertised as such.
+ *
+ * Two rails are simulated in real time: each completes its fragments
+ * in order, at a fixed rate. ob1 hands every fragment to the rail with
+ * the smallest mca_bml_base_btl_completion_time(), and reports the
+ * sends and completions to the BML, which is what is done here with a
+ * few fragments in flight. The rail advertised as the fastest is in
+ * fact the slowest, so the static split by btl_bandwidth would put 99%
+ * of the data on it. The rails then swap their speeds, and the data has
+ * to move to the other one.
+ */
+
+#define NB_RAILS       2
+#define FRAG_SIZE      (16 * 1024)
+#define MAX_INFLIGHT   4
+#define PHASE_BYTES    ((size_t)48 * 1024 * 1024)
+#define MIN_FAST_SHARE 0.9
+
+typedef struct {
+    mca_bml_base_btl_t bml_btl;
+    mca_btl_base_module_t btl;
+    double usec_per_byte;              /**< actual speed */
+    opal_timer_t busy_until;           /**< completion of the last fragment queued */
+    opal_timer_t done[MAX_INFLIGHT];   /**< completion times of the fragments in flight, in order */
+    int first, count;
+    size_t bytes;                      /**< bytes sent in the current phase */
+} rail_t;
+
+static rail_t rails[NB_RAILS];
+
+static void rail_init(rail_t *rail, uint32_t advertised_mbps)
+{
+    memset(rail, 0, sizeof(*rail));
+    rail->btl.btl_bandwidth = advertised_mbps;
+    rail->bml_btl.btl = &rail->btl;
+    mca_bml_base_btl_adaptive_init(&rail->bml_btl);
+}
+
+static void rail_send(rail_t *rail, opal_timer_t now)
+{
+    opal_timer_t start = (rail->busy_until > now) ? rail->busy_until : now;
+
+    mca_bml_base_btl_sent(&rail->bml_btl, FRAG_SIZE);
+    rail->busy_until = start + (opal_timer_t)(FRAG_SIZE * rail->usec_per_byte);
+    rail->done[(rail->first + rail->count) % MAX_INFLIGHT] = rail->busy_until;
+    rail->count++;
+    rail->bytes += FRAG_SIZE;
+}
+
+/* complete the fragments due by now, return how many */
+static int rail_progress(rail_t *rail, opal_timer_t now)
+{
+    int completed = 0;
+
+    while(rail->count > 0 && rail->done[rail->first] <= now) {
+        mca_bml_base_btl_completed(&rail->bml_btl, FRAG_SIZE, false);
+        rail->first = (rail->first + 1) % MAX_INFLIGHT;
+        rail->count--;
+        completed++;
+    }
+    return completed;
+}
+
+/* send PHASE_BYTES, return the share of the given rail */
+static double run_phase(int fast)
+{
+    size_t sent = 0;
+    int inflight = 0, r, best;
+    double t, best_time;
+
+    for(r = 0; r < NB_RAILS; r++) {
+        rails[r].bytes = 0;
+    }
+    while(sent < PHASE_BYTES || inflight > 0) {
+        opal_timer_t now = opal_timer_base_get_usec();
+
+        for(r = 0; r < NB_RAILS; r++) {
+            inflight -= rail_progress(&rails[r], now);
+        }
+        if(sent >= PHASE_BYTES || inflight >= MAX_INFLIGHT) {
+            continue;
+        }
+
+        for(r = 0, best = 0, best_time = 0.0; r < NB_RAILS; r++) {
+            t = mca_bml_base_btl_completion_time(&rails[r].bml_btl, FRAG_SIZE);
+            if(0 == r || t < best_time) {
+                best_time = t;
+                best = r;
+            }
+        }
+        rail_send(&rails[best], now);
+        sent += FRAG_SIZE;
+        inflight++;
+    }
+
+    return (double)rails[fast].bytes / (double)sent;
+}
+
+int main(int argc, char* argv[])
+{
+    double share;
+    int errors = 0;
+
+    opal_init_util(&argc, &argv);
+
+    mca_bml_base_adaptive_striping = true;
+    mca_bml_base_adaptive_window = 2000;
+    mca_bml_base_adaptive_decay = 0.5;
+
+    /* rail 0 is advertised 100 times faster than rail 1, but it is 100
+     * times slower: 10 bytes/usec against 1000 */
+    rail_init(&rails[0], 8000);
+    rail_init(&rails[1], 80);
+    rails[0].usec_per_byte = 1.0 / 10.0;
+    rails[1].usec_per_byte = 1.0 / 1000.0;
+    share = run_phase(1);
+    printf("rail 1 (actually faster) got %.1f%% of the data\n", share * 100.0);
+    if(share < MIN_FAST_SHARE) {
+        errors++;
+    }
+
+    /* the rails swap their speeds */
+    rails[0].usec_per_byte = 1.0 / 1000.0;
+    rails[1].usec_per_byte = 1.0 / 10.0;
+    share = run_phase(0);
+    printf("rail 0 (now faster) got %.1f%% of the data\n", share * 100.0);
+    if(share < MIN_FAST_SHARE) {
+        errors++;
+    }
+
+    opal_finalize_util();
+
+    return (0 == errors) ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2020 The University of Tennessee and The University
+ *                    of Tennessee Research Foundation.  All rights
+ *                    reserved.
+ *
+ * Check the asynchronous progress thread (opal_progress_async) with an
+ * application that asked for MPI_THREAD_SINGLE.
+ *
+ * The thread level reported to the application has to stay
+ * MPI_THREAD_SINGLE. Every process then posts a receive from its left
+ * neighbour and a send to its right one, large enough for the rendezvous
+ * protocol, and waits for the data to land in the receive buffer without
+ * calling MPI: only the progress thread can move it. Last, the main
+ * thread runs blocking and nonblocking point-to-point and collective
+ * operations while the progress thread runs concurrently, which is only
+ * safe if the components were selected and initialized thread safe.
+ *
+ * It needs the progress thread, see async_progress.sh, e.g.:
+ *   mpirun -np 4 --mca opal_progress_async 1 ./async_progress
+ */
+
+#include "mpi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define DEFAULT_LEN      (1024 * 1024)
+#define DEFAULT_ITERS    200
+#define DEFAULT_TIMEOUT  10.0
+
+static int value_of(int sender, int i)
+{
+    return sender * 7 + i + 1;
+}
+
+/* check that a rendezvous completes while no MPI function is called */
+static int check_overlap(int len, double timeout, int rank, int size)
+{
+    int left = (rank + size - 1) % size, right = (rank + 1) % size;
+    int *sbuf, *rbuf, i, errors = 0;
+    volatile int *last;
+    MPI_Request reqs[2];
+    double start;
+
+    sbuf = (int*)malloc(len * sizeof(int));
+    rbuf = (int*)calloc(len, sizeof(int));
+    for(i = 0; i < len; i++) {
+        sbuf[i] = value_of(rank, i);
+    }
+
+    MPI_Irecv(rbuf, len, MPI_INT, left, 0, MPI_COMM_WORLD, &reqs[0]);
+    MPI_Isend(sbuf, len, MPI_INT, right, 0, MPI_COMM_WORLD, &reqs[1]);
+
+    last = &rbuf[len - 1];
+    start = MPI_Wtime();
+    while(value_of(left, len - 1) != *last) {
+        if(MPI_Wtime() - start > timeout) {
+            fprintf(stderr, "[%d] no data received from %d after %.0f seconds without MPI calls\n",
+                    rank, left, timeout);
+            errors = 1;
+            break;
+        }
+    }
+
+    MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+    for(i = 0; 0 == errors && i < len; i++) {
+        if(value_of(left, i) != rbuf[i]) {
+            fprintf(stderr, "[%d] wrong value at index %d: %d\n", rank, i, rbuf[i]);
+            errors = 1;
+        }
+    }
+
+    free(sbuf);
+    free(rbuf);
+    return errors;
+}
+
+/* run communications from the main thread while the progress thread runs */
+static int check_concurrent(int len, int iters, int rank, int size)
+{
+    int left = (rank + size - 1) % size, right = (rank + 1) % size;
+    int *sbuf, *rbuf, it, i, n, sum, errors = 0;
+    MPI_Request req;
+
+    sbuf = (int*)malloc(len * sizeof(int));
+    rbuf = (int*)malloc(len * sizeof(int));
+
+    for(it = 0; 0 == errors && it < iters; it++) {
+        /* alternate eager and rendezvous messages */
+        n = (0 == it % 2) ? 1 + it % 64 : len;
+        for(i = 0; i < n; i++) {
+            sbuf[i] = value_of(rank, i + it);
+        }
+        MPI_Sendrecv(sbuf, n, MPI_INT, right, it, rbuf, n, MPI_INT, left, it,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        for(i = 0; i < n; i++) {
+            if(value_of(left, i + it) != rbuf[i]) {
+                fprintf(stderr, "[%d] iteration %d: wrong value at index %d: %d\n",
+                        rank, it, i, rbuf[i]);
+                errors = 1;
+                break;
+            }
+        }
+
+        /* a nonblocking collective progressed by the thread only */
+        MPI_Iallreduce(&rank, &sum, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD, &req);
+        for(i = 0; i < 1000; i++) {
+            sbuf[i % len] += i;
+        }
+        MPI_Wait(&req, MPI_STATUS_IGNORE);
+        if(size * (size - 1) / 2 != sum) {
+            fprintf(stderr, "[%d] iteration %d: wrong sum %d\n", rank, it, sum);
+            errors = 1;
+        }
+
+        if(0 == it % 16) {
+            MPI_Barrier(MPI_COMM_WORLD);
+        }
+    }
+
+    free(sbuf);
+    free(rbuf);
+    return errors;
+}
+
+int main(int argc, char* argv[])
+{
+    int rank, size, opt, provided, len = DEFAULT_LEN, iters = DEFAULT_ITERS;
+    int errors = 0, total;
+    double timeout = DEFAULT_TIMEOUT;
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SINGLE, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    while(-1 != (opt = getopt(argc, argv, "l:i:w:"))) {
+        switch(opt) {
+        case 'l': len = atoi(optarg); break;
+        case 'i': iters = atoi(optarg); break;
+        case 'w': timeout = atof(optarg); break;
+        default:
+            if(0 == rank)
+                fprintf(stderr, "Usage: %s [-l len] [-i iterations] [-w timeout]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    if(MPI_THREAD_SINGLE != provided) {
+        fprintf(stderr, "[%d] MPI_THREAD_SINGLE requested, %d provided\n", rank, provided);
+        errors = 1;
+    }
+    errors += check_overlap(len, timeout, rank, size);
+    errors += check_concurrent(len, iters, rank, size);
+
+    MPI_Allreduce(&errors, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if(0 == rank) {
+        printf("%s\n", (0 == total) ? "OK" : "FAILED");
+    }
+
+    MPI_Finalize();
+    return (0 == total) ? 0 : 1;
+}
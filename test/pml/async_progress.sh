@@ -0,0 +1,30 @@
+#!/bin/sh
+
+#
+# Copyright (c) 2020 The University of Tennessee and The University
+#                    of Tennessee Research Foundation.  All rights
+#                    reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+#
+# Run async_progress, an MPI_THREAD_SINGLE application, with the
+# asynchronous progress thread spinning and sleeping when idle, with
+# eager and rendezvous sized messages. Extra arguments are passed to
+# mpiexec, e.g. a machine file.
+#
+
+np=${NP:-4}
+exe=./async_progress
+
+for idle in 0 50; do
+    for len in 1024 1048576; do
+        echo "opal_progress_async_idle=$idle, $len ints per message"
+        mpiexec -n $np "$@" --mca opal_progress_async 1 \
+                --mca opal_progress_async_idle $idle $exe -l $len || exit 1
+    done
+done
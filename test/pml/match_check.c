@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2020 The University of Tennessee and The University
+ *                    of Tennessee Research Foundation.  All rights
+ *                    reserved.
+ *
+ * Check the messages selected by the matching engine.
+ *
+ * Rank 0 receives, the other ranks send 'count' numbered messages each,
+ * cycling over a few tags of their own. Rank 0 mixes receives for a
+ * specific source and tag with MPI_ANY_SOURCE and MPI_ANY_TAG ones, in
+ * such a way that the non-overtaking rule leaves a single valid match
+ * for each receive: the i-th receive posted for a sender has to get the
+ * i-th message of that sender, whatever the wildcards used. Every phase
+ * is run twice: with the receives posted before the messages are sent
+ * (expected messages), and with the messages already queued when the
+ * receives are posted (unexpected messages).
+ *
+ * A last phase receives everything with MPI_ANY_SOURCE and MPI_ANY_TAG
+ * and checks that the messages of each sender come in order.
+ *
+ * With -t, the senders are also split between that many threads of rank
+ * 0, which post and complete their receives while the messages arrive.
+ * Only the thread of a sender can match its messages, the ordering is the
+ * same as with a single thread, but the receives of several peers and the
+ * wildcard ones are matched concurrently (partitioned matching).
+ *
+ * Run it against each engine, see match_check.sh, e.g.:
+ *   mpirun -np 4 --mca pml ob1 --mca pml_ob1_matching_engine vector ./match_check
+ *   mpirun -np 4 --mca pml ob1 --mca pml_ob1_partitioned_matching 1 ./match_check -t 3
+ */
+
+#include "mpi.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define DEFAULT_COUNT  100
+#define DEFAULT_LEN    4
+#define TAG_DONE       1
+#define TAG_STRIDE     16
+#define NTAGS          7
+
+/* receive kinds, as bits */
+#define ANY_SOURCE     1
+#define ANY_TAG        2
+
+static int tag_of(int sender, int i)
+{
+    return sender * TAG_STRIDE + i % NTAGS;
+}
+
+static void fill(int *buf, int len, int seq)
+{
+    int j;
+
+    for(j = 0; j < len; j++) {
+        buf[j] = seq * 31 + j;
+    }
+}
+
+static int check_message(const char *phase, int *buf, MPI_Status *status, int len,
+                         int sender, int seq)
+{
+    int j, count;
+
+    MPI_Get_count(status, MPI_INT, &count);
+    if(status->MPI_SOURCE != sender || status->MPI_TAG != tag_of(sender, seq) || count != len) {
+        fprintf(stderr, "%s: expected message %d of %d (tag %d, %d ints), got source %d tag %d, %d ints\n",
+                phase, seq, sender, tag_of(sender, seq), len, status->MPI_SOURCE, status->MPI_TAG, count);
+        return 1;
+    }
+    for(j = 0; j < len; j++) {
+        if(buf[j] != seq * 31 + j) {
+            fprintf(stderr, "%s: message %d of %d carries message %d\n",
+                    phase, seq, sender, (buf[0] - j) / 31);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Send 'count' messages to rank 0, followed by a TAG_DONE message when
+ * the receives are posted afterwards.
+ */
+static void send_messages(MPI_Comm comm, int rank, int count, int len, int unexpected)
+{
+    MPI_Request *reqs;
+    int *buf, i;
+
+    buf = (int*)malloc((size_t)count * len * sizeof(int));
+    reqs = (MPI_Request*)malloc((count + 1) * sizeof(MPI_Request));
+    for(i = 0; i < count; i++) {
+        fill(buf + (size_t)i * len, len, i);
+        MPI_Isend(buf + (size_t)i * len, len, MPI_INT, 0, tag_of(rank, i), comm, &reqs[i]);
+    }
+    if(unexpected) {
+        MPI_Isend(NULL, 0, MPI_INT, 0, TAG_DONE, comm, &reqs[count]);
+    } else {
+        reqs[count] = MPI_REQUEST_NULL;
+    }
+    MPI_Waitall(count + 1, reqs, MPI_STATUSES_IGNORE);
+    free(reqs);
+    free(buf);
+}
+
+/*
+ * The TAG_DONE message is matched after all the messages sent before
+ * it, which are then in the unexpected queue.
+ */
+static void wait_unexpected(MPI_Comm comm, int first, int last)
+{
+    int s;
+
+    for(s = first; s <= last; s++) {
+        MPI_Recv(NULL, 0, MPI_INT, s, TAG_DONE, comm, MPI_STATUS_IGNORE);
+    }
+}
+
+/*
+ * Receive the messages of senders first to last, posting the i-th
+ * receive of every sender before the (i+1)-th. 'kinds' is the number of
+ * receive kinds cycled through: with more than one sender MPI_ANY_TAG
+ * must come with a specific source, so only 3 kinds are used. Expected
+ * messages are only sent once the receives are posted when 'sync' is set.
+ */
+static int receive_messages(const char *phase, MPI_Comm comm, int first, int last,
+                            int count, int len, int kinds, int unexpected, int sync)
+{
+    int nsenders = last - first + 1, *buf, i, s, n, kind, src, tag, errors = 0;
+    MPI_Request *reqs;
+    MPI_Status *statuses;
+
+    buf = (int*)malloc((size_t)nsenders * count * len * sizeof(int));
+    reqs = (MPI_Request*)malloc((size_t)nsenders * count * sizeof(MPI_Request));
+    statuses = (MPI_Status*)malloc((size_t)nsenders * count * sizeof(MPI_Status));
+
+    if(unexpected) {
+        wait_unexpected(comm, first, last);
+    }
+    for(i = 0, n = 0; i < count; i++) {
+        for(s = first; s <= last; s++, n++) {
+            kind = (i + s) % kinds;
+            src = (kind & ANY_SOURCE) ? MPI_ANY_SOURCE : s;
+            tag = (kind & ANY_TAG) ? MPI_ANY_TAG : tag_of(s, i);
+            MPI_Irecv(buf + (size_t)n * len, len, MPI_INT, src, tag, comm, &reqs[n]);
+        }
+    }
+    if(!unexpected && sync) {
+        MPI_Barrier(comm);
+    }
+    MPI_Waitall(nsenders * count, reqs, statuses);
+
+    for(i = 0, n = 0; i < count; i++) {
+        for(s = first; s <= last; s++, n++) {
+            if(errors < 10) {
+                errors += check_message(phase, buf + (size_t)n * len, &statuses[n], len, s, i);
+            }
+        }
+    }
+
+    free(statuses);
+    free(reqs);
+    free(buf);
+    return errors;
+}
+
+/*
+ * Receive everything with MPI_ANY_SOURCE and MPI_ANY_TAG. The messages
+ * of each sender have to complete the receives in the order they were
+ * posted.
+ */
+static int receive_any(const char *phase, MPI_Comm comm, int nsenders, int count, int len,
+                       int unexpected)
+{
+    int total = nsenders * count, *buf, *next, n, s, errors = 0;
+    MPI_Request *reqs;
+    MPI_Status *statuses;
+
+    buf = (int*)malloc((size_t)total * len * sizeof(int));
+    next = (int*)calloc(nsenders + 1, sizeof(int));
+    reqs = (MPI_Request*)malloc(total * sizeof(MPI_Request));
+    statuses = (MPI_Status*)malloc(total * sizeof(MPI_Status));
+
+    if(unexpected) {
+        wait_unexpected(comm, 1, nsenders);
+    }
+    for(n = 0; n < total; n++) {
+        MPI_Irecv(buf + (size_t)n * len, len, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &reqs[n]);
+    }
+    if(!unexpected) {
+        MPI_Barrier(comm);
+    }
+    MPI_Waitall(total, reqs, statuses);
+
+    for(n = 0; n < total && errors < 10; n++) {
+        s = statuses[n].MPI_SOURCE;
+        if(s < 1 || s > nsenders) {
+            fprintf(stderr, "%s: receive %d completed from source %d\n", phase, n, s);
+            errors++;
+            continue;
+        }
+        errors += check_message(phase, buf + (size_t)n * len, &statuses[n], len, s, next[s]++);
+    }
+
+    free(statuses);
+    free(reqs);
+    free(next);
+    free(buf);
+    return errors;
+}
+
+typedef struct {
+    const char *phase;
+    MPI_Comm comm;
+    int first, last, count, len, unexpected;
+    int errors;
+} receiver_t;
+
+static void *receiver_thread(void *arg)
+{
+    receiver_t *recv = (receiver_t*)arg;
+
+    recv->errors = receive_messages(recv->phase, recv->comm, recv->first, recv->last,
+                                    recv->count, recv->len, 3, recv->unexpected, 0);
+    return NULL;
+}
+
+/* split the senders between nthreads threads */
+static int receive_threaded(const char *phase, MPI_Comm comm, int nsenders, int nthreads,
+                            int count, int len, int unexpected)
+{
+    receiver_t *recvs;
+    pthread_t *threads;
+    int t, errors = 0;
+
+    if(nthreads > nsenders) {
+        nthreads = nsenders;
+    }
+    recvs = (receiver_t*)calloc(nthreads, sizeof(receiver_t));
+    threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+    for(t = 0; t < nthreads; t++) {
+        recvs[t].phase = phase;
+        recvs[t].comm = comm;
+        recvs[t].first = 1 + t * nsenders / nthreads;
+        recvs[t].last = (t + 1) * nsenders / nthreads;
+        recvs[t].count = count;
+        recvs[t].len = len;
+        recvs[t].unexpected = unexpected;
+        pthread_create(&threads[t], NULL, receiver_thread, &recvs[t]);
+    }
+    for(t = 0; t < nthreads; t++) {
+        pthread_join(threads[t], NULL);
+        errors += recvs[t].errors;
+    }
+
+    free(threads);
+    free(recvs);
+    return errors;
+}
+
+int main(int argc, char* argv[])
+{
+    int rank, size, opt, count = DEFAULT_COUNT, len = DEFAULT_LEN, nthreads = 0;
+    int unexpected, provided, errors = 0, total;
+    const char *mode;
+    char phase[64];
+    MPI_Comm comm;
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    while(-1 != (opt = getopt(argc, argv, "n:l:t:"))) {
+        switch(opt) {
+        case 'n': count = atoi(optarg); break;
+        case 'l': len = atoi(optarg); break;
+        case 't': nthreads = atoi(optarg); break;
+        default:
+            if(0 == rank)
+                fprintf(stderr, "Usage: %s [-n messages per sender] [-l ints per message] [-t receiving threads]\n",
+                        argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    if(size < 2) {
+        fprintf(stderr, "%s needs at least 2 processes\n", argv[0]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if(nthreads > 0 && MPI_THREAD_MULTIPLE != provided) {
+        if(0 == rank)
+            fprintf(stderr, "%s: -t needs MPI_THREAD_MULTIPLE\n", argv[0]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+
+    for(unexpected = 0; unexpected < 2; unexpected++) {
+        mode = unexpected ? "unexpected" : "expected";
+
+        /* a single sender: any mix of wildcards */
+        snprintf(phase, sizeof(phase), "%s, one sender", mode);
+        if(0 == rank) {
+            errors += receive_messages(phase, comm, 1, 1, count, len, 4, unexpected, 1);
+        } else if(1 == rank) {
+            if(!unexpected) MPI_Barrier(comm);
+            send_messages(comm, rank, count, len, unexpected);
+        } else if(!unexpected) {
+            MPI_Barrier(comm);
+        }
+        MPI_Barrier(comm);
+
+        /* all senders at once */
+        snprintf(phase, sizeof(phase), "%s, all senders", mode);
+        if(0 == rank) {
+            errors += receive_messages(phase, comm, 1, size - 1, count, len, 3, unexpected, 1);
+        } else {
+            if(!unexpected) MPI_Barrier(comm);
+            send_messages(comm, rank, count, len, unexpected);
+        }
+        MPI_Barrier(comm);
+
+        snprintf(phase, sizeof(phase), "%s, any source and tag", mode);
+        if(0 == rank) {
+            errors += receive_any(phase, comm, size - 1, count, len, unexpected);
+        } else {
+            if(!unexpected) MPI_Barrier(comm);
+            send_messages(comm, rank, count, len, unexpected);
+        }
+        MPI_Barrier(comm);
+
+        if(nthreads > 0) {
+            /* the expected messages are sent right away, racing with the receives */
+            snprintf(phase, sizeof(phase), "%s, %d receiving threads", mode, nthreads);
+            if(0 == rank) {
+                errors += receive_threaded(phase, comm, size - 1, nthreads, count, len, unexpected);
+            } else {
+                send_messages(comm, rank, count, len, unexpected);
+            }
+            MPI_Barrier(comm);
+        }
+    }
+
+    MPI_Allreduce(&errors, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if(0 == rank) {
+        printf("%s\n", (0 == total) ? "OK" : "FAILED");
+    }
+
+    MPI_Comm_free(&comm);
+    MPI_Finalize();
+    return (0 == total) ? 0 : 1;
+}
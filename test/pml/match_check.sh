@@ -0,0 +1,33 @@
+#!/bin/sh
+
+#
+# Copyright (c) 2020 The University of Tennessee and The University
+#                    of Tennessee Research Foundation.  All rights
+#                    reserved.
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+#
+# Run match_check with each ob1 matching engine, with eager messages and
+# with messages large enough for the rendezvous protocol, and with 3
+# receiving threads with and without partitioned matching. Extra
+# arguments are passed to mpiexec, e.g. a machine file.
+#
+
+np=${NP:-4}
+exe=./match_check
+
+for engine in list vector; do
+    for partitioned in 0 1; do
+        for len in 4 16384; do
+            echo "pml_ob1_matching_engine=$engine pml_ob1_partitioned_matching=$partitioned, $len ints per message"
+            mpiexec -n $np "$@" --mca pml ob1 \
+                    --mca pml_ob1_matching_engine $engine \
+                    --mca pml_ob1_partitioned_matching $partitioned $exe -l $len -t 3 || exit 1
+        done
+    done
+done
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020 The University of Tennessee and The University
+ *                    of Tennessee Research Foundation.  All rights
+ *                    reserved.
+ *
+ * Cost of matching an incoming message as a function of the number of
+ * receives already posted for its peer.
+ *
+ * Each process posts 'depth' receives that will never match on
+ * MPI_COMM_SELF, then repeatedly posts one more receive and sends the
+ * message it expects to itself. The matching engine has to skip all
+ * the receives posted before to find it. The time per message is
+ * reported for each depth, together with the difference to an empty
+ * queue, which is the cost of the scan.
+ *
+ * Compare the engines with:
+ *   mpirun -np 1 --mca pml ob1 --mca btl self --mca pml_ob1_matching_engine list ./match_depth
+ *   mpirun -np 1 --mca pml ob1 --mca btl self --mca pml_ob1_matching_engine vector ./match_depth
+ */
+
+#include "mpi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define DEFAULT_MAX_DEPTH  16384
+#define DEFAULT_ITERATIONS 10000
+#define WARMUP             100
+
+static double match_time(int depth, int iterations)
+{
+    MPI_Request *reqs, req;
+    int i, data = 0;
+    double start;
+
+    reqs = (MPI_Request*)malloc((depth + 1) * sizeof(MPI_Request));
+    for(i = 0; i < depth; i++) {
+        MPI_Irecv(NULL, 0, MPI_INT, 0, i + 1, MPI_COMM_SELF, &reqs[i]);
+    }
+
+    for(i = 0; i < WARMUP + iterations; i++) {
+        if(WARMUP == i) {
+            start = MPI_Wtime();
+        }
+        MPI_Irecv(&data, 1, MPI_INT, 0, 0, MPI_COMM_SELF, &req);
+        MPI_Send(&data, 1, MPI_INT, 0, 0, MPI_COMM_SELF);
+        MPI_Wait(&req, MPI_STATUS_IGNORE);
+    }
+    start = MPI_Wtime() - start;
+
+    for(i = 0; i < depth; i++) {
+        MPI_Cancel(&reqs[i]);
+        MPI_Wait(&reqs[i], MPI_STATUS_IGNORE);
+    }
+    free(reqs);
+
+    return start * 1e6 / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    int rank, depth, opt, max_depth = DEFAULT_MAX_DEPTH, iterations = DEFAULT_ITERATIONS;
+    double base, t;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    while(-1 != (opt = getopt(argc, argv, "d:n:"))) {
+        switch(opt) {
+        case 'd': max_depth = atoi(optarg); break;
+        case 'n': iterations = atoi(optarg); break;
+        default:
+            if(0 == rank)
+                fprintf(stderr, "Usage: %s [-d max_depth] [-n iterations]\n", argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    if(0 == rank) {
+        printf("# %10s %16s %16s\n", "depth", "usec/msg", "scan usec/msg");
+    }
+    base = match_time(0, iterations);
+    for(depth = 0; depth <= max_depth; depth = (depth ? 2 * depth : 1)) {
+        t = match_time(depth, iterations);
+        if(0 == rank) {
+            printf("  %10d %16.3f %16.3f\n", depth, t, t - base);
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}